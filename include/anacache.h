@@ -0,0 +1,59 @@
+#ifndef ANACACHE_H_
+#define ANACACHE_H_
+
+// Incremental analysis.
+// What the type checker and the dataflow checks found in each function is
+// kept under a key made of
+//  - the function's name,
+//  - a hash of its body: node kinds, names, literals and operators, with
+//    positions relative to the declaration so moving it does not count,
+//  - a hash of the signatures of the globals, functions and types it names,
+//    and of the values of the global constants among them.
+// A function whose key is unchanged on the next run is not checked again,
+// see FuncDecl.cached: the type of each of its nodes and locals is put
+// back, and its diagnostics are replayed at its current position. Every
+// pass after that sees it like any other function: the output is the same
+// with or without the cache, but for the count of types built, as a type
+// the checker only needed along the way is not made again.
+// The cache lives in memory and can be saved to a file between runs.
+
+#include "ast.h"
+#include "diag.h"
+#include "typecheck.h"
+
+typedef struct
+{
+    unsigned long long body;
+    unsigned long long deps;
+    int line;           // where the declaration starts
+    int last_line;      // the last line any of its nodes is on
+} anacache_key_t;
+
+typedef struct anacache_t anacache_t;
+
+anacache_t* anacache_create(void);
+void anacache_destroy(anacache_t* cache);
+
+// read and write the cache file, 0 on success
+int anacache_load(anacache_t* cache, const char* path);
+int anacache_save(const anacache_t* cache, const char* path);
+
+// hash the global constants' values, after typecheck_declarations and
+// before the first key of a run
+void anacache_begin(anacache_t* cache, typecheck_t* tc, ASTNode* prog);
+
+// the key of a top-level function, after anacache_begin
+anacache_key_t anacache_key(anacache_t* cache, typecheck_t* tc, ASTNode* fn);
+
+// on a hit, give the function's nodes and locals their types through tc,
+// append its diagnostics to diags and return 1
+int anacache_lookup(anacache_t* cache, typecheck_t* tc, ASTNode* fn, anacache_key_t key, diag_list_t* diags);
+
+// keep the types of a checked function and its diagnostics, those in
+// diags within it
+void anacache_store(anacache_t* cache, typecheck_t* tc, ASTNode* fn, anacache_key_t key, const diag_list_t* diags);
+
+int anacache_hits(const anacache_t* cache);
+int anacache_misses(const anacache_t* cache);
+
+#endif
@@ -2,31 +2,21 @@
 #define ANALYSIS_H_
 
 #include "ast.h"
-
-void start_analysis(ASTNode* prog);
-
-// type checking
-void check_types(ASTNode* node);
-void type_errors(char* type_error_list);
-
-// array checking
-void array_analyse(ASTNode* array);
-
-// function analysis
-void function_analyse(ASTNode* function);
-
-// conditionals
-void if_analyse(ASTNode* if_condition);
-void match_analyse(ASTNode* matchstmt);
-
-// iteration
-void loop_analyse(ASTNode* loops);
-
-// expression
-void expr_analyse(ASTNode* expr);
-void decl_analyse(ASTNode* decl);
-
-
-void analyse_node(ASTNode* node);
+#include "symtab.h"
+
+// Semantic analysis of a parsed program: runs the type checker, see
+// typecheck.h, and the dataflow checks, see dataflow.h, and prints its diagnostics in source order.
+// Function bodies are checked by up to threads workers, 0 for one per
+// CPU; the output does not depend on the count.
+// With a cache, see anacache.h, functions unchanged since it was filled
+// are neither type checked nor run through the dataflow checks again:
+// their types are restored and their diagnostics replayed; it may be NULL.
+// With graph, the call graph of the program as written, before folding,
+// is handed back for the caller to destroy; it may be NULL.
+// Returns the number of errors found.
+struct anacache_t;
+struct callgraph_t;
+int start_analysis(ASTNode* prog, symtab_t* table, int threads, struct anacache_t* cache,
+                   struct callgraph_t** graph);
 
 #endif
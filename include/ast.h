@@ -35,7 +35,8 @@ typedef enum
     AST_MATCH_CASE,
     AST_LOOP,
     AST_LOOP_EXPR,
-    AST_RETURN
+    AST_RETURN,
+    AST_IMPORT
 } ASTNodeType;
 
 void astnodetype_to_string(ASTNodeType type);
@@ -52,6 +53,7 @@ typedef struct
     ASTNode* left;
     Token* op;
     ASTNode* right;
+    int storage;        // where a str result lives, storage_t, see escape.h
 } BinaryExpr;
 
 typedef struct 
@@ -59,12 +61,14 @@ typedef struct
     Token* name;
     Token* op;
     ASTNode* value;
+    struct sym_entry_t* sym;    // the target, resolved by the parser
 } AssignExpr;
 
 typedef struct 
 {
     ASTNode* base;
     ASTNode* index;
+    int in_bounds;      // proven by the bounds pass, needs no check
 } Index;
 
 typedef struct 
@@ -72,6 +76,7 @@ typedef struct
     ASTNode* callee;    // an identifier
     ASTNode** args;     // dynamic array
     int arg_count;
+    int storage;        // where an aggregate result lives, storage_t, see escape.h
 } FnCall;
 
 typedef struct 
@@ -85,12 +90,14 @@ typedef struct
 typedef struct
 {                             
     char* name; // array of 64 characters max
+    struct sym_entry_t* sym;    // resolved by the parser, NULL if undefined
 } Identifier;
 
 // Literal token char, int, float, string etc.
 typedef struct
 {
     char* value;
+    TokenType kind;     // INT_LITERAL, STRING_LITERAL, ...
 } Literal;
 
 // variable and constant declarations
@@ -110,6 +117,7 @@ typedef struct
     Token* return_type;
     ASTNode* block;
     ASTNode* return_stmt;  // work with return statements
+    int cached;            // types and diagnostics restored from the analysis cache, see anacache.h
 }  FuncDecl;
 
 typedef struct
@@ -117,6 +125,12 @@ typedef struct
     ASTNode* expr;
 } ReturnStmt;
 
+// import module -> names come from module.pni, see iface.h
+typedef struct
+{
+    Token* module;
+} ImportStmt;
+
 typedef struct
 {
     ASTNode* ident;
@@ -151,6 +165,7 @@ typedef struct
     ASTNode** match_cases;
     size_t case_count;
     ASTNode* def_case;
+    struct match_plan_t* plan;  // decision tree, set by match_program, see match.h
 } MatchStmt;
 
 typedef struct
@@ -163,6 +178,7 @@ typedef struct
 {
     ASTNode* variable;
     ASTNode* expr;
+    long long trip_count;   // iterations of a constant range, -1 if unknown
 } LoopExpr;
 
 typedef struct
@@ -209,6 +225,7 @@ struct ASTNode
 {
     ASTNodeType type;
     SourceLocation location;
+    const struct type_t* ty;    // set by the type checker, see types.h
     union
     {
         Identifier ident;
@@ -235,6 +252,7 @@ struct ASTNode
         Struct structType;
         Union unionType;
         ReturnStmt return_stmt;
+        ImportStmt import;
     } as;
 };
 
@@ -265,6 +283,7 @@ ASTNode* ast_fn_decl(ASTNode* ident,
 
 ASTNode* ast_block(ASTNode** statements, size_t count);
 ASTNode* ast_return_stmt(ASTNode* expr);
+ASTNode* ast_import(Token* module);
 ASTNode* ast_if(ASTNode* condition,
                 ASTNode* then_branch,
                 ASTNode* else_branch);
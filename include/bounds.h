@@ -0,0 +1,28 @@
+#ifndef BOUNDS_H_
+#define BOUNDS_H_
+
+// Bounds-check elimination.
+// An interval abstract interpretation of each function body, run after
+// constant folding. Every integer local and parameter holds a range of
+// possible values: range loops bound their variable, comparisons narrow
+// the branches they guard, and a loop body is re-run until its variables
+// settle, widening the ones that keep growing. An AST_INDEX whose index
+// lies within its array's length is marked in_bounds and needs no check
+// at run time; one that can never be in bounds is reported.
+
+#include "ast.h"
+#include "diag.h"
+#include "symtab.h"
+
+#define BOUNDS_WIDEN_AFTER 2    // loop passes before growing bounds are widened
+
+typedef struct
+{
+    long long low;
+    long long high;     // inclusive
+} interval_t;
+
+// mark the indices of every function, returns how many were proven
+int bounds_program(ASTNode* prog, symtab_t* table, diag_list_t* diags);
+
+#endif
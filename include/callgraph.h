@@ -0,0 +1,65 @@
+#ifndef CALLGRAPH_H_
+#define CALLGRAPH_H_
+
+// Whole-program call graph.
+// One node per function symbol, including functions imported from a
+// module interface, and one edge per distinct caller/callee pair, taken
+// from the AST_FN_CALL nodes the parser resolved. Calls made while
+// initializing globals have no caller and add no edge.
+//
+// Strongly connected components are found with Tarjan's algorithm and
+// kept bottom-up: every SCC comes after the SCCs it calls, so an
+// interprocedural pass that walks them in order sees callees first.
+// SCCs with the same level do not call one another and can be processed
+// at the same time.
+
+#include <stdio.h>
+
+#include "ast.h"
+#include "symtab.h"
+
+typedef struct
+{
+    sym_entry_t* sym;
+    ASTNode* decl;      // NULL for imported functions
+    int scc;
+} callgraph_node_t;
+
+typedef struct callgraph_t
+{
+    callgraph_node_t* nodes;
+    int count;
+    int capacity;
+
+    // callees of node n are callees[callee_start[n] .. callee_start[n+1]],
+    // callers likewise
+    int* callees;
+    int* callee_start;
+    int* callers;
+    int* caller_start;
+    int edge_count;
+
+    // members of SCC s are scc_members[scc_start[s] .. scc_start[s+1]]
+    int* scc_members;
+    int* scc_start;
+    int* scc_level;     // 0 when it calls nothing outside itself
+    int scc_count;
+
+    int* node_of;       // by symbol index, -1 for symbols that are not nodes
+    unsigned int sym_count;
+} callgraph_t;
+
+callgraph_t* callgraph_build(ASTNode* prog, symtab_t* table);
+void callgraph_destroy(callgraph_t* cg);
+
+// the node of a function symbol, -1 if it has none
+int callgraph_node(const callgraph_t* cg, sym_entry_t* fn);
+
+// 1 if the node can reach itself: a cycle, or a call to itself
+int callgraph_is_recursive(const callgraph_t* cg, int node);
+
+// Graphviz: one cluster per recursive SCC, labelled with its level
+void callgraph_write_dot(const callgraph_t* cg, FILE* out);
+void callgraph_print_stats(const callgraph_t* cg);
+
+#endif
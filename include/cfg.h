@@ -0,0 +1,57 @@
+#ifndef CFG_H_
+#define CFG_H_
+
+// Control flow graph of a function body.
+// Straight-line statements are grouped into basic blocks, split at the
+// branches the language has: if, match, loop and return. A block holds
+// the nodes it evaluates in order: declarations, expression statements,
+// returns, and the conditions of the branch that ends it. A counted loop
+// evaluates its range once before the loop and leaves its AST_LOOP_EXPR
+// in the header, where the variable takes its next value.
+// Each block has at most two successors: a match tests its cases one by
+// one, so it becomes a chain of two-way branches.
+
+#include "ast.h"
+
+#define CFG_ENTRY 0
+#define CFG_EXIT  1
+
+typedef struct
+{
+    ASTNode** items;    // in evaluation order
+    int count;
+    int capacity;
+    int succ[2];
+    int succ_count;
+} cfg_block_t;
+
+typedef struct
+{
+    ASTNode* fn;
+    cfg_block_t* blocks;    // CFG_ENTRY and CFG_EXIT come first
+    int count;
+    int capacity;
+    int end;                // where control runs off the end of the body
+
+    // predecessors of block b are preds[pred_start[b] .. pred_start[b+1]]
+    int* preds;
+    int* pred_start;
+
+    // blocks reachable from the entry in reverse postorder, and the
+    // position of each block in it, -1 when unreachable
+    int* rpo;
+    int rpo_count;
+    int* rpo_index;
+
+    // functions declared inside the body, they get graphs of their own
+    ASTNode** nested;
+    int nested_count;
+    int nested_capacity;
+} cfg_t;
+
+cfg_t* cfg_build(ASTNode* fn);
+void cfg_destroy(cfg_t* cfg);
+
+void cfg_print(cfg_t* cfg);
+
+#endif
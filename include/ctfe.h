@@ -0,0 +1,37 @@
+#ifndef CTFE_H_
+#define CTFE_H_
+
+// Compile-time function evaluation.
+// A small interpreter over the typed AST, used by constant folding to
+// replace a call such as process_data(5) by its result. Only functions
+// whose summary is pure are run, see effects.h. Each evaluation is
+// bounded by a step count, a call depth and the memory it may hold, and
+// results are memoized by (function, arguments).
+
+#include "ast.h"
+#include "diag.h"
+#include "effects.h"
+#include "fold.h"
+#include "typecheck.h"
+
+#define CTFE_MAX_STEPS  1000000
+#define CTFE_MAX_DEPTH  256
+#define CTFE_MAX_MEMORY (1 << 20)   // bytes of frames and strings
+
+typedef struct ctfe_t ctfe_t;
+
+ctfe_t* ctfe_create(typecheck_t* tc, const effects_t* effects, diag_list_t* diags);
+void ctfe_destroy(ctfe_t* ctfe);
+
+// 1 if the function only depends on its arguments
+int ctfe_is_pure(ctfe_t* ctfe, sym_entry_t* fn);
+
+// evaluate call if its callee is pure and every argument is a literal.
+// Returns 1 and the result in out on success.
+int ctfe_fold_call(ctfe_t* ctfe, ASTNode* call, const_value_t* out);
+
+// calls evaluated and calls answered from the memo table
+int ctfe_evaluated(const ctfe_t* ctfe);
+int ctfe_memo_hits(const ctfe_t* ctfe);
+
+#endif
@@ -0,0 +1,95 @@
+#ifndef DATAFLOW_H_
+#define DATAFLOW_H_
+
+// Iterative dataflow analysis over a function's CFG, see cfg.h.
+// A problem is a direction, a meet and a gen/kill pair per block over
+// dense bit sets, so every block transfer is out = gen | (in & ~kill),
+// a few word operations. The solver visits blocks in reverse postorder
+// (postorder for backward problems) and only revisits a block when
+// something it depends on changed, so it settles in a handful of passes.
+//
+// The checks built on it run per function, on the locals it declares:
+//  - definite assignment: a read of a variable no path has assigned
+//  - liveness:            a store nobody reads afterwards
+//  - reaching definitions: which stores a read may see
+//  - missing return:       a function with a result whose body can end
+//                          without returning, e.g. an if without else
+// Locals that are never read at all are found by the symbol table as
+// their scope closes, see sym_usage_t.
+
+#include "ast.h"
+#include "cfg.h"
+#include "diag.h"
+#include "symtab.h"
+
+typedef unsigned long long bitword_t;
+
+#define BITWORD_BITS    64
+#define BITSET_WORDS(n) (((n) + BITWORD_BITS - 1) / BITWORD_BITS)
+
+static inline void bitset_set(bitword_t* set, int bit)
+{
+    set[bit / BITWORD_BITS] |= 1ULL << (bit % BITWORD_BITS);
+}
+
+static inline void bitset_clear(bitword_t* set, int bit)
+{
+    set[bit / BITWORD_BITS] &= ~(1ULL << (bit % BITWORD_BITS));
+}
+
+static inline int bitset_test(const bitword_t* set, int bit)
+{
+    return (set[bit / BITWORD_BITS] >> (bit % BITWORD_BITS)) & 1;
+}
+
+typedef enum
+{
+    DF_FORWARD,
+    DF_BACKWARD
+} df_direction_t;
+
+typedef enum
+{
+    DF_UNION,       // may: true on some path
+    DF_INTERSECT    // must: true on every path
+} df_meet_t;
+
+// Per-block sets are rows of one array: row b starts at b * words.
+// in and out are relative to execution order, also for backward problems.
+typedef struct
+{
+    df_direction_t direction;
+    df_meet_t meet;
+    int bits;
+    int words;
+    int blocks;
+
+    bitword_t* gen;
+    bitword_t* kill;
+    bitword_t* in;
+    bitword_t* out;
+    bitword_t* boundary;    // in of the entry, or out of the exit
+} df_problem_t;
+
+void df_problem_init(df_problem_t* p, const cfg_t* cfg, df_direction_t direction, df_meet_t meet, int bits);
+void df_problem_free(df_problem_t* p);
+
+static inline bitword_t* df_row(const df_problem_t* p, bitword_t* sets, int block)
+{
+    return sets + (size_t)block * p->words;
+}
+
+// solve to the fixed point, returns the number of block transfers
+int df_solve(df_problem_t* p, const cfg_t* cfg);
+
+// Per-thread state for checking functions: a map from symbol index to the
+// function's local variables, sized for the whole table once.
+typedef struct dataflow_t dataflow_t;
+
+dataflow_t* dataflow_create(symtab_t* table);
+void dataflow_destroy(dataflow_t* df);
+
+// run every check on fn and the functions declared inside it
+void dataflow_check_function(dataflow_t* df, ASTNode* fn, diag_list_t* diags);
+
+#endif
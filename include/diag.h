@@ -0,0 +1,47 @@
+#ifndef DIAG_H_
+#define DIAG_H_
+
+// Diagnostics collected by the analysis passes.
+// Passes append to a list instead of printing straight away, so the
+// messages can be sorted into source order before they are shown.
+
+#include "token.h"
+
+typedef enum
+{
+    DIAG_ERROR,
+    DIAG_WARNING,
+    DIAG_NOTE
+} diag_severity_t;
+
+typedef struct
+{
+    int line;
+    int column;
+    diag_severity_t severity;
+    char* message;
+} diag_t;
+
+typedef struct
+{
+    diag_t* items;
+    int count;
+    int capacity;
+    int errors;
+} diag_list_t;
+
+void diag_init(diag_list_t* list);
+void diag_free(diag_list_t* list);
+
+void diag_error(diag_list_t* list, SourceLocation loc, const char* fmt, ...);
+void diag_warning(diag_list_t* list, SourceLocation loc, const char* fmt, ...);
+void diag_report(diag_list_t* list, diag_severity_t severity, SourceLocation loc, const char* fmt, ...);
+
+// append every entry of from, leaving from empty
+void diag_merge(diag_list_t* into, diag_list_t* from);
+
+// stable sort by line and column
+void diag_sort(diag_list_t* list);
+void diag_print(diag_list_t* list);
+
+#endif
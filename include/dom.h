@@ -0,0 +1,53 @@
+#ifndef DOM_H_
+#define DOM_H_
+
+// Dominators of an IR function, after Cooper, Harvey and Kennedy, "A
+// Simple, Fast Dominance Algorithm": immediate dominators are found by
+// intersecting the dominators of the predecessors, walking the blocks in
+// reverse postorder until nothing changes. The dominator tree is numbered
+// in preorder so one dominance query is two compares, and the dominance
+// frontier of each block is collected from the joins upwards. Blocks the
+// entry cannot reach have no dominator and dominate nothing.
+//
+// dom_get caches the result on the function; anything that changes the
+// CFG drops it, see ir_invalidate.
+
+#include "ir.h"
+
+typedef struct dom_t
+{
+    int block_count;
+
+    ir_block_t** rpo;           // the reachable blocks in reverse postorder
+    int rpo_count;
+
+    // by block id
+    int* order;                 // position in rpo, -1 when unreachable
+    ir_block_t** idom;          // NULL for the entry and unreachable blocks
+    int* enter;                 // preorder interval in the dominator tree
+    int* leave;
+
+    // children of block id i in the dominator tree, and its frontier, are
+    // children[child_start[i] .. child_start[i + 1]) and likewise for front
+    int* child_start;
+    ir_block_t** children;
+    int* front_start;
+    ir_block_t** front;
+} dom_t;
+
+dom_t* dom_compute(const ir_func_t* fn);
+void dom_destroy(dom_t* dom);
+
+// computed once and kept on fn until the CFG changes
+const dom_t* dom_get(ir_func_t* fn);
+
+int dom_reachable(const dom_t* dom, const ir_block_t* b);
+
+// a dominates b, every block dominates itself
+int dom_dominates(const dom_t* dom, const ir_block_t* a, const ir_block_t* b);
+
+ir_block_t* dom_idom(const dom_t* dom, const ir_block_t* b);
+ir_block_t** dom_children(const dom_t* dom, const ir_block_t* b, int* count);
+ir_block_t** dom_frontier(const dom_t* dom, const ir_block_t* b, int* count);
+
+#endif
@@ -0,0 +1,51 @@
+#ifndef EFFECTS_H_
+#define EFFECTS_H_
+
+// Interprocedural side-effect summaries.
+// Every function in the call graph gets the set of effects a call to it
+// may have, its own and those of everything it calls. Summaries are
+// computed once per SCC in the graph's bottom-up order: the members of an
+// SCC share one summary, the union of their bodies and of the SCCs they
+// call, which are final by then, so one pass reaches the fixpoint.
+//
+// A function is pure when a call depends on its arguments only; constant
+// folding evaluates those, see ctfe.h. A pure call that always returns
+// and whose value is unused is dropped. Codegen need not spill globals
+// around a call that neither reads nor writes them.
+
+#include "ast.h"
+#include "callgraph.h"
+#include "symtab.h"
+
+typedef enum
+{
+    EFFECT_READS_GLOBALS  = 0x1,    // a global var or array
+    EFFECT_WRITES_GLOBALS = 0x2,
+    EFFECT_MAY_NOT_RETURN = 0x4,    // recursion or an unbounded loop
+    EFFECT_UNKNOWN        = 0x8     // no body to look at, or an indirect call
+} effect_t;
+
+#define EFFECT_NONE 0
+#define EFFECT_ALL  0xf
+
+typedef struct effects_t effects_t;
+
+effects_t* effects_compute(const callgraph_t* cg);
+void effects_destroy(effects_t* fx);
+
+// the summary of fn, EFFECT_ALL for a function outside the graph
+unsigned int effects_of(const effects_t* fx, sym_entry_t* fn);
+
+// effects of evaluating expr once
+unsigned int effects_of_expr(const effects_t* fx, ASTNode* expr);
+
+// neither reads nor writes anything outside its own frame
+int effects_is_pure(const effects_t* fx, sym_entry_t* fn);
+
+// pure and always returns, a call whose value is unused can go
+int effects_is_removable(const effects_t* fx, sym_entry_t* fn);
+
+const char* effects_to_string(unsigned int effects, char* buf, size_t size);
+void effects_print_stats(const effects_t* fx);
+
+#endif
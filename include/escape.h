@@ -0,0 +1,43 @@
+#ifndef ESCAPE_H_
+#define ESCAPE_H_
+
+// Escape analysis for strings, arrays and vecs.
+// Every such local and parameter, and every str + str or call that makes
+// a new one, is given the cheapest storage that outlives its uses:
+//  - stack:  never leaves the function that made it
+//  - caller: returned, so the caller provides the space
+//  - heap:   stored in a global, captured by a nested function, or handed
+//            to a call that keeps it
+// Values flow through assignments, initializers, array literals, loops
+// over a collection and returns; a local is as long-lived as anything it
+// flows into. Calls are summarized per parameter, bottom-up over the call
+// graph, and an SCC is re-run until its summaries settle. Globals are
+// static data and are left as STORAGE_NONE.
+
+#include "ast.h"
+#include "callgraph.h"
+#include "symtab.h"
+
+typedef enum
+{
+    STORAGE_NONE,       // not an aggregate, or not analyzed
+    STORAGE_STACK,
+    STORAGE_CALLER,
+    STORAGE_HEAP
+} storage_t;
+
+typedef struct escape_t escape_t;
+
+// classify every function, results go to sym_entry_t.storage and to the
+// storage field of str concatenations and calls
+escape_t* escape_analyze(ASTNode* prog, symtab_t* table, const callgraph_t* cg);
+void escape_destroy(escape_t* esc);
+
+// what a call to fn does with an argument: STACK if it is only used,
+// CALLER if it may be returned, HEAP if it may be kept
+storage_t escape_param(const escape_t* esc, sym_entry_t* fn, int param);
+
+const char* storage_name(storage_t storage);
+void escape_print_stats(const escape_t* esc);
+
+#endif
@@ -0,0 +1,74 @@
+#ifndef FOLD_H_
+#define FOLD_H_
+
+// Constant folding.
+// Runs after the type checker. Unary and binary expressions whose operands
+// are constant are replaced in place by an AST_LITERAL holding the value,
+// and reads of a `let` with a constant initializer are replaced by that
+// value, so array sizes and loop bounds written with constants become
+// literals too. Arithmetic follows the target (rv32): int wraps at 32
+// bits, long at 64, shift counts are taken modulo the width, and float
+// results are rounded to single precision.
+
+#include "ast.h"
+#include "diag.h"
+#include "typecheck.h"
+
+typedef enum
+{
+    CONST_NONE,
+    CONST_INT,      // every integer type and char
+    CONST_FLOAT,    // float and double
+    CONST_BOOL,
+    CONST_STR
+} const_kind_t;
+
+typedef struct
+{
+    const_kind_t kind;
+    long long i;        // int and bool
+    double f;
+    const char* s;      // owned by the literal node it came from
+} const_value_t;
+
+typedef enum
+{
+    FOLD_OK,
+    FOLD_NOT_CONSTANT,
+    FOLD_DIV_ZERO
+} fold_status_t;
+
+// the value of a literal node, CONST_NONE for anything else
+const_value_t const_of(ASTNode* node);
+
+// wrap or round v to type, e.g. 300 to a byte gives 44
+const_value_t const_convert(const_value_t v, const type_t* type);
+
+// l op r with the result type given by the checker
+fold_status_t const_binary(TokenType op, const type_t* type, const_value_t l, const_value_t r,
+                           const_value_t* out);
+fold_status_t const_unary(TokenType op, const type_t* type, const_value_t v, const_value_t* out);
+
+// make node an AST_LITERAL holding v
+void const_to_literal(ASTNode* node, const_value_t v);
+
+// A range start...end...step includes end when the steps land on it:
+// 0...3 is 0, 1, 2, 3 and 10...0...-3 is 10, 7, 4, 1. Folding, ctfe.c,
+// bounds.c and lower.c all follow this rule.
+
+// i is still inside a range ending at end with the given step
+int const_range_in(long long i, long long end, long long step);
+
+// iterations of start...end...step. -1 if step is 0
+long long const_trip_count(long long start, long long end, long long step);
+
+// fold the whole program, returns the number of nodes folded.
+// With ctfe, calls to pure functions with constant arguments are
+// evaluated too, see ctfe.h. With effects, a call statement that has no
+// effect is removed from its block, see effects.h.
+struct ctfe_t;
+struct effects_t;
+int fold_program(ASTNode* prog, typecheck_t* tc, struct ctfe_t* ctfe, const struct effects_t* effects,
+                 diag_list_t* diags);
+
+#endif
@@ -0,0 +1,58 @@
+#ifndef GLOBALTAB_H_
+#define GLOBALTAB_H_
+
+// Frozen global symbol table.
+// Once the top level has been declared, symtab_freeze_globals copies the
+// global scope into an immutable open-addressed table and publishes it.
+// From then on any number of threads may read it without locks, and the
+// global scope of the live table refuses new symbols.
+// Function-local scopes stay private: each thread resolves through its
+// own local_scopes_t, which falls back to the frozen globals.
+
+#include "symtab.h"
+
+typedef struct
+{
+    name_id_t name;
+    const sym_entry_t* symbol;
+} globaltab_slot_t;
+
+typedef struct globaltab_t
+{
+    globaltab_slot_t* slots;    // NAME_NONE marks empty
+    unsigned int mask;          // capacity - 1, capacity is a power of two
+    unsigned int count;
+} globaltab_t;
+
+// Build the table from the global scope and publish it. Returns the
+// published table, freezing twice returns the first one.
+const globaltab_t* symtab_freeze_globals(symtab_t* table);
+
+// the published table, NULL before the freeze. Safe from any thread.
+const globaltab_t* symtab_globals(symtab_t* table);
+
+const sym_entry_t* globaltab_lookup(const globaltab_t* globals, name_id_t name);
+void globaltab_destroy(globaltab_t* globals);
+
+// Thread-local scope stack over the frozen globals.
+// Symbols bound here must belong to this thread alone: binding links
+// them into the stack through sym_entry_t.shadowed.
+typedef struct
+{
+    const globaltab_t* globals;
+    symmap_t locals;
+    int* marks;         // undo log position of each open scope
+    int depth;
+    int capacity;
+} local_scopes_t;
+
+void local_scopes_init(local_scopes_t* scopes, const globaltab_t* globals);
+void local_scopes_free(local_scopes_t* scopes);
+void local_scopes_enter(local_scopes_t* scopes);
+void local_scopes_exit(local_scopes_t* scopes);
+void local_scopes_bind(local_scopes_t* scopes, sym_entry_t* symbol);
+
+// innermost local binding, then the globals
+const sym_entry_t* local_scopes_lookup(local_scopes_t* scopes, name_id_t name);
+
+#endif
@@ -0,0 +1,24 @@
+#ifndef GVN_H_
+#define GVN_H_
+
+// Global value numbering over the dominator tree, after Briggs, Cooper and
+// Simpson's dominator-based value numbering. The tree is walked in
+// preorder with a scoped table of hash-consed expressions: the operator,
+// the type, the value numbers of the operands and whatever else the
+// result depends on. An instruction whose expression is already in scope
+// is computed by a dominating one and is replaced by it; the entries a
+// block adds go when the walk leaves it.
+//
+// Commutative operators (+, *, ==, != and the bitwise ones) sort their
+// operands, and a > b is looked up as b < a. Reads of variables in memory
+// and of array elements carry the memory state, which every store, element
+// write and call moves on; a block with several predecessors starts from
+// a fresh one, so arr[i] is reused only where nothing could have written
+// to memory in between.
+
+#include "ir.h"
+
+// returns how many instructions were removed
+int gvn_run(ir_func_t* fn);
+
+#endif
@@ -0,0 +1,45 @@
+#ifndef IFACE_H_
+#define IFACE_H_
+
+// Module interface files (.pni).
+// A compact binary image of a module's exported global symbols, written
+// after a module is parsed and mapped read-only by every file that
+// imports it. The file carries a precomputed hash table over the names,
+// so resolving an imported name is one probe into the mapping: the
+// module's source is never lexed or parsed again.
+//
+// Layout, all integers in host byte order:
+//   header   magic "PNIF", version, counts and section offsets
+//   records  one fixed-size record per symbol
+//   buckets  open-addressed hash table of record index + 1, 0 is empty
+//   types    the full types of the symbols, see types.h
+//   members  function parameters and struct fields of those types
+//   strings  NUL-terminated names
+// The type table is rebuilt through the type constructors when the file
+// is opened, so an imported function is checked against its parameter
+// and result types like a local one.
+
+#include "symtab.h"
+
+typedef struct iface_module_t iface_module_t;
+struct type_t;
+
+// export the global scope of table, returns 0 on success
+int iface_write(symtab_t* table, const char* path);
+
+iface_module_t* iface_open(const char* path);
+void iface_close(iface_module_t* module);
+int iface_symbol_count(const iface_module_t* module);
+
+// map the interface at path and make its names visible to table.
+// Returns 0 on success.
+int symtab_import(symtab_t* table, const char* path);
+
+// Called on a global miss: find name in the imported modules and enter
+// it into the global scope. NULL if no module exports it.
+sym_entry_t* iface_resolve(symtab_t* table, name_id_t name);
+
+// the full type an imported symbol was exported with, NULL if unknown
+const struct type_t* iface_symbol_type(symtab_t* table, const sym_entry_t* sym);
+
+#endif
@@ -0,0 +1,29 @@
+#ifndef INTERN_H_
+#define INTERN_H_
+
+// String interning for identifiers.
+// Every distinct name gets a small integer id, so symbols store 4 bytes
+// instead of a name buffer and names compare with ==. Id 0 is reserved
+// and never names anything. The table lives for the whole compilation.
+// All functions are safe to call from several threads at once.
+
+#include <stddef.h>
+
+typedef unsigned int name_id_t;
+
+#define NAME_NONE ((name_id_t)0)
+
+// id of name, inserting it if it's new
+name_id_t intern(const char* name);
+name_id_t intern_n(const char* name, size_t len);
+
+// id of name if it was interned before, NAME_NONE otherwise
+name_id_t intern_find(const char* name);
+
+// the string for id, "" for NAME_NONE
+const char* intern_str(name_id_t id);
+
+// one past the largest id handed out so far
+name_id_t intern_count(void);
+
+#endif
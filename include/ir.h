@@ -0,0 +1,214 @@
+#ifndef IR_H_
+#define IR_H_
+
+// Mid-level IR in SSA form, between the checked AST and code generation.
+// A module holds one function per function declaration, plus ".init" for
+// the global initializers. A function is a list of basic blocks; a block
+// is a list of instructions with its phis first and exactly one
+// terminator last. Every instruction with a result defines a fresh
+// virtual register %n typed with an interned type_t, see types.h, and its
+// operands point at the instructions that defined them. Values keep a
+// list of their users, so one can be replaced everywhere at once.
+// Everything lives in the module's arena and goes away with the module.
+
+#include <stdio.h>
+
+#include "fold.h"
+#include "symtab.h"
+#include "types.h"
+
+typedef enum
+{
+    // values
+    IR_CONST,       // value
+    IR_PARAM,       // index
+    IR_UNDEF,       // read before any write
+    IR_PHI,         // one operand per predecessor, in the order of preds
+    IR_FUNC,        // the function sym, as a value
+
+    IR_NEG,
+    IR_NOT,
+    IR_BNOT,
+
+    IR_ADD,
+    IR_SUB,
+    IR_MUL,
+    IR_DIV,
+    IR_MOD,
+    IR_BAND,
+    IR_BOR,
+    IR_BXOR,
+    IR_SHL,
+    IR_SHR,
+
+    IR_EQ,
+    IR_NE,
+    IR_LT,
+    IR_LE,
+    IR_GT,
+    IR_GE,
+
+    IR_CONVERT,     // numeric conversion to the result type
+    IR_CONCAT,      // str + str, storage
+    IR_RANGE,       // start, end, step
+    IR_RANGE_GET,   // part index of a range: 0 start, 1 end, 2 step
+
+    // memory
+    IR_LOAD,        // variable sym
+    IR_STORE,       // variable sym = operand 0
+    IR_ARRAY,       // a new array of the result type, zeroed; storage
+    IR_INDEX,       // base[index], in_bounds
+    IR_SET_ELEM,    // array[index] = value
+    IR_CALL,        // sym(args), or operand 0 (args) when sym is NULL; storage
+
+    // terminators, the successors are the block's succs
+    IR_JUMP,        // succs[0]
+    IR_BRANCH,      // cond ? succs[0] : succs[1]
+    IR_SWITCH,      // succs[1 + value - low], succs[0] outside the table
+    IR_RETURN,      // optional value
+    IR_UNREACHABLE
+} ir_op_t;
+
+typedef struct ir_value_t ir_value_t;
+typedef struct ir_block_t ir_block_t;
+typedef struct ir_func_t ir_func_t;
+typedef struct ir_module_t ir_module_t;
+
+struct ir_value_t
+{
+    ir_op_t op;
+    int id;                     // %id, -1 when there is no result
+    const type_t* type;         // NULL when there is no result
+    ir_block_t* block;
+    ir_value_t* prev;
+    ir_value_t* next;
+
+    ir_value_t** operands;
+    int operand_count;
+    int operand_capacity;
+
+    ir_value_t** users;         // one entry per use
+    int user_count;
+    int user_capacity;
+
+    const_value_t value;        // IR_CONST
+    int index;                  // IR_PARAM, IR_RANGE_GET
+    sym_entry_t* sym;           // IR_FUNC, IR_LOAD, IR_STORE, IR_CALL
+    int storage;                // IR_ARRAY, IR_CONCAT, IR_CALL, storage_t, see escape.h
+    int in_bounds;              // IR_INDEX needs no check
+    long long low;              // IR_SWITCH
+};
+
+struct ir_block_t
+{
+    int id;
+    ir_func_t* func;
+    ir_value_t* first;
+    ir_value_t* last;
+
+    ir_block_t** preds;
+    int pred_count;
+    int pred_capacity;
+
+    ir_block_t** succs;         // set by the terminator
+    int succ_count;
+};
+
+struct ir_func_t
+{
+    const char* name;
+    sym_entry_t* sym;           // NULL for .init
+    const type_t* result;
+    ir_module_t* module;
+
+    ir_value_t** params;
+    int param_count;
+
+    ir_block_t** blocks;        // blocks[0] is the entry
+    int block_count;
+    int block_capacity;
+
+    int value_count;            // the next %id
+
+    // analyses kept until the CFG changes, see dom.h and loops.h
+    struct dom_t* dom;
+    struct loops_t* loops;
+};
+
+struct ir_module_t
+{
+    struct ir_arena_t* arena;
+
+    ir_func_t** funcs;
+    int func_count;
+    int func_capacity;
+};
+
+ir_module_t* ir_module_create(void);
+void ir_module_destroy(ir_module_t* module);
+
+// zeroed memory that lives as long as the module
+void* ir_alloc(ir_module_t* module, size_t size);
+
+ir_func_t* ir_func_create(ir_module_t* module, const char* name, sym_entry_t* sym, const type_t* result);
+ir_block_t* ir_block_create(ir_func_t* fn);
+
+// append an instruction to b, before nothing: b must not be terminated
+ir_value_t* ir_emit(ir_block_t* b, ir_op_t op, const type_t* type, ir_value_t** operands, int count);
+// insert an instruction right before another one
+ir_value_t* ir_insert_before(ir_value_t* before, ir_op_t op, const type_t* type, ir_value_t** operands, int count);
+ir_value_t* ir_const(ir_block_t* b, const type_t* type, const_value_t value);
+ir_value_t* ir_param(ir_func_t* fn, int index, const type_t* type);
+
+// a phi at the start of b, with its operands added in pred order
+ir_value_t* ir_phi(ir_block_t* b, const type_t* type);
+void ir_phi_add(ir_value_t* phi, ir_value_t* value);
+
+void ir_jump(ir_block_t* b, ir_block_t* target);
+void ir_branch(ir_block_t* b, ir_value_t* cond, ir_block_t* then_block, ir_block_t* else_block);
+void ir_switch(ir_block_t* b, ir_value_t* value, long long low, ir_block_t** targets, int count,
+               ir_block_t* otherwise);
+void ir_return(ir_block_t* b, ir_value_t* value);
+void ir_unreachable(ir_block_t* b);
+
+int ir_is_terminator(ir_op_t op);
+ir_value_t* ir_terminator(const ir_block_t* b);
+
+void ir_set_operand(ir_value_t* v, int i, ir_value_t* operand);
+
+// make every user of old use value instead
+void ir_replace_uses(ir_value_t* old, ir_value_t* value);
+
+// unlink v from its block and drop its operands, it must have no users
+void ir_remove(ir_value_t* v);
+
+// drop the blocks the entry cannot reach and renumber the rest, returns
+// how many were dropped
+int ir_remove_unreachable(ir_func_t* fn);
+
+// replace b's terminator by a jump to target, one of its successors; the
+// others forget b and their phi operands for it
+void ir_set_jump(ir_block_t* b, ir_block_t* target);
+
+// route every edge from the given blocks to b through a new block, which
+// merges their phi operands, and return it
+ir_block_t* ir_split_preds(ir_block_t* b, ir_block_t* const* moved, int count);
+
+// drop the analyses cached on fn; adding blocks or edges does it already,
+// a pass that rewires the CFG by hand must call it
+void ir_invalidate(ir_func_t* fn);
+
+// replace each phi whose operands are one value, or itself, by that value,
+// until none is left, returns how many were removed
+int ir_remove_trivial_phis(ir_func_t* fn);
+
+const char* ir_op_name(ir_op_t op);
+void ir_print_func(const ir_func_t* fn, FILE* out);
+void ir_print(const ir_module_t* module, FILE* out);
+
+// check the invariants above, that each operand dominates its use and
+// that each function called is in the module or defined elsewhere,
+// print each violation and return how many
+int ir_verify(const ir_module_t* module);
+
+#endif
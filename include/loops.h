@@ -0,0 +1,60 @@
+#ifndef LOOPS_H_
+#define LOOPS_H_
+
+// The natural loops of an IR function, as a forest. A back edge runs from
+// a latch to a header that dominates it, see dom.h; the loop of a header is
+// every block that reaches one of its latches without passing through the
+// header. Loops sharing a header are one loop. A loop found inside another
+// hangs under it and is one deeper.
+//
+// loops_get caches the forest on the function next to its dominators;
+// anything that changes the CFG drops both, see ir_invalidate.
+
+#include "dom.h"
+#include "ir.h"
+
+typedef struct loop_t loop_t;
+
+struct loop_t
+{
+    ir_block_t* header;
+    loop_t* parent;             // NULL for an outermost loop
+    int depth;                  // 1 for an outermost loop
+
+    // the one block entering the header from outside, and going nowhere
+    // else; NULL until loops_insert_preheaders makes one
+    ir_block_t* preheader;
+
+    ir_block_t** blocks;        // header first, inner loops' blocks included
+    int block_count;
+    ir_block_t** latches;
+    int latch_count;
+};
+
+typedef struct loops_t
+{
+    loop_t** loops;             // inner loops come before the loops around them
+    int loop_count;
+
+    loop_t** innermost;         // by block id, NULL outside every loop
+    int block_count;
+} loops_t;
+
+loops_t* loops_compute(const ir_func_t* fn, const dom_t* dom);
+void loops_destroy(loops_t* loops);
+
+// computed once and kept on fn until the CFG changes
+const loops_t* loops_get(ir_func_t* fn);
+
+loop_t* loops_innermost(const loops_t* loops, const ir_block_t* b);
+
+// how many loops b is in, 0 outside every loop
+int loops_depth(const loops_t* loops, const ir_block_t* b);
+
+// b is in loop or in a loop inside it
+int loops_contains(const loops_t* loops, const loop_t* loop, const ir_block_t* b);
+
+// give every loop a preheader, returns how many blocks were added
+int loops_insert_preheaders(ir_func_t* fn);
+
+#endif
@@ -0,0 +1,20 @@
+#ifndef LOWER_H_
+#define LOWER_H_
+
+// Lowering of the checked AST to the IR, see ir.h.
+// Runs on a program the analysis accepted, after folding and match
+// lowering: expressions use the types in node->ty, conversions the checker
+// allowed implicitly become IR_CONVERT, && and || become branches, a
+// match dispatches through its MatchStmt.plan and a counted loop keeps its
+// counter in a phi. The locals of a function become SSA values as they are
+// lowered, see ssa.h; globals and the locals a nested function names are
+// read and written with IR_LOAD and IR_STORE. Nested functions are lowered
+// on their own as outer.inner. Every function with a body is lowered.
+
+#include "ast.h"
+#include "ir.h"
+#include "symtab.h"
+
+ir_module_t* ir_lower_program(ASTNode* prog, symtab_t* table);
+
+#endif
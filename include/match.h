@@ -0,0 +1,69 @@
+#ifndef MATCH_H_
+#define MATCH_H_
+
+// Match statements: exhaustiveness, redundancy and lowering.
+// Runs after constant folding, when every constant case is a literal.
+// Cases over integers, chars and bools are kept as a set of disjoint
+// intervals, in case order, so that
+//  - a case whose values are all taken by earlier cases is unreachable,
+//  - a match without '_' that leaves part of the scrutinee's type out is
+//    not exhaustive, and '_' is unreachable when nothing is left out.
+// Each match is then lowered to a decision tree over the intervals each
+// case owns: a jump table where the values are dense, a binary split
+// where they are not, and a compare chain for a handful of cases.
+// Codegen dispatches through MatchStmt.plan.
+
+#include "ast.h"
+#include "diag.h"
+
+#define MATCH_CHAIN_MAX     3       // cases compared one by one
+#define MATCH_TABLE_MAX     4096    // largest jump table, in entries
+#define MATCH_TABLE_DENSITY 40      // percent of table slots with a case
+
+typedef enum
+{
+    MATCH_LEAF,     // go to target
+    MATCH_TABLE,    // targets[value - low], default outside low .. high
+    MATCH_SPLIT,    // value < pivot ? left : right
+    MATCH_CHAIN     // test cases in order, then default
+} match_kind_t;
+
+// case number of a target, MATCH_DEFAULT for '_' or falling through
+#define MATCH_DEFAULT (-1)
+
+typedef struct
+{
+    long long low;
+    long long high;     // inclusive
+    int target;
+} match_range_t;
+
+typedef struct match_node_t
+{
+    match_kind_t kind;
+    int target;                 // MATCH_LEAF
+
+    long long low;              // MATCH_TABLE
+    long long high;
+    int* targets;
+
+    long long pivot;            // MATCH_SPLIT
+    struct match_node_t* left;
+    struct match_node_t* right;
+
+    match_range_t* ranges;      // MATCH_CHAIN, NULL to compare with each
+    int range_count;            // case expression in order
+} match_node_t;
+
+typedef struct match_plan_t
+{
+    match_node_t* root;
+    int depth;          // most tests on any path, a table counts as one
+} match_plan_t;
+
+// check and lower every match in the program, returns how many were lowered
+int match_program(ASTNode* prog, diag_list_t* diags);
+
+const char* match_kind_name(match_kind_t kind);
+
+#endif
@@ -0,0 +1,12 @@
+#ifndef OPT_H_
+#define OPT_H_
+
+// The passes run over a lowered module, function by function and in a
+// fixed order. Each leaves the function valid for ir_verify and drops the
+// analyses it made stale, see ir_invalidate.
+
+#include "ir.h"
+
+void ir_optimize(ir_module_t* module);
+
+#endif
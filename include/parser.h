@@ -15,7 +15,10 @@ typedef struct
     int current;
     int count;
     const char* error_msg;
+    int error_count;                    // errors printed while parsing, not error_msg
     symtab_t* symtab;
+    struct toplevel_index_t* toplevel;  // top-level declarations, see prepass.h
+    const char* import_dir;             // where module interfaces are found
 } Parser;
 
 /* parser functions */
@@ -37,7 +40,7 @@ ASTNode* parse_program(Parser* parser);
 // declarations
 ASTNode* parse_var_decl(Parser* parser);
 ASTNode* parse_const_decl(Parser* parser);
-ASTNode* parse_array_decl(Parser* parser, ASTNode* ident);
+ASTNode* parse_array_decl(Parser* parser, Token* ident_tk, ASTNode* ident);
 ASTNode* parse_array_init(Parser* parser, ASTNode* ident, Token* data_type);
 ASTNode* parse_param(Parser* parser);
 ASTNode* parse_func_decl(Parser* parser); 
@@ -50,6 +53,7 @@ ASTNode* parse_match_stmt(Parser* parser);
 ASTNode* parse_loop_stmt(Parser* parser); 
 ASTNode* parse_return_stmt(Parser* parser); 
 ASTNode* parse_block(Parser* parser); 
+ASTNode* parse_import_stmt(Parser* parser);
 
 // expressions
 ASTNode* parse_expr(Parser* parser);
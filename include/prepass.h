@@ -0,0 +1,56 @@
+#ifndef PREPASS_H_
+#define PREPASS_H_
+
+// Top-level declaration pre-pass.
+// Before any body is parsed, the token stream is skimmed once with brace
+// matching to find every top-level fn, struct, enum, union, let and var.
+// No AST is built. The names go into the global scope up front, so a
+// function can call one declared further down the file. Each entry also
+// records the token span of its declaration, so bodies can later be
+// parsed independently of each other.
+
+#include "token.h"
+#include "symtab.h"
+#include "intern.h"
+
+typedef enum
+{
+    TOP_FN,
+    TOP_STRUCT,
+    TOP_ENUM,
+    TOP_UNION,
+    TOP_LET,
+    TOP_VAR
+} toplevel_kind_t;
+
+typedef struct
+{
+    toplevel_kind_t kind;
+    name_id_t name;
+    Token* name_token;      // the declaring identifier
+    int start;              // token index of the keyword
+    int end;                // one past the last token of the declaration
+    int is_array;           // let/var name[...]
+    sym_entry_t* symbol;    // predeclared symbol, NULL for a duplicate
+} toplevel_decl_t;
+
+typedef struct toplevel_index_t
+{
+    toplevel_decl_t* decls; // in source order
+    int count;
+    int capacity;
+    toplevel_decl_t** by_name;  // sorted by name, then source order
+} toplevel_index_t;
+
+toplevel_index_t* prepass_collect(Token** tokens, int count);
+void toplevel_index_destroy(toplevel_index_t* index);
+
+// enter every collected name into the table's global scope
+void prepass_declare(toplevel_index_t* index, symtab_t* table);
+
+// the symbol predeclared for this name token, NULL if there is none
+sym_entry_t* prepass_symbol(toplevel_index_t* index, Token* name_token);
+
+const toplevel_decl_t* toplevel_find(toplevel_index_t* index, name_id_t name);
+
+#endif
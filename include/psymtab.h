@@ -0,0 +1,56 @@
+#ifndef PSYMTAB_H_
+#define PSYMTAB_H_
+
+// Persistent symbol tables for long-running tools.
+// A psymtab_t is an immutable snapshot of the symbols of a program. Global
+// names live in a hash array mapped trie (HAMT) keyed by interned name id,
+// and each function's scopes are frozen into one shared record. Updating a
+// version copies only the trie path to the changed entry, so re-analysing
+// one function shares every other function and global with the previous
+// version. Everything is reference counted: releasing a version frees
+// exactly the nodes no other live version still uses.
+// Refcounts are not atomic, keep a version to one thread at a time.
+
+#include "symtab.h"
+
+typedef struct psymtab_t psymtab_t;
+typedef struct pfunc_t pfunc_t;
+typedef struct phamt_node_t phamt_node_t;
+
+// empty version, no globals or functions
+psymtab_t* psymtab_empty(void);
+
+// snapshot a finished symbol table
+psymtab_t* psymtab_from_symtab(symtab_t* table);
+
+// new versions, the previous one is left untouched and stays valid
+psymtab_t* psymtab_set_global(psymtab_t* prev, const sym_entry_t* symbol);
+psymtab_t* psymtab_remove_global(psymtab_t* prev, name_id_t name);
+
+// replace one function with its freshly analysed scopes in table.
+// The function's global symbol is updated as well.
+psymtab_t* psymtab_set_function(psymtab_t* prev, symtab_t* table, const sym_entry_t* function);
+psymtab_t* psymtab_remove_function(psymtab_t* prev, name_id_t name);
+
+void psymtab_retain(psymtab_t* version);
+void psymtab_release(psymtab_t* version);
+
+// Lookups. Symbols are copies: no reference chain and no shadow link.
+const sym_entry_t* psymtab_lookup_global(const psymtab_t* version, name_id_t name);
+const pfunc_t* psymtab_function(const psymtab_t* version, name_id_t name);
+int psymtab_function_count(const psymtab_t* version);
+
+// scope 0 is the function's parameter scope, nested blocks follow in
+// creation order. Falls back to the globals of version.
+const sym_entry_t* psymtab_lookup(const psymtab_t* version, const pfunc_t* function,
+                                  int scope, name_id_t name);
+int pfunc_scope_count(const pfunc_t* function);
+int pfunc_scope_parent(const pfunc_t* function, int scope);
+
+// number of versions, trie nodes and shared records alive, for checking
+// that old versions really are reclaimed. See tools/psymtab_check.c.
+long psymtab_live_objects(void);
+
+void psymtab_print(const psymtab_t* version);
+
+#endif
@@ -0,0 +1,28 @@
+#ifndef SCCP_H_
+#define SCCP_H_
+
+// Sparse conditional constant propagation over the SSA IR, after Wegman
+// and Zadeck. Every value starts unknown and every block unreached; from
+// the entry, a block's instructions are evaluated once it is reached, a
+// branch on a constant reaches only the side it takes, and a phi meets
+// only the operands of edges found executable. A value falls from unknown
+// to one constant to overdefined and never back, so the two worklists, of
+// edges and of values whose users must be looked at again, run dry.
+//
+// Constants are then materialized, branches and switches on constants
+// (a match on a constant scrutinee among them) become jumps and the
+// blocks nothing reaches go. The arithmetic is that of fold.h, so the
+// IR and the AST folder agree on wrapping and rounding.
+
+#include "ir.h"
+
+typedef struct
+{
+    int folded;         // values replaced by a constant
+    int branches;       // branches and switches turned into jumps
+    int blocks;         // blocks removed
+} sccp_stats_t;
+
+sccp_stats_t sccp_run(ir_func_t* fn);
+
+#endif
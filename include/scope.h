@@ -5,20 +5,43 @@
 typedef struct sym_entry_t sym_entry_t;
 typedef struct scope_t scope_t;
 
-#define GLOBAL      0x001
-#define LOCAL       0x002
-#define FUNCTION    0x004
-#define LOOP        0x008
+// scope flags. Prefixed so they don't clash with the LOOP token type
+#define SCOPE_GLOBAL      0x001
+#define SCOPE_LOCAL       0x002
+#define SCOPE_FUNCTION    0x004
+#define SCOPE_LOOP        0x008
+#define SCOPE_LOOP_HEADER 0x010     // declares the loop variable, not inherited
+
+// Bloom filter over interned name ids. A scope's filter covers only the
+// names it declares. Lookups while parsing go through the live symbol map
+// and need no filter; a lookup in the scope tree afterwards tests each
+// scope's filter on the way out and only searches the scopes that may
+// declare the name. A filter grows with its scope, keeping
+// SCOPE_BLOOM_BITS_PER_NAME bits per name, so the global scope of a
+// large file stays as selective as a small block.
+#define SCOPE_BLOOM_MIN_BITS      64
+#define SCOPE_BLOOM_BITS_PER_NAME 16
+
+typedef struct
+{
+    unsigned long long* bits;   // NULL until the first name
+    unsigned int mask;          // bit count - 1, a power of two
+    int count;                  // names added
+} scope_bloom_t;
 
 // Scope structure - represents a lexical scope
 struct scope_t {
     int level;              // nesting level (0 = global)
+    int index;              // position in the table's scope list
     sym_entry_t** symbols;  // hash table or array of symbols
     int symbol_count;       // number of symbols in this scope
+    int symbol_capacity;
     scope_t* parent;        // pointer to enclosing scope
     scope_t** children;
     int children_cnt;
     int flags;              // check if scope is in a function or a loop
+    int undo_mark;          // symbol map undo log position on entry
+    scope_bloom_t names;    // the names declared here
 };
 
 
@@ -32,4 +55,9 @@ void symtab_exit_scope(symtab_t* table);
 scope_t* scope_create(int level, scope_t* parent);
 void scope_destroy(scope_t* scope);
 
+// bloom filters, name is an interned id (see intern.h). Add a name once
+// its symbol is in scope->symbols, which a filter is rebuilt from as it grows.
+void scope_bloom_add(scope_t* scope, unsigned int name);
+int scope_bloom_may_contain(const scope_bloom_t* bloom, unsigned int name);
+
 #endif
\ No newline at end of file
@@ -0,0 +1,35 @@
+#ifndef SSA_H_
+#define SSA_H_
+
+// SSA construction while lowering, after Braun et al., "Simple and
+// Efficient Construction of Static Single Assignment Form" (CC 2013).
+// Lowering writes and reads variables, numbered by the caller, block by
+// block. A read looks for a write in the block, walks up through single
+// predecessors, and places a phi where paths join. A block is sealed once
+// all its predecessors exist; until then a read places an incomplete phi
+// that gets its operands on sealing. A phi whose operands are all the
+// same value, or itself, is replaced by that value at once, and so are
+// the phis that used it if they become trivial in turn. No dominance
+// frontiers are needed and the work stays linear in the size of the body.
+
+#include "ir.h"
+
+typedef struct ssa_t ssa_t;
+
+ssa_t* ssa_create(ir_func_t* fn);
+void ssa_destroy(ssa_t* ssa);
+
+void ssa_write(ssa_t* ssa, int var, ir_block_t* b, ir_value_t* value);
+
+// the value of var at the end of what b has lowered so far, of type type
+ir_value_t* ssa_read(ssa_t* ssa, int var, ir_block_t* b, const type_t* type);
+
+// every predecessor of b is known
+void ssa_seal(ssa_t* ssa, ir_block_t* b);
+int ssa_is_sealed(const ssa_t* ssa, const ir_block_t* b);
+
+// phis placed and phis found trivial and removed
+int ssa_phi_count(const ssa_t* ssa);
+int ssa_removed_count(const ssa_t* ssa);
+
+#endif
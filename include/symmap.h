@@ -0,0 +1,48 @@
+#ifndef SYMMAP_H_
+#define SYMMAP_H_
+
+// Global symbol map (LeBlanc-Cook style).
+// One map from name to the stack of live bindings for that name,
+// plus an undo log of insertions. Entering a scope records the log mark,
+// exiting pops back to it and restores whatever was shadowed. A lookup is
+// one probe no matter how deep the current block is nested.
+// Names are interned (see intern.h), so the map is an array indexed by id.
+
+#include <stddef.h>
+#include "intern.h"
+
+typedef struct sym_entry_t sym_entry_t;
+
+typedef struct
+{
+    sym_entry_t** tops;     // name id -> innermost live binding, NULL if none
+    size_t capacity;
+
+    sym_entry_t** undo_log; // symbols in insertion order
+    int undo_count;
+    int undo_capacity;
+} symmap_t;
+
+void symmap_init(symmap_t* map);
+void symmap_free(symmap_t* map);
+
+// push a binding for symbol->name, shadowing any outer one
+void symmap_push(symmap_t* map, sym_entry_t* symbol);
+
+// innermost live binding for name, NULL if unbound
+sym_entry_t* symmap_lookup(symmap_t* map, name_id_t name);
+
+// bind symbol below every live binding of its name, for globals entered
+// late (imports). Not logged, so it is never unwound.
+void symmap_bind_outermost(symmap_t* map, sym_entry_t* symbol);
+
+// undo log position, taken on scope entry
+int symmap_mark(symmap_t* map);
+
+// pop every binding pushed since mark
+void symmap_unwind(symmap_t* map, int mark);
+
+// drop a binding pushed after mark, used by symtab_remove
+void symmap_forget(symmap_t* map, sym_entry_t* symbol, int mark);
+
+#endif
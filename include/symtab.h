@@ -3,8 +3,10 @@
 
 #include <stdlib.h>
 #include "scope.h"
+#include "symmap.h"
+#include "intern.h"
+#include "diag.h"
 
-#define MAX_NAME_LEN    256
 #define MAX_DEPTH       64
 #define MAX_SYMBOLS     1024
 
@@ -19,6 +21,7 @@ typedef enum
     SYM_ARRAY,
     SYM_STRUCT,
     SYM_ENUM,
+    SYM_UNION,
     SYM_LABEL
 } symbol_t;
 
@@ -58,6 +61,7 @@ typedef struct
     sym_entry_t** params;
     int param_count;
     int is_defined;
+    int body_scope;     // index of the parameter scope, -1 until entered
 } funcSym;
 
 typedef struct
@@ -72,31 +76,59 @@ typedef struct
     int line_used;
 } lbSym;
 
+// How a local was used, decided when its scope is exited. Codegen can
+// give an unused local no stack slot, and drop every store to a
+// write-only one.
+typedef enum
+{
+    SYM_USED,
+    SYM_UNUSED,
+    SYM_WRITE_ONLY
+} sym_usage_t;
+
 // Forward declarations
 typedef struct reference_t reference_t;
 typedef struct sym_entry_t sym_entry_t;
 typedef struct scope_t scope_t;
 
-// Reference structure - tracks where a symbol is used
+// Reference structure - tracks where a symbol is used.
+// References are not stored as records: each one is delta-encoded into
+// two or three bytes of a segment from a chunked pool owned by the table,
+// and a symbol's segments are chained in source order. This is what a
+// reference_t is decoded into, and doubles as the cursor for
+// symtab_first_reference/symtab_next_reference.
 struct reference_t 
 {
     int line;
-    int is_write;           // 1 if this is a write/assignment, 0 if read
+    unsigned short column;      // the span is the name's length from here
+    unsigned char is_write;     // 1 if this is a write/assignment, 0 if read
+    unsigned int segment;       // where the next reference is decoded from
+    unsigned int offset;
 };
 
 // Symbol entry structure
+// Symbols are allocated from a chunked pool owned by the table, so
+// pointers stay valid until symtab_destroy.
 struct sym_entry_t 
 {
-    char name[MAX_NAME_LEN];
-    symbol_t symbol_type;
-    datatype_t type;
-    unsigned long address;
+    name_id_t name;                 // interned, see intern.h
+    unsigned int symbol_type : 8;   // symbol_t
+    unsigned int type : 8;          // datatype_t
+    unsigned int level : 11;        // i.e. scope depth
+    unsigned int imported : 1;      // entered from a module interface, see iface.h
+    unsigned int usage : 2;         // sym_usage_t, set when its scope closes
+    unsigned int storage : 2;       // storage_t of a str, array or vec, see escape.h
+    unsigned int scope;             // index of the scope, see symtab_scope
+    unsigned int index;             // position in the table's symbol pool
     int line;
-    int level;      // i.e. scope
-    scope_t* scope; // pointer to scope
+    unsigned short column;          // where the declaring identifier starts
+
+    unsigned int first_ref;     // chain of reference segments, 0 if none
+    unsigned int last_ref;
+    int ref_count;              // number of references to this symbol
+    int ref_line;               // line of the last reference, the next is encoded from it
 
-    reference_t** references; // linked list of all references
-    int ref_count;          // number of references to this symbol
+    sym_entry_t* shadowed;      // next outer live binding of the same name, see symmap.h
     
     union 
     {
@@ -108,6 +140,29 @@ struct sym_entry_t
     } info;
 };
 
+#define SYM_CHUNK_SHIFT 8
+#define SYM_CHUNK_SIZE  (1 << SYM_CHUNK_SHIFT)
+#define REF_CHUNK_SHIFT 16     // bytes per chunk of reference segments
+#define REF_CHUNK_SIZE  (1 << REF_CHUNK_SHIFT)
+
+// A segment is the position of the next one (4 bytes), the bytes used and
+// its size (1 each), then the encoded references. A symbol's first segment
+// is small and each next one twice the size, so a name used once costs
+// little and a long chain is mostly payload.
+#define REF_SEGMENT_HEADER  6
+#define REF_SEGMENT_MIN     16
+#define REF_SEGMENT_MAX     128
+
+// Lookup counters, printed by symtab_print_stats. Updated atomically, as
+// the parallel checker looks names up too. The filter counts are for the
+// scope tree walks of symtab_lookup_from, see scope.h.
+typedef struct
+{
+    unsigned long lookups;
+    unsigned long hits;
+    unsigned long bloom_rejects;        // scopes the filter ruled out unsearched
+    unsigned long bloom_false_positives; // filter said maybe, the scope had no such name
+} symtab_stats_t;
 
 // Symbol table structure
 struct symtab_t
@@ -116,6 +171,39 @@ struct symtab_t
     int current_depth;
     scope_t* current_scope;
     scope_t* global_scope;
+    symmap_t map;   // name -> live bindings, only valid while parsing
+
+    scope_t** scope_list;       // every scope ever created, by scope_t.index
+    int scope_count;
+    int scope_capacity;
+
+    sym_entry_t** sym_chunks;   // symbol pool
+    unsigned int sym_count;
+    int sym_chunk_count;
+
+    unsigned char** ref_chunks; // reference segments, see symtab_add_reference
+    int ref_chunk_count;
+    unsigned int ref_used;      // bytes used in the last chunk
+    unsigned int ref_count;     // references added so far
+
+    symtab_stats_t stats;
+
+    // read and written symbols, bit i for symbol i, filled as references
+    // are added and swept when a scope is exited
+    unsigned long long* read_set;
+    unsigned long long* write_set;
+    int warn_unused;            // report unused locals, on by default
+    diag_list_t diags;          // warnings found while parsing
+
+    struct globaltab_t* globals;    // frozen global scope, see globaltab.h
+
+    struct iface_module_t** imports;    // mapped module interfaces, see iface.h
+    int import_count;
+
+    // full types by symbol index, left by the type checker for the
+    // passes after analysis, such as the interface writer. NULL before.
+    const struct type_t** types;
+    unsigned int type_count;
 };
 
 
@@ -125,25 +213,45 @@ void symtab_destroy(symtab_t* table);
 
 // Symbol operations
 sym_entry_t* symtab_insert(symtab_t* table, sym_entry_t* symbol);
+sym_entry_t* symtab_insert_global(symtab_t* table, sym_entry_t* symbol);
 
 sym_entry_t* symtab_lookup(symtab_t* table, const char* name);
+sym_entry_t* symtab_lookup_id(symtab_t* table, name_id_t name);
 sym_entry_t* symtab_lookup_current_scope(symtab_t* table, const char* name);
 int symtab_remove(symtab_t* table, const char* name);
 
+// Scope tree lookups. These walk the parent chain and work after
+// parsing has finished, when the live map has been unwound.
+sym_entry_t* scope_lookup(scope_t* scope, const char* name);
+sym_entry_t* scope_lookup_local(scope_t* scope, const char* name);
+sym_entry_t* symtab_lookup_from(symtab_t* table, scope_t* scope, const char* name);
+
+// struct, enum and union names
+int sym_is_type(sym_entry_t* symbol);
+
+// Pool access
+sym_entry_t* symtab_symbol(symtab_t* table, unsigned int index);
+scope_t* symtab_scope(symtab_t* table, unsigned int index);
+void symtab_register_scope(symtab_t* table, scope_t* scope);
+
 // Reference tracking
-void symtab_add_reference(sym_entry_t* symbol, int line, int is_write);
-void reference_destroy(reference_t* ref);
+void symtab_add_reference(symtab_t* table, sym_entry_t* symbol, int line, int column, int is_write);
+// decode the first or the next reference into ref, 0 when there is none
+int symtab_first_reference(symtab_t* table, sym_entry_t* symbol, reference_t* ref);
+int symtab_next_reference(symtab_t* table, reference_t* ref);
 
 // Symbol entry operations
-sym_entry_t* sym_create(const char* name, symbol_t type, datatype_t data_type, int line);
-void sym_destroy(sym_entry_t* entry);
+sym_entry_t* sym_create(symtab_t* table, const char* name, symbol_t type, datatype_t data_type, int line);
+static inline const char* sym_name(sym_entry_t* entry) { return intern_str(entry->name); }
 
 // Utility functions
 void symtab_print(symtab_t* table);
-void symtab_print_scope(scope_t* scope);
+void symtab_print_stats(symtab_t* table);
+void symtab_print_scope(symtab_t* table, scope_t* scope);
+const char* symbol_type_to_string(symbol_t type);
+const char* datatype_to_string(datatype_t type);
 int symtab_check_redeclaration(symtab_t* table, const char* name);
 
-reference_t** grow_array(reference_t** refs, int* count, reference_t* ref);
-sym_entry_t** grow_array_sym(sym_entry_t** refs, int* count, sym_entry_t* ref);
+sym_entry_t** grow_array_sym(sym_entry_t** refs, int* count, int* capacity, sym_entry_t* ref);
 
 #endif
\ No newline at end of file
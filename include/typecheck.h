@@ -0,0 +1,63 @@
+#ifndef TYPECHECK_H_
+#define TYPECHECK_H_
+
+// Type inference and checking.
+// One bottom-up walk over the AST: every expression node gets its type in
+// node->ty from the types of its children, so the pass is linear in the
+// size of the tree. Types are interned (types.h), so every comparison is
+// a pointer compare. Identifiers were resolved by the parser, so symbol
+// types live in an array indexed by sym_entry_t.index.
+
+#include "ast.h"
+#include "diag.h"
+#include "symtab.h"
+#include "types.h"
+
+typedef struct
+{
+    symtab_t* table;
+    diag_list_t* diags;
+
+    const type_t** sym_types;   // by sym_entry_t.index, NULL until known
+    ASTNode** fn_decls;         // function declarations, by symbol index
+    unsigned char* fn_state;    // 0 unchecked, 1 in progress, 2 done
+    unsigned int sym_count;
+
+    // the function being checked
+    sym_entry_t* function;
+    const type_t* return_type;  // declared with '->', NULL to infer
+    const type_t* inferred;     // from the returns seen so far
+    int in_function;            // 0 for the top-level statements
+} typecheck_t;
+
+typecheck_t* typecheck_create(symtab_t* table, diag_list_t* diags);
+
+// the symbol types stay behind in tc->table->types
+void typecheck_destroy(typecheck_t* tc);
+
+// check the whole program, returns the number of errors found
+int typecheck_program(typecheck_t* tc, ASTNode* prog);
+
+// The same work split in two phases so function bodies can be checked in
+// parallel. typecheck_declarations checks the top level, every function
+// whose result must be inferred, and resolves the imported types used by
+// the rest; after it the global scope may be frozen. typecheck_function
+// then checks one remaining function and may run on any thread, each with
+// its own worker.
+int typecheck_declarations(typecheck_t* tc, ASTNode* prog);
+void typecheck_function(typecheck_t* tc, ASTNode* decl);
+
+// a checker sharing tc's symbol types but reporting to diags.
+// Returned by value, nothing to destroy.
+typecheck_t typecheck_worker(typecheck_t* tc, diag_list_t* diags);
+
+// the type of a declared symbol, NULL if it has none
+const type_t* typecheck_symbol_type(typecheck_t* tc, sym_entry_t* sym);
+
+// refine a symbol's type after checking, e.g. an array sized by a constant
+void typecheck_set_symbol_type(typecheck_t* tc, sym_entry_t* sym, const type_t* type);
+
+// the type named by a type annotation token: int, str, Point, ...
+const type_t* typecheck_resolve_type(typecheck_t* tc, Token* name);
+
+#endif
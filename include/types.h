@@ -0,0 +1,87 @@
+#ifndef TYPES_H_
+#define TYPES_H_
+
+// Interned type representation.
+// Every type is built through the constructors below, which hash-cons:
+// two structurally equal types are the same object, so type equality is
+// a pointer compare. Struct, enum and union types are nominal, keyed by
+// their name. Types live until the end of the compilation.
+// The constructors are safe to call from several threads.
+
+#include "intern.h"
+#include "symtab.h"
+
+typedef enum
+{
+    TY_ERROR,       // already reported, absorbs further errors
+    TY_VOID,
+    TY_BOOL,
+    TY_CHAR,
+    TY_BYTE,
+    TY_SHORT,
+    TY_INT,
+    TY_LONG,
+    TY_FLOAT,
+    TY_DOUBLE,
+    TY_STR,         // length -1 when unsized, str[100] otherwise
+    TY_ARRAY,       // elem[length]
+    TY_VEC,         // growable vec of elem
+    TY_RANGE,       // a...b over elem
+    TY_FN,          // params -> elem
+    TY_STRUCT,
+    TY_ENUM,
+    TY_UNION
+} type_kind_t;
+
+typedef struct type_t type_t;
+
+typedef struct
+{
+    name_id_t name;
+    const type_t* type;
+} type_field_t;
+
+struct type_t
+{
+    type_kind_t kind;
+    unsigned int id;            // dense and unique, usable as an array index
+    const type_t* elem;         // array, vec, range element, fn result
+    int length;                 // array and str length, -1 if unsized
+    name_id_t name;             // struct, enum, union
+    const type_t** params;      // fn parameters
+    int param_count;
+
+    // struct and union members, filled in when the declaration is checked
+    type_field_t* fields;
+    int field_count;
+
+    unsigned int hash;
+    type_t* next;               // bucket chain
+};
+
+const type_t* type_prim(type_kind_t kind);
+const type_t* type_str(int length);
+const type_t* type_array(const type_t* elem, int length);
+const type_t* type_vec(const type_t* elem);
+const type_t* type_range(const type_t* elem);
+const type_t* type_fn(const type_t* result, const type_t** params, int param_count);
+const type_t* type_named(type_kind_t kind, name_id_t name);
+
+// set the members of a struct or union type, once
+void type_set_fields(const type_t* type, const type_field_t* fields, int count);
+const type_t* type_field(const type_t* type, name_id_t name);
+
+int type_is_integer(const type_t* type);
+int type_is_numeric(const type_t* type);
+int type_is_error(const type_t* type);
+
+// the coarse datatype_t shown in the symbol table
+datatype_t type_to_datatype(const type_t* type);
+
+// writes a readable form like "int[5]" or "fn(int, str) -> int" into buf
+const char* type_to_string(const type_t* type, char* buf, size_t size);
+
+// number of distinct types built so far
+unsigned int type_count(void);
+
+#endif
@@ -0,0 +1,60 @@
+#ifndef XREF_H_
+#define XREF_H_
+
+// Cross-reference index over a finished symbol table.
+// Built once after parsing from the definition and reference records.
+// Every span is kept twice: sorted by source position for "what is at
+// line:col" queries, and grouped by symbol for "where is X used".
+
+#include "symtab.h"
+
+typedef enum
+{
+    XREF_DEF,
+    XREF_READ,
+    XREF_WRITE
+} xref_kind_t;
+
+typedef struct
+{
+    int line;
+    int column;
+    int length;             // spans are a single identifier
+    unsigned int symbol;    // index in the table's symbol pool
+    xref_kind_t kind;
+} xref_entry_t;
+
+typedef struct
+{
+    symtab_t* table;
+
+    xref_entry_t* by_position;  // sorted by (line, column)
+    int count;
+
+    xref_entry_t* by_symbol;    // grouped by symbol, each group in source order
+    unsigned int* group_start;  // group i is by_symbol[group_start[i] .. group_start[i + 1])
+    unsigned int symbol_count;
+
+    unsigned int* unused;       // symbols that are never read, ascending
+    int unused_count;
+} xref_index_t;
+
+xref_index_t* xref_build(symtab_t* table);
+void xref_destroy(xref_index_t* index);
+
+// the span covering line:column, NULL if it isn't on an identifier
+const xref_entry_t* xref_at(xref_index_t* index, int line, int column);
+sym_entry_t* xref_symbol_at(xref_index_t* index, int line, int column);
+
+// definition first, then every use in source order
+const xref_entry_t* xref_references(xref_index_t* index, sym_entry_t* symbol, int* count);
+const xref_entry_t* xref_definition(xref_index_t* index, sym_entry_t* symbol);
+
+// symbols that are never read: variables, constants, parameters and
+// functions other than main. Write-only variables are included.
+const unsigned int* xref_unused(xref_index_t* index, int* count);
+int xref_is_unused(xref_index_t* index, sym_entry_t* symbol);
+
+void xref_print(xref_index_t* index);
+
+#endif
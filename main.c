@@ -8,7 +8,13 @@
 #include "utils.h"
 #include "scope.h"
 #include "symtab.h"
+#include "xref.h"
+#include "iface.h"
 #include "analysis.h"
+#include "callgraph.h"
+#include "anacache.h"
+#include "lower.h"
+#include "opt.h"
 
 char* filename;
 
@@ -18,11 +24,24 @@ int main(int argc, char* argv[])
 
     if (argc < 2) 
     {
-        printf("Usage: %s <filename>\n", argv[0]);
+        printf("Usage: %s <filename> [-i] [-g] [-c]\n", argv[0]);
+        printf("  -i    also write the module interface <filename>.pni\n");
+        printf("  -g    also write the call graph <filename>.dot\n");
+        printf("  -c    reuse unchanged functions from <filename>.pnc and update it\n");
         return -1;
     }
     
     filename = argv[1];
+
+    int write_iface = 0, write_graph = 0, use_cache = 0;
+    for (int i = 2; i < argc; i++)
+    {
+        if (strcmp(argv[i], "-i") == 0) write_iface = 1;
+        else if (strcmp(argv[i], "-g") == 0) write_graph = 1;
+        else if (strcmp(argv[i], "-c") == 0) use_cache = 1;
+        else printf("Ignoring unknown option %s\n", argv[i]);
+    }
+
     char path[256];
     strcpy(path, "test/");
     strcat(path, filename);
@@ -42,6 +61,7 @@ int main(int argc, char* argv[])
 
     // parsing starts here
     Parser* parser = init_parser(global_array->tokens, global_array->token_count);
+    parser->import_dir = "test/";
     
     ASTNode* root = parse_program(parser);
     if (root != NULL) 
@@ -49,16 +69,93 @@ int main(int argc, char* argv[])
         printf("\nParsing successful\n\n");
         print_ast(root, 0);
 
+        // test/name.pn -> test/name, for the files written below
+        char base_path[256];
+        strcpy(base_path, path);
+        char* ext = strrchr(base_path, '.');
+        if (ext && strcmp(ext, ".pn") == 0) *ext = '\0';
+
+        anacache_t* cache = NULL;
+        char cache_path[260];
+        if (use_cache)
+        {
+            strcpy(cache_path, base_path);
+            strcat(cache_path, ".pnc");
+
+            // a missing or unreadable file just means everything is checked
+            cache = anacache_create();
+            anacache_load(cache, cache_path);
+        }
+
+        // semantic analysis, fills in the symbol types shown below
+        printf("\n");
+        callgraph_t* cg = NULL;
+        int errors = start_analysis(root, parser->symtab, 0, cache, write_graph ? &cg : NULL);
+
+        if (cache)
+        {
+            if (anacache_save(cache, cache_path) != 0)
+                printf("Error: could not write %s\n", cache_path);
+            anacache_destroy(cache);
+        }
+
+        // only a program the parser and the analysis accepted has the
+        // types lowering needs
+        if (parser->error_count)
+            printf("%d error(s) while parsing, no IR generated\n", parser->error_count);
+        if (errors == 0 && parser->error_count == 0)
+        {
+            ir_module_t* ir = ir_lower_program(root, parser->symtab);
+            ir_optimize(ir);
+            printf("\n-------- IR ----------\n");
+            ir_print(ir, stdout);
+            int broken = ir_verify(ir);
+            if (broken) printf("IR verification failed: %d problem(s)\n", broken);
+            ir_module_destroy(ir);
+        }
+
         printf("\n-------- Symbol Table ----------\n");
         symtab_print(parser->symtab);
+
+        xref_index_t* xref = xref_build(parser->symtab);
+        xref_print(xref);
+        xref_destroy(xref);
+
+        if (write_iface)
+        {
+            char iface_path[260];
+            strcpy(iface_path, base_path);
+            strcat(iface_path, ".pni");
+
+            if (iface_write(parser->symtab, iface_path) == 0)
+                printf("\nWrote interface %s\n", iface_path);
+        }
+
+        if (write_graph)
+        {
+            char dot_path[260];
+            strcpy(dot_path, base_path);
+            strcat(dot_path, ".dot");
+
+            // the calls as written, the graph the analysis ran on
+            FILE* dot = fopen(dot_path, "w");
+            if (dot)
+            {
+                callgraph_write_dot(cg, dot);
+                fclose(dot);
+                printf("\nWrote call graph %s\n", dot_path);
+            }
+            else
+            {
+                printf("Error: could not write %s\n", dot_path);
+            }
+            callgraph_destroy(cg);
+        }
     } else 
     {
         printf("Parsing failed: %s\n", parser->error_msg);
     }
 
-    // semantic analysis
-    // start_analysis(root);
-
     // code generation - rv32
 
 
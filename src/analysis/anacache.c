@@ -0,0 +1,864 @@
+#include "anacache.h"
+#include "globaltab.h"
+#include "intern.h"
+#include "types.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define ANACACHE_MAGIC      "pencil-cache 3"
+#define ANACACHE_TYPE_DEPTH 8       // nested types hashed into a signature
+#define ANACACHE_LINE       4096    // longest line of the file
+#define ANACACHE_PER_LINE   32      // node types written on one line
+#define ANACACHE_MAX_NODES  (1 << 24)   // in one function, beyond is a damaged file
+
+typedef struct
+{
+    int line;           // relative to the declaration
+    int column;
+    diag_severity_t severity;
+    char* message;
+} anacache_diag_t;
+
+// a local symbol's type, by the identifier that first names it
+typedef struct
+{
+    int node;
+    int type;
+} anacache_local_t;
+
+typedef struct
+{
+    char* name;
+    unsigned long long body;
+    unsigned long long deps;
+    anacache_diag_t* diags;
+    int diag_count;
+
+    // what the checker found: the distinct types written out, see
+    // put_type, then one per node of the function in the order hash_node
+    // visits them, -1 for none, and the types of its locals
+    char** types;
+    int type_count;
+    int* node_types;
+    int node_count;
+    anacache_local_t* locals;
+    int local_count;
+
+    int live;           // looked up or stored this run, only these are saved
+} anacache_entry_t;
+
+struct anacache_t
+{
+    anacache_entry_t* entries;
+    int count;
+    int capacity;
+
+    int* slots;         // open addressing by name, -1 if empty, power of two
+    int slot_count;
+
+    int hits;
+    int misses;
+
+    // this run's hash of each global constant's value, by symbol index
+    unsigned long long* values;
+    unsigned int value_count;
+};
+
+static void* anacache_alloc(size_t size)
+{
+    void* m = calloc(1, size ? size : 1);
+    if (!m) { fprintf(stderr, "Out of memory\n"); exit(1); }
+    return m;
+}
+
+static char* anacache_strdup(const char* s)
+{
+    char* copy = anacache_alloc(strlen(s) + 1);
+    strcpy(copy, s);
+    return copy;
+}
+
+/* ---------- hashing ---------- */
+
+// 64-bit FNV-1a
+static unsigned long long hash_bytes(unsigned long long h, const void* data, size_t size)
+{
+    const unsigned char* p = data;
+    for (size_t i = 0; i < size; i++)
+    {
+        h ^= p[i];
+        h *= 1099511628211ULL;
+    }
+    return h;
+}
+
+static unsigned long long hash_int(unsigned long long h, long long v)
+{
+    return hash_bytes(h, &v, sizeof(v));
+}
+
+static unsigned long long hash_str(unsigned long long h, const char* s)
+{
+    // the terminator keeps "ab","c" apart from "a","bc"
+    return s ? hash_bytes(h, s, strlen(s) + 1) : hash_int(h, -1);
+}
+
+#define HASH_SEED 14695981039346656037ULL
+
+static unsigned long long hash_type(unsigned long long h, const type_t* type, int depth)
+{
+    if (!type) return hash_int(h, -1);
+
+    h = hash_int(h, type->kind);
+    h = hash_int(h, type->length);
+    h = hash_str(h, type->name != NAME_NONE ? intern_str(type->name) : NULL);
+    if (depth >= ANACACHE_TYPE_DEPTH) return h;
+
+    h = hash_type(h, type->elem, depth + 1);
+    for (int i = 0; i < type->param_count; i++)
+        h = hash_type(h, type->params[i], depth + 1);
+
+    // a struct's layout is part of the signature of everything using it
+    for (int i = 0; i < type->field_count; i++)
+    {
+        h = hash_str(h, intern_str(type->fields[i].name));
+        h = hash_type(h, type->fields[i].type, depth + 1);
+    }
+    return h;
+}
+
+typedef struct
+{
+    ASTNode** items;
+    int count;
+    int capacity;
+} anacache_nodes_t;
+
+typedef struct
+{
+    typecheck_t* tc;
+    const anacache_t* cache;
+    unsigned long long body;
+    unsigned long long deps;
+    int line;
+    int last_line;
+    anacache_nodes_t* nodes;    // when set, every node hashed is appended
+} anacache_hasher_t;
+
+// a global the body names: its type is what the body was checked against,
+// and a constant's value too
+static void hash_symbol(anacache_hasher_t* k, sym_entry_t* sym)
+{
+    if (!sym || sym->level > 0) return;
+
+    k->deps = hash_str(k->deps, sym_name(sym));
+    k->deps = hash_int(k->deps, sym->symbol_type);
+    k->deps = hash_type(k->deps, typecheck_symbol_type(k->tc, sym), 0);
+    if (k->cache && sym->index < k->cache->value_count)
+        k->deps = hash_int(k->deps, (long long)k->cache->values[sym->index]);
+}
+
+// a type annotation names a global type by its spelling
+static void hash_annotation(anacache_hasher_t* k, Token* token)
+{
+    if (!token || !token->lexeme) return;
+    k->body = hash_str(k->body, token->lexeme);
+
+    const globaltab_t* globals = symtab_globals(k->tc->table);
+    name_id_t name = intern_find(token->lexeme);
+    const sym_entry_t* sym = globals && name != NAME_NONE ? globaltab_lookup(globals, name) : NULL;
+    if (!sym || !sym_is_type((sym_entry_t*)sym)) return;
+
+    type_kind_t kind = sym->symbol_type == SYM_STRUCT ? TY_STRUCT : sym->symbol_type == SYM_ENUM ? TY_ENUM : TY_UNION;
+    k->deps = hash_str(k->deps, token->lexeme);
+    k->deps = hash_type(k->deps, type_named(kind, sym->name), 0);
+}
+
+static void hash_node(anacache_hasher_t* k, ASTNode* node)
+{
+    if (!node)
+    {
+        k->body = hash_int(k->body, -1);
+        return;
+    }
+
+    if (k->nodes)
+    {
+        anacache_nodes_t* n = k->nodes;
+        if (n->count == n->capacity)
+        {
+            n->capacity = n->capacity ? n->capacity * 2 : 64;
+            n->items = realloc(n->items, sizeof(ASTNode*) * n->capacity);
+            if (!n->items) { fprintf(stderr, "Out of memory\n"); exit(1); }
+        }
+        n->items[n->count++] = node;
+    }
+
+    k->body = hash_int(k->body, node->type);
+    // blocks carry no position of their own, line 0
+    k->body = hash_int(k->body, node->location.line > 0 ? node->location.line - k->line : -1);
+    k->body = hash_int(k->body, node->location.column);
+    if (node->location.line > k->last_line) k->last_line = node->location.line;
+
+    switch (node->type)
+    {
+        case AST_LITERAL:
+            k->body = hash_int(k->body, node->as.literal.kind);
+            k->body = hash_str(k->body, node->as.literal.value);
+            break;
+        case AST_IDENTIFIER:
+            k->body = hash_str(k->body, node->as.ident.name);
+            hash_symbol(k, node->as.ident.sym);
+            break;
+        case AST_UNARY:
+            k->body = hash_int(k->body, node->as.unary.op->type);
+            hash_node(k, node->as.unary.operand);
+            break;
+        case AST_BINARY:
+            k->body = hash_int(k->body, node->as.binary.op->type);
+            hash_node(k, node->as.binary.left);
+            hash_node(k, node->as.binary.right);
+            break;
+        case AST_ASSIGN:
+            k->body = hash_int(k->body, node->as.assign.op->type);
+            k->body = hash_str(k->body, node->as.assign.name ? node->as.assign.name->lexeme : NULL);
+            hash_symbol(k, node->as.assign.sym);
+            hash_node(k, node->as.assign.value);
+            break;
+        case AST_INDEX:
+            hash_node(k, node->as.idx.base);
+            hash_node(k, node->as.idx.index);
+            break;
+        case AST_FN_CALL:
+            hash_node(k, node->as.call.callee);
+            k->body = hash_int(k->body, node->as.call.arg_count);
+            for (int i = 0; i < node->as.call.arg_count; i++)
+                hash_node(k, node->as.call.args[i]);
+            break;
+        case AST_RANGE:
+            hash_node(k, node->as.rng.start);
+            hash_node(k, node->as.rng.end);
+            hash_node(k, node->as.rng.step);
+            break;
+        case AST_VAR_DECL:
+        case AST_CONST_DECL:
+            hash_annotation(k, node->as.declaration.data_type);
+            hash_node(k, node->as.declaration.ident);
+            hash_node(k, node->as.declaration.value);
+            break;
+        case AST_ARRAY_DECL:
+            hash_annotation(k, node->as.arr.type);
+            hash_node(k, node->as.arr.ident);
+            hash_node(k, node->as.arr.range);
+            k->body = hash_int(k->body, (long long)node->as.arr.literal_count);
+            for (size_t i = 0; i < node->as.arr.literal_count; i++)
+                hash_node(k, node->as.arr.literals[i]);
+            break;
+        case AST_FN_DECL:
+            hash_node(k, node->as.func.ident);
+            k->body = hash_int(k->body, (long long)node->as.func.params_count);
+            for (size_t i = 0; i < node->as.func.params_count; i++)
+                hash_node(k, node->as.func.params[i]);
+            hash_annotation(k, node->as.func.return_type);
+            hash_node(k, node->as.func.block);
+            hash_node(k, node->as.func.return_stmt);
+            break;
+        case AST_PARAM:
+            hash_annotation(k, node->as.param.type);
+            hash_node(k, node->as.param.ident);
+            break;
+        case AST_BLOCK:
+            k->body = hash_int(k->body, (long long)node->as.block.count);
+            for (size_t i = 0; i < node->as.block.count; i++)
+                hash_node(k, node->as.block.statements[i]);
+            break;
+        case AST_IF:
+            hash_node(k, node->as.ifstmt.condition);
+            hash_node(k, node->as.ifstmt.then_branch);
+            hash_node(k, node->as.ifstmt.else_branch);
+            break;
+        case AST_MATCH:
+            hash_node(k, node->as.matchstmt.pattern);
+            k->body = hash_int(k->body, (long long)node->as.matchstmt.case_count);
+            for (size_t i = 0; i < node->as.matchstmt.case_count; i++)
+                hash_node(k, node->as.matchstmt.match_cases[i]);
+            hash_node(k, node->as.matchstmt.def_case);
+            break;
+        case AST_MATCH_CASE:
+            hash_node(k, node->as.matchcase.expr);
+            hash_node(k, node->as.matchcase.stmt);
+            break;
+        case AST_LOOP:
+            hash_node(k, node->as.loop.condition);
+            hash_node(k, node->as.loop.block);
+            break;
+        case AST_LOOP_EXPR:
+            hash_node(k, node->as.loopexpr.variable);
+            hash_node(k, node->as.loopexpr.expr);
+            break;
+        case AST_RETURN:
+            hash_node(k, node->as.return_stmt.expr);
+            break;
+        default:
+            break;
+    }
+}
+
+void anacache_begin(anacache_t* cache, typecheck_t* tc, ASTNode* prog)
+{
+    if (!cache || !prog || prog->type != AST_PROGRAM) return;
+
+    free(cache->values);
+    cache->value_count = tc->table ? tc->table->sym_count : 0;
+    cache->values = anacache_alloc(sizeof(unsigned long long) * cache->value_count);
+
+    // in program order, so a constant defined by earlier ones takes their values in
+    for (int i = 0; i < prog->as.program.stmt_count; i++)
+    {
+        ASTNode* node = prog->as.program.statements[i];
+        if (!node || node->type != AST_CONST_DECL) continue;
+
+        sym_entry_t* sym = node->as.declaration.ident->as.ident.sym;
+        if (!sym || sym->index >= cache->value_count) continue;
+
+        anacache_hasher_t k = { .tc = tc, .cache = cache, .body = HASH_SEED, .deps = HASH_SEED };
+        k.line = k.last_line = node->location.line;
+        hash_node(&k, node->as.declaration.value);
+        cache->values[sym->index] = hash_int(k.body, (long long)k.deps);
+    }
+}
+
+anacache_key_t anacache_key(anacache_t* cache, typecheck_t* tc, ASTNode* fn)
+{
+    anacache_hasher_t k = { .tc = tc, .cache = cache, .body = HASH_SEED, .deps = HASH_SEED };
+    k.line = k.last_line = fn->location.line;
+    hash_node(&k, fn);
+
+    // the function's own signature, callers depend on it through deps
+    hash_symbol(&k, fn->as.func.ident->as.ident.sym);
+
+    return (anacache_key_t){ k.body, k.deps, k.line, k.last_line };
+}
+
+// the nodes of a function in the order hash_node visits them
+static void anacache_nodes(typecheck_t* tc, ASTNode* fn, anacache_nodes_t* nodes)
+{
+    anacache_hasher_t k = { .tc = tc, .body = HASH_SEED, .deps = HASH_SEED, .nodes = nodes };
+    k.line = k.last_line = fn->location.line;
+    hash_node(&k, fn);
+}
+
+/* ---------- types as text ---------- */
+
+typedef struct
+{
+    char* text;
+    size_t length;
+    size_t capacity;
+} anacache_text_t;
+
+static void text_add(anacache_text_t* t, const char* s)
+{
+    size_t n = strlen(s);
+    if (t->length + n + 1 > t->capacity)
+    {
+        t->capacity = (t->length + n + 1) * 2;
+        t->text = realloc(t->text, t->capacity);
+        if (!t->text) { fprintf(stderr, "Out of memory\n"); exit(1); }
+    }
+    memcpy(t->text + t->length, s, n + 1);
+    t->length += n;
+}
+
+// a type in prefix form, fields separated by commas: the kind, then
+// str: length; array: length, element; vec and range: element;
+// fn: parameter count, result, parameters; struct, enum, union: name.
+// '.' is no type, where a fn has no result yet.
+static void put_type(anacache_text_t* t, const type_t* type)
+{
+    char buf[32];
+    if (!type)
+    {
+        text_add(t, ".");
+        return;
+    }
+
+    snprintf(buf, sizeof(buf), "%d", (int)type->kind);
+    text_add(t, buf);
+    switch (type->kind)
+    {
+        case TY_STR:
+            snprintf(buf, sizeof(buf), ",%d", type->length);
+            text_add(t, buf);
+            break;
+        case TY_ARRAY:
+            snprintf(buf, sizeof(buf), ",%d,", type->length);
+            text_add(t, buf);
+            put_type(t, type->elem);
+            break;
+        case TY_VEC:
+        case TY_RANGE:
+            text_add(t, ",");
+            put_type(t, type->elem);
+            break;
+        case TY_FN:
+            snprintf(buf, sizeof(buf), ",%d,", type->param_count);
+            text_add(t, buf);
+            put_type(t, type->elem);
+            for (int i = 0; i < type->param_count; i++)
+            {
+                text_add(t, ",");
+                put_type(t, type->params[i]);
+            }
+            break;
+        case TY_STRUCT:
+        case TY_ENUM:
+        case TY_UNION:
+            text_add(t, ",");
+            text_add(t, intern_str(type->name));
+            break;
+        default:
+            break;
+    }
+}
+
+static int get_int(const char** p, long* out)
+{
+    char* end;
+    *out = strtol(*p, &end, 10);
+    if (end == *p) return 0;
+    *p = end;
+    return 1;
+}
+
+static int get_comma(const char** p)
+{
+    if (**p != ',') return 0;
+    (*p)++;
+    return 1;
+}
+
+// the inverse of put_type, 0 if the text is damaged
+static int get_type(const char** p, const type_t** out, int depth)
+{
+    if (**p == '.')
+    {
+        (*p)++;
+        *out = NULL;
+        return 1;
+    }
+
+    long kind, n;
+    const type_t* elem;
+    if (depth > ANACACHE_TYPE_DEPTH * 8 || !get_int(p, &kind)) return 0;
+
+    switch (kind)
+    {
+        case TY_STR:
+            if (!get_comma(p) || !get_int(p, &n)) return 0;
+            *out = type_str((int)n);
+            return 1;
+        case TY_ARRAY:
+            if (!get_comma(p) || !get_int(p, &n) || !get_comma(p) || !get_type(p, &elem, depth + 1) || !elem)
+                return 0;
+            *out = type_array(elem, (int)n);
+            return 1;
+        case TY_VEC:
+        case TY_RANGE:
+            if (!get_comma(p) || !get_type(p, &elem, depth + 1) || !elem) return 0;
+            *out = kind == TY_VEC ? type_vec(elem) : type_range(elem);
+            return 1;
+        case TY_FN:
+        {
+            if (!get_comma(p) || !get_int(p, &n) || n < 0 || n > 4096 || !get_comma(p)
+                || !get_type(p, &elem, depth + 1))
+                return 0;
+            const type_t** params = anacache_alloc(sizeof(const type_t*) * n);
+            int ok = 1;
+            for (long i = 0; ok && i < n; i++)
+                ok = get_comma(p) && get_type(p, &params[i], depth + 1) && params[i];
+            if (ok) *out = type_fn(elem, params, (int)n);
+            free(params);
+            return ok;
+        }
+        case TY_STRUCT:
+        case TY_ENUM:
+        case TY_UNION:
+        {
+            if (!get_comma(p)) return 0;
+            size_t length = strcspn(*p, ", ");
+            if (length == 0 || length >= 256) return 0;
+            char name[256];
+            memcpy(name, *p, length);
+            name[length] = '\0';
+            *p += length;
+            *out = type_named((type_kind_t)kind, intern(name));
+            return 1;
+        }
+        default:
+            if (kind < TY_ERROR || kind > TY_DOUBLE) return 0;
+            *out = type_prim((type_kind_t)kind);
+            return 1;
+    }
+}
+
+/* ---------- the table ---------- */
+
+anacache_t* anacache_create(void)
+{
+    anacache_t* cache = anacache_alloc(sizeof(anacache_t));
+    cache->slot_count = 64;
+    cache->slots = anacache_alloc(sizeof(int) * cache->slot_count);
+    memset(cache->slots, -1, sizeof(int) * cache->slot_count);
+    return cache;
+}
+
+static void anacache_clear_entry(anacache_entry_t* e)
+{
+    for (int i = 0; i < e->diag_count; i++)
+        free(e->diags[i].message);
+    free(e->diags);
+    e->diags = NULL;
+    e->diag_count = 0;
+
+    for (int i = 0; i < e->type_count; i++)
+        free(e->types[i]);
+    free(e->types);
+    free(e->node_types);
+    free(e->locals);
+    e->types = NULL;
+    e->node_types = NULL;
+    e->locals = NULL;
+    e->type_count = e->node_count = e->local_count = 0;
+}
+
+void anacache_destroy(anacache_t* cache)
+{
+    if (!cache) return;
+    for (int i = 0; i < cache->count; i++)
+    {
+        anacache_clear_entry(&cache->entries[i]);
+        free(cache->entries[i].name);
+    }
+    free(cache->entries);
+    free(cache->slots);
+    free(cache->values);
+    free(cache);
+}
+
+static int* anacache_slot(const anacache_t* cache, const char* name)
+{
+    unsigned int mask = (unsigned int)cache->slot_count - 1;
+    unsigned int i = (unsigned int)hash_str(HASH_SEED, name) & mask;
+    while (cache->slots[i] >= 0 && strcmp(cache->entries[cache->slots[i]].name, name) != 0)
+        i = (i + 1) & mask;
+    return &cache->slots[i];
+}
+
+static anacache_entry_t* anacache_find(const anacache_t* cache, const char* name)
+{
+    int slot = *anacache_slot(cache, name);
+    return slot >= 0 ? &cache->entries[slot] : NULL;
+}
+
+static anacache_entry_t* anacache_insert(anacache_t* cache, const char* name)
+{
+    anacache_entry_t* e = anacache_find(cache, name);
+    if (e) return e;
+
+    // keep the table at most half full
+    if ((cache->count + 1) * 2 > cache->slot_count)
+    {
+        free(cache->slots);
+        cache->slot_count *= 2;
+        cache->slots = anacache_alloc(sizeof(int) * cache->slot_count);
+        memset(cache->slots, -1, sizeof(int) * cache->slot_count);
+        for (int i = 0; i < cache->count; i++)
+            *anacache_slot(cache, cache->entries[i].name) = i;
+    }
+
+    if (cache->count == cache->capacity)
+    {
+        cache->capacity = cache->capacity ? cache->capacity * 2 : 64;
+        cache->entries = realloc(cache->entries, sizeof(anacache_entry_t) * cache->capacity);
+        if (!cache->entries) { fprintf(stderr, "Out of memory\n"); exit(1); }
+    }
+
+    e = &cache->entries[cache->count];
+    memset(e, 0, sizeof(*e));
+    e->name = anacache_strdup(name);
+    *anacache_slot(cache, name) = cache->count++;
+    return e;
+}
+
+static void anacache_add_diag(anacache_entry_t* e, int line, int column, diag_severity_t severity, const char* message)
+{
+    e->diags = realloc(e->diags, sizeof(anacache_diag_t) * (e->diag_count + 1));
+    if (!e->diags) { fprintf(stderr, "Out of memory\n"); exit(1); }
+    e->diags[e->diag_count++] = (anacache_diag_t){ line, column, severity, anacache_strdup(message) };
+}
+
+static const char* anacache_name(ASTNode* fn)
+{
+    return fn->as.func.ident->as.ident.name;
+}
+
+// the entry's types back on the function's nodes and locals, 0 if they
+// do not fit, when the tree is left as it was
+static int anacache_restore(anacache_entry_t* e, typecheck_t* tc, ASTNode* fn)
+{
+    anacache_nodes_t nodes = { 0 };
+    anacache_nodes(tc, fn, &nodes);
+
+    const type_t** types = anacache_alloc(sizeof(const type_t*) * (e->type_count + 1));
+    int ok = nodes.count == e->node_count;
+    for (int i = 0; ok && i < e->type_count; i++)
+    {
+        const char* p = e->types[i];
+        ok = get_type(&p, &types[i], 0) && *p == '\0';
+    }
+    for (int i = 0; ok && i < e->node_count; i++)
+        ok = e->node_types[i] >= -1 && e->node_types[i] < e->type_count;
+    for (int i = 0; ok && i < e->local_count; i++)
+    {
+        const anacache_local_t* l = &e->locals[i];
+        ok = l->node >= 0 && l->node < nodes.count && l->type >= 0 && l->type < e->type_count
+             && nodes.items[l->node]->type == AST_IDENTIFIER && nodes.items[l->node]->as.ident.sym;
+    }
+
+    if (ok)
+    {
+        for (int i = 0; i < e->node_count; i++)
+            nodes.items[i]->ty = e->node_types[i] >= 0 ? types[e->node_types[i]] : NULL;
+        for (int i = 0; i < e->local_count; i++)
+            typecheck_set_symbol_type(tc, nodes.items[e->locals[i].node]->as.ident.sym, types[e->locals[i].type]);
+    }
+
+    free(types);
+    free(nodes.items);
+    return ok;
+}
+
+int anacache_lookup(anacache_t* cache, typecheck_t* tc, ASTNode* fn, anacache_key_t key, diag_list_t* diags)
+{
+    anacache_entry_t* e = cache ? anacache_find(cache, anacache_name(fn)) : NULL;
+    if (!e || e->body != key.body || e->deps != key.deps || !anacache_restore(e, tc, fn))
+    {
+        if (cache) cache->misses++;
+        return 0;
+    }
+
+    for (int i = 0; i < e->diag_count; i++)
+    {
+        SourceLocation loc = { NULL, key.line + e->diags[i].line, e->diags[i].column };
+        diag_report(diags, e->diags[i].severity, loc, "%s", e->diags[i].message);
+    }
+    e->live = 1;
+    cache->hits++;
+    return 1;
+}
+
+// the index of type in the entry's table, added when new
+static int anacache_type_index(anacache_entry_t* e, const type_t* type, const type_t*** seen)
+{
+    for (int i = 0; i < e->type_count; i++)
+        if ((*seen)[i] == type) return i;
+
+    anacache_text_t t = { 0 };
+    put_type(&t, type);
+
+    e->types = realloc(e->types, sizeof(char*) * (e->type_count + 1));
+    *seen = realloc(*seen, sizeof(const type_t*) * (e->type_count + 1));
+    if (!e->types || !*seen) { fprintf(stderr, "Out of memory\n"); exit(1); }
+    e->types[e->type_count] = t.text;
+    (*seen)[e->type_count] = type;
+    return e->type_count++;
+}
+
+void anacache_store(anacache_t* cache, typecheck_t* tc, ASTNode* fn, anacache_key_t key, const diag_list_t* diags)
+{
+    if (!cache) return;
+
+    anacache_entry_t* e = anacache_insert(cache, anacache_name(fn));
+    anacache_clear_entry(e);
+    e->body = key.body;
+    e->deps = key.deps;
+    e->live = 1;
+
+    for (int i = 0; i < diags->count; i++)
+    {
+        const diag_t* d = &diags->items[i];
+        if (d->line >= key.line && d->line <= key.last_line)
+            anacache_add_diag(e, d->line - key.line, d->column, d->severity, d->message);
+    }
+
+    anacache_nodes_t nodes = { 0 };
+    anacache_nodes(tc, fn, &nodes);
+    const type_t** seen = NULL;
+
+    unsigned char* named = anacache_alloc(tc->sym_count);
+
+    e->node_count = nodes.count;
+    e->node_types = anacache_alloc(sizeof(int) * (nodes.count + 1));
+    e->locals = anacache_alloc(sizeof(anacache_local_t) * (nodes.count + 1));
+    for (int i = 0; i < nodes.count; i++)
+    {
+        ASTNode* node = nodes.items[i];
+        e->node_types[i] = node->ty ? anacache_type_index(e, node->ty, &seen) : -1;
+
+        // each local once, where it is first named
+        sym_entry_t* sym = node->type == AST_IDENTIFIER ? node->as.ident.sym : NULL;
+        const type_t* type = sym && sym->level > 0 ? typecheck_symbol_type(tc, sym) : NULL;
+        if (!type || named[sym->index]) continue;
+        named[sym->index] = 1;
+        e->locals[e->local_count++] = (anacache_local_t){ i, anacache_type_index(e, type, &seen) };
+    }
+
+    // a type too long for a line of the file is checked again next time
+    for (int i = 0; i < e->type_count; i++)
+        if (strlen(e->types[i]) + 3 > ANACACHE_LINE) e->live = 0;
+
+    free(named);
+    free(seen);
+    free(nodes.items);
+}
+
+int anacache_hits(const anacache_t* cache)
+{
+    return cache ? cache->hits : 0;
+}
+
+int anacache_misses(const anacache_t* cache)
+{
+    return cache ? cache->misses : 0;
+}
+
+/* ---------- the file ---------- */
+
+// fn <name> <body> <deps> <diagnostics> <types> <nodes> <locals>, then
+//   <severity> <line> <column> <message>     one per diagnostic
+//   t <type>                                 one per type, see put_type
+//   n <type> <type> ...                      the nodes' types, a line per 32
+//   l <node> <type>                          one per local
+int anacache_save(const anacache_t* cache, const char* path)
+{
+    if (!cache || !path) return -1;
+
+    FILE* out = fopen(path, "w");
+    if (!out) return -1;
+
+    fprintf(out, "%s\n", ANACACHE_MAGIC);
+    for (int i = 0; i < cache->count; i++)
+    {
+        const anacache_entry_t* e = &cache->entries[i];
+        if (!e->live) continue;
+
+        fprintf(out, "fn %s %llx %llx %d %d %d %d\n", e->name, e->body, e->deps, e->diag_count,
+                e->type_count, e->node_count, e->local_count);
+        for (int j = 0; j < e->diag_count; j++)
+            fprintf(out, "%d %d %d %s\n", (int)e->diags[j].severity, e->diags[j].line,
+                    e->diags[j].column, e->diags[j].message);
+        for (int j = 0; j < e->type_count; j++)
+            fprintf(out, "t %s\n", e->types[j]);
+        for (int j = 0; j < e->node_count; j++)
+            fprintf(out, "%s%d%s", j % ANACACHE_PER_LINE ? " " : "n ", e->node_types[j],
+                    j % ANACACHE_PER_LINE == ANACACHE_PER_LINE - 1 || j == e->node_count - 1 ? "\n" : "");
+        for (int j = 0; j < e->local_count; j++)
+            fprintf(out, "l %d %d\n", e->locals[j].node, e->locals[j].type);
+    }
+
+    return fclose(out) == 0 ? 0 : -1;
+}
+
+static int anacache_read_line(FILE* in, char* line)
+{
+    if (!fgets(line, ANACACHE_LINE, in)) return 0;
+    line[strcspn(line, "\n")] = '\0';
+    return 1;
+}
+
+// the lines after an entry's header, 0 if they are not what it announced
+static int anacache_read_entry(FILE* in, anacache_entry_t* e, int diags, int types, int nodes, int locals)
+{
+    char line[ANACACHE_LINE];
+    if (diags < 0 || nodes < 0 || nodes > ANACACHE_MAX_NODES || types < 0 || types > 2 * nodes
+        || locals < 0 || locals > nodes)
+        return 0;
+
+    for (int i = 0; i < diags; i++)
+    {
+        int severity, rel, column, used = 0;
+        if (!anacache_read_line(in, line) || sscanf(line, "%d %d %d %n", &severity, &rel, &column, &used) != 3)
+            return 0;
+        anacache_add_diag(e, rel, column, (diag_severity_t)severity, line + used);
+    }
+
+    e->types = anacache_alloc(sizeof(char*) * (types + 1));
+    for (; e->type_count < types; e->type_count++)
+    {
+        if (!anacache_read_line(in, line) || strncmp(line, "t ", 2) != 0) return 0;
+        e->types[e->type_count] = anacache_strdup(line + 2);
+    }
+
+    e->node_types = anacache_alloc(sizeof(int) * (nodes + 1));
+    while (e->node_count < nodes)
+    {
+        if (!anacache_read_line(in, line) || strncmp(line, "n ", 2) != 0) return 0;
+        const char* p = line + 1;
+        long v;
+        for (int j = 0; j < ANACACHE_PER_LINE && e->node_count < nodes; j++)
+        {
+            if (!get_int(&p, &v)) return 0;
+            e->node_types[e->node_count++] = (int)v;
+        }
+    }
+
+    e->locals = anacache_alloc(sizeof(anacache_local_t) * (locals + 1));
+    for (; e->local_count < locals; e->local_count++)
+    {
+        anacache_local_t* l = &e->locals[e->local_count];
+        if (!anacache_read_line(in, line) || sscanf(line, "l %d %d", &l->node, &l->type) != 2) return 0;
+    }
+    return 1;
+}
+
+int anacache_load(anacache_t* cache, const char* path)
+{
+    if (!cache || !path) return -1;
+
+    FILE* in = fopen(path, "r");
+    if (!in) return -1;
+
+    char line[ANACACHE_LINE];
+    if (!anacache_read_line(in, line) || strcmp(line, ANACACHE_MAGIC) != 0)
+    {
+        fclose(in);
+        return -1;
+    }
+
+    while (anacache_read_line(in, line))
+    {
+        char name[256];
+        unsigned long long body, deps;
+        int diags, types, nodes, locals;
+        if (sscanf(line, "fn %255s %llx %llx %d %d %d %d", name, &body, &deps, &diags, &types, &nodes, &locals) != 7)
+            continue;
+
+        anacache_entry_t* e = anacache_insert(cache, name);
+        anacache_clear_entry(e);
+        e->body = body;
+        e->deps = deps;
+
+        // a damaged entry only costs a full check of its function
+        if (!anacache_read_entry(in, e, diags, types, nodes, locals))
+        {
+            anacache_clear_entry(e);
+            e->body = e->deps = 0;
+        }
+    }
+
+    fclose(in);
+    return 0;
+}
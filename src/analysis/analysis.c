@@ -1,121 +1,189 @@
+#define _POSIX_C_SOURCE 200809L     // sysconf under -std=c99
+
 #include "analysis.h"
+#include "anacache.h"
 #include "ast.h"
-#include "parser.h"
-#include "token.h"
+#include "bounds.h"
+#include "callgraph.h"
+#include "diag.h"
+#include "effects.h"
+#include "escape.h"
+#include "fold.h"
+#include "match.h"
+#include "ctfe.h"
+#include "dataflow.h"
+#include "globaltab.h"
+#include "typecheck.h"
+#include "types.h"
+#include <pthread.h>
 #include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
 
 
-// analysis starts by taking a program node.
-void start_analysis(ASTNode* prog)
+// Function bodies still to check. Workers take the next one with an
+// atomic increment, and each function reports into its own lists so the
+// messages can be merged in program order afterwards.
+typedef struct
 {
-    if (prog->type != AST_PROGRAM) return;
+    typecheck_t* tc;
+    ASTNode** fns;
+    diag_list_t* diags;     // one per function, from the type checker
+    diag_list_t* flow;      // one per function, from the dataflow checks
+    int count;
+    int next;
+} analysis_queue_t;
 
-    ("Starting analysis...\n");
+static void* analysis_worker(void* arg)
+{
+    analysis_queue_t* queue = arg;
+    dataflow_t* df = dataflow_create(queue->tc->table);
 
-    for (int i = 0; i < prog->as.program.stmt_count; i++)
+    for (;;)
     {
-        ASTNode* node = prog->as.program.statements[i];
-        ASTNodeType type = node->type;
-        astnodetype_to_string(type);
-        analyse_node(node);
+        int i = __atomic_fetch_add(&queue->next, 1, __ATOMIC_RELAXED);
+        if (i >= queue->count) break;
+
+        // a cached function has its types and diagnostics restored already
+        if (queue->fns[i]->as.func.cached) continue;
+        typecheck_t worker = typecheck_worker(queue->tc, &queue->diags[i]);
+        typecheck_function(&worker, queue->fns[i]);
+        dataflow_check_function(df, queue->fns[i], &queue->flow[i]);
     }
 
-    ("End of analysis\n");
+    dataflow_destroy(df);
+    return NULL;
 }
 
+static int analysis_threads(int threads, int work)
+{
+    if (threads <= 0)
+    {
+        long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+        threads = cpus > 0 ? (int)cpus : 1;
+    }
+    return threads < work ? threads : work;
+}
 
-// check for nodes in a node
-void analyse_node(ASTNode* node)
+// check the bodies left by typecheck_declarations and run the dataflow
+// checks, in parallel, on every function the cache does not hold
+static void analysis_check_functions(typecheck_t* tc, ASTNode* prog, diag_list_t* diags, int threads,
+                                     anacache_t* cache)
 {
-    ASTNodeType type = node->type;
+    analysis_queue_t queue = { .tc = tc };
+    queue.fns = malloc(sizeof(ASTNode*) * (prog->as.program.stmt_count + 1));
+    if (!queue.fns) { fprintf(stderr, "Out of memory\n"); exit(1); }
 
-    switch (type){
-        case AST_BLOCK:
-        {
-            break;
-        }
-        case AST_LITERAL:
-            break;
-        case AST_IDENTIFIER:
-            break;
-        case AST_UNARY:
-            break;
-        case AST_BINARY:
-            break;
-        case AST_ASSIGN:
-            break;
-        case AST_INDEX:
-            break;
-        case AST_FN_CALL:
-            break;
-        case AST_RANGE:
-            break;
-        case AST_VAR_DECL:
-        case AST_CONST_DECL:
-        {
-            Token* type = node->as.declaration.data_type;
-            ASTNode* identifier = node->as.declaration.ident;
-            ASTNode* value = node->as.declaration.value;
-            // TODO: Check that type is set else infer the type from 
-            // the literal or expression assigned to the variable or constant
-            printf("   Declaration analysed\n");
-            break;
-        }
-        case AST_FN_DECL:
-        {
-            // params
-            if (node->as.func.params_count != 0) 
-            {
-                for (int i = 0; i < node->as.func.params_count; i++)
-                {
-                    if (node->as.func.params[i] != NULL)
-                        analyse_node(node->as.func.params[i]);
-                }
-            }
-             
-            // return type
-            // block 
-            ASTNode* block = node->as.func.block;
-            int blk_stmt_count = block->as.block.count;
-            for (int i = 0; i < blk_stmt_count; i++)
-            {
-                ASTNodeType block_node_type = block->as.block.statements[i]->type;
-                printf(" - ");
-                astnodetype_to_string(block_node_type);
-                analyse_node(block->as.block.statements[i]);
-            }
-            break;
-        }
-        case AST_ARRAY_DECL:
-            break;
-        case AST_PARAM:
+    for (int i = 0; i < prog->as.program.stmt_count; i++)
+    {
+        ASTNode* stmt = prog->as.program.statements[i];
+        if (stmt && stmt->type == AST_FN_DECL) queue.fns[queue.count++] = stmt;
+    }
+
+    queue.diags = calloc(queue.count + 1, sizeof(diag_list_t));
+    queue.flow = calloc(queue.count + 1, sizeof(diag_list_t));
+    anacache_key_t* keys = calloc(queue.count + 1, sizeof(anacache_key_t));
+    if (!queue.diags || !queue.flow || !keys) { fprintf(stderr, "Out of memory\n"); exit(1); }
+    for (int i = 0; i < queue.count; i++)
+    {
+        diag_init(&queue.diags[i]);
+        diag_init(&queue.flow[i]);
+    }
+
+    // keys before any body is checked, the signatures are complete by now
+    if (cache)
+    {
+        anacache_begin(cache, tc, prog);
+        for (int i = 0; i < queue.count; i++)
         {
-            astnodetype_to_string(node->type);
-            break;
+            ASTNode* fn = queue.fns[i];
+            if (!fn->as.func.block) continue;
+            keys[i] = anacache_key(cache, tc, fn);
+            if (anacache_lookup(cache, tc, fn, keys[i], &queue.flow[i])) fn->as.func.cached = 1;
         }
-        case AST_STRUCT:
-            break;
-        case AST_ENUM:
-            break;
-        case AST_VECTOR:
-            break;
-        case AST_FIELD:
-            break;
-        case AST_UNION:
-            break;
-        case AST_IF:
-            break;
-        case AST_MATCH:
-            break;
-        case AST_MATCH_CASE:
-            break;
-        case AST_LOOP:
-            break;
-        case AST_LOOP_EXPR:
-            break;
-        case AST_RETURN:
-            break;
-        default:
-            break;
-    }   
+    }
+
+    threads = analysis_threads(threads, queue.count);
+    pthread_t* ids = malloc(sizeof(pthread_t) * (threads > 0 ? threads : 1));
+    if (!ids) { fprintf(stderr, "Out of memory\n"); exit(1); }
+
+    // this thread is a worker too
+    int started = 0;
+    for (int i = 1; i < threads; i++)
+        if (pthread_create(&ids[started], NULL, analysis_worker, &queue) == 0) started++;
+    analysis_worker(&queue);
+    for (int i = 0; i < started; i++) pthread_join(ids[i], NULL);
+
+    for (int i = 0; i < queue.count; i++)
+    {
+        ASTNode* fn = queue.fns[i];
+        // one list for both checks, in the order they ran
+        diag_merge(&queue.diags[i], &queue.flow[i]);
+        if (cache && fn->as.func.block && !fn->as.func.cached) anacache_store(cache, tc, fn, keys[i], &queue.diags[i]);
+        diag_merge(diags, &queue.diags[i]);
+    }
+
+    free(ids);
+    free(keys);
+    free(queue.diags);
+    free(queue.flow);
+    free(queue.fns);
+}
+
+// analysis starts by taking a program node.
+int start_analysis(ASTNode* prog, symtab_t* table, int threads, anacache_t* cache, callgraph_t** graph)
+{
+    if (graph) *graph = NULL;
+    if (prog == NULL || prog->type != AST_PROGRAM) return 0;
+
+    printf("Starting analysis...\n");
+
+    diag_list_t diags;
+    diag_init(&diags);
+
+    // the top level is complete after the declarations, from then on the
+    // workers read the globals without locks
+    typecheck_t* tc = typecheck_create(table, &diags);
+    typecheck_declarations(tc, prog);
+    if (table) symtab_freeze_globals(table);
+
+    analysis_check_functions(tc, prog, &diags, threads, cache);
+
+    // the calls as written, before folding replaces some with their value
+    callgraph_t* cg = callgraph_build(prog, table);
+    callgraph_print_stats(cg);
+    effects_t* fx = effects_compute(cg);
+    effects_print_stats(fx);
+
+    // constants are only folded in a well-typed tree
+    ctfe_t* ctfe = ctfe_create(tc, fx, &diags);
+    int folded = diags.errors == 0 ? fold_program(prog, tc, ctfe, fx, &diags) : 0;
+    if (diags.errors == 0) match_program(prog, &diags);
+    if (diags.errors == 0) bounds_program(prog, table, &diags);
+    if (diags.errors == 0)
+    {
+        escape_t* esc = escape_analyze(prog, table, cg);
+        escape_print_stats(esc);
+        escape_destroy(esc);
+    }
+
+    if (cache) printf("Cache: %d function(s) reused, %d checked\n", anacache_hits(cache), anacache_misses(cache));
+
+    int evaluated = ctfe_evaluated(ctfe);
+    ctfe_destroy(ctfe);
+    effects_destroy(fx);
+    if (graph) *graph = cg;
+    else callgraph_destroy(cg);
+    typecheck_destroy(tc);
+
+    if (table) diag_merge(&diags, &table->diags);  // unused locals, from the parser
+    diag_sort(&diags);
+    diag_print(&diags);
+
+    int errors = diags.errors;
+    printf("End of analysis: %d error(s), %u type(s), %d constant(s) folded, %d call(s) evaluated\n",
+           errors, type_count(), folded, evaluated);
+
+    diag_free(&diags);
+    return errors;
 }
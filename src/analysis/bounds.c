@@ -0,0 +1,803 @@
+#include "bounds.h"
+#include "fold.h"
+#include "types.h"
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+static const interval_t INTERVAL_TOP = { INT64_MIN, INT64_MAX };
+
+// what the tracked variables may hold at one point of a body
+typedef struct
+{
+    interval_t* vars;
+    int reachable;
+} bounds_state_t;
+
+typedef struct
+{
+    symtab_t* table;
+    diag_list_t* diags;
+
+    // the integer locals of the function being checked
+    int* var_of;                // by symbol index, -1 if not tracked
+    sym_entry_t** syms;
+    interval_t* domain;         // what each one's type can hold
+    unsigned char* escaped;     // assigned by a nested function, never known
+    int var_count;
+    int var_capacity;
+
+    ASTNode** nested;           // functions declared inside it
+    int nested_count;
+    int nested_capacity;
+
+    int marking;                // the final pass over a body, see bounds_loop
+    int indexes;
+    int proven;
+} bounds_t;
+
+static void* bounds_alloc(size_t size)
+{
+    void* m = calloc(1, size ? size : 1);
+    if (!m) { fprintf(stderr, "Out of memory\n"); exit(1); }
+    return m;
+}
+
+/* ---------- intervals ---------- */
+
+// the values of an integer type, TOP for everything else
+static interval_t interval_of_type(const type_t* type)
+{
+    if (!type) return INTERVAL_TOP;
+
+    switch (type->kind)
+    {
+        case TY_BOOL:  return (interval_t){ 0, 1 };
+        case TY_CHAR:
+        case TY_BYTE:  return (interval_t){ 0, 255 };
+        case TY_SHORT: return (interval_t){ INT16_MIN, INT16_MAX };
+        case TY_INT:   return (interval_t){ INT32_MIN, INT32_MAX };
+        default:       return INTERVAL_TOP;
+    }
+}
+
+static int interval_is_integer(const type_t* type)
+{
+    return type && (type->kind == TY_BOOL || type->kind == TY_CHAR || type->kind == TY_BYTE
+                    || type->kind == TY_SHORT || type->kind == TY_INT || type->kind == TY_LONG);
+}
+
+// a value outside the type wraps, so nothing is known of it
+static interval_t interval_fit(interval_t v, interval_t domain)
+{
+    return v.low >= domain.low && v.high <= domain.high ? v : domain;
+}
+
+static interval_t interval_join(interval_t a, interval_t b)
+{
+    return (interval_t){ a.low < b.low ? a.low : b.low, a.high > b.high ? a.high : b.high };
+}
+
+static long long min_ll(long long a, long long b) { return a < b ? a : b; }
+static long long max_ll(long long a, long long b) { return a > b ? a : b; }
+
+static interval_t interval_binary(TokenType op, interval_t l, interval_t r)
+{
+    long long a, b, c, d;
+
+    switch (op)
+    {
+        case PLUS:
+            if (__builtin_add_overflow(l.low, r.low, &a) || __builtin_add_overflow(l.high, r.high, &b))
+                return INTERVAL_TOP;
+            return (interval_t){ a, b };
+        case MINUS:
+            if (__builtin_sub_overflow(l.low, r.high, &a) || __builtin_sub_overflow(l.high, r.low, &b))
+                return INTERVAL_TOP;
+            return (interval_t){ a, b };
+        case STAR:
+            if (__builtin_mul_overflow(l.low, r.low, &a) || __builtin_mul_overflow(l.low, r.high, &b)
+                || __builtin_mul_overflow(l.high, r.low, &c) || __builtin_mul_overflow(l.high, r.high, &d))
+                return INTERVAL_TOP;
+            return (interval_t){ min_ll(min_ll(a, b), min_ll(c, d)), max_ll(max_ll(a, b), max_ll(c, d)) };
+        case SLASH:
+            // monotonic in each operand while the divisor keeps its sign
+            if (r.low <= 0 && r.high >= 0) return INTERVAL_TOP;
+            if ((l.low == INT64_MIN && (r.low == -1 || r.high == -1))) return INTERVAL_TOP;
+            a = l.low / r.low;  b = l.low / r.high;
+            c = l.high / r.low; d = l.high / r.high;
+            return (interval_t){ min_ll(min_ll(a, b), min_ll(c, d)), max_ll(max_ll(a, b), max_ll(c, d)) };
+        case PERCENT:
+        {
+            if (r.low <= 0) return INTERVAL_TOP;
+            long long m = r.high - 1;
+            if (l.low >= 0) return (interval_t){ 0, min_ll(l.high, m) };
+            if (l.high <= 0) return (interval_t){ max_ll(l.low, -m), 0 };
+            return (interval_t){ -m, m };
+        }
+        case BITWISE_AND:
+            // masking with a non-negative value keeps at most its bits
+            if (l.low >= 0 && r.low >= 0) return (interval_t){ 0, min_ll(l.high, r.high) };
+            if (l.low >= 0) return (interval_t){ 0, l.high };
+            if (r.low >= 0) return (interval_t){ 0, r.high };
+            return INTERVAL_TOP;
+        case RSHIFT:
+            if (l.low < 0 || r.low < 0 || r.high >= 63) return INTERVAL_TOP;
+            return (interval_t){ l.low >> r.high, l.high >> r.low };
+        case EQUAL:
+        case NOT_EQUAL:
+        case LESS:
+        case LESS_EQUAL:
+        case GREATER:
+        case GREATER_EQUAL:
+        case AND:
+        case OR:
+            return (interval_t){ 0, 1 };
+        default:
+            return INTERVAL_TOP;
+    }
+}
+
+static TokenType interval_compound_op(TokenType op)
+{
+    switch (op)
+    {
+        case PLUS_ASSIGN:    return PLUS;
+        case MINUS_ASSIGN:   return MINUS;
+        case STAR_ASSIGN:    return STAR;
+        case SLASH_ASSIGN:   return SLASH;
+        case PERCENT_ASSIGN: return PERCENT;
+        case AND_ASSIGN:     return BITWISE_AND;
+        default:             return op;
+    }
+}
+
+/* ---------- states ---------- */
+
+static bounds_state_t state_copy(bounds_t* b, const bounds_state_t* s)
+{
+    bounds_state_t copy = { bounds_alloc(sizeof(interval_t) * b->var_count), s->reachable };
+    memcpy(copy.vars, s->vars, sizeof(interval_t) * b->var_count);
+    return copy;
+}
+
+static void state_assign(bounds_t* b, bounds_state_t* into, const bounds_state_t* from)
+{
+    memcpy(into->vars, from->vars, sizeof(interval_t) * b->var_count);
+    into->reachable = from->reachable;
+}
+
+// into becomes what holds on either path
+static void state_join(bounds_t* b, bounds_state_t* into, const bounds_state_t* from)
+{
+    if (!from->reachable) return;
+    if (!into->reachable)
+    {
+        state_assign(b, into, from);
+        return;
+    }
+    for (int v = 0; v < b->var_count; v++)
+        into->vars[v] = interval_join(into->vars[v], from->vars[v]);
+}
+
+static int state_equal(bounds_t* b, const bounds_state_t* x, const bounds_state_t* y)
+{
+    if (x->reachable != y->reachable) return 0;
+    return memcmp(x->vars, y->vars, sizeof(interval_t) * b->var_count) == 0;
+}
+
+// a bound still moving after a few passes goes straight to its type's limit
+static void state_widen(bounds_t* b, bounds_state_t* next, const bounds_state_t* prev)
+{
+    if (!prev->reachable) return;
+    for (int v = 0; v < b->var_count; v++)
+    {
+        if (next->vars[v].low < prev->vars[v].low) next->vars[v].low = b->domain[v].low;
+        if (next->vars[v].high > prev->vars[v].high) next->vars[v].high = b->domain[v].high;
+    }
+}
+
+static int bounds_var(bounds_t* b, ASTNode* node)
+{
+    if (!node || node->type != AST_IDENTIFIER || !node->as.ident.sym) return -1;
+    sym_entry_t* sym = node->as.ident.sym;
+    if (sym->index >= b->table->sym_count) return -1;
+
+    int v = b->var_of[sym->index];
+    return v >= 0 && !b->escaped[v] ? v : -1;
+}
+
+/* ---------- expressions ---------- */
+
+static interval_t bounds_expr(bounds_t* b, bounds_state_t* s, ASTNode* node);
+
+static void bounds_index(bounds_t* b, bounds_state_t* s, ASTNode* node)
+{
+    bounds_expr(b, s, node->as.idx.base);
+    interval_t index = bounds_expr(b, s, node->as.idx.index);
+    if (!b->marking || !s->reachable) return;
+
+    const type_t* type = node->as.idx.base ? node->as.idx.base->ty : NULL;
+    int length = type && (type->kind == TY_ARRAY || type->kind == TY_STR) ? type->length : -1;
+
+    int proven = length >= 0 && index.low >= 0 && index.high < length;
+    node->as.idx.in_bounds = proven;
+    b->indexes++;
+    b->proven += proven;
+
+    if (length >= 0 && (index.high < 0 || index.low >= length))
+    {
+        ASTNode* base = node->as.idx.base;
+        const char* name = base->type == AST_IDENTIFIER ? base->as.ident.name : "array";
+        if (index.low == index.high)
+            diag_warning(b->diags, node->location, "index %lld is out of bounds for '%s' of length %d",
+                         index.low, name, length);
+        else
+            diag_warning(b->diags, node->location, "index is always out of bounds for '%s' of length %d",
+                         name, length);
+    }
+}
+
+static interval_t bounds_expr(bounds_t* b, bounds_state_t* s, ASTNode* node)
+{
+    if (!node) return INTERVAL_TOP;
+    interval_t domain = interval_of_type(node->ty);
+
+    switch (node->type)
+    {
+        case AST_LITERAL:
+        {
+            const_value_t v = const_of(node);
+            if (v.kind == CONST_INT || v.kind == CONST_BOOL) return (interval_t){ v.i, v.i };
+            return domain;
+        }
+        case AST_IDENTIFIER:
+        {
+            int v = bounds_var(b, node);
+            return v >= 0 ? s->vars[v] : domain;
+        }
+        case AST_UNARY:
+        {
+            interval_t operand = bounds_expr(b, s, node->as.unary.operand);
+            TokenType op = node->as.unary.op->type;
+            if (op == NOT) return (interval_t){ 0, 1 };
+            if (op != MINUS || operand.low == INT64_MIN) return domain;
+            return interval_fit((interval_t){ -operand.high, -operand.low }, domain);
+        }
+        case AST_BINARY:
+        {
+            TokenType op = node->as.binary.op->type;
+            interval_t l = bounds_expr(b, s, node->as.binary.left);
+
+            if (op == AND || op == OR)
+            {
+                // the right side may not run
+                bounds_state_t right = state_copy(b, s);
+                bounds_expr(b, &right, node->as.binary.right);
+                state_join(b, s, &right);
+                free(right.vars);
+                return (interval_t){ 0, 1 };
+            }
+
+            interval_t r = bounds_expr(b, s, node->as.binary.right);
+            return interval_fit(interval_binary(op, l, r), domain);
+        }
+        case AST_ASSIGN:
+        {
+            interval_t value = bounds_expr(b, s, node->as.assign.value);
+            sym_entry_t* sym = node->as.assign.sym;
+            int v = sym && sym->index < b->table->sym_count ? b->var_of[sym->index] : -1;
+            if (v < 0 || b->escaped[v]) return domain;
+
+            TokenType op = node->as.assign.op->type;
+            if (op != ASSIGN) value = interval_binary(interval_compound_op(op), s->vars[v], value);
+            s->vars[v] = interval_fit(value, b->domain[v]);
+            return s->vars[v];
+        }
+        case AST_INDEX:
+            bounds_index(b, s, node);
+            return domain;
+        case AST_FN_CALL:
+            for (int i = 0; i < node->as.call.arg_count; i++)
+                bounds_expr(b, s, node->as.call.args[i]);
+            return domain;
+        case AST_RANGE:
+            bounds_expr(b, s, node->as.rng.start);
+            bounds_expr(b, s, node->as.rng.end);
+            bounds_expr(b, s, node->as.rng.step);
+            return INTERVAL_TOP;
+        default:
+            return domain;
+    }
+}
+
+// the interval of node without recording anything or changing s
+static interval_t bounds_peek(bounds_t* b, const bounds_state_t* s, ASTNode* node)
+{
+    int v = bounds_var(b, node);
+    if (v >= 0) return s->vars[v];
+    if (node && node->type == AST_LITERAL) return bounds_expr(b, (bounds_state_t*)s, node);
+
+    int marking = b->marking;
+    b->marking = 0;
+    bounds_state_t scratch = state_copy(b, s);
+    interval_t result = bounds_expr(b, &scratch, node);
+    free(scratch.vars);
+    b->marking = marking;
+    return result;
+}
+
+/* ---------- conditions ---------- */
+
+static TokenType compare_negate(TokenType op)
+{
+    switch (op)
+    {
+        case LESS:          return GREATER_EQUAL;
+        case LESS_EQUAL:    return GREATER;
+        case GREATER:       return LESS_EQUAL;
+        case GREATER_EQUAL: return LESS;
+        case EQUAL:         return NOT_EQUAL;
+        case NOT_EQUAL:     return EQUAL;
+        default:            return op;
+    }
+}
+
+// a op b is b flip(op) a
+static TokenType compare_flip(TokenType op)
+{
+    switch (op)
+    {
+        case LESS:          return GREATER;
+        case LESS_EQUAL:    return GREATER_EQUAL;
+        case GREATER:       return LESS;
+        case GREATER_EQUAL: return LESS_EQUAL;
+        default:            return op;
+    }
+}
+
+// var op e holds
+static void bounds_narrow(bounds_state_t* s, int v, TokenType op, interval_t e)
+{
+    interval_t x = s->vars[v];
+
+    switch (op)
+    {
+        case LESS:
+            if (e.high == INT64_MIN) { s->reachable = 0; return; }
+            x.high = min_ll(x.high, e.high - 1);
+            break;
+        case LESS_EQUAL:
+            x.high = min_ll(x.high, e.high);
+            break;
+        case GREATER:
+            if (e.low == INT64_MAX) { s->reachable = 0; return; }
+            x.low = max_ll(x.low, e.low + 1);
+            break;
+        case GREATER_EQUAL:
+            x.low = max_ll(x.low, e.low);
+            break;
+        case EQUAL:
+            x.low = max_ll(x.low, e.low);
+            x.high = min_ll(x.high, e.high);
+            break;
+        case NOT_EQUAL:
+            if (e.low != e.high) return;
+            if (x.low == e.low && x.low < INT64_MAX) x.low++;
+            else if (x.high == e.low && x.high > INT64_MIN) x.high--;
+            break;
+        default:
+            return;
+    }
+
+    if (x.low > x.high) s->reachable = 0;
+    else s->vars[v] = x;
+}
+
+// narrow s to the states in which cond is sense
+static void bounds_refine(bounds_t* b, bounds_state_t* s, ASTNode* cond, int sense)
+{
+    if (!s->reachable || !cond) return;
+
+    if (cond->type == AST_UNARY && cond->as.unary.op->type == NOT)
+    {
+        bounds_refine(b, s, cond->as.unary.operand, !sense);
+        return;
+    }
+    if (cond->type != AST_BINARY) return;
+
+    TokenType op = cond->as.binary.op->type;
+    ASTNode* left = cond->as.binary.left;
+    ASTNode* right = cond->as.binary.right;
+
+    if ((op == AND && sense) || (op == OR && !sense))
+    {
+        bounds_refine(b, s, left, sense);
+        bounds_refine(b, s, right, sense);
+        return;
+    }
+    if (op == AND || op == OR)
+    {
+        // decided by the left side alone, or by both
+        bounds_state_t early = state_copy(b, s);
+        bounds_refine(b, &early, left, sense);
+        bounds_refine(b, s, left, !sense);
+        bounds_refine(b, s, right, sense);
+        state_join(b, s, &early);
+        free(early.vars);
+        return;
+    }
+
+    if (!sense) op = compare_negate(op);
+    int lv = bounds_var(b, left), rv = bounds_var(b, right);
+    if (lv < 0 && rv < 0) return;
+
+    interval_t l = bounds_peek(b, s, left);
+    interval_t r = bounds_peek(b, s, right);
+    if (lv >= 0) bounds_narrow(s, lv, op, r);
+    if (rv >= 0 && s->reachable) bounds_narrow(s, rv, compare_flip(op), l);
+}
+
+/* ---------- statements ---------- */
+
+static void bounds_stmt(bounds_t* b, bounds_state_t* s, ASTNode* node);
+
+// 1 if node stores to sym anywhere
+static int bounds_assigns(ASTNode* node, sym_entry_t* sym)
+{
+    if (!node) return 0;
+
+    switch (node->type)
+    {
+        case AST_ASSIGN:
+            return node->as.assign.sym == sym || bounds_assigns(node->as.assign.value, sym);
+        case AST_UNARY:
+            return bounds_assigns(node->as.unary.operand, sym);
+        case AST_BINARY:
+            return bounds_assigns(node->as.binary.left, sym) || bounds_assigns(node->as.binary.right, sym);
+        case AST_INDEX:
+            return bounds_assigns(node->as.idx.index, sym);
+        case AST_FN_CALL:
+            for (int i = 0; i < node->as.call.arg_count; i++)
+                if (bounds_assigns(node->as.call.args[i], sym)) return 1;
+            return 0;
+        case AST_BLOCK:
+            for (size_t i = 0; i < node->as.block.count; i++)
+                if (bounds_assigns(node->as.block.statements[i], sym)) return 1;
+            return 0;
+        case AST_VAR_DECL:
+        case AST_CONST_DECL:
+            return bounds_assigns(node->as.declaration.value, sym);
+        case AST_IF:
+            return bounds_assigns(node->as.ifstmt.condition, sym)
+                || bounds_assigns(node->as.ifstmt.then_branch, sym)
+                || bounds_assigns(node->as.ifstmt.else_branch, sym);
+        case AST_MATCH:
+            for (size_t i = 0; i < node->as.matchstmt.case_count; i++)
+                if (bounds_assigns(node->as.matchstmt.match_cases[i]->as.matchcase.stmt, sym)) return 1;
+            return node->as.matchstmt.def_case
+                && bounds_assigns(node->as.matchstmt.def_case->as.matchcase.stmt, sym);
+        case AST_LOOP:
+            return bounds_assigns(node->as.loop.condition, sym) || bounds_assigns(node->as.loop.block, sym);
+        case AST_LOOP_EXPR:
+            return bounds_assigns(node->as.loopexpr.expr, sym);
+        case AST_RETURN:
+            return bounds_assigns(node->as.return_stmt.expr, sym);
+        default:
+            return 0;
+    }
+}
+
+// the values a range loop's variable takes in the body
+static interval_t bounds_range(bounds_t* b, bounds_state_t* s, ASTNode* range, int* runs)
+{
+    interval_t start = bounds_expr(b, s, range->as.rng.start);
+    interval_t end = bounds_expr(b, s, range->as.rng.end);
+    interval_t step = range->as.rng.step ? bounds_expr(b, s, range->as.rng.step) : (interval_t){ 1, 1 };
+
+    *runs = 1;
+    if (step.low > 0)
+    {
+        // start, start + step, ... up to end, see const_range_in
+        if (start.low > end.high) *runs = 0;
+        return (interval_t){ start.low, max_ll(start.low, end.high) };
+    }
+    if (step.high < 0)
+    {
+        if (start.high < end.low) *runs = 0;
+        return (interval_t){ min_ll(start.high, end.low), start.high };
+    }
+    return interval_join(start, end);
+}
+
+// Loops are iterated to a fixed point without recording anything, then
+// the body is walked once more from the settled state to mark indices.
+static void bounds_loop(bounds_t* b, bounds_state_t* s, ASTNode* node)
+{
+    ASTNode* cond = node->as.loop.condition;
+    ASTNode* block = node->as.loop.block;
+    ASTNode* test = cond;
+    int var = -1, runs = 1;
+    interval_t var_range = INTERVAL_TOP;
+
+    if (cond && cond->type == AST_LOOP_EXPR)
+    {
+        ASTNode* expr = cond->as.loopexpr.expr;
+        ASTNode* variable = cond->as.loopexpr.variable;
+        test = NULL;
+
+        if (expr && expr->type == AST_RANGE) var_range = bounds_range(b, s, expr, &runs);
+        else if (variable) bounds_expr(b, s, expr);
+        else test = expr;   // a while loop
+
+        // a body that moves the variable can take it anywhere
+        var = bounds_var(b, variable);
+        if (var >= 0)
+            var_range = bounds_assigns(block, variable->as.ident.sym) ? b->domain[var]
+                                                                       : interval_fit(var_range, b->domain[var]);
+    }
+    if (!runs || !s->reachable) return;
+
+    bounds_state_t head = state_copy(b, s);
+    bounds_state_t body = state_copy(b, s);
+    int marking = b->marking;
+    b->marking = 0;
+
+    for (int pass = 0;; pass++)
+    {
+        state_assign(b, &body, &head);
+        if (var >= 0) body.vars[var] = var_range;
+        if (test)
+        {
+            bounds_expr(b, &body, test);
+            bounds_refine(b, &body, test, 1);
+        }
+        bounds_stmt(b, &body, block);
+
+        // the header is reached from before the loop and from the body's
+        // end, and only ever grows
+        state_join(b, &body, &head);
+        if (pass >= BOUNDS_WIDEN_AFTER) state_widen(b, &body, &head);
+        if (state_equal(b, &body, &head)) break;
+        state_assign(b, &head, &body);
+    }
+
+    b->marking = marking;
+    if (marking)
+    {
+        state_assign(b, &body, &head);
+        if (var >= 0) body.vars[var] = var_range;
+        if (test)
+        {
+            bounds_expr(b, &body, test);
+            bounds_refine(b, &body, test, 1);
+        }
+        bounds_stmt(b, &body, block);
+    }
+
+    // leaving: the header with the test failed
+    if (test)
+    {
+        bounds_expr(b, &head, test);
+        bounds_refine(b, &head, test, 0);
+    }
+    state_assign(b, s, &head);
+
+    free(head.vars);
+    free(body.vars);
+}
+
+static void bounds_match(bounds_t* b, bounds_state_t* s, ASTNode* node)
+{
+    MatchStmt* match = &node->as.matchstmt;
+    bounds_expr(b, s, match->pattern);
+    int var = bounds_var(b, match->pattern);
+
+    bounds_state_t out = state_copy(b, s);
+    out.reachable = 0;
+    bounds_state_t arm = state_copy(b, s);
+
+    for (size_t i = 0; i < match->case_count; i++)
+    {
+        ASTNode* c = match->match_cases[i];
+        state_assign(b, &arm, s);
+
+        const_value_t v = const_of(c->as.matchcase.expr);
+        if (var >= 0 && (v.kind == CONST_INT || v.kind == CONST_BOOL))
+            bounds_narrow(&arm, var, EQUAL, (interval_t){ v.i, v.i });
+
+        bounds_stmt(b, &arm, c->as.matchcase.stmt);
+        state_join(b, &out, &arm);
+    }
+
+    // '_', or no case matched
+    if (match->def_case) bounds_stmt(b, s, match->def_case->as.matchcase.stmt);
+    state_join(b, &out, s);
+    state_assign(b, s, &out);
+
+    free(arm.vars);
+    free(out.vars);
+}
+
+static void bounds_stmt(bounds_t* b, bounds_state_t* s, ASTNode* node)
+{
+    if (!node) return;
+
+    switch (node->type)
+    {
+        case AST_BLOCK:
+            for (size_t i = 0; i < node->as.block.count; i++)
+                bounds_stmt(b, s, node->as.block.statements[i]);
+            break;
+        case AST_VAR_DECL:
+        case AST_CONST_DECL:
+        {
+            Decl* decl = &node->as.declaration;
+            interval_t value = decl->value ? bounds_expr(b, s, decl->value) : INTERVAL_TOP;
+            int v = bounds_var(b, decl->ident);
+            if (v >= 0) s->vars[v] = interval_fit(value, b->domain[v]);
+            break;
+        }
+        case AST_ARRAY_DECL:
+            for (size_t i = 0; i < node->as.arr.literal_count; i++)
+                bounds_expr(b, s, node->as.arr.literals[i]);
+            break;
+        case AST_IF:
+        {
+            ASTNode* cond = node->as.ifstmt.condition;
+            bounds_expr(b, s, cond);
+
+            bounds_state_t then = state_copy(b, s);
+            bounds_refine(b, &then, cond, 1);
+            bounds_stmt(b, &then, node->as.ifstmt.then_branch);
+
+            bounds_refine(b, s, cond, 0);
+            bounds_stmt(b, s, node->as.ifstmt.else_branch);
+            state_join(b, s, &then);
+            free(then.vars);
+            break;
+        }
+        case AST_MATCH:
+            bounds_match(b, s, node);
+            break;
+        case AST_LOOP:
+            bounds_loop(b, s, node);
+            break;
+        case AST_RETURN:
+            bounds_expr(b, s, node->as.return_stmt.expr);
+            s->reachable = 0;
+            break;
+        case AST_FN_DECL:
+            // checked on its own once the enclosing function is done
+            break;
+        default:
+            bounds_expr(b, s, node);
+            break;
+    }
+}
+
+/* ---------- functions ---------- */
+
+static void bounds_track(bounds_t* b, ASTNode* ident)
+{
+    if (!ident || ident->type != AST_IDENTIFIER || !ident->as.ident.sym) return;
+    sym_entry_t* sym = ident->as.ident.sym;
+    if (sym->index >= b->table->sym_count || b->var_of[sym->index] >= 0) return;
+    if (!interval_is_integer(ident->ty)) return;
+
+    if (b->var_count == b->var_capacity)
+    {
+        b->var_capacity = b->var_capacity ? b->var_capacity * 2 : 16;
+        b->syms = realloc(b->syms, sizeof(sym_entry_t*) * b->var_capacity);
+        b->domain = realloc(b->domain, sizeof(interval_t) * b->var_capacity);
+        b->escaped = realloc(b->escaped, b->var_capacity);
+        if (!b->syms || !b->domain || !b->escaped) { fprintf(stderr, "Out of memory\n"); exit(1); }
+    }
+    b->var_of[sym->index] = b->var_count;
+    b->syms[b->var_count] = sym;
+    b->domain[b->var_count] = interval_of_type(ident->ty);
+    b->escaped[b->var_count] = 0;
+    b->var_count++;
+}
+
+static void bounds_collect(bounds_t* b, ASTNode* node)
+{
+    if (!node) return;
+
+    switch (node->type)
+    {
+        case AST_BLOCK:
+            for (size_t i = 0; i < node->as.block.count; i++)
+                bounds_collect(b, node->as.block.statements[i]);
+            break;
+        case AST_VAR_DECL:
+        case AST_CONST_DECL:
+            bounds_track(b, node->as.declaration.ident);
+            break;
+        case AST_IF:
+            bounds_collect(b, node->as.ifstmt.then_branch);
+            bounds_collect(b, node->as.ifstmt.else_branch);
+            break;
+        case AST_MATCH:
+            for (size_t i = 0; i < node->as.matchstmt.case_count; i++)
+                bounds_collect(b, node->as.matchstmt.match_cases[i]->as.matchcase.stmt);
+            if (node->as.matchstmt.def_case)
+                bounds_collect(b, node->as.matchstmt.def_case->as.matchcase.stmt);
+            break;
+        case AST_LOOP:
+            if (node->as.loop.condition && node->as.loop.condition->type == AST_LOOP_EXPR)
+                bounds_track(b, node->as.loop.condition->as.loopexpr.variable);
+            bounds_collect(b, node->as.loop.block);
+            break;
+        case AST_FN_DECL:
+            if (b->nested_count == b->nested_capacity)
+            {
+                b->nested_capacity = b->nested_capacity ? b->nested_capacity * 2 : 4;
+                b->nested = realloc(b->nested, sizeof(ASTNode*) * b->nested_capacity);
+                if (!b->nested) { fprintf(stderr, "Out of memory\n"); exit(1); }
+            }
+            b->nested[b->nested_count++] = node;
+            break;
+        default:
+            break;
+    }
+}
+
+static void bounds_function(bounds_t* b, ASTNode* fn)
+{
+    FuncDecl* func = &fn->as.func;
+    if (!func->block) return;
+
+    b->var_count = 0;
+    int nested_from = b->nested_count;
+    for (size_t i = 0; i < func->params_count; i++)
+        if (func->params[i]) bounds_track(b, func->params[i]->as.param.ident);
+    bounds_collect(b, func->block);
+
+    // a nested function may store to our locals at any call
+    for (int n = nested_from; n < b->nested_count; n++)
+        for (int v = 0; v < b->var_count; v++)
+            if (!b->escaped[v] && bounds_assigns(b->nested[n]->as.func.block, b->syms[v]))
+                b->escaped[v] = 1;
+
+    bounds_state_t s = { bounds_alloc(sizeof(interval_t) * b->var_count), 1 };
+    if (b->var_count) memcpy(s.vars, b->domain, sizeof(interval_t) * b->var_count);
+
+    b->marking = 1;
+    bounds_stmt(b, &s, func->block);
+    free(s.vars);
+
+    for (int v = 0; v < b->var_count; v++)
+        b->var_of[b->syms[v]->index] = -1;
+
+    // the nested list grows while these are checked, index it afresh
+    int nested_to = b->nested_count;
+    for (int n = nested_from; n < nested_to; n++)
+        bounds_function(b, b->nested[n]);
+}
+
+int bounds_program(ASTNode* prog, symtab_t* table, diag_list_t* diags)
+{
+    if (!prog || prog->type != AST_PROGRAM || !table) return 0;
+
+    bounds_t b = { .table = table, .diags = diags };
+    b.var_of = bounds_alloc(sizeof(int) * (table->sym_count + 1));
+    for (unsigned int i = 0; i < table->sym_count; i++) b.var_of[i] = -1;
+
+    for (int i = 0; i < prog->as.program.stmt_count; i++)
+    {
+        ASTNode* stmt = prog->as.program.statements[i];
+        if (stmt && stmt->type == AST_FN_DECL) bounds_function(&b, stmt);
+    }
+
+    printf("DEBUG: %d of %d index(es) proven in bounds\n", b.proven, b.indexes);
+
+    free(b.var_of);
+    free(b.syms);
+    free(b.domain);
+    free(b.escaped);
+    free(b.nested);
+    return b.proven;
+}
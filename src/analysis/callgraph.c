@@ -0,0 +1,413 @@
+#include "callgraph.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+static void* cg_alloc(size_t size)
+{
+    void* m = calloc(1, size ? size : 1);
+    if (!m) { fprintf(stderr, "Out of memory\n"); exit(1); }
+    return m;
+}
+
+typedef struct
+{
+    int caller;
+    int callee;
+} cg_edge_t;
+
+typedef struct
+{
+    callgraph_t* cg;
+    cg_edge_t* edges;
+    int edge_count;
+    int edge_capacity;
+} cg_builder_t;
+
+static int cg_add_node(callgraph_t* cg, sym_entry_t* sym, ASTNode* decl)
+{
+    if (!sym || sym->symbol_type != SYM_FUNCTION || sym->index >= cg->sym_count) return -1;
+
+    int n = cg->node_of[sym->index];
+    if (n >= 0)
+    {
+        // a prototype first, the definition later
+        if (decl && decl->as.func.block) cg->nodes[n].decl = decl;
+        return n;
+    }
+
+    if (cg->count == cg->capacity)
+    {
+        cg->capacity = cg->capacity ? cg->capacity * 2 : 16;
+        cg->nodes = realloc(cg->nodes, sizeof(callgraph_node_t) * cg->capacity);
+        if (!cg->nodes) { fprintf(stderr, "Out of memory\n"); exit(1); }
+    }
+    cg->nodes[cg->count] = (callgraph_node_t){ .sym = sym, .decl = decl, .scc = -1 };
+    cg->node_of[sym->index] = cg->count;
+    return cg->count++;
+}
+
+static void cg_add_edge(cg_builder_t* b, int caller, int callee)
+{
+    if (caller < 0 || callee < 0) return;
+
+    if (b->edge_count == b->edge_capacity)
+    {
+        b->edge_capacity = b->edge_capacity ? b->edge_capacity * 2 : 64;
+        b->edges = realloc(b->edges, sizeof(cg_edge_t) * b->edge_capacity);
+        if (!b->edges) { fprintf(stderr, "Out of memory\n"); exit(1); }
+    }
+    b->edges[b->edge_count++] = (cg_edge_t){ caller, callee };
+}
+
+// every call in node, made by caller
+static void cg_walk(cg_builder_t* b, int caller, ASTNode* node)
+{
+    if (!node) return;
+
+    switch (node->type)
+    {
+        case AST_FN_CALL:
+        {
+            ASTNode* callee = node->as.call.callee;
+            if (callee && callee->type == AST_IDENTIFIER)
+                cg_add_edge(b, caller, cg_add_node(b->cg, callee->as.ident.sym, NULL));
+            for (int i = 0; i < node->as.call.arg_count; i++)
+                cg_walk(b, caller, node->as.call.args[i]);
+            break;
+        }
+        case AST_FN_DECL:
+        {
+            int fn = cg_add_node(b->cg, node->as.func.ident->as.ident.sym, node);
+            cg_walk(b, fn, node->as.func.block);
+            break;
+        }
+        case AST_BLOCK:
+            for (size_t i = 0; i < node->as.block.count; i++)
+                cg_walk(b, caller, node->as.block.statements[i]);
+            break;
+        case AST_UNARY:
+            cg_walk(b, caller, node->as.unary.operand);
+            break;
+        case AST_BINARY:
+            cg_walk(b, caller, node->as.binary.left);
+            cg_walk(b, caller, node->as.binary.right);
+            break;
+        case AST_ASSIGN:
+            cg_walk(b, caller, node->as.assign.value);
+            break;
+        case AST_INDEX:
+            cg_walk(b, caller, node->as.idx.base);
+            cg_walk(b, caller, node->as.idx.index);
+            break;
+        case AST_RANGE:
+            cg_walk(b, caller, node->as.rng.start);
+            cg_walk(b, caller, node->as.rng.end);
+            cg_walk(b, caller, node->as.rng.step);
+            break;
+        case AST_VAR_DECL:
+        case AST_CONST_DECL:
+            cg_walk(b, caller, node->as.declaration.value);
+            break;
+        case AST_ARRAY_DECL:
+            cg_walk(b, caller, node->as.arr.range);
+            for (size_t i = 0; i < node->as.arr.literal_count; i++)
+                cg_walk(b, caller, node->as.arr.literals[i]);
+            break;
+        case AST_IF:
+            cg_walk(b, caller, node->as.ifstmt.condition);
+            cg_walk(b, caller, node->as.ifstmt.then_branch);
+            cg_walk(b, caller, node->as.ifstmt.else_branch);
+            break;
+        case AST_MATCH:
+            cg_walk(b, caller, node->as.matchstmt.pattern);
+            for (size_t i = 0; i < node->as.matchstmt.case_count; i++)
+            {
+                cg_walk(b, caller, node->as.matchstmt.match_cases[i]->as.matchcase.expr);
+                cg_walk(b, caller, node->as.matchstmt.match_cases[i]->as.matchcase.stmt);
+            }
+            if (node->as.matchstmt.def_case)
+                cg_walk(b, caller, node->as.matchstmt.def_case->as.matchcase.stmt);
+            break;
+        case AST_LOOP:
+            cg_walk(b, caller, node->as.loop.condition);
+            cg_walk(b, caller, node->as.loop.block);
+            break;
+        case AST_LOOP_EXPR:
+            cg_walk(b, caller, node->as.loopexpr.expr);
+            break;
+        case AST_RETURN:
+            cg_walk(b, caller, node->as.return_stmt.expr);
+            break;
+        default:
+            break;
+    }
+}
+
+// adjacency in both directions, without duplicate edges
+static void cg_link(callgraph_t* cg, cg_builder_t* b)
+{
+    int n = cg->count;
+    int* last = cg_alloc(sizeof(int) * (n + 1));
+    for (int i = 0; i < n; i++) last[i] = -1;
+
+    cg->callee_start = cg_alloc(sizeof(int) * (n + 1));
+    cg->caller_start = cg_alloc(sizeof(int) * (n + 1));
+
+    // edges were added caller by caller, so a repeat is caught by
+    // remembering the last caller seen for each callee
+    int kept = 0;
+    for (int e = 0; e < b->edge_count; e++)
+    {
+        cg_edge_t edge = b->edges[e];
+        if (last[edge.callee] == edge.caller) continue;
+
+        int seen = 0;
+        for (int k = kept - 1; k >= 0 && b->edges[k].caller == edge.caller; k--)
+            if (b->edges[k].callee == edge.callee) { seen = 1; break; }
+        last[edge.callee] = edge.caller;
+        if (seen) continue;
+
+        b->edges[kept++] = edge;
+        cg->callee_start[edge.caller + 1]++;
+        cg->caller_start[edge.callee + 1]++;
+    }
+    cg->edge_count = kept;
+    free(last);
+
+    for (int i = 0; i < n; i++)
+    {
+        cg->callee_start[i + 1] += cg->callee_start[i];
+        cg->caller_start[i + 1] += cg->caller_start[i];
+    }
+
+    cg->callees = cg_alloc(sizeof(int) * (kept + 1));
+    cg->callers = cg_alloc(sizeof(int) * (kept + 1));
+    int* out = cg_alloc(sizeof(int) * (n + 1));
+    int* in = cg_alloc(sizeof(int) * (n + 1));
+    memcpy(out, cg->callee_start, sizeof(int) * n);
+    memcpy(in, cg->caller_start, sizeof(int) * n);
+
+    for (int e = 0; e < kept; e++)
+    {
+        cg->callees[out[b->edges[e].caller]++] = b->edges[e].callee;
+        cg->callers[in[b->edges[e].callee]++] = b->edges[e].caller;
+    }
+    free(out);
+    free(in);
+}
+
+// Tarjan's algorithm with an explicit stack, deep call chains must not
+// overflow ours. Components are completed callees first.
+static void cg_tarjan(callgraph_t* cg)
+{
+    int n = cg->count;
+    int* index = cg_alloc(sizeof(int) * (n + 1));
+    int* low = cg_alloc(sizeof(int) * (n + 1));
+    int* next_edge = cg_alloc(sizeof(int) * (n + 1));
+    int* stack = cg_alloc(sizeof(int) * (n + 1));     // nodes of open components
+    int* calls = cg_alloc(sizeof(int) * (n + 1));     // depth-first path
+    unsigned char* on_stack = cg_alloc(n + 1);
+
+    for (int i = 0; i < n; i++) index[i] = -1;
+
+    cg->scc_members = cg_alloc(sizeof(int) * (n + 1));
+    cg->scc_start = cg_alloc(sizeof(int) * (n + 1));
+    cg->scc_count = 0;
+
+    int counter = 0, top = 0, members = 0;
+    for (int root = 0; root < n; root++)
+    {
+        if (index[root] >= 0) continue;
+
+        int depth = 0;
+        calls[depth++] = root;
+        index[root] = low[root] = counter++;
+        next_edge[root] = cg->callee_start[root];
+        stack[top++] = root;
+        on_stack[root] = 1;
+
+        while (depth > 0)
+        {
+            int v = calls[depth - 1];
+            if (next_edge[v] < cg->callee_start[v + 1])
+            {
+                int w = cg->callees[next_edge[v]++];
+                if (index[w] < 0)
+                {
+                    index[w] = low[w] = counter++;
+                    next_edge[w] = cg->callee_start[w];
+                    stack[top++] = w;
+                    on_stack[w] = 1;
+                    calls[depth++] = w;
+                }
+                else if (on_stack[w] && index[w] < low[v])
+                {
+                    low[v] = index[w];
+                }
+                continue;
+            }
+
+            // v is done, close its component if it is the root of one
+            if (low[v] == index[v])
+            {
+                cg->scc_start[cg->scc_count] = members;
+                int w;
+                do
+                {
+                    w = stack[--top];
+                    on_stack[w] = 0;
+                    cg->nodes[w].scc = cg->scc_count;
+                    cg->scc_members[members++] = w;
+                } while (w != v);
+                cg->scc_count++;
+            }
+
+            depth--;
+            if (depth > 0)
+            {
+                int parent = calls[depth - 1];
+                if (low[v] < low[parent]) low[parent] = low[v];
+            }
+        }
+    }
+    cg->scc_start[cg->scc_count] = members;
+
+    free(index);
+    free(low);
+    free(next_edge);
+    free(stack);
+    free(calls);
+    free(on_stack);
+}
+
+static void cg_levels(callgraph_t* cg)
+{
+    cg->scc_level = cg_alloc(sizeof(int) * (cg->scc_count + 1));
+
+    // bottom-up, so every callee SCC already has its level
+    for (int s = 0; s < cg->scc_count; s++)
+    {
+        int level = 0;
+        for (int m = cg->scc_start[s]; m < cg->scc_start[s + 1]; m++)
+        {
+            int v = cg->scc_members[m];
+            for (int e = cg->callee_start[v]; e < cg->callee_start[v + 1]; e++)
+            {
+                int callee_scc = cg->nodes[cg->callees[e]].scc;
+                if (callee_scc != s && cg->scc_level[callee_scc] + 1 > level)
+                    level = cg->scc_level[callee_scc] + 1;
+            }
+        }
+        cg->scc_level[s] = level;
+    }
+}
+
+callgraph_t* callgraph_build(ASTNode* prog, symtab_t* table)
+{
+    if (!prog || prog->type != AST_PROGRAM || !table) return NULL;
+
+    callgraph_t* cg = cg_alloc(sizeof(callgraph_t));
+    cg->sym_count = table->sym_count;
+    cg->node_of = cg_alloc(sizeof(int) * (cg->sym_count + 1));
+    for (unsigned int i = 0; i < cg->sym_count; i++) cg->node_of[i] = -1;
+
+    // every declared function is a node, called or not
+    for (int i = 0; i < prog->as.program.stmt_count; i++)
+    {
+        ASTNode* stmt = prog->as.program.statements[i];
+        if (stmt && stmt->type == AST_FN_DECL) cg_add_node(cg, stmt->as.func.ident->as.ident.sym, stmt);
+    }
+
+    cg_builder_t b = { .cg = cg };
+    for (int i = 0; i < prog->as.program.stmt_count; i++)
+        cg_walk(&b, -1, prog->as.program.statements[i]);
+
+    cg_link(cg, &b);
+    free(b.edges);
+
+    cg_tarjan(cg);
+    cg_levels(cg);
+    return cg;
+}
+
+void callgraph_destroy(callgraph_t* cg)
+{
+    if (!cg) return;
+    free(cg->nodes);
+    free(cg->callees);
+    free(cg->callee_start);
+    free(cg->callers);
+    free(cg->caller_start);
+    free(cg->scc_members);
+    free(cg->scc_start);
+    free(cg->scc_level);
+    free(cg->node_of);
+    free(cg);
+}
+
+int callgraph_node(const callgraph_t* cg, sym_entry_t* fn)
+{
+    if (!cg || !fn || fn->index >= cg->sym_count) return -1;
+    return cg->node_of[fn->index];
+}
+
+int callgraph_is_recursive(const callgraph_t* cg, int node)
+{
+    if (!cg || node < 0 || node >= cg->count) return 0;
+
+    int s = cg->nodes[node].scc;
+    if (cg->scc_start[s + 1] - cg->scc_start[s] > 1) return 1;
+
+    for (int e = cg->callee_start[node]; e < cg->callee_start[node + 1]; e++)
+        if (cg->callees[e] == node) return 1;
+    return 0;
+}
+
+void callgraph_write_dot(const callgraph_t* cg, FILE* out)
+{
+    if (!cg || !out) return;
+
+    fprintf(out, "digraph calls {\n");
+    fprintf(out, "    node [shape=box];\n");
+
+    for (int s = 0; s < cg->scc_count; s++)
+    {
+        int first = cg->scc_start[s], end = cg->scc_start[s + 1];
+        int cluster = callgraph_is_recursive(cg, cg->scc_members[first]);
+
+        if (cluster)
+        {
+            fprintf(out, "    subgraph cluster_%d {\n", s);
+            fprintf(out, "        label=\"SCC %d, level %d\";\n", s, cg->scc_level[s]);
+        }
+        for (int m = first; m < end; m++)
+        {
+            int v = cg->scc_members[m];
+            fprintf(out, "%s    n%d [label=\"%s\"%s];\n", cluster ? "    " : "", v,
+                    sym_name(cg->nodes[v].sym), cg->nodes[v].decl ? "" : ", style=dashed");
+        }
+        if (cluster) fprintf(out, "    }\n");
+    }
+
+    for (int v = 0; v < cg->count; v++)
+        for (int e = cg->callee_start[v]; e < cg->callee_start[v + 1]; e++)
+            fprintf(out, "    n%d -> n%d;\n", v, cg->callees[e]);
+
+    fprintf(out, "}\n");
+}
+
+void callgraph_print_stats(const callgraph_t* cg)
+{
+    if (!cg) return;
+
+    int recursive = 0, levels = 0;
+    for (int s = 0; s < cg->scc_count; s++)
+    {
+        if (callgraph_is_recursive(cg, cg->scc_members[cg->scc_start[s]])) recursive++;
+        if (cg->scc_level[s] + 1 > levels) levels = cg->scc_level[s] + 1;
+    }
+
+    printf("Call graph: %d function(s), %d call edge(s), %d SCC(s), %d recursive, %d level(s)\n",
+           cg->count, cg->edge_count, cg->scc_count, recursive, levels);
+}
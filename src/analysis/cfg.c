@@ -0,0 +1,297 @@
+#include "cfg.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+static void* cfg_realloc(void* m, size_t size)
+{
+    m = realloc(m, size ? size : 1);
+    if (!m) { fprintf(stderr, "Out of memory\n"); exit(1); }
+    return m;
+}
+
+static int cfg_new_block(cfg_t* cfg)
+{
+    if (cfg->count == cfg->capacity)
+    {
+        cfg->capacity = cfg->capacity ? cfg->capacity * 2 : 16;
+        cfg->blocks = cfg_realloc(cfg->blocks, sizeof(cfg_block_t) * cfg->capacity);
+    }
+    memset(&cfg->blocks[cfg->count], 0, sizeof(cfg_block_t));
+    return cfg->count++;
+}
+
+static void cfg_add_item(cfg_t* cfg, int b, ASTNode* node)
+{
+    cfg_block_t* block = &cfg->blocks[b];
+    if (block->count == block->capacity)
+    {
+        block->capacity = block->capacity ? block->capacity * 2 : 4;
+        block->items = cfg_realloc(block->items, sizeof(ASTNode*) * block->capacity);
+    }
+    block->items[block->count++] = node;
+}
+
+static void cfg_edge(cfg_t* cfg, int from, int to)
+{
+    cfg_block_t* block = &cfg->blocks[from];
+    if (block->succ_count < 2) block->succ[block->succ_count++] = to;
+}
+
+static void cfg_add_nested(cfg_t* cfg, ASTNode* fn)
+{
+    if (cfg->nested_count == cfg->nested_capacity)
+    {
+        cfg->nested_capacity = cfg->nested_capacity ? cfg->nested_capacity * 2 : 4;
+        cfg->nested = cfg_realloc(cfg->nested, sizeof(ASTNode*) * cfg->nested_capacity);
+    }
+    cfg->nested[cfg->nested_count++] = fn;
+}
+
+static int cfg_stmt(cfg_t* cfg, int cur, ASTNode* node);
+
+static int cfg_if(cfg_t* cfg, int cur, ASTNode* node)
+{
+    IfStmt* stmt = &node->as.ifstmt;
+
+    // a plain else has no condition
+    if (!stmt->condition) return cfg_stmt(cfg, cur, stmt->then_branch);
+
+    cfg_add_item(cfg, cur, stmt->condition);
+
+    int then_block = cfg_new_block(cfg);
+    int join = cfg_new_block(cfg);
+    cfg_edge(cfg, cur, then_block);
+    cfg_edge(cfg, cfg_stmt(cfg, then_block, stmt->then_branch), join);
+
+    if (stmt->else_branch)
+    {
+        int else_block = cfg_new_block(cfg);
+        cfg_edge(cfg, cur, else_block);
+        cfg_edge(cfg, cfg_stmt(cfg, else_block, stmt->else_branch), join);
+    }
+    else
+    {
+        cfg_edge(cfg, cur, join);
+    }
+    return join;
+}
+
+static int cfg_match(cfg_t* cfg, int cur, ASTNode* node)
+{
+    MatchStmt* match = &node->as.matchstmt;
+    cfg_add_item(cfg, cur, match->pattern);
+
+    int join = cfg_new_block(cfg);
+    int test = cur;
+
+    for (size_t i = 0; i < match->case_count; i++)
+    {
+        ASTNode* c = match->match_cases[i];
+        cfg_add_item(cfg, test, c->as.matchcase.expr);
+
+        int body = cfg_new_block(cfg);
+        int next = cfg_new_block(cfg);
+        cfg_edge(cfg, test, body);
+        cfg_edge(cfg, test, next);
+        cfg_edge(cfg, cfg_stmt(cfg, body, c->as.matchcase.stmt), join);
+        test = next;
+    }
+
+    // no case matched
+    if (match->def_case) test = cfg_stmt(cfg, test, match->def_case->as.matchcase.stmt);
+    cfg_edge(cfg, test, join);
+    return join;
+}
+
+static int cfg_loop(cfg_t* cfg, int cur, ASTNode* node)
+{
+    ASTNode* cond = node->as.loop.condition;
+    int header = cfg_new_block(cfg);
+
+    if (cond && cond->type == AST_LOOP_EXPR)
+    {
+        ASTNode* expr = cond->as.loopexpr.expr;
+        if (cond->as.loopexpr.variable || (expr && expr->type == AST_RANGE))
+        {
+            // the range is evaluated once, the variable steps in the header
+            if (expr) cfg_add_item(cfg, cur, expr);
+            if (cond->as.loopexpr.variable) cfg_add_item(cfg, header, cond);
+        }
+        else if (expr)
+        {
+            cfg_add_item(cfg, header, expr);
+        }
+    }
+    else if (cond)
+    {
+        cfg_add_item(cfg, header, cond);
+    }
+    cfg_edge(cfg, cur, header);
+
+    int body = cfg_new_block(cfg);
+    cfg_edge(cfg, header, body);
+    cfg_edge(cfg, cfg_stmt(cfg, body, node->as.loop.block), header);
+
+    // a loop without a condition only ends by returning
+    int exit = cfg_new_block(cfg);
+    if (cond) cfg_edge(cfg, header, exit);
+    return exit;
+}
+
+// add node to block cur, returns the block control continues in
+static int cfg_stmt(cfg_t* cfg, int cur, ASTNode* node)
+{
+    if (!node) return cur;
+
+    switch (node->type)
+    {
+        case AST_BLOCK:
+            for (size_t i = 0; i < node->as.block.count; i++)
+                cur = cfg_stmt(cfg, cur, node->as.block.statements[i]);
+            return cur;
+        case AST_IF:
+            return cfg_if(cfg, cur, node);
+        case AST_MATCH:
+            return cfg_match(cfg, cur, node);
+        case AST_LOOP:
+            return cfg_loop(cfg, cur, node);
+        case AST_RETURN:
+            // whatever follows is unreachable
+            cfg_add_item(cfg, cur, node);
+            cfg_edge(cfg, cur, CFG_EXIT);
+            return cfg_new_block(cfg);
+        case AST_FN_DECL:
+            cfg_add_nested(cfg, node);
+            return cur;
+        case AST_STRUCT:
+        case AST_UNION:
+        case AST_ENUM:
+        case AST_IMPORT:
+        case AST_STMT:
+        case AST_PROGRAM:
+            return cur;
+        default:
+            cfg_add_item(cfg, cur, node);
+            return cur;
+    }
+}
+
+static void cfg_link_preds(cfg_t* cfg)
+{
+    cfg->pred_start = calloc(cfg->count + 1, sizeof(int));
+    if (!cfg->pred_start) { fprintf(stderr, "Out of memory\n"); exit(1); }
+
+    for (int b = 0; b < cfg->count; b++)
+        for (int i = 0; i < cfg->blocks[b].succ_count; i++)
+            cfg->pred_start[cfg->blocks[b].succ[i] + 1]++;
+    for (int b = 0; b < cfg->count; b++)
+        cfg->pred_start[b + 1] += cfg->pred_start[b];
+
+    int* fill = cfg_realloc(NULL, sizeof(int) * cfg->count);
+    memcpy(fill, cfg->pred_start, sizeof(int) * cfg->count);
+    cfg->preds = cfg_realloc(NULL, sizeof(int) * cfg->pred_start[cfg->count]);
+
+    for (int b = 0; b < cfg->count; b++)
+        for (int i = 0; i < cfg->blocks[b].succ_count; i++)
+            cfg->preds[fill[cfg->blocks[b].succ[i]]++] = b;
+    free(fill);
+}
+
+// iterative depth-first search, so deep nesting cannot overflow the stack
+static void cfg_order(cfg_t* cfg)
+{
+    int n = cfg->count;
+    cfg->rpo = cfg_realloc(NULL, sizeof(int) * n);
+    cfg->rpo_index = cfg_realloc(NULL, sizeof(int) * n);
+    for (int b = 0; b < n; b++) cfg->rpo_index[b] = -1;
+
+    int* stack = cfg_realloc(NULL, sizeof(int) * n);
+    int* next = calloc(n, sizeof(int));
+    if (!next) { fprintf(stderr, "Out of memory\n"); exit(1); }
+
+    // visited blocks are marked -2 until they are numbered
+    int post = n;
+    int top = 0;
+    stack[top++] = CFG_ENTRY;
+    cfg->rpo_index[CFG_ENTRY] = -2;
+
+    while (top > 0)
+    {
+        int b = stack[top - 1];
+        cfg_block_t* block = &cfg->blocks[b];
+
+        if (next[b] < block->succ_count)
+        {
+            int s = block->succ[next[b]++];
+            if (cfg->rpo_index[s] == -1)
+            {
+                cfg->rpo_index[s] = -2;
+                stack[top++] = s;
+            }
+            continue;
+        }
+
+        // finished, filled from the back gives reverse postorder
+        cfg->rpo[--post] = b;
+        top--;
+    }
+
+    cfg->rpo_count = n - post;
+    memmove(cfg->rpo, cfg->rpo + post, sizeof(int) * cfg->rpo_count);
+    for (int i = 0; i < cfg->rpo_count; i++) cfg->rpo_index[cfg->rpo[i]] = i;
+
+    free(stack);
+    free(next);
+}
+
+cfg_t* cfg_build(ASTNode* fn)
+{
+    if (!fn || fn->type != AST_FN_DECL) return NULL;
+
+    cfg_t* cfg = calloc(1, sizeof(cfg_t));
+    if (!cfg) { fprintf(stderr, "Out of memory\n"); exit(1); }
+    cfg->fn = fn;
+
+    cfg_new_block(cfg);     // CFG_ENTRY
+    cfg_new_block(cfg);     // CFG_EXIT
+
+    cfg->end = cfg_stmt(cfg, CFG_ENTRY, fn->as.func.block);
+    cfg_edge(cfg, cfg->end, CFG_EXIT);
+
+    cfg_link_preds(cfg);
+    cfg_order(cfg);
+    return cfg;
+}
+
+void cfg_destroy(cfg_t* cfg)
+{
+    if (!cfg) return;
+    for (int b = 0; b < cfg->count; b++) free(cfg->blocks[b].items);
+    free(cfg->blocks);
+    free(cfg->preds);
+    free(cfg->pred_start);
+    free(cfg->rpo);
+    free(cfg->rpo_index);
+    free(cfg->nested);
+    free(cfg);
+}
+
+void cfg_print(cfg_t* cfg)
+{
+    if (!cfg) return;
+
+    const char* name = cfg->fn->as.func.ident->as.ident.name;
+    printf("CFG of %s: %d block(s), %d reachable\n", name, cfg->count, cfg->rpo_count);
+
+    for (int i = 0; i < cfg->rpo_count; i++)
+    {
+        int b = cfg->rpo[i];
+        cfg_block_t* block = &cfg->blocks[b];
+
+        printf("  B%d: %d item(s) ->", b, block->count);
+        for (int s = 0; s < block->succ_count; s++) printf(" B%d", block->succ[s]);
+        printf("\n");
+    }
+}
@@ -0,0 +1,677 @@
+#include "ctfe.h"
+#include "symtab.h"
+#include "types.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+typedef enum
+{
+    EXEC_NEXT,
+    EXEC_RETURN,
+    EXEC_FAIL
+} exec_t;
+
+typedef enum
+{
+    CTFE_OK,
+    CTFE_UNSUPPORTED,   // a construct the interpreter does not run
+    CTFE_STEPS,
+    CTFE_DEPTH,
+    CTFE_MEMORY,
+    CTFE_DIV_ZERO,
+    CTFE_BOUNDS
+} ctfe_failure_t;
+
+typedef struct
+{
+    unsigned int sym;
+    const_value_t value;
+} ctfe_slot_t;
+
+typedef struct
+{
+    ctfe_slot_t* slots;
+    int count;
+    int capacity;
+} ctfe_frame_t;
+
+typedef struct ctfe_memo_t
+{
+    unsigned int fn;
+    int arg_count;
+    const_value_t* args;
+    const_value_t result;
+    unsigned int hash;
+    struct ctfe_memo_t* next;
+} ctfe_memo_t;
+
+struct ctfe_t
+{
+    typecheck_t* tc;
+    diag_list_t* diags;
+
+    const effects_t* effects;
+
+    ctfe_memo_t** memo;         // buckets, power of two
+    unsigned int memo_buckets;
+    unsigned int memo_count;
+
+    char** strings;             // every string built, freed on destroy
+    int string_count;
+    int string_capacity;
+
+    // the evaluation in progress
+    ctfe_frame_t* frame;
+    const_value_t ret;
+    long steps;
+    long memory;
+    int depth;
+    ctfe_failure_t failure;
+
+    int evaluated;
+    int memo_hits;
+};
+
+static int eval_expr(ctfe_t* c, ASTNode* node, const_value_t* out);
+static exec_t exec_stmt(ctfe_t* c, ASTNode* node);
+static int ctfe_invoke(ctfe_t* c, sym_entry_t* fn, const_value_t* args, int count, const_value_t* out);
+
+static void* ctfe_alloc(size_t size)
+{
+    void* m = calloc(1, size ? size : 1);
+    if (!m) { fprintf(stderr, "Out of memory\n"); exit(1); }
+    return m;
+}
+
+ctfe_t* ctfe_create(typecheck_t* tc, const effects_t* effects, diag_list_t* diags)
+{
+    ctfe_t* c = ctfe_alloc(sizeof(ctfe_t));
+    c->tc = tc;
+    c->effects = effects;
+    c->diags = diags;
+    return c;
+}
+
+void ctfe_destroy(ctfe_t* c)
+{
+    if (!c) return;
+
+    for (unsigned int i = 0; i < c->memo_buckets; i++)
+    {
+        ctfe_memo_t* m = c->memo[i];
+        while (m)
+        {
+            ctfe_memo_t* next = m->next;
+            free(m->args);
+            free(m);
+            m = next;
+        }
+    }
+    free(c->memo);
+
+    for (int i = 0; i < c->string_count; i++)
+        free(c->strings[i]);
+    free(c->strings);
+    free(c);
+}
+
+int ctfe_evaluated(const ctfe_t* c)
+{
+    return c ? c->evaluated : 0;
+}
+
+int ctfe_memo_hits(const ctfe_t* c)
+{
+    return c ? c->memo_hits : 0;
+}
+
+static ASTNode* ctfe_decl(ctfe_t* c, sym_entry_t* fn)
+{
+    if (!fn || fn->index >= c->tc->sym_count) return NULL;
+    return c->tc->fn_decls[fn->index];
+}
+
+/* ---------- purity ---------- */
+
+// a run cannot diverge, it is bounded by CTFE_MAX_STEPS
+int ctfe_is_pure(ctfe_t* c, sym_entry_t* fn)
+{
+    if (!c || !fn || fn->symbol_type != SYM_FUNCTION || !ctfe_decl(c, fn)) return 0;
+    return effects_is_pure(c->effects, fn);
+}
+
+/* ---------- memo table ---------- */
+
+static unsigned int memo_hash(unsigned int fn, const const_value_t* args, int count)
+{
+    unsigned int h = 2166136261u ^ fn;
+    for (int i = 0; i < count; i++)
+    {
+        unsigned long long bits = 0;
+        if (args[i].kind == CONST_FLOAT) memcpy(&bits, &args[i].f, sizeof(bits));
+        else if (args[i].kind == CONST_STR)
+        {
+            for (const char* s = args[i].s; *s; s++) bits = bits * 31 + (unsigned char)*s;
+        }
+        else bits = (unsigned long long)args[i].i;
+
+        h = (h ^ args[i].kind) * 16777619u;
+        h = (h ^ (unsigned int)bits) * 16777619u;
+        h = (h ^ (unsigned int)(bits >> 32)) * 16777619u;
+    }
+    return h;
+}
+
+static int const_same(const_value_t a, const_value_t b)
+{
+    if (a.kind != b.kind) return 0;
+    switch (a.kind)
+    {
+        case CONST_FLOAT: return memcmp(&a.f, &b.f, sizeof(double)) == 0;
+        case CONST_STR:   return strcmp(a.s, b.s) == 0;
+        default:          return a.i == b.i;
+    }
+}
+
+static ctfe_memo_t* memo_find(ctfe_t* c, unsigned int fn, const const_value_t* args, int count,
+                              unsigned int hash)
+{
+    if (!c->memo) return NULL;
+
+    for (ctfe_memo_t* m = c->memo[hash & (c->memo_buckets - 1)]; m; m = m->next)
+    {
+        if (m->hash != hash || m->fn != fn || m->arg_count != count) continue;
+
+        int same = 1;
+        for (int i = 0; i < count && same; i++)
+            same = const_same(m->args[i], args[i]);
+        if (same) return m;
+    }
+    return NULL;
+}
+
+static void memo_insert(ctfe_t* c, unsigned int fn, const const_value_t* args, int count,
+                        unsigned int hash, const_value_t result)
+{
+    if (c->memo_count >= c->memo_buckets)
+    {
+        unsigned int buckets = c->memo_buckets ? c->memo_buckets * 2 : 64;
+        ctfe_memo_t** table = ctfe_alloc(sizeof(ctfe_memo_t*) * buckets);
+        for (unsigned int i = 0; i < c->memo_buckets; i++)
+        {
+            ctfe_memo_t* m = c->memo[i];
+            while (m)
+            {
+                ctfe_memo_t* next = m->next;
+                m->next = table[m->hash & (buckets - 1)];
+                table[m->hash & (buckets - 1)] = m;
+                m = next;
+            }
+        }
+        free(c->memo);
+        c->memo = table;
+        c->memo_buckets = buckets;
+    }
+
+    ctfe_memo_t* m = ctfe_alloc(sizeof(ctfe_memo_t));
+    m->fn = fn;
+    m->arg_count = count;
+    m->args = ctfe_alloc(sizeof(const_value_t) * count);
+    memcpy(m->args, args, sizeof(const_value_t) * count);
+    m->result = result;
+    m->hash = hash;
+    m->next = c->memo[hash & (c->memo_buckets - 1)];
+    c->memo[hash & (c->memo_buckets - 1)] = m;
+    c->memo_count++;
+}
+
+/* ---------- interpreter state ---------- */
+
+static int ctfe_fail(ctfe_t* c, ctfe_failure_t failure)
+{
+    if (c->failure == CTFE_OK) c->failure = failure;
+    return 0;
+}
+
+static int ctfe_step(ctfe_t* c)
+{
+    if (++c->steps > CTFE_MAX_STEPS) return ctfe_fail(c, CTFE_STEPS);
+    return 1;
+}
+
+static int ctfe_charge(ctfe_t* c, long bytes)
+{
+    c->memory += bytes;
+    if (c->memory > CTFE_MAX_MEMORY) return ctfe_fail(c, CTFE_MEMORY);
+    return 1;
+}
+
+static const char* ctfe_string(ctfe_t* c, const char* a, const char* b)
+{
+    size_t len = strlen(a) + strlen(b) + 1;
+    if (!ctfe_charge(c, (long)len)) return NULL;
+
+    if (c->string_count == c->string_capacity)
+    {
+        c->string_capacity = c->string_capacity ? c->string_capacity * 2 : 16;
+        c->strings = realloc(c->strings, sizeof(char*) * c->string_capacity);
+        if (!c->strings) { fprintf(stderr, "Out of memory\n"); exit(1); }
+    }
+
+    char* s = ctfe_alloc(len);
+    strcpy(s, a);
+    strcat(s, b);
+    c->strings[c->string_count++] = s;
+    return s;
+}
+
+static const_value_t* frame_find(ctfe_frame_t* frame, sym_entry_t* sym)
+{
+    if (!sym) return NULL;
+    for (int i = frame->count - 1; i >= 0; i--)
+        if (frame->slots[i].sym == sym->index) return &frame->slots[i].value;
+    return NULL;
+}
+
+static int frame_set(ctfe_t* c, sym_entry_t* sym, const_value_t value)
+{
+    if (!sym) return ctfe_fail(c, CTFE_UNSUPPORTED);
+
+    ctfe_frame_t* frame = c->frame;
+    const_value_t* slot = frame_find(frame, sym);
+    if (slot)
+    {
+        *slot = value;
+        return 1;
+    }
+
+    if (frame->count == frame->capacity)
+    {
+        int capacity = frame->capacity ? frame->capacity * 2 : 8;
+        if (!ctfe_charge(c, (long)sizeof(ctfe_slot_t) * (capacity - frame->capacity))) return 0;
+        frame->slots = realloc(frame->slots, sizeof(ctfe_slot_t) * capacity);
+        if (!frame->slots) { fprintf(stderr, "Out of memory\n"); exit(1); }
+        frame->capacity = capacity;
+    }
+    frame->slots[frame->count].sym = sym->index;
+    frame->slots[frame->count].value = value;
+    frame->count++;
+    return 1;
+}
+
+/* ---------- expressions ---------- */
+
+static TokenType compound_op(TokenType op)
+{
+    switch (op)
+    {
+        case PLUS_ASSIGN:    return PLUS;
+        case MINUS_ASSIGN:   return MINUS;
+        case STAR_ASSIGN:    return STAR;
+        case SLASH_ASSIGN:   return SLASH;
+        case PERCENT_ASSIGN: return PERCENT;
+        case AND_ASSIGN:     return BITWISE_AND;
+        default:             return op;
+    }
+}
+
+static int eval_binary_op(ctfe_t* c, TokenType op, const type_t* type, const_value_t l, const_value_t r,
+                          const_value_t* out)
+{
+    if (op == PLUS && l.kind == CONST_STR && r.kind == CONST_STR)
+    {
+        out->kind = CONST_STR;
+        out->s = ctfe_string(c, l.s, r.s);
+        return out->s != NULL;
+    }
+
+    fold_status_t status = const_binary(op, type, l, r, out);
+    if (status == FOLD_DIV_ZERO) return ctfe_fail(c, CTFE_DIV_ZERO);
+    if (status != FOLD_OK) return ctfe_fail(c, CTFE_UNSUPPORTED);
+    return 1;
+}
+
+static int eval_call(ctfe_t* c, ASTNode* node, const_value_t* out)
+{
+    ASTNode* callee = node->as.call.callee;
+    sym_entry_t* fn = callee && callee->type == AST_IDENTIFIER ? callee->as.ident.sym : NULL;
+    if (!fn || !ctfe_is_pure(c, fn)) return ctfe_fail(c, CTFE_UNSUPPORTED);
+
+    int count = node->as.call.arg_count;
+    const_value_t args[count ? count : 1];
+    for (int i = 0; i < count; i++)
+        if (!eval_expr(c, node->as.call.args[i], &args[i])) return 0;
+
+    return ctfe_invoke(c, fn, args, count, out);
+}
+
+static int eval_expr(ctfe_t* c, ASTNode* node, const_value_t* out)
+{
+    if (!node || !ctfe_step(c)) return ctfe_fail(c, CTFE_UNSUPPORTED);
+
+    switch (node->type)
+    {
+        case AST_LITERAL:
+            *out = const_convert(const_of(node), node->ty);
+            return out->kind != CONST_NONE || ctfe_fail(c, CTFE_UNSUPPORTED);
+
+        case AST_IDENTIFIER:
+        {
+            // global lets were replaced by their value when folding could
+            const_value_t* v = frame_find(c->frame, node->as.ident.sym);
+            if (!v || v->kind == CONST_NONE) return ctfe_fail(c, CTFE_UNSUPPORTED);
+            *out = *v;
+            return 1;
+        }
+
+        case AST_UNARY:
+        {
+            const_value_t v;
+            if (!eval_expr(c, node->as.unary.operand, &v)) return 0;
+            if (const_unary(node->as.unary.op->type, node->ty, v, out) != FOLD_OK)
+                return ctfe_fail(c, CTFE_UNSUPPORTED);
+            return 1;
+        }
+
+        case AST_BINARY:
+        {
+            TokenType op = node->as.binary.op->type;
+            const_value_t l, r;
+            if (!eval_expr(c, node->as.binary.left, &l)) return 0;
+
+            // && and || only evaluate what they need
+            if ((op == AND && l.kind == CONST_BOOL && !l.i) || (op == OR && l.kind == CONST_BOOL && l.i))
+            {
+                *out = l;
+                return 1;
+            }
+            if (!eval_expr(c, node->as.binary.right, &r)) return 0;
+            return eval_binary_op(c, op, node->ty, l, r, out);
+        }
+
+        case AST_ASSIGN:
+        {
+            sym_entry_t* sym = node->as.assign.sym;
+            const_value_t v;
+            if (!eval_expr(c, node->as.assign.value, &v)) return 0;
+
+            if (node->as.assign.op->type != ASSIGN)
+            {
+                const_value_t* old = frame_find(c->frame, sym);
+                if (!old || old->kind == CONST_NONE) return ctfe_fail(c, CTFE_UNSUPPORTED);
+
+                const_value_t result;
+                if (!eval_binary_op(c, compound_op(node->as.assign.op->type), node->ty, *old, v, &result))
+                    return 0;
+                v = result;
+            }
+
+            v = const_convert(v, node->ty);
+            if (!frame_set(c, sym, v)) return 0;
+            *out = v;
+            return 1;
+        }
+
+        case AST_INDEX:
+        {
+            const_value_t base, index;
+            if (!eval_expr(c, node->as.idx.base, &base) || !eval_expr(c, node->as.idx.index, &index))
+                return 0;
+            if (base.kind != CONST_STR || index.kind != CONST_INT) return ctfe_fail(c, CTFE_UNSUPPORTED);
+            if (index.i < 0 || (size_t)index.i >= strlen(base.s)) return ctfe_fail(c, CTFE_BOUNDS);
+
+            out->kind = CONST_INT;
+            out->i = (unsigned char)base.s[index.i];
+            return 1;
+        }
+
+        case AST_FN_CALL:
+            return eval_call(c, node, out);
+
+        default:
+            return ctfe_fail(c, CTFE_UNSUPPORTED);
+    }
+}
+
+/* ---------- statements ---------- */
+
+static int eval_bool(ctfe_t* c, ASTNode* node, int* out)
+{
+    const_value_t v;
+    if (!eval_expr(c, node, &v)) return 0;
+    if (v.kind != CONST_BOOL) return ctfe_fail(c, CTFE_UNSUPPORTED);
+    *out = (int)v.i;
+    return 1;
+}
+
+static exec_t exec_loop(ctfe_t* c, ASTNode* node)
+{
+    ASTNode* cond = node->as.loop.condition;
+    ASTNode* var = cond && cond->type == AST_LOOP_EXPR ? cond->as.loopexpr.variable : NULL;
+    ASTNode* expr = cond && cond->type == AST_LOOP_EXPR ? cond->as.loopexpr.expr : cond;
+
+    if (expr && expr->type == AST_RANGE)
+    {
+        const_value_t start, end, step = { CONST_INT, 1, 0.0, NULL };
+        if (!eval_expr(c, expr->as.rng.start, &start) || !eval_expr(c, expr->as.rng.end, &end))
+            return EXEC_FAIL;
+        if (expr->as.rng.step && !eval_expr(c, expr->as.rng.step, &step))
+            return EXEC_FAIL;
+        if (start.kind != CONST_INT || end.kind != CONST_INT || step.kind != CONST_INT || step.i == 0)
+        {
+            ctfe_fail(c, CTFE_UNSUPPORTED);
+            return EXEC_FAIL;
+        }
+
+        const type_t* var_type = var ? var->ty : NULL;
+        long long i = start.i;
+        for (; const_range_in(i, end.i, step.i); i = (long long)((unsigned long long)i + step.i))
+        {
+            if (!ctfe_step(c)) return EXEC_FAIL;
+            if (var)
+            {
+                const_value_t v = { CONST_INT, i, 0.0, NULL };
+                if (!frame_set(c, var->as.ident.sym, const_convert(v, var_type))) return EXEC_FAIL;
+            }
+
+            exec_t r = exec_stmt(c, node->as.loop.block);
+            if (r != EXEC_NEXT) return r;
+        }
+
+        // the variable is left one step past the last iteration
+        if (var)
+        {
+            const_value_t v = { CONST_INT, i, 0.0, NULL };
+            if (!frame_set(c, var->as.ident.sym, const_convert(v, var_type))) return EXEC_FAIL;
+        }
+        return EXEC_NEXT;
+    }
+
+    for (;;)
+    {
+        if (!ctfe_step(c)) return EXEC_FAIL;
+        if (expr)
+        {
+            int go;
+            if (!eval_bool(c, expr, &go)) return EXEC_FAIL;
+            if (!go) return EXEC_NEXT;
+        }
+
+        exec_t r = exec_stmt(c, node->as.loop.block);
+        if (r != EXEC_NEXT) return r;
+    }
+}
+
+static exec_t exec_match(ctfe_t* c, ASTNode* node)
+{
+    MatchStmt* match = &node->as.matchstmt;
+    const_value_t pattern;
+    if (!eval_expr(c, match->pattern, &pattern)) return EXEC_FAIL;
+
+    for (size_t i = 0; i < match->case_count; i++)
+    {
+        ASTNode* mc = match->match_cases[i];
+        const_value_t value, equal;
+        if (!eval_expr(c, mc->as.matchcase.expr, &value)) return EXEC_FAIL;
+        if (const_binary(EQUAL, type_prim(TY_BOOL), pattern, value, &equal) != FOLD_OK)
+        {
+            ctfe_fail(c, CTFE_UNSUPPORTED);
+            return EXEC_FAIL;
+        }
+        if (equal.i) return exec_stmt(c, mc->as.matchcase.stmt);
+    }
+
+    if (match->def_case) return exec_stmt(c, match->def_case->as.matchcase.stmt);
+    return EXEC_NEXT;
+}
+
+static exec_t exec_stmt(ctfe_t* c, ASTNode* node)
+{
+    if (!node) return EXEC_NEXT;
+    if (!ctfe_step(c)) return EXEC_FAIL;
+
+    switch (node->type)
+    {
+        case AST_BLOCK:
+            for (size_t i = 0; i < node->as.block.count; i++)
+            {
+                exec_t r = exec_stmt(c, node->as.block.statements[i]);
+                if (r != EXEC_NEXT) return r;
+            }
+            return EXEC_NEXT;
+
+        case AST_VAR_DECL:
+        case AST_CONST_DECL:
+        {
+            ASTNode* ident = node->as.declaration.ident;
+            const_value_t v = { CONST_NONE, 0, 0.0, NULL };
+            if (node->as.declaration.value && !eval_expr(c, node->as.declaration.value, &v))
+                return EXEC_FAIL;
+            return frame_set(c, ident->as.ident.sym, const_convert(v, ident->ty)) ? EXEC_NEXT : EXEC_FAIL;
+        }
+
+        case AST_IF:
+        {
+            int taken = 1;
+            if (node->as.ifstmt.condition && !eval_bool(c, node->as.ifstmt.condition, &taken))
+                return EXEC_FAIL;
+            return exec_stmt(c, taken ? node->as.ifstmt.then_branch : node->as.ifstmt.else_branch);
+        }
+
+        case AST_MATCH:
+            return exec_match(c, node);
+
+        case AST_LOOP:
+            return exec_loop(c, node);
+
+        case AST_RETURN:
+        {
+            c->ret.kind = CONST_NONE;
+            if (node->as.return_stmt.expr && !eval_expr(c, node->as.return_stmt.expr, &c->ret))
+                return EXEC_FAIL;
+            return EXEC_RETURN;
+        }
+
+        case AST_ARRAY_DECL:
+            ctfe_fail(c, CTFE_UNSUPPORTED);
+            return EXEC_FAIL;
+
+        default:
+        {
+            const_value_t ignored;
+            return eval_expr(c, node, &ignored) ? EXEC_NEXT : EXEC_FAIL;
+        }
+    }
+}
+
+static int ctfe_invoke(ctfe_t* c, sym_entry_t* fn, const_value_t* args, int count, const_value_t* out)
+{
+    unsigned int hash = memo_hash(fn->index, args, count);
+    ctfe_memo_t* memo = memo_find(c, fn->index, args, count, hash);
+    if (memo)
+    {
+        c->memo_hits++;
+        *out = memo->result;
+        return 1;
+    }
+
+    ASTNode* decl = ctfe_decl(c, fn);
+    if (!decl || (int)decl->as.func.params_count != count) return ctfe_fail(c, CTFE_UNSUPPORTED);
+    if (c->depth >= CTFE_MAX_DEPTH) return ctfe_fail(c, CTFE_DEPTH);
+
+    ctfe_frame_t frame = { NULL, 0, 0 };
+    ctfe_frame_t* caller = c->frame;
+    c->frame = &frame;
+    c->depth++;
+
+    int ok = 1;
+    for (int i = 0; i < count && ok; i++)
+    {
+        ASTNode* param = decl->as.func.params[i];
+        ok = frame_set(c, param->as.param.ident->as.ident.sym, const_convert(args[i], param->ty));
+    }
+
+    exec_t r = ok ? exec_stmt(c, decl->as.func.block) : EXEC_FAIL;
+
+    c->memory -= (long)sizeof(ctfe_slot_t) * frame.capacity;
+    free(frame.slots);
+    c->frame = caller;
+    c->depth--;
+
+    if (r == EXEC_FAIL) return 0;
+
+    const type_t* fn_type = typecheck_symbol_type(c->tc, fn);
+    const_value_t result = r == EXEC_RETURN ? c->ret : (const_value_t){ CONST_NONE, 0, 0.0, NULL };
+    if (fn_type && fn_type->kind == TY_FN) result = const_convert(result, fn_type->elem);
+    if (result.kind == CONST_NONE) return ctfe_fail(c, CTFE_UNSUPPORTED);
+
+    memo_insert(c, fn->index, args, count, hash, result);
+    *out = result;
+    return 1;
+}
+
+int ctfe_fold_call(ctfe_t* c, ASTNode* call, const_value_t* out)
+{
+    if (!c || !call || call->type != AST_FN_CALL) return 0;
+    if (type_is_error(call->ty) || call->ty->kind == TY_VOID) return 0;
+
+    ASTNode* callee = call->as.call.callee;
+    sym_entry_t* fn = callee && callee->type == AST_IDENTIFIER ? callee->as.ident.sym : NULL;
+    if (!fn || !ctfe_is_pure(c, fn)) return 0;
+
+    int count = call->as.call.arg_count;
+    const_value_t args[count ? count : 1];
+    for (int i = 0; i < count; i++)
+    {
+        args[i] = const_of(call->as.call.args[i]);
+        if (args[i].kind == CONST_NONE) return 0;
+    }
+
+    ctfe_frame_t top = { NULL, 0, 0 };
+    c->frame = &top;
+    c->steps = 0;
+    c->memory = 0;
+    c->depth = 0;
+    c->failure = CTFE_OK;
+
+    int ok = ctfe_invoke(c, fn, args, count, out);
+    c->frame = NULL;
+
+    const char* why = NULL;
+    switch (c->failure)
+    {
+        case CTFE_STEPS:    why = "ran past its step limit";   break;
+        case CTFE_DEPTH:    why = "recursed too deeply";       break;
+        case CTFE_MEMORY:   why = "ran past its memory limit"; break;
+        case CTFE_DIV_ZERO: why = "divides by zero";           break;
+        case CTFE_BOUNDS:   why = "indexes out of bounds";     break;
+        default:            break;
+    }
+    if (!ok && why)
+        diag_warning(c->diags, call->location, "compile-time evaluation of '%s' %s", sym_name(fn), why);
+
+    if (ok) c->evaluated++;
+    return ok;
+}
@@ -0,0 +1,668 @@
+#include "dataflow.h"
+#include "types.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+static void* df_alloc(size_t size)
+{
+    void* m = calloc(1, size ? size : 1);
+    if (!m) { fprintf(stderr, "Out of memory\n"); exit(1); }
+    return m;
+}
+
+static void* df_grow(void* m, int* capacity, int count, size_t size)
+{
+    if (count < *capacity) return m;
+    *capacity = *capacity ? *capacity * 2 : 16;
+    m = realloc(m, size * *capacity);
+    if (!m) { fprintf(stderr, "Out of memory\n"); exit(1); }
+    return m;
+}
+
+/* ---------- solver ---------- */
+
+void df_problem_init(df_problem_t* p, const cfg_t* cfg, df_direction_t direction, df_meet_t meet, int bits)
+{
+    memset(p, 0, sizeof(*p));
+    p->direction = direction;
+    p->meet = meet;
+    p->bits = bits;
+    p->words = BITSET_WORDS(bits) ? BITSET_WORDS(bits) : 1;
+    p->blocks = cfg->count;
+
+    size_t size = sizeof(bitword_t) * p->words * p->blocks;
+    p->gen = df_alloc(size);
+    p->kill = df_alloc(size);
+    p->in = df_alloc(size);
+    p->out = df_alloc(size);
+    p->boundary = df_alloc(sizeof(bitword_t) * p->words);
+
+    // must problems start from everything and shrink
+    if (meet == DF_INTERSECT)
+    {
+        memset(p->in, 0xff, size);
+        memset(p->out, 0xff, size);
+    }
+}
+
+void df_problem_free(df_problem_t* p)
+{
+    free(p->gen);
+    free(p->kill);
+    free(p->in);
+    free(p->out);
+    free(p->boundary);
+    memset(p, 0, sizeof(*p));
+}
+
+// combine what flows into block b: out of its predecessors going forward,
+// in of its successors going backward. Unreachable blocks never change
+// from their initial value, which is neutral for the meet.
+static void df_meet(df_problem_t* p, const cfg_t* cfg, int b, bitword_t* into)
+{
+    int forward = p->direction == DF_FORWARD;
+    if (b == (forward ? CFG_ENTRY : CFG_EXIT))
+    {
+        memcpy(into, p->boundary, sizeof(bitword_t) * p->words);
+        return;
+    }
+
+    memset(into, p->meet == DF_INTERSECT ? 0xff : 0, sizeof(bitword_t) * p->words);
+
+    const int* from;
+    int count;
+    if (forward)
+    {
+        from = cfg->preds + cfg->pred_start[b];
+        count = cfg->pred_start[b + 1] - cfg->pred_start[b];
+    }
+    else
+    {
+        from = cfg->blocks[b].succ;
+        count = cfg->blocks[b].succ_count;
+    }
+
+    for (int i = 0; i < count; i++)
+    {
+        const bitword_t* set = df_row(p, forward ? p->out : p->in, from[i]);
+        if (p->meet == DF_UNION)
+            for (int w = 0; w < p->words; w++) into[w] |= set[w];
+        else
+            for (int w = 0; w < p->words; w++) into[w] &= set[w];
+    }
+}
+
+int df_solve(df_problem_t* p, const cfg_t* cfg)
+{
+    int n = cfg->rpo_count;
+    int forward = p->direction == DF_FORWARD;
+    if (n == 0) return 0;
+
+    // pending[i] is the i-th block in visiting order: reverse postorder
+    // forward, postorder backward. The lowest pending position is always
+    // taken first, so a loop is settled before what follows it.
+    unsigned char* pending = df_alloc(n);
+    memset(pending, 1, n);
+
+    int transfers = 0;
+    int pos = 0;
+    while (pos < n)
+    {
+        if (!pending[pos]) { pos++; continue; }
+        pending[pos] = 0;
+
+        int b = cfg->rpo[forward ? pos : n - 1 - pos];
+        bitword_t* facing = df_row(p, forward ? p->in : p->out, b);
+        bitword_t* result = df_row(p, forward ? p->out : p->in, b);
+        const bitword_t* gen = df_row(p, p->gen, b);
+        const bitword_t* kill = df_row(p, p->kill, b);
+
+        df_meet(p, cfg, b, facing);
+
+        int changed = 0;
+        for (int w = 0; w < p->words; w++)
+        {
+            bitword_t v = gen[w] | (facing[w] & ~kill[w]);
+            if (v != result[w]) { result[w] = v; changed = 1; }
+        }
+        transfers++;
+
+        int next = pos + 1;
+        if (changed)
+        {
+            const int* to;
+            int count;
+            if (forward)
+            {
+                to = cfg->blocks[b].succ;
+                count = cfg->blocks[b].succ_count;
+            }
+            else
+            {
+                to = cfg->preds + cfg->pred_start[b];
+                count = cfg->pred_start[b + 1] - cfg->pred_start[b];
+            }
+
+            for (int i = 0; i < count; i++)
+            {
+                int index = cfg->rpo_index[to[i]];
+                if (index < 0) continue;
+                int q = forward ? index : n - 1 - index;
+                pending[q] = 1;
+                if (q < next) next = q;
+            }
+        }
+        pos = next;
+    }
+
+    free(pending);
+    return transfers;
+}
+
+/* ---------- uses and definitions ---------- */
+
+typedef enum
+{
+    DF_USE,
+    DF_DEF,     // a value is stored
+    DF_DECL     // declared without a value, whatever it held is gone
+} df_event_kind_t;
+
+typedef struct
+{
+    unsigned char kind;
+    unsigned char maybe;    // might not happen, e.g. right of && and ||
+    int var;
+    int def;                // definition number of a DF_DEF, -1 otherwise
+    ASTNode* node;          // identifier, assignment, declaration, loop or parameter
+} df_event_t;
+
+typedef struct
+{
+    sym_entry_t* sym;
+    ASTNode* decl;
+    int uses;
+} df_var_t;
+
+struct dataflow_t
+{
+    symtab_t* table;
+    int* var_of;                // by symbol index, -1 if not a local being checked
+    unsigned int sym_count;
+
+    diag_list_t* diags;
+    cfg_t* cfg;
+
+    df_var_t* vars;
+    int var_count;
+    int var_capacity;
+
+    df_event_t* events;
+    int event_count;
+    int event_capacity;
+    int* block_events;          // block b has events block_events[b] .. block_events[b+1]
+
+    // definition d is events[def_event[d]]; var v has definitions
+    // var_defs[var_def_start[v] .. var_def_start[v+1]]
+    int def_count;
+    int* def_event;
+    int* var_defs;
+    int* var_def_start;
+};
+
+dataflow_t* dataflow_create(symtab_t* table)
+{
+    dataflow_t* df = df_alloc(sizeof(dataflow_t));
+    df->table = table;
+    df->sym_count = table ? table->sym_count : 0;
+    df->var_of = df_alloc(sizeof(int) * (df->sym_count + 1));
+    for (unsigned int i = 0; i < df->sym_count; i++) df->var_of[i] = -1;
+    return df;
+}
+
+void dataflow_destroy(dataflow_t* df)
+{
+    if (!df) return;
+    free(df->var_of);
+    free(df->vars);
+    free(df->events);
+    free(df);
+}
+
+static int df_var(dataflow_t* df, sym_entry_t* sym)
+{
+    if (!sym || sym->index >= df->sym_count) return -1;
+    return df->var_of[sym->index];
+}
+
+static void df_declare(dataflow_t* df, sym_entry_t* sym, ASTNode* decl)
+{
+    // globals and anything not stored in a slot are not tracked
+    if (!sym || sym->level == 0 || sym->index >= df->sym_count) return;
+    if (sym->symbol_type != SYM_VARIABLE && sym->symbol_type != SYM_CONSTANT
+        && sym->symbol_type != SYM_PARAM && sym->symbol_type != SYM_ARRAY) return;
+    if (df->var_of[sym->index] >= 0) return;
+
+    df->vars = df_grow(df->vars, &df->var_capacity, df->var_count, sizeof(df_var_t));
+    df->vars[df->var_count] = (df_var_t){ .sym = sym, .decl = decl };
+    df->var_of[sym->index] = df->var_count++;
+}
+
+// every local the body declares, before any event refers to one
+static void df_collect(dataflow_t* df, ASTNode* node)
+{
+    if (!node) return;
+
+    switch (node->type)
+    {
+        case AST_BLOCK:
+            for (size_t i = 0; i < node->as.block.count; i++)
+                df_collect(df, node->as.block.statements[i]);
+            break;
+        case AST_VAR_DECL:
+        case AST_CONST_DECL:
+            df_declare(df, node->as.declaration.ident->as.ident.sym, node);
+            break;
+        case AST_ARRAY_DECL:
+            df_declare(df, node->as.arr.ident->as.ident.sym, node);
+            break;
+        case AST_IF:
+            df_collect(df, node->as.ifstmt.then_branch);
+            df_collect(df, node->as.ifstmt.else_branch);
+            break;
+        case AST_MATCH:
+            for (size_t i = 0; i < node->as.matchstmt.case_count; i++)
+                df_collect(df, node->as.matchstmt.match_cases[i]->as.matchcase.stmt);
+            if (node->as.matchstmt.def_case) df_collect(df, node->as.matchstmt.def_case->as.matchcase.stmt);
+            break;
+        case AST_LOOP:
+        {
+            ASTNode* cond = node->as.loop.condition;
+            if (cond && cond->type == AST_LOOP_EXPR && cond->as.loopexpr.variable)
+                df_declare(df, cond->as.loopexpr.variable->as.ident.sym, cond);
+            df_collect(df, node->as.loop.block);
+            break;
+        }
+        default:
+            break;
+    }
+}
+
+static void df_event(dataflow_t* df, df_event_kind_t kind, sym_entry_t* sym, ASTNode* node, int maybe)
+{
+    int var = df_var(df, sym);
+    if (var < 0) return;
+
+    df->events = df_grow(df->events, &df->event_capacity, df->event_count, sizeof(df_event_t));
+    df->events[df->event_count++] = (df_event_t){
+        .kind = kind, .maybe = maybe, .var = var,
+        .def = kind == DF_DEF ? df->def_count++ : -1, .node = node
+    };
+    if (kind == DF_USE) df->vars[var].uses++;
+}
+
+// the events of evaluating node, in evaluation order
+static void df_visit(dataflow_t* df, ASTNode* node, int maybe)
+{
+    if (!node) return;
+
+    switch (node->type)
+    {
+        case AST_IDENTIFIER:
+            df_event(df, DF_USE, node->as.ident.sym, node, maybe);
+            break;
+        case AST_UNARY:
+            df_visit(df, node->as.unary.operand, maybe);
+            break;
+        case AST_BINARY:
+        {
+            TokenType op = node->as.binary.op->type;
+            df_visit(df, node->as.binary.left, maybe);
+            df_visit(df, node->as.binary.right, maybe || op == AND || op == OR);
+            break;
+        }
+        case AST_ASSIGN:
+            df_visit(df, node->as.assign.value, maybe);
+            if (node->as.assign.op->type != ASSIGN)
+                df_event(df, DF_USE, node->as.assign.sym, node, maybe);
+            df_event(df, DF_DEF, node->as.assign.sym, node, maybe);
+            break;
+        case AST_INDEX:
+            df_visit(df, node->as.idx.base, maybe);
+            df_visit(df, node->as.idx.index, maybe);
+            break;
+        case AST_FN_CALL:
+            for (int i = 0; i < node->as.call.arg_count; i++)
+                df_visit(df, node->as.call.args[i], maybe);
+            break;
+        case AST_RANGE:
+            df_visit(df, node->as.rng.start, maybe);
+            df_visit(df, node->as.rng.end, maybe);
+            df_visit(df, node->as.rng.step, maybe);
+            break;
+        case AST_VAR_DECL:
+        case AST_CONST_DECL:
+            df_visit(df, node->as.declaration.value, maybe);
+            df_event(df, node->as.declaration.value ? DF_DEF : DF_DECL,
+                     node->as.declaration.ident->as.ident.sym, node, maybe);
+            break;
+        case AST_ARRAY_DECL:
+            df_visit(df, node->as.arr.range, maybe);
+            for (size_t i = 0; i < node->as.arr.literal_count; i++)
+                df_visit(df, node->as.arr.literals[i], maybe);
+            df_event(df, DF_DEF, node->as.arr.ident->as.ident.sym, node, maybe);
+            break;
+        case AST_LOOP_EXPR:
+            df_event(df, DF_DEF, node->as.loopexpr.variable->as.ident.sym, node, maybe);
+            break;
+        case AST_RETURN:
+            df_visit(df, node->as.return_stmt.expr, maybe);
+            break;
+        default:
+            break;
+    }
+}
+
+static void df_build_events(dataflow_t* df)
+{
+    cfg_t* cfg = df->cfg;
+    df->block_events = df_alloc(sizeof(int) * (cfg->count + 1));
+
+    for (int b = 0; b < cfg->count; b++)
+    {
+        df->block_events[b] = df->event_count;
+
+        // parameters hold their arguments on entry
+        if (b == CFG_ENTRY)
+        {
+            ASTNode* fn = cfg->fn;
+            for (size_t i = 0; i < fn->as.func.params_count; i++)
+            {
+                ASTNode* param = fn->as.func.params[i];
+                if (param) df_event(df, DF_DEF, param->as.param.ident->as.ident.sym, param, 0);
+            }
+        }
+
+        for (int i = 0; i < cfg->blocks[b].count; i++)
+            df_visit(df, cfg->blocks[b].items[i], 0);
+    }
+    df->block_events[cfg->count] = df->event_count;
+
+    // definitions by variable
+    df->def_event = df_alloc(sizeof(int) * (df->def_count + 1));
+    df->var_defs = df_alloc(sizeof(int) * (df->def_count + 1));
+    df->var_def_start = df_alloc(sizeof(int) * (df->var_count + 1));
+
+    for (int e = 0; e < df->event_count; e++)
+    {
+        df_event_t* ev = &df->events[e];
+        if (ev->kind != DF_DEF) continue;
+        df->def_event[ev->def] = e;
+        df->var_def_start[ev->var + 1]++;
+    }
+    for (int v = 0; v < df->var_count; v++)
+        df->var_def_start[v + 1] += df->var_def_start[v];
+
+    int* fill = df_alloc(sizeof(int) * (df->var_count + 1));
+    memcpy(fill, df->var_def_start, sizeof(int) * df->var_count);
+    for (int d = 0; d < df->def_count; d++)
+        df->var_defs[fill[df->events[df->def_event[d]].var]++] = d;
+    free(fill);
+}
+
+static const char* df_var_name(dataflow_t* df, int var)
+{
+    return sym_name(df->vars[var].sym);
+}
+
+/* ---------- definite assignment ---------- */
+
+static void df_definite_assignment(dataflow_t* df)
+{
+    df_problem_t p;
+    df_problem_init(&p, df->cfg, DF_FORWARD, DF_INTERSECT, df->var_count);
+
+    for (int b = 0; b < df->cfg->count; b++)
+    {
+        bitword_t* gen = df_row(&p, p.gen, b);
+        bitword_t* kill = df_row(&p, p.kill, b);
+
+        for (int e = df->block_events[b]; e < df->block_events[b + 1]; e++)
+        {
+            df_event_t* ev = &df->events[e];
+            if (ev->kind == DF_DEF && !ev->maybe)
+            {
+                bitset_set(gen, ev->var);
+                bitset_clear(kill, ev->var);
+            }
+            else if (ev->kind == DF_DECL)
+            {
+                bitset_clear(gen, ev->var);
+                bitset_set(kill, ev->var);
+            }
+        }
+    }
+
+    df_solve(&p, df->cfg);
+
+    // report each variable once, at its first unassigned read
+    bitword_t* cur = df_alloc(sizeof(bitword_t) * p.words);
+    bitword_t* reported = df_alloc(sizeof(bitword_t) * p.words);
+
+    for (int i = 0; i < df->cfg->rpo_count; i++)
+    {
+        int b = df->cfg->rpo[i];
+        memcpy(cur, df_row(&p, p.in, b), sizeof(bitword_t) * p.words);
+
+        for (int e = df->block_events[b]; e < df->block_events[b + 1]; e++)
+        {
+            df_event_t* ev = &df->events[e];
+            if (ev->kind == DF_USE && !bitset_test(cur, ev->var) && !bitset_test(reported, ev->var))
+            {
+                diag_warning(df->diags, ev->node->location, "'%s' may be used before it is assigned",
+                             df_var_name(df, ev->var));
+                bitset_set(reported, ev->var);
+            }
+            else if (ev->kind == DF_DEF && !ev->maybe) bitset_set(cur, ev->var);
+            else if (ev->kind == DF_DECL) bitset_clear(cur, ev->var);
+        }
+    }
+
+    free(cur);
+    free(reported);
+    df_problem_free(&p);
+}
+
+/* ---------- reaching definitions ---------- */
+
+static void df_kill_var(dataflow_t* df, bitword_t* set, int var)
+{
+    for (int i = df->var_def_start[var]; i < df->var_def_start[var + 1]; i++)
+        bitset_clear(set, df->var_defs[i]);
+}
+
+// marks in used[v] the variables with a definition some read sees
+static void df_reaching_definitions(dataflow_t* df, unsigned char* used)
+{
+    df_problem_t p;
+    df_problem_init(&p, df->cfg, DF_FORWARD, DF_UNION, df->def_count);
+
+    // walked backwards, the first definite store of a variable seen is
+    // the one that survives the block, and it kills all the others
+    unsigned char* seen = df_alloc(df->var_count);
+    for (int b = 0; b < df->cfg->count; b++)
+    {
+        bitword_t* gen = df_row(&p, p.gen, b);
+        bitword_t* kill = df_row(&p, p.kill, b);
+
+        for (int e = df->block_events[b + 1] - 1; e >= df->block_events[b]; e--)
+        {
+            df_event_t* ev = &df->events[e];
+            if (ev->kind == DF_USE || seen[ev->var]) continue;
+
+            if (ev->kind == DF_DEF) bitset_set(gen, ev->def);
+            if (ev->kind == DF_DECL || !ev->maybe)
+            {
+                seen[ev->var] = 1;
+                for (int i = df->var_def_start[ev->var]; i < df->var_def_start[ev->var + 1]; i++)
+                    bitset_set(kill, df->var_defs[i]);
+            }
+        }
+        for (int e = df->block_events[b]; e < df->block_events[b + 1]; e++)
+            seen[df->events[e].var] = 0;
+    }
+    free(seen);
+
+    df_solve(&p, df->cfg);
+
+    bitword_t* cur = df_alloc(sizeof(bitword_t) * p.words);
+    for (int i = 0; i < df->cfg->rpo_count; i++)
+    {
+        int b = df->cfg->rpo[i];
+        memcpy(cur, df_row(&p, p.in, b), sizeof(bitword_t) * p.words);
+
+        for (int e = df->block_events[b]; e < df->block_events[b + 1]; e++)
+        {
+            df_event_t* ev = &df->events[e];
+            if (ev->kind == DF_USE)
+            {
+                if (used[ev->var]) continue;
+                for (int k = df->var_def_start[ev->var]; k < df->var_def_start[ev->var + 1]; k++)
+                    if (bitset_test(cur, df->var_defs[k])) { used[ev->var] = 1; break; }
+                continue;
+            }
+
+            if (ev->kind == DF_DECL || !ev->maybe) df_kill_var(df, cur, ev->var);
+            if (ev->kind == DF_DEF) bitset_set(cur, ev->def);
+        }
+    }
+
+    free(cur);
+    df_problem_free(&p);
+}
+
+/* ---------- liveness ---------- */
+
+static void df_liveness(dataflow_t* df, const unsigned char* used)
+{
+    df_problem_t p;
+    df_problem_init(&p, df->cfg, DF_BACKWARD, DF_UNION, df->var_count);
+
+    for (int b = 0; b < df->cfg->count; b++)
+    {
+        bitword_t* gen = df_row(&p, p.gen, b);
+        bitword_t* kill = df_row(&p, p.kill, b);
+
+        for (int e = df->block_events[b + 1] - 1; e >= df->block_events[b]; e--)
+        {
+            df_event_t* ev = &df->events[e];
+            if (ev->kind == DF_USE)
+            {
+                bitset_set(gen, ev->var);
+                bitset_clear(kill, ev->var);
+            }
+            else if (ev->kind == DF_DECL || !ev->maybe)
+            {
+                bitset_clear(gen, ev->var);
+                bitset_set(kill, ev->var);
+            }
+        }
+    }
+
+    df_solve(&p, df->cfg);
+
+    // a store to a variable that is read somewhere, but not after it.
+    // Variables never read at all were reported when their scope closed.
+    bitword_t* cur = df_alloc(sizeof(bitword_t) * p.words);
+    for (int i = 0; i < df->cfg->rpo_count; i++)
+    {
+        int b = df->cfg->rpo[i];
+        memcpy(cur, df_row(&p, p.out, b), sizeof(bitword_t) * p.words);
+
+        for (int e = df->block_events[b + 1] - 1; e >= df->block_events[b]; e--)
+        {
+            df_event_t* ev = &df->events[e];
+            if (ev->kind == DF_USE)
+            {
+                bitset_set(cur, ev->var);
+                continue;
+            }
+
+            ASTNodeType type = ev->node->type;
+            if (ev->kind == DF_DEF && !bitset_test(cur, ev->var) && (used[ev->var] || df->vars[ev->var].uses > 0)
+                && (type == AST_ASSIGN || type == AST_VAR_DECL || type == AST_CONST_DECL))
+            {
+                diag_warning(df->diags, ev->node->location, "value assigned to '%s' is never read",
+                             df_var_name(df, ev->var));
+            }
+            if (ev->kind == DF_DECL || !ev->maybe) bitset_clear(cur, ev->var);
+        }
+    }
+
+    free(cur);
+    df_problem_free(&p);
+}
+
+/* ---------- missing return ---------- */
+
+// the end of the body is reachable in a function that returns a value
+static void df_missing_return(dataflow_t* df)
+{
+    ASTNode* fn = df->cfg->fn;
+    const type_t* type = fn->as.func.ident->ty;
+    if (!type || type->kind != TY_FN || !type->elem) return;
+    if (type->elem->kind == TY_VOID || type->elem->kind == TY_ERROR) return;
+
+    if (df->cfg->rpo_index[df->cfg->end] >= 0)
+        diag_error(df->diags, fn->location, "'%s' may reach the end of its body without returning a value",
+                   fn->as.func.ident->as.ident.name);
+}
+
+/* ---------- driver ---------- */
+
+static void df_reset(dataflow_t* df)
+{
+    for (int v = 0; v < df->var_count; v++) df->var_of[df->vars[v].sym->index] = -1;
+    df->var_count = 0;
+    df->event_count = 0;
+    df->def_count = 0;
+
+    free(df->block_events);
+    free(df->def_event);
+    free(df->var_defs);
+    free(df->var_def_start);
+    df->block_events = df->def_event = df->var_defs = df->var_def_start = NULL;
+}
+
+void dataflow_check_function(dataflow_t* df, ASTNode* fn, diag_list_t* diags)
+{
+    if (!df || !fn || fn->type != AST_FN_DECL || !fn->as.func.block) return;
+
+    df->diags = diags;
+    df->cfg = cfg_build(fn);
+
+    for (size_t i = 0; i < fn->as.func.params_count; i++)
+    {
+        ASTNode* param = fn->as.func.params[i];
+        if (param) df_declare(df, param->as.param.ident->as.ident.sym, param);
+    }
+    df_collect(df, fn->as.func.block);
+    df_build_events(df);
+
+    unsigned char* used = df_alloc(df->var_count);
+    df_definite_assignment(df);
+    df_reaching_definitions(df, used);
+    df_liveness(df, used);
+    free(used);
+    df_missing_return(df);
+
+    cfg_t* cfg = df->cfg;
+    df_reset(df);
+    df->cfg = NULL;
+
+    for (int i = 0; i < cfg->nested_count; i++)
+        dataflow_check_function(df, cfg->nested[i], diags);
+    cfg_destroy(cfg);
+}
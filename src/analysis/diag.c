@@ -0,0 +1,126 @@
+#include "diag.h"
+
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+void diag_init(diag_list_t* list)
+{
+    list->items = NULL;
+    list->count = 0;
+    list->capacity = 0;
+    list->errors = 0;
+}
+
+void diag_free(diag_list_t* list)
+{
+    for (int i = 0; i < list->count; i++)
+        free(list->items[i].message);
+    free(list->items);
+    diag_init(list);
+}
+
+static void diag_push(diag_list_t* list, diag_t diag)
+{
+    if (list->count == list->capacity)
+    {
+        list->capacity = list->capacity ? list->capacity * 2 : 16;
+        list->items = realloc(list->items, sizeof(diag_t) * list->capacity);
+        if (!list->items)
+        {
+            fprintf(stderr, "Out of memory\n");
+            exit(1);
+        }
+    }
+    list->items[list->count++] = diag;
+    if (diag.severity == DIAG_ERROR) list->errors++;
+}
+
+static void diag_add(diag_list_t* list, diag_severity_t severity, SourceLocation loc,
+                     const char* fmt, va_list args)
+{
+    char buf[512];
+    vsnprintf(buf, sizeof(buf), fmt, args);
+
+    diag_t diag;
+    diag.line = loc.line;
+    diag.column = loc.column;
+    diag.severity = severity;
+    diag.message = malloc(strlen(buf) + 1);
+    if (!diag.message)
+    {
+        fprintf(stderr, "Out of memory\n");
+        exit(1);
+    }
+    strcpy(diag.message, buf);
+    diag_push(list, diag);
+}
+
+void diag_error(diag_list_t* list, SourceLocation loc, const char* fmt, ...)
+{
+    va_list args;
+    va_start(args, fmt);
+    diag_add(list, DIAG_ERROR, loc, fmt, args);
+    va_end(args);
+}
+
+void diag_warning(diag_list_t* list, SourceLocation loc, const char* fmt, ...)
+{
+    va_list args;
+    va_start(args, fmt);
+    diag_add(list, DIAG_WARNING, loc, fmt, args);
+    va_end(args);
+}
+
+// the severity is chosen by the caller, e.g. when replaying saved results
+void diag_report(diag_list_t* list, diag_severity_t severity, SourceLocation loc, const char* fmt, ...)
+{
+    va_list args;
+    va_start(args, fmt);
+    diag_add(list, severity, loc, fmt, args);
+    va_end(args);
+}
+
+void diag_merge(diag_list_t* into, diag_list_t* from)
+{
+    for (int i = 0; i < from->count; i++)
+        diag_push(into, from->items[i]);
+
+    // the messages moved, only the array is freed
+    free(from->items);
+    diag_init(from);
+}
+
+static int diag_before(const diag_t* a, const diag_t* b)
+{
+    if (a->line != b->line) return a->line < b->line;
+    return a->column < b->column;
+}
+
+void diag_sort(diag_list_t* list)
+{
+    // insertion sort: stable, and lists are short and mostly in order
+    for (int i = 1; i < list->count; i++)
+    {
+        diag_t d = list->items[i];
+        int j = i - 1;
+        while (j >= 0 && diag_before(&d, &list->items[j]))
+        {
+            list->items[j + 1] = list->items[j];
+            j--;
+        }
+        list->items[j + 1] = d;
+    }
+}
+
+void diag_print(diag_list_t* list)
+{
+    for (int i = 0; i < list->count; i++)
+    {
+        diag_t* d = &list->items[i];
+        const char* kind = d->severity == DIAG_ERROR ? "Error"
+                         : d->severity == DIAG_WARNING ? "Warning" : "Note";
+        fprintf(stderr, "%s at line %d:%d: %s\n", kind, d->line, d->column, d->message);
+    }
+}
@@ -0,0 +1,304 @@
+#include "effects.h"
+#include "fold.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+struct effects_t
+{
+    const callgraph_t* cg;
+    unsigned char* summary;     // effect_t bits, by call graph node
+};
+
+// One walk over a body or an expression. Calls into the SCC being
+// summarized are skipped, their effects are added by the union over the
+// SCC's members.
+typedef struct
+{
+    const effects_t* fx;
+    int scc;
+    unsigned int flags;
+
+    sym_entry_t** loop_vars;    // variables of the bounded loops we are in
+    int loop_count;
+    int loop_capacity;
+} effects_walk_t;
+
+static void fx_walk(effects_walk_t* w, ASTNode* node);
+
+// locals and parameters are below the top level
+static void fx_symbol(effects_walk_t* w, sym_entry_t* sym, int is_write)
+{
+    if (!sym) return;
+
+    if (is_write)
+    {
+        // stepping a loop's own variable can keep it running
+        for (int i = 0; i < w->loop_count; i++)
+            if (w->loop_vars[i] == sym) w->flags |= EFFECT_MAY_NOT_RETURN;
+    }
+
+    if (sym->level > 0) return;
+
+    // a global let never changes, reading it is like reading a literal
+    if (sym->symbol_type == SYM_ARRAY || (sym->symbol_type == SYM_VARIABLE && !sym->info.var.is_constant))
+        w->flags |= is_write ? EFFECT_WRITES_GLOBALS : EFFECT_READS_GLOBALS;
+}
+
+static void fx_call(effects_walk_t* w, ASTNode* call)
+{
+    ASTNode* callee = call->as.call.callee;
+    for (int i = 0; i < call->as.call.arg_count; i++)
+        fx_walk(w, call->as.call.args[i]);
+
+    if (!callee || callee->type != AST_IDENTIFIER)
+    {
+        w->flags |= EFFECT_ALL;
+        return;
+    }
+
+    int node = callgraph_node(w->fx->cg, callee->as.ident.sym);
+    if (node < 0) w->flags |= EFFECT_ALL;
+    else if (w->fx->cg->nodes[node].scc != w->scc) w->flags |= w->fx->summary[node];
+}
+
+// a range loop runs a known number of times unless its step may be zero,
+// the bounds are evaluated once before it starts. Without a variable or a
+// range the loop is a while.
+static int fx_loop_bounded(ASTNode* cond)
+{
+    if (!cond || cond->type != AST_LOOP_EXPR) return 0;
+
+    ASTNode* range = cond->as.loopexpr.expr;
+    if (!range || range->type != AST_RANGE) return cond->as.loopexpr.variable != NULL;
+    if (!range->as.rng.step) return 1;
+
+    const_value_t step = const_of(range->as.rng.step);
+    return step.kind == CONST_INT && step.i != 0;
+}
+
+static void fx_loop(effects_walk_t* w, ASTNode* node)
+{
+    ASTNode* cond = node->as.loop.condition;
+    if (!fx_loop_bounded(cond))
+    {
+        w->flags |= EFFECT_MAY_NOT_RETURN;
+        fx_walk(w, cond);
+        fx_walk(w, node->as.loop.block);
+        return;
+    }
+
+    fx_walk(w, cond->as.loopexpr.expr);
+
+    ASTNode* var = cond->as.loopexpr.variable;
+    if (var && var->type == AST_IDENTIFIER && var->as.ident.sym)
+    {
+        if (w->loop_count == w->loop_capacity)
+        {
+            w->loop_capacity = w->loop_capacity ? w->loop_capacity * 2 : 8;
+            w->loop_vars = realloc(w->loop_vars, sizeof(sym_entry_t*) * w->loop_capacity);
+            if (!w->loop_vars) { fprintf(stderr, "Out of memory\n"); exit(1); }
+        }
+        w->loop_vars[w->loop_count++] = var->as.ident.sym;
+        fx_walk(w, node->as.loop.block);
+        w->loop_count--;
+    }
+    else
+    {
+        fx_walk(w, node->as.loop.block);
+    }
+}
+
+static void fx_walk(effects_walk_t* w, ASTNode* node)
+{
+    if (!node) return;
+
+    switch (node->type)
+    {
+        case AST_IDENTIFIER:
+            fx_symbol(w, node->as.ident.sym, 0);
+            break;
+        case AST_UNARY:
+            fx_walk(w, node->as.unary.operand);
+            break;
+        case AST_BINARY:
+            fx_walk(w, node->as.binary.left);
+            fx_walk(w, node->as.binary.right);
+            break;
+        case AST_ASSIGN:
+            fx_walk(w, node->as.assign.value);
+            fx_symbol(w, node->as.assign.sym, 1);
+            break;
+        case AST_INDEX:
+            fx_walk(w, node->as.idx.base);
+            fx_walk(w, node->as.idx.index);
+            break;
+        case AST_RANGE:
+            fx_walk(w, node->as.rng.start);
+            fx_walk(w, node->as.rng.end);
+            fx_walk(w, node->as.rng.step);
+            break;
+        case AST_FN_CALL:
+            fx_call(w, node);
+            break;
+        case AST_BLOCK:
+            for (size_t i = 0; i < node->as.block.count; i++)
+                fx_walk(w, node->as.block.statements[i]);
+            break;
+        case AST_VAR_DECL:
+        case AST_CONST_DECL:
+            fx_walk(w, node->as.declaration.value);
+            break;
+        case AST_ARRAY_DECL:
+            fx_walk(w, node->as.arr.range);
+            for (size_t i = 0; i < node->as.arr.literal_count; i++)
+                fx_walk(w, node->as.arr.literals[i]);
+            break;
+        case AST_IF:
+            fx_walk(w, node->as.ifstmt.condition);
+            fx_walk(w, node->as.ifstmt.then_branch);
+            fx_walk(w, node->as.ifstmt.else_branch);
+            break;
+        case AST_MATCH:
+            fx_walk(w, node->as.matchstmt.pattern);
+            for (size_t i = 0; i < node->as.matchstmt.case_count; i++)
+            {
+                fx_walk(w, node->as.matchstmt.match_cases[i]->as.matchcase.expr);
+                fx_walk(w, node->as.matchstmt.match_cases[i]->as.matchcase.stmt);
+            }
+            if (node->as.matchstmt.def_case)
+                fx_walk(w, node->as.matchstmt.def_case->as.matchcase.stmt);
+            break;
+        case AST_LOOP:
+            fx_loop(w, node);
+            break;
+        case AST_LOOP_EXPR:
+            fx_walk(w, node->as.loopexpr.expr);
+            break;
+        case AST_RETURN:
+            fx_walk(w, node->as.return_stmt.expr);
+            break;
+        case AST_LITERAL:
+        case AST_FN_DECL:   // a node of its own, declaring it does nothing
+        case AST_STRUCT:
+        case AST_UNION:
+        case AST_ENUM:
+        case AST_IMPORT:
+        case AST_STMT:
+            break;
+        default:
+            w->flags |= EFFECT_UNKNOWN;
+            break;
+    }
+}
+
+effects_t* effects_compute(const callgraph_t* cg)
+{
+    if (!cg) return NULL;
+
+    effects_t* fx = calloc(1, sizeof(effects_t));
+    if (!fx) { fprintf(stderr, "Out of memory\n"); exit(1); }
+    fx->cg = cg;
+    fx->summary = calloc(cg->count + 1, 1);
+    if (!fx->summary) { fprintf(stderr, "Out of memory\n"); exit(1); }
+
+    effects_walk_t w = { .fx = fx };
+    for (int s = 0; s < cg->scc_count; s++)
+    {
+        w.scc = s;
+        w.flags = EFFECT_NONE;
+
+        for (int m = cg->scc_start[s]; m < cg->scc_start[s + 1]; m++)
+        {
+            ASTNode* decl = cg->nodes[cg->scc_members[m]].decl;
+            if (decl && decl->as.func.block) fx_walk(&w, decl->as.func.block);
+            else w.flags |= EFFECT_ALL;
+        }
+        if (callgraph_is_recursive(cg, cg->scc_members[cg->scc_start[s]]))
+            w.flags |= EFFECT_MAY_NOT_RETURN;
+
+        for (int m = cg->scc_start[s]; m < cg->scc_start[s + 1]; m++)
+            fx->summary[cg->scc_members[m]] = (unsigned char)w.flags;
+    }
+
+    free(w.loop_vars);
+    return fx;
+}
+
+void effects_destroy(effects_t* fx)
+{
+    if (!fx) return;
+    free(fx->summary);
+    free(fx);
+}
+
+unsigned int effects_of(const effects_t* fx, sym_entry_t* fn)
+{
+    int node = fx ? callgraph_node(fx->cg, fn) : -1;
+    return node < 0 ? EFFECT_ALL : fx->summary[node];
+}
+
+unsigned int effects_of_expr(const effects_t* fx, ASTNode* expr)
+{
+    if (!fx) return EFFECT_ALL;
+
+    effects_walk_t w = { .fx = fx, .scc = -1 };
+    fx_walk(&w, expr);
+    free(w.loop_vars);
+    return w.flags;
+}
+
+int effects_is_pure(const effects_t* fx, sym_entry_t* fn)
+{
+    return (effects_of(fx, fn) & ~EFFECT_MAY_NOT_RETURN) == 0;
+}
+
+int effects_is_removable(const effects_t* fx, sym_entry_t* fn)
+{
+    return effects_of(fx, fn) == EFFECT_NONE;
+}
+
+const char* effects_to_string(unsigned int effects, char* buf, size_t size)
+{
+    if (effects == EFFECT_NONE)
+    {
+        snprintf(buf, size, "pure");
+        return buf;
+    }
+
+    static const char* names[] = { "reads globals", "writes globals", "may not return", "unknown" };
+    size_t len = 0;
+    buf[0] = '\0';
+    for (int i = 0; i < 4; i++)
+    {
+        if (!(effects & (1u << i))) continue;
+        int n = snprintf(buf + len, size - len, "%s%s", len ? ", " : "", names[i]);
+        if (n < 0 || (size_t)n >= size - len) break;
+        len += n;
+    }
+    return buf;
+}
+
+void effects_print_stats(const effects_t* fx)
+{
+    if (!fx) return;
+
+    const callgraph_t* cg = fx->cg;
+    int pure = 0, reads = 0, writes = 0, diverges = 0;
+    for (int n = 0; n < cg->count; n++)
+    {
+        unsigned int e = fx->summary[n];
+        char buf[64];
+        if (cg->nodes[n].decl)
+            printf("DEBUG: fn '%s': %s\n", sym_name(cg->nodes[n].sym), effects_to_string(e, buf, sizeof(buf)));
+
+        if ((e & ~EFFECT_MAY_NOT_RETURN) == 0) pure++;
+        if (e & EFFECT_READS_GLOBALS) reads++;
+        if (e & EFFECT_WRITES_GLOBALS) writes++;
+        if (e & EFFECT_MAY_NOT_RETURN) diverges++;
+    }
+
+    printf("Effects: %d pure, %d read globals, %d write globals, %d may not return\n",
+           pure, reads, writes, diverges);
+}
@@ -0,0 +1,563 @@
+#include "escape.h"
+#include "types.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+struct escape_t
+{
+    const callgraph_t* cg;
+    unsigned char* params;      // storage_t per parameter, see param_start
+    int* param_start;           // by call graph node
+    int counts[4];              // aggregates per storage_t
+};
+
+// where a value ends up: a tracked local, or a fixed storage
+typedef struct
+{
+    int var;
+    storage_t storage;
+} escape_sink_t;
+
+static const escape_sink_t SINK_USE = { -1, STORAGE_STACK };
+
+typedef struct
+{
+    int from;
+    int to;         // from lives at least as long as to
+} escape_edge_t;
+
+typedef struct
+{
+    ASTNode* node;  // a str concatenation or a call
+    escape_sink_t sink;
+} escape_temp_t;
+
+typedef struct
+{
+    escape_t* esc;
+    symtab_t* table;
+
+    int* var_of;                // by symbol index, -1 if not tracked
+    sym_entry_t** syms;
+    unsigned char* storage;     // storage_t per local
+    int var_count;
+    int var_capacity;
+
+    escape_edge_t* edges;
+    int edge_count;
+    int edge_capacity;
+
+    escape_temp_t* temps;
+    int temp_count;
+    int temp_capacity;
+} escape_ctx_t;
+
+static void* escape_alloc(size_t size)
+{
+    void* m = calloc(1, size ? size : 1);
+    if (!m) { fprintf(stderr, "Out of memory\n"); exit(1); }
+    return m;
+}
+
+static void* escape_grow(void* m, int* capacity, int count, size_t size)
+{
+    if (count < *capacity) return m;
+    *capacity = *capacity ? *capacity * 2 : 16;
+    m = realloc(m, size * *capacity);
+    if (!m) { fprintf(stderr, "Out of memory\n"); exit(1); }
+    return m;
+}
+
+static int escape_is_aggregate(const type_t* type)
+{
+    return type && (type->kind == TY_STR || type->kind == TY_ARRAY || type->kind == TY_VEC);
+}
+
+static void escape_raise(unsigned char* storage, storage_t to)
+{
+    if (*storage < to) *storage = (unsigned char)to;
+}
+
+storage_t escape_param(const escape_t* esc, sym_entry_t* fn, int param)
+{
+    int node = esc ? callgraph_node(esc->cg, fn) : -1;
+    if (node < 0 || !esc->cg->nodes[node].decl) return STORAGE_HEAP;
+    if (param < 0 || param >= esc->param_start[node + 1] - esc->param_start[node]) return STORAGE_HEAP;
+    return (storage_t)esc->params[esc->param_start[node] + param];
+}
+
+/* ---------- flow ---------- */
+
+static int escape_var(escape_ctx_t* ctx, sym_entry_t* sym)
+{
+    if (!sym || sym->index >= ctx->table->sym_count) return -1;
+    return ctx->var_of[sym->index];
+}
+
+static void escape_temp(escape_ctx_t* ctx, ASTNode* node, escape_sink_t sink)
+{
+    ctx->temps = escape_grow(ctx->temps, &ctx->temp_capacity, ctx->temp_count, sizeof(escape_temp_t));
+    ctx->temps[ctx->temp_count++] = (escape_temp_t){ node, sink };
+}
+
+static void escape_into(escape_ctx_t* ctx, int var, escape_sink_t sink)
+{
+    if (sink.var < 0)
+    {
+        escape_raise(&ctx->storage[var], sink.storage);
+        return;
+    }
+    if (sink.var == var) return;
+
+    ctx->edges = escape_grow(ctx->edges, &ctx->edge_capacity, ctx->edge_count, sizeof(escape_edge_t));
+    ctx->edges[ctx->edge_count++] = (escape_edge_t){ var, sink.var };
+}
+
+// the aggregates expr evaluates to end up in sink
+static void escape_flow(escape_ctx_t* ctx, ASTNode* node, escape_sink_t sink)
+{
+    if (!node) return;
+
+    switch (node->type)
+    {
+        case AST_IDENTIFIER:
+        {
+            int v = escape_var(ctx, node->as.ident.sym);
+            if (v >= 0) escape_into(ctx, v, sink);
+            break;
+        }
+        case AST_BINARY:
+            // concatenation copies its operands into a new string
+            escape_flow(ctx, node->as.binary.left, SINK_USE);
+            escape_flow(ctx, node->as.binary.right, SINK_USE);
+            if (node->ty && node->ty->kind == TY_STR) escape_temp(ctx, node, sink);
+            break;
+        case AST_UNARY:
+            escape_flow(ctx, node->as.unary.operand, SINK_USE);
+            break;
+        case AST_ASSIGN:
+        {
+            sym_entry_t* target = node->as.assign.sym;
+            int v = escape_var(ctx, target);
+            if (v >= 0) escape_flow(ctx, node->as.assign.value, (escape_sink_t){ v, STORAGE_STACK });
+            else if (target && target->level == 0) escape_flow(ctx, node->as.assign.value,
+                                                               (escape_sink_t){ -1, STORAGE_HEAP });
+            else escape_flow(ctx, node->as.assign.value, SINK_USE);
+
+            // the assignment's own value
+            if (sink.var >= 0 || sink.storage > STORAGE_STACK) escape_flow(ctx, node->as.assign.value, sink);
+            break;
+        }
+        case AST_INDEX:
+        {
+            // an element of an array of strings is the array's storage
+            int whole = escape_is_aggregate(node->ty);
+            escape_flow(ctx, node->as.idx.base, whole ? sink : SINK_USE);
+            escape_flow(ctx, node->as.idx.index, SINK_USE);
+            break;
+        }
+        case AST_FN_CALL:
+        {
+            ASTNode* callee = node->as.call.callee;
+            sym_entry_t* fn = callee && callee->type == AST_IDENTIFIER ? callee->as.ident.sym : NULL;
+
+            for (int i = 0; i < node->as.call.arg_count; i++)
+            {
+                storage_t p = escape_param(ctx->esc, fn, i);
+                if (p == STORAGE_HEAP) escape_flow(ctx, node->as.call.args[i], (escape_sink_t){ -1, STORAGE_HEAP });
+                else if (p == STORAGE_CALLER) escape_flow(ctx, node->as.call.args[i], sink);
+                else escape_flow(ctx, node->as.call.args[i], SINK_USE);
+            }
+            if (escape_is_aggregate(node->ty)) escape_temp(ctx, node, sink);
+            break;
+        }
+        case AST_RANGE:
+            escape_flow(ctx, node->as.rng.start, SINK_USE);
+            escape_flow(ctx, node->as.rng.end, SINK_USE);
+            escape_flow(ctx, node->as.rng.step, SINK_USE);
+            break;
+        default:
+            // literals are static data
+            break;
+    }
+}
+
+// a nested function can run after we return, whatever it names escapes
+static void escape_capture(escape_ctx_t* ctx, ASTNode* node)
+{
+    if (!node) return;
+
+    switch (node->type)
+    {
+        case AST_IDENTIFIER:
+        {
+            int v = escape_var(ctx, node->as.ident.sym);
+            if (v >= 0) escape_raise(&ctx->storage[v], STORAGE_HEAP);
+            break;
+        }
+        case AST_ASSIGN:
+        {
+            int v = escape_var(ctx, node->as.assign.sym);
+            if (v >= 0) escape_raise(&ctx->storage[v], STORAGE_HEAP);
+            escape_capture(ctx, node->as.assign.value);
+            break;
+        }
+        case AST_UNARY:
+            escape_capture(ctx, node->as.unary.operand);
+            break;
+        case AST_BINARY:
+            escape_capture(ctx, node->as.binary.left);
+            escape_capture(ctx, node->as.binary.right);
+            break;
+        case AST_INDEX:
+            escape_capture(ctx, node->as.idx.base);
+            escape_capture(ctx, node->as.idx.index);
+            break;
+        case AST_FN_CALL:
+            for (int i = 0; i < node->as.call.arg_count; i++)
+                escape_capture(ctx, node->as.call.args[i]);
+            break;
+        case AST_RANGE:
+            escape_capture(ctx, node->as.rng.start);
+            escape_capture(ctx, node->as.rng.end);
+            escape_capture(ctx, node->as.rng.step);
+            break;
+        case AST_BLOCK:
+            for (size_t i = 0; i < node->as.block.count; i++)
+                escape_capture(ctx, node->as.block.statements[i]);
+            break;
+        case AST_VAR_DECL:
+        case AST_CONST_DECL:
+            escape_capture(ctx, node->as.declaration.value);
+            break;
+        case AST_ARRAY_DECL:
+            for (size_t i = 0; i < node->as.arr.literal_count; i++)
+                escape_capture(ctx, node->as.arr.literals[i]);
+            break;
+        case AST_IF:
+            escape_capture(ctx, node->as.ifstmt.condition);
+            escape_capture(ctx, node->as.ifstmt.then_branch);
+            escape_capture(ctx, node->as.ifstmt.else_branch);
+            break;
+        case AST_MATCH:
+            escape_capture(ctx, node->as.matchstmt.pattern);
+            for (size_t i = 0; i < node->as.matchstmt.case_count; i++)
+                escape_capture(ctx, node->as.matchstmt.match_cases[i]->as.matchcase.stmt);
+            if (node->as.matchstmt.def_case)
+                escape_capture(ctx, node->as.matchstmt.def_case->as.matchcase.stmt);
+            break;
+        case AST_LOOP:
+            escape_capture(ctx, node->as.loop.condition);
+            escape_capture(ctx, node->as.loop.block);
+            break;
+        case AST_LOOP_EXPR:
+            escape_capture(ctx, node->as.loopexpr.expr);
+            break;
+        case AST_RETURN:
+            escape_capture(ctx, node->as.return_stmt.expr);
+            break;
+        case AST_FN_DECL:
+            escape_capture(ctx, node->as.func.block);
+            break;
+        default:
+            break;
+    }
+}
+
+static void escape_stmt(escape_ctx_t* ctx, ASTNode* node)
+{
+    if (!node) return;
+
+    switch (node->type)
+    {
+        case AST_BLOCK:
+            for (size_t i = 0; i < node->as.block.count; i++)
+                escape_stmt(ctx, node->as.block.statements[i]);
+            break;
+        case AST_VAR_DECL:
+        case AST_CONST_DECL:
+        {
+            ASTNode* ident = node->as.declaration.ident;
+            int v = escape_var(ctx, ident->as.ident.sym);
+            escape_sink_t sink = v >= 0 ? (escape_sink_t){ v, STORAGE_STACK } : SINK_USE;
+            if (ident->as.ident.sym && ident->as.ident.sym->level == 0) sink = (escape_sink_t){ -1, STORAGE_HEAP };
+            escape_flow(ctx, node->as.declaration.value, sink);
+            break;
+        }
+        case AST_ARRAY_DECL:
+        {
+            int v = escape_var(ctx, node->as.arr.ident->as.ident.sym);
+            escape_sink_t sink = v >= 0 ? (escape_sink_t){ v, STORAGE_STACK } : SINK_USE;
+            for (size_t i = 0; i < node->as.arr.literal_count; i++)
+                escape_flow(ctx, node->as.arr.literals[i], sink);
+            break;
+        }
+        case AST_IF:
+            escape_flow(ctx, node->as.ifstmt.condition, SINK_USE);
+            escape_stmt(ctx, node->as.ifstmt.then_branch);
+            escape_stmt(ctx, node->as.ifstmt.else_branch);
+            break;
+        case AST_MATCH:
+            escape_flow(ctx, node->as.matchstmt.pattern, SINK_USE);
+            for (size_t i = 0; i < node->as.matchstmt.case_count; i++)
+                escape_stmt(ctx, node->as.matchstmt.match_cases[i]->as.matchcase.stmt);
+            if (node->as.matchstmt.def_case)
+                escape_stmt(ctx, node->as.matchstmt.def_case->as.matchcase.stmt);
+            break;
+        case AST_LOOP:
+        {
+            ASTNode* cond = node->as.loop.condition;
+            if (cond && cond->type == AST_LOOP_EXPR)
+            {
+                // the variable of a loop over a collection holds its elements
+                ASTNode* var = cond->as.loopexpr.variable;
+                int v = var ? escape_var(ctx, var->as.ident.sym) : -1;
+                escape_flow(ctx, cond->as.loopexpr.expr, v >= 0 ? (escape_sink_t){ v, STORAGE_STACK } : SINK_USE);
+            }
+            else
+            {
+                escape_flow(ctx, cond, SINK_USE);
+            }
+            escape_stmt(ctx, node->as.loop.block);
+            break;
+        }
+        case AST_RETURN:
+            escape_flow(ctx, node->as.return_stmt.expr, (escape_sink_t){ -1, STORAGE_CALLER });
+            break;
+        case AST_FN_DECL:
+            escape_capture(ctx, node->as.func.block);
+            break;
+        default:
+            escape_flow(ctx, node, SINK_USE);
+            break;
+    }
+}
+
+/* ---------- functions ---------- */
+
+static void escape_track(escape_ctx_t* ctx, ASTNode* ident)
+{
+    if (!ident || ident->type != AST_IDENTIFIER || !escape_is_aggregate(ident->ty)) return;
+    sym_entry_t* sym = ident->as.ident.sym;
+    if (!sym || sym->index >= ctx->table->sym_count || ctx->var_of[sym->index] >= 0) return;
+
+    if (ctx->var_count == ctx->var_capacity)
+    {
+        ctx->var_capacity = ctx->var_capacity ? ctx->var_capacity * 2 : 16;
+        ctx->syms = realloc(ctx->syms, sizeof(sym_entry_t*) * ctx->var_capacity);
+        ctx->storage = realloc(ctx->storage, ctx->var_capacity);
+        if (!ctx->syms || !ctx->storage) { fprintf(stderr, "Out of memory\n"); exit(1); }
+    }
+    ctx->var_of[sym->index] = ctx->var_count;
+    ctx->syms[ctx->var_count] = sym;
+    ctx->storage[ctx->var_count] = STORAGE_STACK;
+    ctx->var_count++;
+}
+
+// the locals the function itself declares, not those of nested functions
+static void escape_collect(escape_ctx_t* ctx, ASTNode* node)
+{
+    if (!node) return;
+
+    switch (node->type)
+    {
+        case AST_BLOCK:
+            for (size_t i = 0; i < node->as.block.count; i++)
+                escape_collect(ctx, node->as.block.statements[i]);
+            break;
+        case AST_VAR_DECL:
+        case AST_CONST_DECL:
+            escape_track(ctx, node->as.declaration.ident);
+            break;
+        case AST_ARRAY_DECL:
+            escape_track(ctx, node->as.arr.ident);
+            break;
+        case AST_IF:
+            escape_collect(ctx, node->as.ifstmt.then_branch);
+            escape_collect(ctx, node->as.ifstmt.else_branch);
+            break;
+        case AST_MATCH:
+            for (size_t i = 0; i < node->as.matchstmt.case_count; i++)
+                escape_collect(ctx, node->as.matchstmt.match_cases[i]->as.matchcase.stmt);
+            if (node->as.matchstmt.def_case)
+                escape_collect(ctx, node->as.matchstmt.def_case->as.matchcase.stmt);
+            break;
+        case AST_LOOP:
+            if (node->as.loop.condition && node->as.loop.condition->type == AST_LOOP_EXPR)
+                escape_track(ctx, node->as.loop.condition->as.loopexpr.variable);
+            escape_collect(ctx, node->as.loop.block);
+            break;
+        default:
+            break;
+    }
+}
+
+// Classifies one function's aggregates and records what it does with its
+// parameters. Returns 1 if that summary changed.
+static int escape_function(escape_ctx_t* ctx, int node)
+{
+    escape_t* esc = ctx->esc;
+    ASTNode* fn = esc->cg->nodes[node].decl;
+    FuncDecl* func = &fn->as.func;
+
+    ctx->var_count = 0;
+    ctx->edge_count = 0;
+    ctx->temp_count = 0;
+
+    int params = esc->param_start[node + 1] - esc->param_start[node];
+    for (int i = 0; i < params; i++)
+        if (func->params[i]) escape_track(ctx, func->params[i]->as.param.ident);
+    escape_collect(ctx, func->block);
+    escape_stmt(ctx, func->block);
+
+    // a value lives as long as the longest-lived place it flows into
+    for (int changed = 1; changed;)
+    {
+        changed = 0;
+        for (int e = 0; e < ctx->edge_count; e++)
+        {
+            escape_edge_t edge = ctx->edges[e];
+            if (ctx->storage[edge.from] < ctx->storage[edge.to])
+            {
+                ctx->storage[edge.from] = ctx->storage[edge.to];
+                changed = 1;
+            }
+        }
+    }
+
+    for (int t = 0; t < ctx->temp_count; t++)
+    {
+        escape_temp_t temp = ctx->temps[t];
+        int* storage = temp.node->type == AST_BINARY ? &temp.node->as.binary.storage : &temp.node->as.call.storage;
+        *storage = STORAGE_NONE;
+    }
+    for (int t = 0; t < ctx->temp_count; t++)
+    {
+        escape_temp_t temp = ctx->temps[t];
+        int* storage = temp.node->type == AST_BINARY ? &temp.node->as.binary.storage : &temp.node->as.call.storage;
+        storage_t s = temp.sink.var >= 0 ? (storage_t)ctx->storage[temp.sink.var] : temp.sink.storage;
+        if (*storage < (int)s) *storage = s;
+    }
+
+    int changed = 0;
+    for (int i = 0; i < params; i++)
+    {
+        ASTNode* param = func->params[i];
+        int v = param ? escape_var(ctx, param->as.param.ident->as.ident.sym) : -1;
+        storage_t s = v >= 0 ? (storage_t)ctx->storage[v] : STORAGE_STACK;
+        if (esc->params[esc->param_start[node] + i] != s) changed = 1;
+        esc->params[esc->param_start[node] + i] = (unsigned char)s;
+    }
+
+    // a parameter's own storage is the caller's
+    for (int v = 0; v < ctx->var_count; v++)
+    {
+        sym_entry_t* sym = ctx->syms[v];
+        sym->storage = sym->symbol_type == SYM_PARAM ? STORAGE_CALLER : ctx->storage[v];
+        ctx->var_of[sym->index] = -1;
+
+        if (sym->storage == STORAGE_HEAP)
+            printf("DEBUG: '%s' declared on line %d escapes to the heap\n", sym_name(sym), sym->line);
+    }
+    return changed;
+}
+
+escape_t* escape_analyze(ASTNode* prog, symtab_t* table, const callgraph_t* cg)
+{
+    if (!prog || prog->type != AST_PROGRAM || !table || !cg) return NULL;
+
+    escape_t* esc = escape_alloc(sizeof(escape_t));
+    esc->cg = cg;
+    esc->param_start = escape_alloc(sizeof(int) * (cg->count + 1));
+    for (int n = 0; n < cg->count; n++)
+    {
+        ASTNode* decl = cg->nodes[n].decl;
+        esc->param_start[n + 1] = esc->param_start[n] + (decl ? (int)decl->as.func.params_count : 0);
+    }
+    esc->params = escape_alloc(esc->param_start[cg->count] + 1);
+    memset(esc->params, STORAGE_STACK, esc->param_start[cg->count] + 1);
+
+    // a prototype without a body may keep anything
+    for (int n = 0; n < cg->count; n++)
+        if (cg->nodes[n].decl && !cg->nodes[n].decl->as.func.block)
+            memset(esc->params + esc->param_start[n], STORAGE_HEAP, esc->param_start[n + 1] - esc->param_start[n]);
+
+    escape_ctx_t ctx = { .esc = esc, .table = table };
+    ctx.var_of = escape_alloc(sizeof(int) * (table->sym_count + 1));
+    for (unsigned int i = 0; i < table->sym_count; i++) ctx.var_of[i] = -1;
+
+    // callees first; a recursive SCC starts from "keeps nothing" and is
+    // re-run until its summaries stop growing
+    for (int s = 0; s < cg->scc_count; s++)
+    {
+        for (int changed = 1; changed;)
+        {
+            changed = 0;
+            for (int m = cg->scc_start[s]; m < cg->scc_start[s + 1]; m++)
+            {
+                int node = cg->scc_members[m];
+                ASTNode* decl = cg->nodes[node].decl;
+                if (decl && decl->as.func.block && escape_function(&ctx, node)) changed = 1;
+            }
+            if (!callgraph_is_recursive(cg, cg->scc_members[cg->scc_start[s]])) break;
+        }
+    }
+
+    // temporaries in global initializers live as long as the program
+    for (int i = 0; i < prog->as.program.stmt_count; i++)
+    {
+        ASTNode* stmt = prog->as.program.statements[i];
+        if (stmt && stmt->type != AST_FN_DECL)
+        {
+            ctx.temp_count = 0;
+            escape_stmt(&ctx, stmt);
+            for (int t = 0; t < ctx.temp_count; t++)
+            {
+                ASTNode* node = ctx.temps[t].node;
+                if (node->type == AST_BINARY) node->as.binary.storage = STORAGE_HEAP;
+                else node->as.call.storage = STORAGE_HEAP;
+            }
+        }
+    }
+
+    for (unsigned int i = 1; i < table->sym_count; i++)
+    {
+        sym_entry_t* sym = symtab_symbol(table, i);
+        if (sym && sym->storage != STORAGE_NONE && sym->symbol_type != SYM_PARAM) esc->counts[sym->storage]++;
+    }
+
+    free(ctx.var_of);
+    free(ctx.syms);
+    free(ctx.storage);
+    free(ctx.edges);
+    free(ctx.temps);
+    return esc;
+}
+
+void escape_destroy(escape_t* esc)
+{
+    if (!esc) return;
+    free(esc->params);
+    free(esc->param_start);
+    free(esc);
+}
+
+const char* storage_name(storage_t storage)
+{
+    switch (storage)
+    {
+        case STORAGE_STACK:  return "stack";
+        case STORAGE_CALLER: return "caller";
+        case STORAGE_HEAP:   return "heap";
+        default:             return "none";
+    }
+}
+
+void escape_print_stats(const escape_t* esc)
+{
+    if (!esc) return;
+    printf("Escape: %d local aggregate(s) on the stack, %d in the caller, %d on the heap\n",
+           esc->counts[STORAGE_STACK], esc->counts[STORAGE_CALLER], esc->counts[STORAGE_HEAP]);
+}
@@ -0,0 +1,620 @@
+#include "fold.h"
+#include "ctfe.h"
+#include "effects.h"
+#include "symtab.h"
+#include "types.h"
+
+#include <limits.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+typedef struct
+{
+    symtab_t* table;
+    typecheck_t* tc;
+    ctfe_t* ctfe;               // evaluates pure calls, may be NULL
+    const effects_t* effects;   // drops calls that do nothing, may be NULL
+    diag_list_t* diags;
+
+    const_value_t* lets;        // constant `let` values, by symbol index
+    unsigned int let_count;
+    int folded;
+} fold_t;
+
+static void fold_expr(fold_t* f, ASTNode* node);
+static void fold_stmt(fold_t* f, ASTNode* node);
+
+/* ---------- values ---------- */
+
+const_value_t const_of(ASTNode* node)
+{
+    const_value_t v = { CONST_NONE, 0, 0.0, NULL };
+    if (!node || node->type != AST_LITERAL || !node->as.literal.value) return v;
+
+    const char* s = node->as.literal.value;
+    switch (node->as.literal.kind)
+    {
+        // the lexer strips the 0x, 0o and 0b prefixes
+        case INT_LITERAL:    v.kind = CONST_INT; v.i = (long long)strtoull(s, NULL, 10); break;
+        case HEX_LITERAL:    v.kind = CONST_INT; v.i = (long long)strtoull(s, NULL, 16); break;
+        case OCTAL_LITERAL:  v.kind = CONST_INT; v.i = (long long)strtoull(s, NULL, 8);  break;
+        case BINARY_LITERAL: v.kind = CONST_INT; v.i = (long long)strtoull(s, NULL, 2);  break;
+        case CHAR_LITERAL:   v.kind = CONST_INT; v.i = (unsigned char)s[0];              break;
+        case FLOAT_LITERAL:  v.kind = CONST_FLOAT; v.f = strtod(s, NULL);                break;
+        case BOOL_LITERAL:   v.kind = CONST_BOOL; v.i = strcmp(s, "true") == 0;          break;
+        case STRING_LITERAL: v.kind = CONST_STR; v.s = s;                                break;
+        default: break;
+    }
+
+    // a folded negative is written with its sign
+    if (v.kind == CONST_INT && node->as.literal.kind == INT_LITERAL && s[0] == '-')
+        v.i = strtoll(s, NULL, 10);
+    return v;
+}
+
+static long long wrap_bits(unsigned long long x, int bits, int is_signed)
+{
+    if (bits >= 64) return (long long)x;
+
+    unsigned long long mask = (1ULL << bits) - 1;
+    x &= mask;
+    if (is_signed && (x >> (bits - 1)))
+        x |= ~mask;
+    return (long long)x;
+}
+
+// width of an integer type in bits, 0 for anything else
+static int int_bits(const type_t* type, int* is_signed)
+{
+    *is_signed = 1;
+    switch (type ? type->kind : TY_ERROR)
+    {
+        case TY_CHAR:  *is_signed = 0; return 8;
+        case TY_BYTE:  *is_signed = 0; return 8;
+        case TY_SHORT: return 16;
+        case TY_INT:   return 32;
+        case TY_LONG:  return 64;
+        default:       return 0;
+    }
+}
+
+const_value_t const_convert(const_value_t v, const type_t* type)
+{
+    if (!type || v.kind == CONST_NONE) return v;
+
+    int is_signed;
+    int bits = int_bits(type, &is_signed);
+    if (bits)
+    {
+        long long i = v.kind == CONST_FLOAT ? (long long)v.f : v.i;
+        v.kind = CONST_INT;
+        v.i = wrap_bits((unsigned long long)i, bits, is_signed);
+    }
+    else if (type->kind == TY_FLOAT || type->kind == TY_DOUBLE)
+    {
+        double d = v.kind == CONST_FLOAT ? v.f : (double)v.i;
+        v.kind = CONST_FLOAT;
+        v.f = type->kind == TY_FLOAT ? (double)(float)d : d;
+    }
+    return v;
+}
+
+static double as_double(const_value_t v)
+{
+    return v.kind == CONST_FLOAT ? v.f : (double)v.i;
+}
+
+static fold_status_t const_compare(TokenType op, const_value_t l, const_value_t r, const_value_t* out)
+{
+    int c;
+    if (l.kind == CONST_STR && r.kind == CONST_STR)
+        c = strcmp(l.s, r.s);
+    else if (l.kind == CONST_FLOAT || r.kind == CONST_FLOAT)
+    {
+        double a = as_double(l), b = as_double(r);
+        c = a < b ? -1 : a > b;
+    }
+    else
+        c = l.i < r.i ? -1 : l.i > r.i;
+
+    int result;
+    switch (op)
+    {
+        case EQUAL:         result = c == 0; break;
+        case NOT_EQUAL:     result = c != 0; break;
+        case LESS:          result = c < 0;  break;
+        case LESS_EQUAL:    result = c <= 0; break;
+        case GREATER:       result = c > 0;  break;
+        case GREATER_EQUAL: result = c >= 0; break;
+        default:            return FOLD_NOT_CONSTANT;
+    }
+
+    out->kind = CONST_BOOL;
+    out->i = result;
+    return FOLD_OK;
+}
+
+static fold_status_t const_int_op(TokenType op, int bits, int is_signed,
+                                  long long a, long long b, long long* out)
+{
+    unsigned long long ua = (unsigned long long)a, ub = (unsigned long long)b;
+    unsigned long long r;
+
+    switch (op)
+    {
+        case PLUS:        r = ua + ub; break;
+        case MINUS:       r = ua - ub; break;
+        case STAR:        r = ua * ub; break;
+        case BITWISE_AND: r = ua & ub; break;
+        case BITWISE_OR:  r = ua | ub; break;
+        case BITWISE_XOR: r = ua ^ ub; break;
+        case LSHIFT:      r = ua << (ub & (unsigned)(bits - 1)); break;
+        case RSHIFT:
+            // operands are already sign or zero extended from their width
+            r = (unsigned long long)(a >> (ub & (unsigned)(bits - 1)));
+            break;
+        case SLASH:
+        case PERCENT:
+            if (b == 0) return FOLD_DIV_ZERO;
+            // the one overflowing division, defined to wrap
+            if (b == -1 && a == LLONG_MIN)
+                r = op == SLASH ? ua : 0;
+            else
+                r = (unsigned long long)(op == SLASH ? a / b : a % b);
+            break;
+        default:
+            return FOLD_NOT_CONSTANT;
+    }
+
+    *out = wrap_bits(r, bits, is_signed);
+    return FOLD_OK;
+}
+
+fold_status_t const_binary(TokenType op, const type_t* type, const_value_t l, const_value_t r,
+                           const_value_t* out)
+{
+    if (l.kind == CONST_NONE || r.kind == CONST_NONE || type_is_error(type))
+        return FOLD_NOT_CONSTANT;
+
+    out->kind = CONST_NONE;
+    out->i = 0;
+    out->f = 0.0;
+    out->s = NULL;
+
+    switch (op)
+    {
+        case EQUAL:
+        case NOT_EQUAL:
+        case LESS:
+        case LESS_EQUAL:
+        case GREATER:
+        case GREATER_EQUAL:
+            return const_compare(op, l, r, out);
+
+        case AND:
+        case OR:
+            if (l.kind != CONST_BOOL || r.kind != CONST_BOOL) return FOLD_NOT_CONSTANT;
+            out->kind = CONST_BOOL;
+            out->i = op == AND ? (l.i && r.i) : (l.i || r.i);
+            return FOLD_OK;
+
+        default:
+            break;
+    }
+
+    if (l.kind == CONST_STR || r.kind == CONST_STR || l.kind == CONST_BOOL || r.kind == CONST_BOOL)
+        return FOLD_NOT_CONSTANT;
+
+    if (type->kind == TY_FLOAT || type->kind == TY_DOUBLE)
+    {
+        double a = as_double(l), b = as_double(r), d;
+        switch (op)
+        {
+            case PLUS:  d = a + b; break;
+            case MINUS: d = a - b; break;
+            case STAR:  d = a * b; break;
+            case SLASH:
+                // left to run time, where it gives an infinity or NaN
+                if (b == 0.0) return FOLD_NOT_CONSTANT;
+                d = a / b;
+                break;
+            default:
+                return FOLD_NOT_CONSTANT;
+        }
+        out->kind = CONST_FLOAT;
+        out->f = d;
+        *out = const_convert(*out, type);
+        return FOLD_OK;
+    }
+
+    int is_signed;
+    int bits = int_bits(type, &is_signed);
+    if (!bits) return FOLD_NOT_CONSTANT;
+
+    out->kind = CONST_INT;
+    return const_int_op(op, bits, is_signed, l.i, r.i, &out->i);
+}
+
+fold_status_t const_unary(TokenType op, const type_t* type, const_value_t v, const_value_t* out)
+{
+    if (v.kind == CONST_NONE || type_is_error(type)) return FOLD_NOT_CONSTANT;
+
+    *out = v;
+    switch (op)
+    {
+        case NOT:
+            if (v.kind != CONST_BOOL) return FOLD_NOT_CONSTANT;
+            out->i = !v.i;
+            return FOLD_OK;
+        case MINUS:
+            if (v.kind == CONST_FLOAT) out->f = -v.f;
+            else if (v.kind == CONST_INT) out->i = (long long)(0ULL - (unsigned long long)v.i);
+            else return FOLD_NOT_CONSTANT;
+            *out = const_convert(*out, type);
+            return FOLD_OK;
+        case BITWISE_NOT:
+            if (v.kind != CONST_INT) return FOLD_NOT_CONSTANT;
+            out->i = ~v.i;
+            *out = const_convert(*out, type);
+            return FOLD_OK;
+        default:
+            return FOLD_NOT_CONSTANT;
+    }
+}
+
+void const_to_literal(ASTNode* node, const_value_t v)
+{
+    char buf[64];
+    TokenType kind;
+
+    switch (v.kind)
+    {
+        case CONST_INT:
+            snprintf(buf, sizeof(buf), "%lld", v.i);
+            kind = INT_LITERAL;
+            break;
+        case CONST_FLOAT:
+            // enough digits to read back the same value, always with a point
+            snprintf(buf, sizeof(buf), "%.*g", node->ty && node->ty->kind == TY_FLOAT ? 9 : 17, v.f);
+            if (!strpbrk(buf, ".eEn")) strcat(buf, ".0");
+            kind = FLOAT_LITERAL;
+            break;
+        case CONST_BOOL:
+            strcpy(buf, v.i ? "true" : "false");
+            kind = BOOL_LITERAL;
+            break;
+        case CONST_STR:
+            kind = STRING_LITERAL;
+            break;
+        default:
+            return;
+    }
+
+    SourceLocation loc = node->location;
+    const type_t* ty = node->ty;
+    memset(&node->as, 0, sizeof(node->as));
+
+    node->type = AST_LITERAL;
+    node->location = loc;
+    node->ty = ty;
+    node->as.literal.value = my_strdup(v.kind == CONST_STR ? v.s : buf);
+    node->as.literal.kind = kind;
+}
+
+int const_range_in(long long i, long long end, long long step)
+{
+    return step > 0 ? i <= end : i >= end;
+}
+
+long long const_trip_count(long long start, long long end, long long step)
+{
+    if (step == 0) return -1;
+    if (!const_range_in(start, end, step)) return 0;
+    if (step > 0)
+        return (long long)(((unsigned long long)end - start) / (unsigned long long)step + 1);
+    return (long long)(((unsigned long long)start - end) / (0ULL - (unsigned long long)step) + 1);
+}
+
+/* ---------- the pass ---------- */
+
+static const_value_t* fold_let(fold_t* f, sym_entry_t* sym)
+{
+    if (!sym || sym->index >= f->let_count) return NULL;
+    const_value_t* v = &f->lets[sym->index];
+    return v->kind == CONST_NONE ? NULL : v;
+}
+
+static void fold_set_let(fold_t* f, sym_entry_t* sym, const_value_t v)
+{
+    if (!sym) return;
+    if (sym->index >= f->let_count)
+    {
+        unsigned int count = f->let_count ? f->let_count : 64;
+        while (count <= sym->index) count *= 2;
+        f->lets = realloc(f->lets, sizeof(const_value_t) * count);
+        if (!f->lets) { fprintf(stderr, "Out of memory\n"); exit(1); }
+        memset(f->lets + f->let_count, 0, sizeof(const_value_t) * (count - f->let_count));
+        f->let_count = count;
+    }
+    f->lets[sym->index] = v;
+}
+
+static void fold_replace(fold_t* f, ASTNode* node, const_value_t v)
+{
+    const_to_literal(node, v);
+    f->folded++;
+}
+
+static void fold_report(fold_t* f, ASTNode* node, fold_status_t status)
+{
+    if (status == FOLD_DIV_ZERO)
+        diag_error(f->diags, node->location, "division by zero in constant expression");
+}
+
+static void fold_expr(fold_t* f, ASTNode* node)
+{
+    if (!node) return;
+
+    switch (node->type)
+    {
+        case AST_IDENTIFIER:
+        {
+            sym_entry_t* sym = node->as.ident.sym;
+            const_value_t* v = fold_let(f, sym);
+            if (v && !type_is_error(node->ty)) fold_replace(f, node, *v);
+            break;
+        }
+        case AST_UNARY:
+        {
+            fold_expr(f, node->as.unary.operand);
+            const_value_t v;
+            fold_status_t status = const_unary(node->as.unary.op->type, node->ty,
+                                               const_of(node->as.unary.operand), &v);
+            if (status == FOLD_OK) fold_replace(f, node, v);
+            break;
+        }
+        case AST_BINARY:
+        {
+            fold_expr(f, node->as.binary.left);
+            fold_expr(f, node->as.binary.right);
+            const_value_t v;
+            fold_status_t status = const_binary(node->as.binary.op->type, node->ty,
+                                                const_of(node->as.binary.left),
+                                                const_of(node->as.binary.right), &v);
+            if (status == FOLD_OK) fold_replace(f, node, v);
+            else fold_report(f, node, status);
+            break;
+        }
+        case AST_ASSIGN:
+            fold_expr(f, node->as.assign.value);
+            break;
+        case AST_INDEX:
+            // the base is an array, only scalar constants are propagated
+            fold_expr(f, node->as.idx.index);
+            break;
+        case AST_FN_CALL:
+        {
+            for (int i = 0; i < node->as.call.arg_count; i++)
+                fold_expr(f, node->as.call.args[i]);
+            const_value_t v;
+            if (f->ctfe && ctfe_fold_call(f->ctfe, node, &v)) fold_replace(f, node, v);
+            break;
+        }
+        case AST_RANGE:
+            fold_expr(f, node->as.rng.start);
+            fold_expr(f, node->as.rng.end);
+            fold_expr(f, node->as.rng.step);
+            break;
+        default:
+            break;
+    }
+}
+
+// a constant stored into a narrower integer must fit
+static void fold_check_fits(fold_t* f, ASTNode* value, const type_t* type, const char* name)
+{
+    const_value_t v = const_of(value);
+    if (v.kind != CONST_INT) return;
+
+    int is_signed;
+    if (!int_bits(type, &is_signed)) return;
+
+    const_value_t c = const_convert(v, type);
+    if (c.i != v.i)
+    {
+        char buf[64];
+        diag_error(f->diags, value->location, "constant %lld does not fit %s '%s'",
+                   v.i, type_to_string(type, buf, sizeof(buf)), name);
+    }
+}
+
+static void fold_decl(fold_t* f, ASTNode* node)
+{
+    Decl* decl = &node->as.declaration;
+    if (!decl->value) return;
+
+    fold_expr(f, decl->value);
+
+    const type_t* type = decl->ident->ty;
+    if (decl->data_type) fold_check_fits(f, decl->value, type, decl->ident->as.ident.name);
+
+    const_value_t v = const_of(decl->value);
+    if (node->type == AST_CONST_DECL && v.kind != CONST_NONE && v.kind != CONST_STR && !type_is_error(type))
+        fold_set_let(f, decl->ident->as.ident.sym, const_convert(v, type));
+}
+
+static void fold_array_decl(fold_t* f, ASTNode* node)
+{
+    Array* arr = &node->as.arr;
+    sym_entry_t* sym = arr->ident->as.ident.sym;
+    const char* name = arr->ident->as.ident.name;
+
+    for (size_t i = 0; i < arr->literal_count; i++)
+    {
+        fold_expr(f, arr->literals[i]);
+        if (arr->ident->ty && arr->ident->ty->kind == TY_ARRAY)
+            fold_check_fits(f, arr->literals[i], arr->ident->ty->elem, name);
+    }
+
+    // the size was written as a name: the checker left the array unsized
+    ASTNode* range = arr->range;
+    if (!range || range->type != AST_LITERAL || range->as.literal.kind != IDENTIFIER) return;
+
+    scope_t* scope = sym ? symtab_scope(f->table, sym->scope) : f->table->global_scope;
+    sym_entry_t* size_sym = scope_lookup(scope, range->as.literal.value);
+    const_value_t* v = fold_let(f, size_sym);
+    if (!v || v->kind != CONST_INT || v->i < 0)
+    {
+        diag_error(f->diags, range->location, "size of '%s' must be a non-negative integer constant", name);
+        return;
+    }
+
+    range->ty = type_prim(TY_INT);
+    fold_replace(f, range, *v);
+
+    int length = (int)v->i;
+    if ((int)arr->literal_count > length)
+        diag_error(f->diags, node->location, "too many initializers for '%s' (%d for %d)",
+                   name, (int)arr->literal_count, length);
+
+    const type_t* elem = arr->ident->ty && arr->ident->ty->kind == TY_ARRAY
+                       ? arr->ident->ty->elem : type_prim(TY_ERROR);
+    arr->ident->ty = type_array(elem, length);
+    typecheck_set_symbol_type(f->tc, sym, arr->ident->ty);
+    if (sym) sym->info.array.size = length;
+}
+
+static void fold_loop(fold_t* f, ASTNode* node)
+{
+    ASTNode* cond = node->as.loop.condition;
+    if (cond && cond->type == AST_LOOP_EXPR)
+    {
+        ASTNode* range = cond->as.loopexpr.expr;
+        fold_expr(f, range);
+
+        if (range && range->type == AST_RANGE)
+        {
+            const_value_t start = const_of(range->as.rng.start);
+            const_value_t end = const_of(range->as.rng.end);
+            const_value_t step = range->as.rng.step ? const_of(range->as.rng.step)
+                                                    : (const_value_t){ CONST_INT, 1, 0.0, NULL };
+
+            if (start.kind == CONST_INT && end.kind == CONST_INT && step.kind == CONST_INT)
+            {
+                cond->as.loopexpr.trip_count = const_trip_count(start.i, end.i, step.i);
+                if (step.i == 0)
+                    diag_error(f->diags, range->location, "range step is zero");
+            }
+        }
+    }
+    else
+    {
+        fold_expr(f, cond);
+    }
+
+    fold_stmt(f, node->as.loop.block);
+}
+
+// a call statement whose value is unused and that has no effect at all
+static int fold_is_dead_call(fold_t* f, ASTNode* stmt)
+{
+    if (!f->effects || !stmt || stmt->type != AST_FN_CALL) return 0;
+    if (effects_of_expr(f->effects, stmt) != EFFECT_NONE) return 0;
+
+    ASTNode* callee = stmt->as.call.callee;
+    printf("DEBUG: dropped call to '%s' at line %d, it has no effect\n",
+           callee->type == AST_IDENTIFIER ? callee->as.ident.name : "?", stmt->location.line);
+    return 1;
+}
+
+static void fold_stmt(fold_t* f, ASTNode* node)
+{
+    if (!node) return;
+
+    switch (node->type)
+    {
+        case AST_BLOCK:
+        {
+            size_t kept = 0;
+            for (size_t i = 0; i < node->as.block.count; i++)
+            {
+                ASTNode* stmt = node->as.block.statements[i];
+                if (fold_is_dead_call(f, stmt)) continue;
+                fold_stmt(f, stmt);
+                node->as.block.statements[kept++] = stmt;
+            }
+            node->as.block.count = kept;
+            break;
+        }
+        case AST_VAR_DECL:
+        case AST_CONST_DECL:
+            fold_decl(f, node);
+            break;
+        case AST_ARRAY_DECL:
+            fold_array_decl(f, node);
+            break;
+        case AST_FN_DECL:
+            fold_stmt(f, node->as.func.block);
+            break;
+        case AST_IF:
+            fold_expr(f, node->as.ifstmt.condition);
+            fold_stmt(f, node->as.ifstmt.then_branch);
+            fold_stmt(f, node->as.ifstmt.else_branch);
+            break;
+        case AST_MATCH:
+            fold_expr(f, node->as.matchstmt.pattern);
+            for (size_t i = 0; i < node->as.matchstmt.case_count; i++)
+            {
+                ASTNode* c = node->as.matchstmt.match_cases[i];
+                fold_expr(f, c->as.matchcase.expr);
+                fold_stmt(f, c->as.matchcase.stmt);
+            }
+            if (node->as.matchstmt.def_case)
+                fold_stmt(f, node->as.matchstmt.def_case->as.matchcase.stmt);
+            break;
+        case AST_LOOP:
+            fold_loop(f, node);
+            break;
+        case AST_RETURN:
+            fold_expr(f, node->as.return_stmt.expr);
+            break;
+        case AST_STRUCT:
+        case AST_UNION:
+        case AST_ENUM:
+        case AST_IMPORT:
+        case AST_STMT:
+        case AST_PROGRAM:
+            break;
+        default:
+            fold_expr(f, node);
+            break;
+    }
+}
+
+int fold_program(ASTNode* prog, typecheck_t* tc, struct ctfe_t* ctfe, const struct effects_t* effects,
+                 diag_list_t* diags)
+{
+    if (!prog || prog->type != AST_PROGRAM || !tc) return 0;
+
+    fold_t f;
+    memset(&f, 0, sizeof(f));
+    f.table = tc->table;
+    f.tc = tc;
+    f.ctfe = ctfe;
+    f.effects = effects;
+    f.diags = diags;
+
+    ASTNode** stmts = prog->as.program.statements;
+    int count = prog->as.program.stmt_count;
+
+    // globals first, as the checker did, so bodies see every top-level let
+    for (int i = 0; i < count; i++)
+        if (stmts[i] && stmts[i]->type != AST_FN_DECL) fold_stmt(&f, stmts[i]);
+
+    for (int i = 0; i < count; i++)
+        if (stmts[i] && stmts[i]->type == AST_FN_DECL) fold_stmt(&f, stmts[i]);
+
+    free(f.lets);
+    return f.folded;
+}
@@ -0,0 +1,351 @@
+#include "match.h"
+#include "fold.h"
+#include "types.h"
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define TYPE_STR_MAX 128
+
+typedef struct
+{
+    diag_list_t* diags;
+    int lowered;
+} match_ctx_t;
+
+/* ---------- interval sets ---------- */
+
+// sorted, disjoint and not adjacent: [1,3] and [4,4] are kept as [1,4]
+typedef struct
+{
+    match_range_t* items;
+    int count;
+    int capacity;
+} interval_set_t;
+
+// index of the first interval ending at or after value
+static int iset_find(const interval_set_t* set, long long value)
+{
+    int lo = 0, hi = set->count;
+    while (lo < hi)
+    {
+        int mid = (lo + hi) / 2;
+        if (set->items[mid].high < value) lo = mid + 1;
+        else hi = mid;
+    }
+    return lo;
+}
+
+static int iset_covers(const interval_set_t* set, long long low, long long high)
+{
+    int i = iset_find(set, low);
+    return i < set->count && set->items[i].low <= low && set->items[i].high >= high;
+}
+
+// first value of low .. high outside the set, 0 if there is none
+static int iset_gap(const interval_set_t* set, long long low, long long high, long long* value)
+{
+    long long v = low;
+    for (int i = iset_find(set, low); i < set->count && set->items[i].low <= v; i++)
+    {
+        if (set->items[i].high >= high) return 0;
+        v = set->items[i].high + 1;
+    }
+    *value = v;
+    return 1;
+}
+
+static void iset_add(interval_set_t* set, long long low, long long high)
+{
+    // take in the neighbours that overlap or touch
+    int first = iset_find(set, low == INT64_MIN ? low : low - 1);
+    int last = first;
+    while (last < set->count && (set->items[last].low <= high || set->items[last].low - 1 == high))
+    {
+        if (set->items[last].low < low) low = set->items[last].low;
+        if (set->items[last].high > high) high = set->items[last].high;
+        last++;
+    }
+
+    if (first == last && set->count == set->capacity)
+    {
+        set->capacity = set->capacity ? set->capacity * 2 : 8;
+        set->items = realloc(set->items, sizeof(match_range_t) * set->capacity);
+        if (!set->items) { fprintf(stderr, "Out of memory\n"); exit(1); }
+    }
+
+    // replace items first .. last-1 by one interval
+    int removed = last - first;
+    memmove(set->items + first + 1, set->items + last, sizeof(match_range_t) * (set->count - last));
+    set->count += 1 - removed;
+    set->items[first] = (match_range_t){ .low = low, .high = high, .target = MATCH_DEFAULT };
+}
+
+/* ---------- case values ---------- */
+
+// the values a scrutinee of this type can hold
+static int match_domain(const type_t* type, long long* low, long long* high)
+{
+    if (!type) return 0;
+
+    switch (type->kind)
+    {
+        case TY_BOOL:  *low = 0;          *high = 1;          return 1;
+        case TY_CHAR:
+        case TY_BYTE:  *low = 0;          *high = 255;        return 1;
+        case TY_SHORT: *low = INT16_MIN;  *high = INT16_MAX;  return 1;
+        case TY_INT:   *low = INT32_MIN;  *high = INT32_MAX;  return 1;
+        case TY_LONG:  *low = INT64_MIN;  *high = INT64_MAX;  return 1;
+        default:       return 0;
+    }
+}
+
+static const char* match_value_string(const type_t* type, long long value, char* buf, size_t size)
+{
+    if (type->kind == TY_BOOL) snprintf(buf, size, "%s", value ? "true" : "false");
+    else if (type->kind == TY_CHAR && value >= 32 && value < 127) snprintf(buf, size, "'%c'", (char)value);
+    else snprintf(buf, size, "%lld", value);
+    return buf;
+}
+
+static int match_same_constant(const_value_t a, const_value_t b)
+{
+    if (a.kind != b.kind) return 0;
+    switch (a.kind)
+    {
+        case CONST_STR:   return strcmp(a.s, b.s) == 0;
+        case CONST_FLOAT: return a.f == b.f;
+        default:          return a.i == b.i;
+    }
+}
+
+/* ---------- decision trees ---------- */
+
+static match_node_t* match_node(match_kind_t kind)
+{
+    match_node_t* node = parser_alloc(sizeof(match_node_t));
+    node->kind = kind;
+    node->target = MATCH_DEFAULT;
+    return node;
+}
+
+// ranges are sorted and disjoint, each owned by one case
+static match_node_t* match_lower(match_range_t* ranges, int count, int* depth)
+{
+    if (count == 0)
+    {
+        *depth = 0;
+        return match_node(MATCH_LEAF);
+    }
+
+    if (count <= MATCH_CHAIN_MAX)
+    {
+        match_node_t* node = match_node(MATCH_CHAIN);
+        node->ranges = parser_alloc(sizeof(match_range_t) * count);
+        memcpy(node->ranges, ranges, sizeof(match_range_t) * count);
+        node->range_count = count;
+        *depth = count;
+        return node;
+    }
+
+    // unsigned, a long scrutinee can span the whole 64 bits
+    unsigned long long span = (unsigned long long)ranges[count - 1].high - (unsigned long long)ranges[0].low;
+    if (span < MATCH_TABLE_MAX)
+    {
+        unsigned long long values = 0;
+        for (int i = 0; i < count; i++)
+            values += (unsigned long long)ranges[i].high - (unsigned long long)ranges[i].low + 1;
+
+        if (values * 100 >= (span + 1) * MATCH_TABLE_DENSITY)
+        {
+            match_node_t* node = match_node(MATCH_TABLE);
+            node->low = ranges[0].low;
+            node->high = ranges[count - 1].high;
+            node->targets = parser_alloc(sizeof(int) * (span + 1));
+            for (unsigned long long v = 0; v <= span; v++) node->targets[v] = MATCH_DEFAULT;
+
+            for (int i = 0; i < count; i++)
+            {
+                unsigned long long from = (unsigned long long)ranges[i].low - (unsigned long long)node->low;
+                unsigned long long to = (unsigned long long)ranges[i].high - (unsigned long long)node->low;
+                for (unsigned long long k = from; k <= to; k++) node->targets[k] = ranges[i].target;
+            }
+            *depth = 1;
+            return node;
+        }
+    }
+
+    // too sparse for one table: split in the middle, each half may be dense
+    int mid = count / 2;
+    int left_depth, right_depth;
+    match_node_t* node = match_node(MATCH_SPLIT);
+    node->pivot = ranges[mid].low;
+    node->left = match_lower(ranges, mid, &left_depth);
+    node->right = match_lower(ranges + mid, count - mid, &right_depth);
+    *depth = 1 + (left_depth > right_depth ? left_depth : right_depth);
+    return node;
+}
+
+static int match_compare_ranges(const void* a, const void* b)
+{
+    long long x = ((const match_range_t*)a)->low;
+    long long y = ((const match_range_t*)b)->low;
+    return (x > y) - (x < y);
+}
+
+/* ---------- checking ---------- */
+
+static void match_stmt(match_ctx_t* ctx, ASTNode* node)
+{
+    MatchStmt* match = &node->as.matchstmt;
+    const type_t* type = match->pattern ? match->pattern->ty : NULL;
+    if (!type || type_is_error(type)) return;
+
+    long long low = 0, high = 0;
+    int integral = match_domain(type, &low, &high);
+    int constant = 1;
+
+    char buf[TYPE_STR_MAX], name[TYPE_STR_MAX];
+    type_to_string(type, name, sizeof(name));
+
+    interval_set_t seen = { 0 };
+    match_range_t* ranges = calloc(match->case_count + 1, sizeof(match_range_t));
+    if (!ranges) { fprintf(stderr, "Out of memory\n"); exit(1); }
+    int range_count = 0;
+
+    for (size_t i = 0; i < match->case_count; i++)
+    {
+        ASTNode* c = match->match_cases[i];
+        const_value_t v = const_of(c->as.matchcase.expr);
+
+        if (v.kind == CONST_NONE)
+        {
+            constant = 0;
+            continue;
+        }
+
+        if (integral && (v.kind == CONST_INT || v.kind == CONST_BOOL))
+        {
+            if (v.i < low || v.i > high)
+            {
+                diag_warning(ctx->diags, c->location, "case %lld can never match a %s", v.i, name);
+                continue;
+            }
+            if (iset_covers(&seen, v.i, v.i))
+            {
+                diag_warning(ctx->diags, c->location, "unreachable case, %s is matched by an earlier case",
+                             match_value_string(type, v.i, buf, sizeof(buf)));
+                continue;
+            }
+            iset_add(&seen, v.i, v.i);
+            ranges[range_count++] = (match_range_t){ .low = v.i, .high = v.i, .target = (int)i };
+            continue;
+        }
+
+        // strings and floats are only compared with the earlier cases
+        for (size_t j = 0; j < i; j++)
+        {
+            if (match_same_constant(v, const_of(match->match_cases[j]->as.matchcase.expr)))
+            {
+                diag_warning(ctx->diags, c->location, "unreachable case, the same value is matched on line %d",
+                             match->match_cases[j]->location.line);
+                break;
+            }
+        }
+    }
+
+    long long missing;
+    if (integral && constant)
+    {
+        // name a value next to the cases rather than the type's minimum
+        int covered = !((seen.count > 0 && iset_gap(&seen, seen.items[0].low, high, &missing))
+                        || iset_gap(&seen, low, high, &missing));
+        if (covered && match->def_case)
+            diag_warning(ctx->diags, match->def_case->location, "unreachable '_', the cases cover every %s", name);
+        else if (!covered && !match->def_case)
+            diag_warning(ctx->diags, node->location, "match over %s is not exhaustive, %s is not covered", name,
+                         match_value_string(type, missing, buf, sizeof(buf)));
+    }
+    else if (!integral && !match->def_case)
+    {
+        diag_warning(ctx->diags, node->location, "match over %s is not exhaustive, add a '_' case", name);
+    }
+
+    // lower to a decision tree when every case is a known integer,
+    // otherwise the cases are compared in order
+    match_plan_t* plan = parser_alloc(sizeof(match_plan_t));
+    if (integral && constant)
+    {
+        qsort(ranges, range_count, sizeof(match_range_t), match_compare_ranges);
+        plan->root = match_lower(ranges, range_count, &plan->depth);
+    }
+    else
+    {
+        plan->root = match_node(MATCH_CHAIN);
+        plan->depth = (int)match->case_count;
+    }
+    match->plan = plan;
+    ctx->lowered++;
+
+    printf("DEBUG: match at line %d lowered to %s, depth %d\n", node->location.line,
+           match_kind_name(plan->root->kind), plan->depth);
+
+    free(ranges);
+    free(seen.items);
+}
+
+static void match_walk(match_ctx_t* ctx, ASTNode* node)
+{
+    if (!node) return;
+
+    switch (node->type)
+    {
+        case AST_BLOCK:
+            for (size_t i = 0; i < node->as.block.count; i++)
+                match_walk(ctx, node->as.block.statements[i]);
+            break;
+        case AST_FN_DECL:
+            match_walk(ctx, node->as.func.block);
+            break;
+        case AST_IF:
+            match_walk(ctx, node->as.ifstmt.then_branch);
+            match_walk(ctx, node->as.ifstmt.else_branch);
+            break;
+        case AST_LOOP:
+            match_walk(ctx, node->as.loop.block);
+            break;
+        case AST_MATCH:
+            match_stmt(ctx, node);
+            for (size_t i = 0; i < node->as.matchstmt.case_count; i++)
+                match_walk(ctx, node->as.matchstmt.match_cases[i]->as.matchcase.stmt);
+            if (node->as.matchstmt.def_case)
+                match_walk(ctx, node->as.matchstmt.def_case->as.matchcase.stmt);
+            break;
+        default:
+            break;
+    }
+}
+
+int match_program(ASTNode* prog, diag_list_t* diags)
+{
+    if (!prog || prog->type != AST_PROGRAM) return 0;
+
+    match_ctx_t ctx = { .diags = diags };
+    for (int i = 0; i < prog->as.program.stmt_count; i++)
+        match_walk(&ctx, prog->as.program.statements[i]);
+    return ctx.lowered;
+}
+
+const char* match_kind_name(match_kind_t kind)
+{
+    switch (kind)
+    {
+        case MATCH_LEAF:  return "leaf";
+        case MATCH_TABLE: return "jump table";
+        case MATCH_SPLIT: return "binary search";
+        case MATCH_CHAIN: return "compare chain";
+        default:          return "?";
+    }
+}
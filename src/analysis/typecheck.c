@@ -0,0 +1,1139 @@
+#include "typecheck.h"
+#include "globaltab.h"
+#include "iface.h"
+#include "intern.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define TYPE_STR_MAX 128
+
+static const type_t* check_expr(typecheck_t* tc, ASTNode* node);
+static void check_stmt(typecheck_t* tc, ASTNode* node);
+
+static const type_t* tc_error(void)
+{
+    return type_prim(TY_ERROR);
+}
+
+static void* tc_alloc(size_t size)
+{
+    void* m = calloc(1, size ? size : 1);
+    if (!m) { fprintf(stderr, "Out of memory\n"); exit(1); }
+    return m;
+}
+
+// symbols can be added after creation, e.g. by a late import
+static void tc_reserve(typecheck_t* tc, unsigned int index)
+{
+    if (index < tc->sym_count) return;
+
+    unsigned int count = tc->sym_count ? tc->sym_count : 64;
+    while (count <= index) count *= 2;
+
+    tc->sym_types = realloc(tc->sym_types, sizeof(const type_t*) * count);
+    tc->fn_decls = realloc(tc->fn_decls, sizeof(ASTNode*) * count);
+    tc->fn_state = realloc(tc->fn_state, count);
+    if (!tc->sym_types || !tc->fn_decls || !tc->fn_state)
+    {
+        fprintf(stderr, "Out of memory\n");
+        exit(1);
+    }
+
+    unsigned int added = count - tc->sym_count;
+    memset(tc->sym_types + tc->sym_count, 0, sizeof(const type_t*) * added);
+    memset(tc->fn_decls + tc->sym_count, 0, sizeof(ASTNode*) * added);
+    memset(tc->fn_state + tc->sym_count, 0, added);
+    tc->sym_count = count;
+}
+
+typecheck_t* typecheck_create(symtab_t* table, diag_list_t* diags)
+{
+    typecheck_t* tc = tc_alloc(sizeof(typecheck_t));
+    tc->table = table;
+    tc->diags = diags;
+    if (table && table->sym_count) tc_reserve(tc, table->sym_count - 1);
+    return tc;
+}
+
+void typecheck_destroy(typecheck_t* tc)
+{
+    if (!tc) return;
+
+    // the symbol types outlive the checker, see symtab_t.types
+    if (tc->table)
+    {
+        free(tc->table->types);
+        tc->table->types = tc->sym_types;
+        tc->table->type_count = tc->sym_count;
+    }
+    else
+    {
+        free(tc->sym_types);
+    }
+    free(tc->fn_decls);
+    free(tc->fn_state);
+    free(tc);
+}
+
+static void tc_set_sym(typecheck_t* tc, sym_entry_t* sym, const type_t* type)
+{
+    if (!sym || !type) return;
+    tc_reserve(tc, sym->index);
+    tc->sym_types[sym->index] = type;
+
+    // functions keep their result in the coarse type, as the parser did
+    const type_t* shown = type->kind == TY_FN ? type->elem : type;
+    sym->type = type_to_datatype(shown);
+}
+
+void typecheck_set_symbol_type(typecheck_t* tc, sym_entry_t* sym, const type_t* type)
+{
+    if (tc) tc_set_sym(tc, sym, type);
+}
+
+const type_t* typecheck_symbol_type(typecheck_t* tc, sym_entry_t* sym)
+{
+    if (!tc || !sym || sym->index >= tc->sym_count) return NULL;
+    return tc->sym_types[sym->index];
+}
+
+// an imported symbol from an interface without full types
+static const type_t* tc_from_datatype(datatype_t type)
+{
+    switch (type)
+    {
+        case TYPE_VOID:   return type_prim(TY_VOID);
+        case TYPE_INT:    return type_prim(TY_INT);
+        case TYPE_FLOAT:  return type_prim(TY_FLOAT);
+        case TYPE_DOUBLE: return type_prim(TY_DOUBLE);
+        case TYPE_CHAR:   return type_prim(TY_CHAR);
+        case TYPE_BOOL:   return type_prim(TY_BOOL);
+        case TYPE_STRING: return type_str(-1);
+        default:          return tc_error();
+    }
+}
+
+static const char* tc_name(sym_entry_t* sym)
+{
+    return sym ? sym_name(sym) : "?";
+}
+
+/* ---------- type names ---------- */
+
+static const struct
+{
+    const char* name;
+    type_kind_t kind;
+} tc_prim_names[] =
+{
+    { "void", TY_VOID },
+    { "bool", TY_BOOL },
+    { "char", TY_CHAR },
+    { "byte", TY_BYTE },   { "u8",  TY_BYTE },
+    { "short", TY_SHORT },
+    { "int", TY_INT },     { "i32", TY_INT },
+    { "long", TY_LONG },   { "i64", TY_LONG },
+    { "float", TY_FLOAT }, { "f32", TY_FLOAT },
+    { "double", TY_DOUBLE }, { "f64", TY_DOUBLE },
+    { "str", TY_STR },
+};
+
+static int tc_prim_index(const char* name)
+{
+    for (size_t i = 0; i < sizeof(tc_prim_names) / sizeof(tc_prim_names[0]); i++)
+        if (strcmp(name, tc_prim_names[i].name) == 0) return (int)i;
+    return -1;
+}
+
+// struct, enum and union names are declared at the top level. Once the
+// globals are frozen they are read lock-free, and imports can no longer
+// be loaded: typecheck_declarations resolves them before the freeze.
+static sym_entry_t* tc_lookup_global(symtab_t* table, const char* name)
+{
+    if (!table) return NULL;
+
+    const globaltab_t* globals = symtab_globals(table);
+    if (globals) return (sym_entry_t*)globaltab_lookup(globals, intern_find(name));
+
+    sym_entry_t* sym = scope_lookup(table->global_scope, name);
+    if (!sym && table->import_count > 0) sym = iface_resolve(table, intern(name));
+    return sym;
+}
+
+const type_t* typecheck_resolve_type(typecheck_t* tc, Token* name)
+{
+    if (!name || !name->lexeme) return tc_error();
+
+    int prim = tc_prim_index(name->lexeme);
+    if (prim >= 0)
+        return tc_prim_names[prim].kind == TY_STR ? type_str(-1) : type_prim(tc_prim_names[prim].kind);
+
+    sym_entry_t* sym = tc_lookup_global(tc->table, name->lexeme);
+
+    if (sym && sym_is_type(sym))
+    {
+        type_kind_t kind = sym->symbol_type == SYM_STRUCT ? TY_STRUCT
+                         : sym->symbol_type == SYM_ENUM ? TY_ENUM : TY_UNION;
+        return type_named(kind, sym->name);
+    }
+
+    diag_error(tc->diags, name->location, "unknown type '%s'", name->lexeme);
+    return tc_error();
+}
+
+/* ---------- compatibility ---------- */
+
+static const type_t* tc_arith(const type_t* a, const type_t* b)
+{
+    type_kind_t kind = a->kind > b->kind ? a->kind : b->kind;
+    if (kind < TY_INT) kind = TY_INT;
+    return type_prim(kind);
+}
+
+static int tc_is_int_literal(ASTNode* node)
+{
+    if (!node || node->type != AST_LITERAL) return 0;
+    TokenType kind = node->as.literal.kind;
+    return kind == INT_LITERAL || kind == HEX_LITERAL
+        || kind == OCTAL_LITERAL || kind == BINARY_LITERAL;
+}
+
+// can a value of type src, computed by node, be stored in dst
+static int tc_assignable(const type_t* dst, const type_t* src, ASTNode* node)
+{
+    if (dst == src || type_is_error(dst) || type_is_error(src)) return 1;
+
+    if (type_is_numeric(dst) && type_is_numeric(src))
+    {
+        // integer literals fit any numeric type, range is checked by folding
+        return src->kind <= dst->kind || tc_is_int_literal(node);
+    }
+
+    if (dst->kind == TY_STR && src->kind == TY_STR)
+        return dst->length < 0 || src->length < 0 || src->length <= dst->length;
+
+    if (dst->kind == TY_ARRAY && src->kind == TY_ARRAY)
+        return dst->elem == src->elem && (dst->length < 0 || dst->length == src->length);
+
+    return 0;
+}
+
+static void tc_expect(typecheck_t* tc, const type_t* dst, const type_t* src, ASTNode* node,
+                      SourceLocation loc, const char* what)
+{
+    if (tc_assignable(dst, src, node)) return;
+
+    char want[TYPE_STR_MAX], got[TYPE_STR_MAX];
+    diag_error(tc->diags, node ? node->location : loc, "%s: expected %s, found %s", what,
+               type_to_string(dst, want, sizeof(want)), type_to_string(src, got, sizeof(got)));
+}
+
+/* ---------- functions ---------- */
+
+static const type_t* tc_param_type(typecheck_t* tc, ASTNode* param)
+{
+    if (!param) return tc_error();
+    if (!param->ty) param->ty = typecheck_resolve_type(tc, param->as.param.type);
+    return param->ty;
+}
+
+static const type_t* tc_fn_type(typecheck_t* tc, ASTNode* decl, const type_t* result)
+{
+    int count = (int)decl->as.func.params_count;
+    const type_t** params = tc_alloc(sizeof(const type_t*) * count);
+    for (int i = 0; i < count; i++)
+        params[i] = tc_param_type(tc, decl->as.func.params[i]);
+
+    const type_t* fn = type_fn(result, params, count);
+    free(params);
+    return fn;
+}
+
+// does a body return a value, outside the functions nested in it
+static int tc_returns_value(ASTNode* node)
+{
+    if (!node) return 0;
+
+    switch (node->type)
+    {
+        case AST_RETURN:
+            return node->as.return_stmt.expr != NULL;
+        case AST_BLOCK:
+            for (size_t i = 0; i < node->as.block.count; i++)
+                if (tc_returns_value(node->as.block.statements[i])) return 1;
+            return 0;
+        case AST_IF:
+            return tc_returns_value(node->as.ifstmt.then_branch) || tc_returns_value(node->as.ifstmt.else_branch);
+        case AST_LOOP:
+            return tc_returns_value(node->as.loop.block);
+        case AST_MATCH:
+            for (size_t i = 0; i < node->as.matchstmt.case_count; i++)
+                if (tc_returns_value(node->as.matchstmt.match_cases[i]->as.matchcase.stmt)) return 1;
+            return node->as.matchstmt.def_case && tc_returns_value(node->as.matchstmt.def_case->as.matchcase.stmt);
+        default:
+            return 0;
+    }
+}
+
+// parameters and, when declared, the result, before any body is checked
+static void tc_signature(typecheck_t* tc, ASTNode* decl)
+{
+    for (size_t i = 0; i < decl->as.func.params_count; i++)
+    {
+        ASTNode* param = decl->as.func.params[i];
+        if (!param) continue;
+        tc_set_sym(tc, param->as.param.ident->as.ident.sym, tc_param_type(tc, param));
+        param->as.param.ident->ty = param->ty;
+    }
+
+    sym_entry_t* sym = decl->as.func.ident->as.ident.sym;
+    if (!sym) return;
+
+    tc_reserve(tc, sym->index);
+    tc->fn_decls[sym->index] = decl;
+
+    // without '->' a body that never returns a value returns nothing, so
+    // only the rest need their bodies checked to know the result
+    if (decl->as.func.return_type)
+        tc_set_sym(tc, sym, tc_fn_type(tc, decl, typecheck_resolve_type(tc, decl->as.func.return_type)));
+    else if (!tc_returns_value(decl->as.func.block))
+        tc_set_sym(tc, sym, tc_fn_type(tc, decl, type_prim(TY_VOID)));
+}
+
+static void check_function(typecheck_t* tc, ASTNode* decl)
+{
+    sym_entry_t* sym = decl->as.func.ident->as.ident.sym;
+    if (sym)
+    {
+        tc_reserve(tc, sym->index);
+        if (tc->fn_state[sym->index] != 0) return;
+        tc->fn_state[sym->index] = 1;
+    }
+
+    sym_entry_t* saved_function = tc->function;
+    const type_t* saved_return = tc->return_type;
+    const type_t* saved_inferred = tc->inferred;
+    int saved_in_function = tc->in_function;
+
+    // a nested function gets its signature when its body is reached
+    if (sym && sym->level > 0 && !typecheck_symbol_type(tc, sym)) tc_signature(tc, decl);
+
+    const type_t* declared = sym ? typecheck_symbol_type(tc, sym) : NULL;
+    if (!sym && decl->as.func.return_type)
+        declared = tc_fn_type(tc, decl, typecheck_resolve_type(tc, decl->as.func.return_type));
+
+    tc->function = sym;
+    tc->return_type = declared ? declared->elem : NULL;
+    tc->inferred = NULL;
+    tc->in_function = 1;
+
+    decl->as.func.ident->ty = declared;
+    if (decl->as.func.block) check_stmt(tc, decl->as.func.block);
+
+    if (!declared)
+    {
+        const type_t* result = tc->inferred ? tc->inferred : type_prim(TY_VOID);
+        declared = tc_fn_type(tc, decl, result);
+        decl->as.func.ident->ty = declared;
+        tc_set_sym(tc, sym, declared);
+    }
+
+    if (sym) tc->fn_state[sym->index] = 2;
+    tc->function = saved_function;
+    tc->return_type = saved_return;
+    tc->inferred = saved_inferred;
+    tc->in_function = saved_in_function;
+}
+
+// the type of a function, checking its body first if the result is inferred
+static const type_t* tc_function_type(typecheck_t* tc, sym_entry_t* sym, SourceLocation loc)
+{
+    const type_t* type = typecheck_symbol_type(tc, sym);
+    if (type) return type;
+
+    ASTNode* decl = sym->index < tc->sym_count ? tc->fn_decls[sym->index] : NULL;
+    if (!decl) return NULL;
+
+    if (tc->fn_state[sym->index] == 1)
+    {
+        diag_error(tc->diags, loc, "cannot infer the return type of recursive function '%s', declare it with '->'",
+                   sym_name(sym));
+        return tc_error();
+    }
+
+    check_function(tc, decl);
+    return typecheck_symbol_type(tc, sym);
+}
+
+/* ---------- expressions ---------- */
+
+static const type_t* tc_literal(ASTNode* node)
+{
+    switch (node->as.literal.kind)
+    {
+        case INT_LITERAL:
+        case HEX_LITERAL:
+        case OCTAL_LITERAL:
+        case BINARY_LITERAL: return type_prim(TY_INT);
+        case FLOAT_LITERAL:  return type_prim(TY_FLOAT);
+        case CHAR_LITERAL:   return type_prim(TY_CHAR);
+        case BOOL_LITERAL:   return type_prim(TY_BOOL);
+        case STRING_LITERAL: return type_str(-1);
+        default:             return tc_error();
+    }
+}
+
+static const type_t* tc_identifier(typecheck_t* tc, ASTNode* node)
+{
+    sym_entry_t* sym = node->as.ident.sym;
+    if (!sym) return tc_error();    // reported by the parser
+
+    if (sym_is_type(sym))
+    {
+        diag_error(tc->diags, node->location, "'%s' is a type, not a value", node->as.ident.name);
+        return tc_error();
+    }
+
+    if (sym->symbol_type == SYM_FUNCTION)
+    {
+        const type_t* fn = tc_function_type(tc, sym, node->location);
+        return fn ? fn : tc_error();
+    }
+
+    const type_t* type = typecheck_symbol_type(tc, sym);
+    if (type) return type;
+    if (sym->imported) return tc_from_datatype(sym->type);
+
+    // a global whose declaration has not been checked yet
+    if (sym->level == 0)
+        diag_error(tc->diags, node->location, "'%s' is used before its type is known", node->as.ident.name);
+    return tc_error();
+}
+
+static const type_t* tc_unary(typecheck_t* tc, ASTNode* node)
+{
+    const type_t* operand = check_expr(tc, node->as.unary.operand);
+    if (type_is_error(operand)) return tc_error();
+
+    Token* op = node->as.unary.op;
+    int ok;
+    const type_t* result = operand;
+    switch (op->type)
+    {
+        case NOT:
+            ok = operand->kind == TY_BOOL;
+            break;
+        case MINUS:
+            ok = type_is_numeric(operand);
+            if (ok) result = tc_arith(operand, operand);
+            break;
+        case BITWISE_NOT:
+            ok = type_is_integer(operand);
+            if (ok) result = tc_arith(operand, operand);
+            break;
+        default:
+            ok = 0;
+            break;
+    }
+
+    if (!ok)
+    {
+        char buf[TYPE_STR_MAX];
+        diag_error(tc->diags, node->location, "operator '%s' cannot be applied to %s",
+                   op->lexeme, type_to_string(operand, buf, sizeof(buf)));
+        return tc_error();
+    }
+    return result;
+}
+
+// the result of l op r, NULL if the operator does not apply
+static const type_t* tc_binary_result(TokenType op, const type_t* l, const type_t* r)
+{
+    switch (op)
+    {
+        case PLUS:
+        case PLUS_ASSIGN:
+            if (l->kind == TY_STR && r->kind == TY_STR) return type_str(-1);
+            // fall through
+        case MINUS:
+        case STAR:
+        case SLASH:
+        case MINUS_ASSIGN:
+        case STAR_ASSIGN:
+        case SLASH_ASSIGN:
+            return type_is_numeric(l) && type_is_numeric(r) ? tc_arith(l, r) : NULL;
+
+        case PERCENT:
+        case PERCENT_ASSIGN:
+        case AND_ASSIGN:
+        case BITWISE_AND:
+        case BITWISE_OR:
+        case BITWISE_XOR:
+        case LSHIFT:
+        case RSHIFT:
+            return type_is_integer(l) && type_is_integer(r) ? tc_arith(l, r) : NULL;
+
+        case LESS:
+        case LESS_EQUAL:
+        case GREATER:
+        case GREATER_EQUAL:
+            return type_is_numeric(l) && type_is_numeric(r) ? type_prim(TY_BOOL) : NULL;
+
+        case EQUAL:
+        case NOT_EQUAL:
+            if (type_is_numeric(l) && type_is_numeric(r)) return type_prim(TY_BOOL);
+            if (l->kind == TY_STR && r->kind == TY_STR) return type_prim(TY_BOOL);
+            return l == r ? type_prim(TY_BOOL) : NULL;
+
+        case AND:
+        case OR:
+            return l->kind == TY_BOOL && r->kind == TY_BOOL ? type_prim(TY_BOOL) : NULL;
+
+        default:
+            return NULL;
+    }
+}
+
+static const type_t* tc_binary(typecheck_t* tc, ASTNode* node)
+{
+    const type_t* l = check_expr(tc, node->as.binary.left);
+    const type_t* r = check_expr(tc, node->as.binary.right);
+    if (type_is_error(l) || type_is_error(r)) return tc_error();
+
+    Token* op = node->as.binary.op;
+    const type_t* result = tc_binary_result(op->type, l, r);
+    if (!result)
+    {
+        char a[TYPE_STR_MAX], b[TYPE_STR_MAX];
+        diag_error(tc->diags, op->location, "operator '%s' cannot be applied to %s and %s", op->lexeme,
+                   type_to_string(l, a, sizeof(a)), type_to_string(r, b, sizeof(b)));
+        return tc_error();
+    }
+    return result;
+}
+
+static const type_t* tc_assign(typecheck_t* tc, ASTNode* node)
+{
+    AssignExpr* assign = &node->as.assign;
+    const type_t* value = check_expr(tc, assign->value);
+
+    sym_entry_t* sym = assign->sym;
+    if (!sym) return tc_error();    // reported by the parser
+
+    if (sym->symbol_type == SYM_FUNCTION || sym_is_type(sym))
+    {
+        diag_error(tc->diags, node->location, "cannot assign to '%s'", sym_name(sym));
+        return tc_error();
+    }
+    if ((sym->symbol_type == SYM_VARIABLE || sym->symbol_type == SYM_CONSTANT) && sym->info.var.is_constant)
+        diag_error(tc->diags, node->location, "cannot assign to constant '%s'", sym_name(sym));
+
+    const type_t* target = typecheck_symbol_type(tc, sym);
+    if (!target && sym->imported) target = tc_from_datatype(sym->type);
+    if (!target)
+    {
+        // var x without a type or initializer takes the first value stored
+        if (assign->op->type != ASSIGN || type_is_error(value)) return tc_error();
+        tc_set_sym(tc, sym, value);
+        return value;
+    }
+
+    if (assign->op->type != ASSIGN)
+    {
+        if (type_is_error(target) || type_is_error(value)) return target;
+
+        const type_t* result = tc_binary_result(assign->op->type, target, value);
+        if (!result)
+        {
+            char a[TYPE_STR_MAX], b[TYPE_STR_MAX];
+            diag_error(tc->diags, node->location, "operator '%s' cannot be applied to %s and %s",
+                       assign->op->lexeme, type_to_string(target, a, sizeof(a)),
+                       type_to_string(value, b, sizeof(b)));
+            return target;
+        }
+        value = result;
+    }
+
+    char what[96];
+    snprintf(what, sizeof(what), "assignment to '%s'", sym_name(sym));
+    tc_expect(tc, target, value, assign->op->type == ASSIGN ? assign->value : NULL, node->location, what);
+    return target;
+}
+
+static const type_t* tc_index(typecheck_t* tc, ASTNode* node)
+{
+    const type_t* base = check_expr(tc, node->as.idx.base);
+    const type_t* index = check_expr(tc, node->as.idx.index);
+
+    if (!type_is_error(index) && !type_is_integer(index))
+    {
+        char buf[TYPE_STR_MAX];
+        diag_error(tc->diags, node->as.idx.index->location, "index must be an integer, found %s",
+                   type_to_string(index, buf, sizeof(buf)));
+    }
+
+    if (type_is_error(base)) return tc_error();
+    if (base->kind == TY_ARRAY || base->kind == TY_VEC) return base->elem;
+    if (base->kind == TY_STR) return type_prim(TY_CHAR);
+
+    char buf[TYPE_STR_MAX];
+    diag_error(tc->diags, node->location, "cannot index a value of type %s",
+               type_to_string(base, buf, sizeof(buf)));
+    return tc_error();
+}
+
+static const type_t* tc_call(typecheck_t* tc, ASTNode* node)
+{
+    FnCall* call = &node->as.call;
+
+    // arguments first, the tree is typed bottom-up
+    for (int i = 0; i < call->arg_count; i++)
+        check_expr(tc, call->args[i]);
+
+    ASTNode* callee = call->callee;
+    sym_entry_t* sym = callee && callee->type == AST_IDENTIFIER ? callee->as.ident.sym : NULL;
+    const char* name = sym ? sym_name(sym) : "expression";
+
+    // an interface without full types gives only the arity and result
+    if (sym && sym->imported && sym->symbol_type == SYM_FUNCTION && !typecheck_symbol_type(tc, sym))
+    {
+        callee->ty = tc_error();
+        if (call->arg_count != sym->info.func.param_count)
+            diag_error(tc->diags, node->location, "'%s' takes %d arguments, %d given", name,
+                       sym->info.func.param_count, call->arg_count);
+        return tc_from_datatype(sym->type);
+    }
+
+    const type_t* fn = check_expr(tc, callee);
+    if (type_is_error(fn)) return tc_error();
+    if (fn->kind != TY_FN)
+    {
+        diag_error(tc->diags, node->location, "'%s' is not a function", name);
+        return tc_error();
+    }
+
+    if (call->arg_count != fn->param_count)
+    {
+        diag_error(tc->diags, node->location, "'%s' takes %d arguments, %d given", name,
+                   fn->param_count, call->arg_count);
+        return fn->elem;
+    }
+
+    for (int i = 0; i < call->arg_count; i++)
+    {
+        char what[96];
+        snprintf(what, sizeof(what), "argument %d of '%s'", i + 1, name);
+        tc_expect(tc, fn->params[i], call->args[i]->ty, call->args[i], node->location, what);
+    }
+    return fn->elem;
+}
+
+static const type_t* tc_range(typecheck_t* tc, ASTNode* node)
+{
+    const type_t* start = check_expr(tc, node->as.rng.start);
+    const type_t* end = check_expr(tc, node->as.rng.end);
+    const type_t* step = node->as.rng.step ? check_expr(tc, node->as.rng.step) : NULL;
+
+    if (type_is_error(start) || type_is_error(end) || (step && type_is_error(step)))
+        return tc_error();
+
+    if (!type_is_integer(start) || !type_is_integer(end) || (step && !type_is_integer(step)))
+    {
+        char a[TYPE_STR_MAX], b[TYPE_STR_MAX];
+        diag_error(tc->diags, node->location, "range bounds must be integers, found %s...%s",
+                   type_to_string(start, a, sizeof(a)), type_to_string(end, b, sizeof(b)));
+        return tc_error();
+    }
+    return type_range(tc_arith(start, end));
+}
+
+static const type_t* check_expr(typecheck_t* tc, ASTNode* node)
+{
+    if (!node) return tc_error();
+
+    const type_t* type;
+    switch (node->type)
+    {
+        case AST_LITERAL:    type = tc_literal(node);        break;
+        case AST_IDENTIFIER: type = tc_identifier(tc, node); break;
+        case AST_UNARY:      type = tc_unary(tc, node);      break;
+        case AST_BINARY:     type = tc_binary(tc, node);     break;
+        case AST_ASSIGN:     type = tc_assign(tc, node);     break;
+        case AST_INDEX:      type = tc_index(tc, node);      break;
+        case AST_FN_CALL:    type = tc_call(tc, node);       break;
+        case AST_RANGE:      type = tc_range(tc, node);      break;
+        default:             type = tc_error();              break;
+    }
+
+    node->ty = type;
+    return type;
+}
+
+/* ---------- statements ---------- */
+
+static void tc_condition(typecheck_t* tc, ASTNode* cond, const char* what)
+{
+    const type_t* type = check_expr(tc, cond);
+    if (type_is_error(type) || type->kind == TY_BOOL) return;
+
+    char buf[TYPE_STR_MAX];
+    diag_error(tc->diags, cond->location, "%s condition must be bool, found %s", what,
+               type_to_string(type, buf, sizeof(buf)));
+}
+
+static void tc_decl(typecheck_t* tc, ASTNode* node)
+{
+    Decl* decl = &node->as.declaration;
+    sym_entry_t* sym = decl->ident->as.ident.sym;
+    const char* name = decl->ident->as.ident.name;
+
+    const type_t* declared = decl->data_type ? typecheck_resolve_type(tc, decl->data_type) : NULL;
+    const type_t* value = decl->value ? check_expr(tc, decl->value) : NULL;
+
+    const type_t* type = declared;
+    if (declared && value)
+    {
+        char what[96];
+        snprintf(what, sizeof(what), "initializer of '%s'", name);
+        tc_expect(tc, declared, value, decl->value, node->location, what);
+    }
+    else if (value)
+    {
+        type = value;
+        if (value->kind == TY_VOID)
+        {
+            diag_error(tc->diags, decl->value->location, "'%s' is initialized from an expression with no value", name);
+            type = tc_error();
+        }
+    }
+
+    decl->ident->ty = type;
+    tc_set_sym(tc, sym, type);
+}
+
+static void tc_array_decl(typecheck_t* tc, ASTNode* node)
+{
+    Array* arr = &node->as.arr;
+    const char* name = arr->ident->as.ident.name;
+
+    // a slot the parser could not fill is skipped, the element is zero
+    for (size_t i = 0; i < arr->literal_count; i++)
+        if (arr->literals[i]) check_expr(tc, arr->literals[i]);
+
+    const type_t* elem;
+    if (arr->type)
+        elem = typecheck_resolve_type(tc, arr->type);
+    else if (arr->literal_count > 0 && arr->literals[0])
+        elem = arr->literals[0]->ty;
+    else
+    {
+        diag_error(tc->diags, node->location, "cannot infer the element type of '%s'", name);
+        elem = tc_error();
+    }
+
+    int length = (int)arr->literal_count;
+    if (arr->range && arr->range->as.literal.kind == IDENTIFIER)
+    {
+        // a named size is a let constant, resolved by folding, see fold.h
+        length = -1;
+    }
+    else if (arr->range)
+    {
+        arr->range->ty = check_expr(tc, arr->range);
+        if (!tc_is_int_literal(arr->range))
+            diag_error(tc->diags, arr->range->location, "size of '%s' must be an integer constant", name);
+        else
+            length = atoi(arr->range->as.literal.value);
+
+        if ((int)arr->literal_count > length)
+            diag_error(tc->diags, node->location, "too many initializers for '%s' (%d for %d)",
+                       name, (int)arr->literal_count, length);
+    }
+
+    for (size_t i = 0; i < arr->literal_count; i++)
+    {
+        if (!arr->literals[i]) continue;
+        char what[96];
+        snprintf(what, sizeof(what), "element %d of '%s'", (int)i + 1, name);
+        tc_expect(tc, elem, arr->literals[i]->ty, arr->literals[i], node->location, what);
+    }
+
+    const type_t* type = type_array(elem, length);
+    arr->ident->ty = type;
+    tc_set_sym(tc, arr->ident->as.ident.sym, type);
+}
+
+static void tc_return(typecheck_t* tc, ASTNode* node)
+{
+    ASTNode* expr = node->as.return_stmt.expr;
+    const type_t* value = expr ? check_expr(tc, expr) : type_prim(TY_VOID);
+    const char* name = tc_name(tc->function);
+
+    if (!tc->in_function)
+    {
+        diag_error(tc->diags, node->location, "'return' outside a function");
+        return;
+    }
+
+    if (tc->return_type)
+    {
+        if (tc->return_type->kind == TY_VOID && value->kind != TY_VOID)
+        {
+            diag_error(tc->diags, node->location, "'%s' returns void but a value is returned", name);
+            return;
+        }
+
+        char what[96];
+        snprintf(what, sizeof(what), "return value of '%s'", name);
+        tc_expect(tc, tc->return_type, value, expr, node->location, what);
+        return;
+    }
+
+    // no '->': the returns decide, numeric results widen to the largest
+    if (type_is_error(value)) return;
+    if (!tc->inferred)
+        tc->inferred = value;
+    else if (type_is_numeric(tc->inferred) && type_is_numeric(value))
+        tc->inferred = tc->inferred->kind >= value->kind ? tc->inferred : value;
+    else if (!tc_assignable(tc->inferred, value, expr))
+    {
+        char a[TYPE_STR_MAX], b[TYPE_STR_MAX];
+        diag_error(tc->diags, node->location, "'%s' returns %s here but %s earlier", name,
+                   type_to_string(value, a, sizeof(a)), type_to_string(tc->inferred, b, sizeof(b)));
+    }
+}
+
+static void tc_loop(typecheck_t* tc, ASTNode* node)
+{
+    ASTNode* cond = node->as.loop.condition;
+
+    if (cond && cond->type == AST_LOOP_EXPR)
+    {
+        ASTNode* var = cond->as.loopexpr.variable;
+        const type_t* range = check_expr(tc, cond->as.loopexpr.expr);
+
+        if (var)
+        {
+            if (!type_is_error(range) && range->kind != TY_RANGE)
+            {
+                char buf[TYPE_STR_MAX];
+                diag_error(tc->diags, cond->as.loopexpr.expr->location, "loop over %s, expected a range",
+                           type_to_string(range, buf, sizeof(buf)));
+                range = tc_error();
+            }
+
+            sym_entry_t* sym = var->as.ident.sym;
+            const type_t* type = typecheck_symbol_type(tc, sym);
+            if (!type && !type_is_error(range))
+            {
+                // declared by the loop header
+                type = range->elem;
+                tc_set_sym(tc, sym, type);
+            }
+            else if (type && !type_is_error(type) && !type_is_integer(type))
+            {
+                char buf[TYPE_STR_MAX];
+                diag_error(tc->diags, var->location, "loop variable '%s' must be an integer, found %s",
+                           var->as.ident.name, type_to_string(type, buf, sizeof(buf)));
+            }
+            var->ty = type ? type : tc_error();
+        }
+        else if (!type_is_error(range) && range->kind != TY_RANGE && range->kind != TY_BOOL)
+        {
+            char buf[TYPE_STR_MAX];
+            diag_error(tc->diags, cond->location, "loop condition must be bool or a range, found %s",
+                       type_to_string(range, buf, sizeof(buf)));
+        }
+        cond->ty = range;
+    }
+    else if (cond)
+    {
+        tc_condition(tc, cond, "loop");
+    }
+
+    check_stmt(tc, node->as.loop.block);
+}
+
+static void tc_match(typecheck_t* tc, ASTNode* node)
+{
+    MatchStmt* match = &node->as.matchstmt;
+    const type_t* pattern = check_expr(tc, match->pattern);
+
+    for (size_t i = 0; i < match->case_count; i++)
+    {
+        ASTNode* c = match->match_cases[i];
+        const type_t* type = check_expr(tc, c->as.matchcase.expr);
+
+        if (!type_is_error(pattern) && !type_is_error(type)
+            && !tc_binary_result(EQUAL, pattern, type))
+        {
+            char a[TYPE_STR_MAX], b[TYPE_STR_MAX];
+            diag_error(tc->diags, c->location, "case of type %s cannot match %s",
+                       type_to_string(type, a, sizeof(a)), type_to_string(pattern, b, sizeof(b)));
+        }
+        check_stmt(tc, c->as.matchcase.stmt);
+    }
+
+    if (match->def_case) check_stmt(tc, match->def_case->as.matchcase.stmt);
+}
+
+static void check_stmt(typecheck_t* tc, ASTNode* node)
+{
+    if (!node) return;
+
+    switch (node->type)
+    {
+        case AST_BLOCK:
+            for (size_t i = 0; i < node->as.block.count; i++)
+                check_stmt(tc, node->as.block.statements[i]);
+            break;
+        case AST_VAR_DECL:
+        case AST_CONST_DECL:
+            tc_decl(tc, node);
+            break;
+        case AST_ARRAY_DECL:
+            tc_array_decl(tc, node);
+            break;
+        case AST_FN_DECL:
+            check_function(tc, node);
+            break;
+        case AST_IF:
+            if (node->as.ifstmt.condition) tc_condition(tc, node->as.ifstmt.condition, "if");
+            check_stmt(tc, node->as.ifstmt.then_branch);
+            check_stmt(tc, node->as.ifstmt.else_branch);
+            break;
+        case AST_MATCH:
+            tc_match(tc, node);
+            break;
+        case AST_LOOP:
+            tc_loop(tc, node);
+            break;
+        case AST_RETURN:
+            tc_return(tc, node);
+            break;
+        case AST_STRUCT:
+        case AST_UNION:
+        case AST_ENUM:
+        case AST_IMPORT:
+        case AST_STMT:
+        case AST_PROGRAM:
+            break;
+        default:
+            check_expr(tc, node);
+            break;
+    }
+}
+
+/* ---------- declarations ---------- */
+
+static int tc_has_member(const type_field_t* members, int count, name_id_t name)
+{
+    for (int i = 0; i < count; i++)
+        if (members[i].name == name) return 1;
+    return 0;
+}
+
+static void tc_fields(typecheck_t* tc, const type_t* type, ASTNode** fields, size_t count)
+{
+    type_field_t* members = tc_alloc(sizeof(type_field_t) * count);
+    int n = 0;
+
+    for (size_t i = 0; i < count; i++)
+    {
+        ASTNode* field = fields[i];
+        if (!field) continue;
+
+        name_id_t name = intern(field->as.field.ident->as.ident.name);
+        if (tc_has_member(members, n, name))
+        {
+            diag_error(tc->diags, field->location, "duplicate member '%s'", field->as.field.ident->as.ident.name);
+            continue;
+        }
+
+        field->ty = typecheck_resolve_type(tc, field->as.field.type);
+        members[n].name = name;
+        members[n].type = field->ty;
+        n++;
+    }
+
+    type_set_fields(type, members, n);
+    free(members);
+}
+
+static void tc_type_decl(typecheck_t* tc, ASTNode* node)
+{
+    switch (node->type)
+    {
+        case AST_STRUCT:
+        {
+            const type_t* type = type_named(TY_STRUCT, intern(node->as.structType.name->as.ident.name));
+            node->ty = type;
+            tc_fields(tc, type, node->as.structType.fields, node->as.structType.fields_count);
+            break;
+        }
+        case AST_UNION:
+        {
+            const type_t* type = type_named(TY_UNION, intern(node->as.unionType.name->as.ident.name));
+            node->ty = type;
+            tc_fields(tc, type, node->as.unionType.fields, node->as.unionType.fields_count);
+            break;
+        }
+        case AST_ENUM:
+        {
+            const type_t* type = type_named(TY_ENUM, intern(node->as.enumType.enum_name->as.ident.name));
+            node->ty = type;
+            for (size_t i = 0; i < node->as.enumType.enum_count; i++)
+                node->as.enumType.enum_values[i]->ty = type;
+            break;
+        }
+        default:
+            break;
+    }
+}
+
+// load the interface declaring a type name, without reporting anything
+static void tc_preload_type(typecheck_t* tc, Token* name)
+{
+    if (name && name->lexeme && tc_prim_index(name->lexeme) < 0)
+        tc_lookup_global(tc->table, name->lexeme);
+}
+
+// every type named inside a body, so imports are in before the freeze
+static void tc_preload(typecheck_t* tc, ASTNode* node)
+{
+    if (!node) return;
+
+    switch (node->type)
+    {
+        case AST_BLOCK:
+            for (size_t i = 0; i < node->as.block.count; i++)
+                tc_preload(tc, node->as.block.statements[i]);
+            break;
+        case AST_VAR_DECL:
+        case AST_CONST_DECL:
+            tc_preload_type(tc, node->as.declaration.data_type);
+            break;
+        case AST_ARRAY_DECL:
+            tc_preload_type(tc, node->as.arr.type);
+            break;
+        case AST_FN_DECL:
+            for (size_t i = 0; i < node->as.func.params_count; i++)
+                if (node->as.func.params[i]) tc_preload_type(tc, node->as.func.params[i]->as.param.type);
+            tc_preload_type(tc, node->as.func.return_type);
+            tc_preload(tc, node->as.func.block);
+            break;
+        case AST_IF:
+            tc_preload(tc, node->as.ifstmt.then_branch);
+            tc_preload(tc, node->as.ifstmt.else_branch);
+            break;
+        case AST_LOOP:
+            tc_preload(tc, node->as.loop.block);
+            break;
+        case AST_MATCH:
+            for (size_t i = 0; i < node->as.matchstmt.case_count; i++)
+                tc_preload(tc, node->as.matchstmt.match_cases[i]->as.matchcase.stmt);
+            if (node->as.matchstmt.def_case) tc_preload(tc, node->as.matchstmt.def_case->as.matchcase.stmt);
+            break;
+        default:
+            break;
+    }
+}
+
+// a global var declared without type or initializer still has none
+static int tc_has_untyped_global(typecheck_t* tc, ASTNode** stmts, int count)
+{
+    for (int i = 0; i < count; i++)
+    {
+        if (!stmts[i] || stmts[i]->type != AST_VAR_DECL) continue;
+        sym_entry_t* sym = stmts[i]->as.declaration.ident->as.ident.sym;
+        if (sym && !typecheck_symbol_type(tc, sym)) return 1;
+    }
+    return 0;
+}
+
+// the full types the imported symbols were exported with; those from an
+// interface without them keep only their coarse type
+static void tc_import_types(typecheck_t* tc)
+{
+    if (!tc->table || tc->table->import_count == 0) return;
+
+    for (unsigned int i = 1; i < tc->table->sym_count; i++)
+    {
+        sym_entry_t* sym = symtab_symbol(tc->table, i);
+        if (sym && sym->imported && !typecheck_symbol_type(tc, sym))
+            tc_set_sym(tc, sym, iface_symbol_type(tc->table, sym));
+    }
+}
+
+int typecheck_declarations(typecheck_t* tc, ASTNode* prog)
+{
+    if (!tc || !prog || prog->type != AST_PROGRAM) return 0;
+
+    int errors = tc->diags->errors;
+    ASTNode** stmts = prog->as.program.statements;
+    int count = prog->as.program.stmt_count;
+
+    tc_import_types(tc);
+
+    // types and signatures first, so bodies can use anything declared at
+    // the top level; then globals
+    for (int i = 0; i < count; i++)
+        if (stmts[i]) tc_type_decl(tc, stmts[i]);
+
+    for (int i = 0; i < count; i++)
+        if (stmts[i] && stmts[i]->type == AST_FN_DECL) tc_signature(tc, stmts[i]);
+
+    for (int i = 0; i < count; i++)
+        if (stmts[i] && stmts[i]->type != AST_FN_DECL) check_stmt(tc, stmts[i]);
+
+    // callers need inferred results, and an untyped global takes the first
+    // value stored in program order, so those bodies are checked here
+    int in_order = tc_has_untyped_global(tc, stmts, count);
+    for (int i = 0; i < count; i++)
+    {
+        ASTNode* fn = stmts[i];
+        if (!fn || fn->type != AST_FN_DECL) continue;
+
+        sym_entry_t* sym = fn->as.func.ident->as.ident.sym;
+        if (in_order || (fn->as.func.block && sym && !typecheck_symbol_type(tc, sym)))
+            check_function(tc, fn);
+        else if (tc->table && tc->table->import_count > 0)
+            tc_preload(tc, fn);
+    }
+
+    // every symbol exists by now, so workers never grow the arrays
+    if (tc->table && tc->table->sym_count) tc_reserve(tc, tc->table->sym_count - 1);
+
+    return tc->diags->errors - errors;
+}
+
+void typecheck_function(typecheck_t* tc, ASTNode* decl)
+{
+    if (tc && decl && decl->type == AST_FN_DECL) check_function(tc, decl);
+}
+
+typecheck_t typecheck_worker(typecheck_t* tc, diag_list_t* diags)
+{
+    typecheck_t worker = *tc;
+    worker.diags = diags;
+    worker.function = NULL;
+    worker.return_type = NULL;
+    worker.inferred = NULL;
+    worker.in_function = 0;
+    return worker;
+}
+
+int typecheck_program(typecheck_t* tc, ASTNode* prog)
+{
+    if (!tc || !prog || prog->type != AST_PROGRAM) return 0;
+
+    int errors = tc->diags->errors;
+    typecheck_declarations(tc, prog);
+
+    for (int i = 0; i < prog->as.program.stmt_count; i++)
+        typecheck_function(tc, prog->as.program.statements[i]);
+
+    return tc->diags->errors - errors;
+}
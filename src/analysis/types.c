@@ -0,0 +1,328 @@
+#define _POSIX_C_SOURCE 200809L     // pthread_mutex_t under -std=c99
+
+#include "types.h"
+#include "intern.h"
+
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define TYPE_INITIAL_BUCKETS 256
+
+typedef struct
+{
+    type_t** buckets;
+    unsigned int bucket_count;  // power of two
+    unsigned int count;
+    pthread_mutex_t lock;
+} type_table_t;
+
+static type_table_t types = { .lock = PTHREAD_MUTEX_INITIALIZER };
+
+static void* type_alloc(size_t size)
+{
+    void* m = calloc(1, size ? size : 1);
+    if (!m) { fprintf(stderr, "Out of memory\n"); exit(1); }
+    return m;
+}
+
+static unsigned int type_mix(unsigned int h, unsigned int v)
+{
+    h ^= v + 0x9e3779b9u + (h << 6) + (h >> 2);
+    return h;
+}
+
+static unsigned int type_hash(const type_t* key)
+{
+    unsigned int h = type_mix(0, key->kind);
+    h = type_mix(h, key->elem ? key->elem->id + 1 : 0);
+    h = type_mix(h, (unsigned int)key->length);
+    h = type_mix(h, key->name);
+    for (int i = 0; i < key->param_count; i++)
+        h = type_mix(h, key->params[i]->id + 1);
+    return h;
+}
+
+// components are interned already, so comparing them is pointer equality
+static int type_same(const type_t* a, const type_t* b)
+{
+    if (a->kind != b->kind || a->elem != b->elem || a->length != b->length
+        || a->name != b->name || a->param_count != b->param_count)
+        return 0;
+
+    for (int i = 0; i < a->param_count; i++)
+        if (a->params[i] != b->params[i]) return 0;
+    return 1;
+}
+
+static void type_grow(void)
+{
+    unsigned int count = types.bucket_count ? types.bucket_count * 2 : TYPE_INITIAL_BUCKETS;
+    type_t** buckets = type_alloc(sizeof(type_t*) * count);
+
+    for (unsigned int i = 0; i < types.bucket_count; i++)
+    {
+        type_t* t = types.buckets[i];
+        while (t)
+        {
+            type_t* next = t->next;
+            t->next = buckets[t->hash & (count - 1)];
+            buckets[t->hash & (count - 1)] = t;
+            t = next;
+        }
+    }
+
+    free(types.buckets);
+    types.buckets = buckets;
+    types.bucket_count = count;
+}
+
+static const type_t* type_intern(const type_t* key)
+{
+    unsigned int hash = type_hash(key);
+
+    pthread_mutex_lock(&types.lock);
+    if (!types.buckets) type_grow();
+
+    for (type_t* t = types.buckets[hash & (types.bucket_count - 1)]; t; t = t->next)
+    {
+        if (t->hash == hash && type_same(t, key))
+        {
+            pthread_mutex_unlock(&types.lock);
+            return t;
+        }
+    }
+
+    type_t* t = type_alloc(sizeof(type_t));
+    *t = *key;
+    t->hash = hash;
+    t->id = types.count++;
+    if (key->param_count)
+    {
+        t->params = type_alloc(sizeof(const type_t*) * key->param_count);
+        memcpy(t->params, key->params, sizeof(const type_t*) * key->param_count);
+    }
+
+    if (types.count > types.bucket_count) type_grow();
+    unsigned int b = hash & (types.bucket_count - 1);
+    t->next = types.buckets[b];
+    types.buckets[b] = t;
+
+    pthread_mutex_unlock(&types.lock);
+    return t;
+}
+
+// primitives are asked for constantly, from every checker thread, so
+// they are cached outside the lock. Two threads racing to fill a slot
+// store the same interned pointer.
+static const type_t* type_prims[TY_STR + 1];
+
+const type_t* type_prim(type_kind_t kind)
+{
+    if (kind > TY_DOUBLE && kind != TY_STR) kind = TY_ERROR;
+
+    const type_t* t = __atomic_load_n(&type_prims[kind], __ATOMIC_ACQUIRE);
+    if (t) return t;
+
+    type_t key = { .kind = kind, .length = -1 };
+    t = type_intern(&key);
+    __atomic_store_n(&type_prims[kind], t, __ATOMIC_RELEASE);
+    return t;
+}
+
+const type_t* type_str(int length)
+{
+    if (length < 0) return type_prim(TY_STR);
+
+    type_t key = { .kind = TY_STR, .length = length < 0 ? -1 : length };
+    return type_intern(&key);
+}
+
+const type_t* type_array(const type_t* elem, int length)
+{
+    type_t key = { .kind = TY_ARRAY, .elem = elem, .length = length < 0 ? -1 : length };
+    return type_intern(&key);
+}
+
+const type_t* type_vec(const type_t* elem)
+{
+    type_t key = { .kind = TY_VEC, .elem = elem, .length = -1 };
+    return type_intern(&key);
+}
+
+const type_t* type_range(const type_t* elem)
+{
+    type_t key = { .kind = TY_RANGE, .elem = elem, .length = -1 };
+    return type_intern(&key);
+}
+
+const type_t* type_fn(const type_t* result, const type_t** params, int param_count)
+{
+    type_t key = { .kind = TY_FN, .elem = result, .length = -1,
+                   .params = params, .param_count = param_count };
+    return type_intern(&key);
+}
+
+const type_t* type_named(type_kind_t kind, name_id_t name)
+{
+    type_t key = { .kind = kind, .length = -1, .name = name };
+    return type_intern(&key);
+}
+
+void type_set_fields(const type_t* type, const type_field_t* fields, int count)
+{
+    type_t* t = (type_t*)type;     // members are the one mutable part
+
+    pthread_mutex_lock(&types.lock);
+    if (!t->fields && count > 0)
+    {
+        t->fields = type_alloc(sizeof(type_field_t) * count);
+        memcpy(t->fields, fields, sizeof(type_field_t) * count);
+        t->field_count = count;
+    }
+    pthread_mutex_unlock(&types.lock);
+}
+
+const type_t* type_field(const type_t* type, name_id_t name)
+{
+    if (!type) return NULL;
+    for (int i = 0; i < type->field_count; i++)
+        if (type->fields[i].name == name) return type->fields[i].type;
+    return NULL;
+}
+
+int type_is_integer(const type_t* type)
+{
+    return type && type->kind >= TY_CHAR && type->kind <= TY_LONG;
+}
+
+int type_is_numeric(const type_t* type)
+{
+    return type && type->kind >= TY_CHAR && type->kind <= TY_DOUBLE;
+}
+
+int type_is_error(const type_t* type)
+{
+    return !type || type->kind == TY_ERROR;
+}
+
+datatype_t type_to_datatype(const type_t* type)
+{
+    if (!type) return TYPE_UNKNOWN;
+
+    switch (type->kind)
+    {
+        case TY_VOID:   return TYPE_VOID;
+        case TY_BOOL:   return TYPE_BOOL;
+        case TY_CHAR:   return TYPE_CHAR;
+        case TY_BYTE:
+        case TY_SHORT:
+        case TY_INT:
+        case TY_LONG:   return TYPE_INT;
+        case TY_FLOAT:  return TYPE_FLOAT;
+        case TY_DOUBLE: return TYPE_DOUBLE;
+        case TY_STR:    return TYPE_STRING;
+        case TY_ARRAY:
+        case TY_VEC:    return TYPE_ARRAY;
+        case TY_STRUCT:
+        case TY_UNION:  return TYPE_STRUCT;
+        case TY_ENUM:   return TYPE_ENUM;
+        default:        return TYPE_UNKNOWN;
+    }
+}
+
+static const char* type_kind_name(type_kind_t kind)
+{
+    switch (kind)
+    {
+        case TY_ERROR:  return "<error>";
+        case TY_VOID:   return "void";
+        case TY_BOOL:   return "bool";
+        case TY_CHAR:   return "char";
+        case TY_BYTE:   return "byte";
+        case TY_SHORT:  return "short";
+        case TY_INT:    return "int";
+        case TY_LONG:   return "long";
+        case TY_FLOAT:  return "float";
+        case TY_DOUBLE: return "double";
+        case TY_STR:    return "str";
+        default:        return "?";
+    }
+}
+
+static size_t type_write(const type_t* type, char* buf, size_t size, size_t at)
+{
+#define TYPE_PUT(...) \
+    do { int n = snprintf(buf + (at < size ? at : size), at < size ? size - at : 0, __VA_ARGS__); \
+         if (n > 0) at += (size_t)n; } while (0)
+
+    if (!type)
+    {
+        TYPE_PUT("<none>");
+        return at;
+    }
+
+    switch (type->kind)
+    {
+        case TY_STR:
+            TYPE_PUT("str");
+            if (type->length >= 0) TYPE_PUT("[%d]", type->length);
+            break;
+        case TY_ARRAY:
+            at = type_write(type->elem, buf, size, at);
+            if (type->length >= 0) TYPE_PUT("[%d]", type->length);
+            else TYPE_PUT("[]");
+            break;
+        case TY_VEC:
+            TYPE_PUT("vec<");
+            at = type_write(type->elem, buf, size, at);
+            TYPE_PUT(">");
+            break;
+        case TY_RANGE:
+            TYPE_PUT("range<");
+            at = type_write(type->elem, buf, size, at);
+            TYPE_PUT(">");
+            break;
+        case TY_FN:
+            TYPE_PUT("fn(");
+            for (int i = 0; i < type->param_count; i++)
+            {
+                if (i) TYPE_PUT(", ");
+                at = type_write(type->params[i], buf, size, at);
+            }
+            TYPE_PUT(") -> ");
+            at = type_write(type->elem, buf, size, at);
+            break;
+        case TY_STRUCT:
+            TYPE_PUT("struct %s", intern_str(type->name));
+            break;
+        case TY_ENUM:
+            TYPE_PUT("enum %s", intern_str(type->name));
+            break;
+        case TY_UNION:
+            TYPE_PUT("union %s", intern_str(type->name));
+            break;
+        default:
+            TYPE_PUT("%s", type_kind_name(type->kind));
+            break;
+    }
+    return at;
+#undef TYPE_PUT
+}
+
+const char* type_to_string(const type_t* type, char* buf, size_t size)
+{
+    if (!buf || size == 0) return "";
+    buf[0] = '\0';
+    type_write(type, buf, size, 0);
+    return buf;
+}
+
+unsigned int type_count(void)
+{
+    pthread_mutex_lock(&types.lock);
+    unsigned int count = types.count;
+    pthread_mutex_unlock(&types.lock);
+    return count;
+}
@@ -97,6 +97,9 @@ void astnodetype_to_string(ASTNodeType type)
         case AST_RETURN:
             printf("AST_RETURN\n");
             break;
+        case AST_IMPORT:
+            printf("AST_IMPORT\n");
+            break;
         default:
             printf("Default cae: UNKOWN ASTNODE\n");
             break;
@@ -136,7 +139,7 @@ void add_stmt(ASTNode* program, ASTNode* stmt)
 
 ASTNode* ast_block(ASTNode** statements, size_t count)
 {
-    ASTNode* n = malloc(sizeof(ASTNode));
+    ASTNode* n = (ASTNode*)parser_alloc(sizeof(ASTNode));
     n->type = AST_BLOCK;
     n->as.block.statements = statements;
     n->as.block.count = count;
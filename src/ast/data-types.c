@@ -35,7 +35,7 @@ ASTNode* ast_union(ASTNode* name, ASTNode** fields, size_t fields_count)
 
 ASTNode* ast_enum(ASTNode* name, ASTNode** values, size_t count)
 {
-    ASTNode* n = malloc(sizeof(ASTNode));
+    ASTNode* n = (ASTNode*)parser_alloc(sizeof(ASTNode));
     n->type = AST_ENUM;
     n->as.enumType.enum_name = name;
     n->as.enumType.enum_values = values;
@@ -63,6 +63,15 @@ ASTNode* ast_fn_decl(ASTNode* ident,
     return n;
 }
 
+ASTNode* ast_import(Token* module)
+{
+    ASTNode* n = (ASTNode*)parser_alloc(sizeof(ASTNode));
+    n->type = AST_IMPORT;
+    n->as.import.module = module;
+    n->location = module->location;
+    return n;
+}
+
 ASTNode* ast_return_stmt(ASTNode* expr)
 {
     ASTNode* n = (ASTNode*)parser_alloc(sizeof(ASTNode));
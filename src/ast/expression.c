@@ -7,6 +7,7 @@ ASTNode* ast_new_literal(Token* t)
     ASTNode* n = (ASTNode*)parser_alloc(sizeof(ASTNode)); 
     n->type = AST_LITERAL; 
     n->as.literal.value = my_strdup(t->lexeme); 
+    n->as.literal.kind = t->type;
     n->location = t->location;  
     return n; 
 }
@@ -90,6 +91,7 @@ ASTNode* ast_loop_expr(ASTNode* variable, ASTNode* expr)
     n->type = AST_LOOP_EXPR;
     n->as.loopexpr.variable = variable;
     n->as.loopexpr.expr = expr;
+    n->as.loopexpr.trip_count = -1;
     // n->location = variable->location;
     return n;
 }
\ No newline at end of file
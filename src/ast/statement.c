@@ -23,7 +23,9 @@ ASTNode* ast_new_match_case(ASTNode* expr,
     n->type = AST_MATCH_CASE;
     n->as.matchcase.expr = expr;
     n->as.matchcase.stmt = stmt;
-    n->location = expr->location;
+    // the default case '_' has no expression
+    if (expr) n->location = expr->location;
+    else if (stmt) n->location = stmt->location;
     return n;
 }
 
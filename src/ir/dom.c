@@ -0,0 +1,270 @@
+#include "dom.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+static void* dom_malloc(size_t size)
+{
+    void* m = calloc(1, size ? size : 1);
+    if (!m) { fprintf(stderr, "Out of memory\n"); exit(1); }
+    return m;
+}
+
+// depth first from the entry with an explicit stack, so deep CFGs cost no
+// C stack; blocks are numbered in postorder and rpo is filled backwards
+static void dom_number(dom_t* dom, const ir_func_t* fn)
+{
+    int n = fn->block_count;
+    ir_block_t** stack = dom_malloc(sizeof(ir_block_t*) * n);
+    int* next = dom_malloc(sizeof(int) * n);
+    ir_block_t** post = dom_malloc(sizeof(ir_block_t*) * n);
+    int post_count = 0;
+
+    for (int i = 0; i < n; i++) dom->order[i] = -1;
+
+    int top = 0;
+    stack[top++] = fn->blocks[0];
+    dom->order[0] = 0;      // seen
+    while (top > 0)
+    {
+        ir_block_t* b = stack[top - 1];
+        if (next[b->id] < b->succ_count)
+        {
+            ir_block_t* s = b->succs[next[b->id]++];
+            if (dom->order[s->id] < 0)
+            {
+                dom->order[s->id] = 0;
+                stack[top++] = s;
+            }
+            continue;
+        }
+        post[post_count++] = b;
+        top--;
+    }
+
+    dom->rpo_count = post_count;
+    for (int i = 0; i < post_count; i++)
+    {
+        ir_block_t* b = post[post_count - 1 - i];
+        dom->rpo[i] = b;
+        dom->order[b->id] = i;
+    }
+
+    free(stack);
+    free(next);
+    free(post);
+}
+
+// the nearest common dominator, on rpo positions
+static int dom_intersect(const int* doms, int a, int b)
+{
+    while (a != b)
+    {
+        while (a > b) a = doms[a];
+        while (b > a) b = doms[b];
+    }
+    return a;
+}
+
+static void dom_idoms(dom_t* dom)
+{
+    int n = dom->rpo_count;
+    int* doms = dom_malloc(sizeof(int) * n);
+    for (int i = 0; i < n; i++) doms[i] = -1;
+    doms[0] = 0;
+
+    int changed = 1;
+    while (changed)
+    {
+        changed = 0;
+        for (int i = 1; i < n; i++)
+        {
+            ir_block_t* b = dom->rpo[i];
+            int idom = -1;
+            for (int p = 0; p < b->pred_count; p++)
+            {
+                int pred = dom->order[b->preds[p]->id];
+                if (pred < 0 || doms[pred] < 0) continue;   // unreachable or not reached yet
+                idom = idom < 0 ? pred : dom_intersect(doms, pred, idom);
+            }
+            if (doms[i] != idom)
+            {
+                doms[i] = idom;
+                changed = 1;
+            }
+        }
+    }
+
+    for (int i = 1; i < n; i++)
+        dom->idom[dom->rpo[i]->id] = dom->rpo[doms[i]];
+    free(doms);
+}
+
+static void dom_tree(dom_t* dom)
+{
+    int n = dom->block_count;
+    dom->child_start = dom_malloc(sizeof(int) * (n + 1));
+    dom->children = dom_malloc(sizeof(ir_block_t*) * n);
+
+    for (int i = 1; i < dom->rpo_count; i++)
+        dom->child_start[dom->idom[dom->rpo[i]->id]->id + 1]++;
+    for (int i = 0; i < n; i++)
+        dom->child_start[i + 1] += dom->child_start[i];
+
+    // children in reverse postorder, like the blocks themselves
+    int* fill = dom_malloc(sizeof(int) * n);
+    for (int i = 1; i < dom->rpo_count; i++)
+    {
+        int parent = dom->idom[dom->rpo[i]->id]->id;
+        dom->children[dom->child_start[parent] + fill[parent]++] = dom->rpo[i];
+    }
+    free(fill);
+
+    // preorder intervals, again without recursion
+    ir_block_t** stack = dom_malloc(sizeof(ir_block_t*) * n);
+    int* next = dom_malloc(sizeof(int) * n);
+    int top = 0, clock = 0;
+    stack[top++] = dom->rpo[0];
+    dom->enter[dom->rpo[0]->id] = clock++;
+    while (top > 0)
+    {
+        ir_block_t* b = stack[top - 1];
+        int first = dom->child_start[b->id];
+        if (first + next[b->id] < dom->child_start[b->id + 1])
+        {
+            ir_block_t* c = dom->children[first + next[b->id]++];
+            dom->enter[c->id] = clock++;
+            stack[top++] = c;
+            continue;
+        }
+        dom->leave[b->id] = clock++;
+        top--;
+    }
+    free(stack);
+    free(next);
+}
+
+// every block from a predecessor of a join up to, not including, the
+// join's idom has the join in its frontier
+static void dom_frontiers(dom_t* dom)
+{
+    int n = dom->block_count;
+    int* mark = dom_malloc(sizeof(int) * n);
+    int* fill = dom_malloc(sizeof(int) * n);
+    dom->front_start = dom_malloc(sizeof(int) * (n + 1));
+
+    // count, then fill the same walks; mark keeps a join from being added
+    // twice to one block
+    for (int pass = 0; pass < 2; pass++)
+    {
+        for (int i = 0; i < n; i++) mark[i] = -1;
+        for (int i = 0; i < dom->rpo_count; i++)
+        {
+            ir_block_t* b = dom->rpo[i];
+            if (b->pred_count < 2) continue;
+            for (int p = 0; p < b->pred_count; p++)
+            {
+                ir_block_t* runner = b->preds[p];
+                if (dom->order[runner->id] < 0) continue;
+                while (runner && runner != dom->idom[b->id] && mark[runner->id] != b->id)
+                {
+                    mark[runner->id] = b->id;
+                    if (pass == 0) dom->front_start[runner->id + 1]++;
+                    else dom->front[dom->front_start[runner->id] + fill[runner->id]++] = b;
+                    runner = dom->idom[runner->id];
+                }
+            }
+        }
+        if (pass == 0)
+        {
+            for (int i = 0; i < n; i++)
+                dom->front_start[i + 1] += dom->front_start[i];
+            dom->front = dom_malloc(sizeof(ir_block_t*) * (dom->front_start[n] + 1));
+        }
+    }
+    free(mark);
+    free(fill);
+}
+
+dom_t* dom_compute(const ir_func_t* fn)
+{
+    dom_t* dom = dom_malloc(sizeof(dom_t));
+    int n = fn->block_count;
+    dom->block_count = n;
+    dom->rpo = dom_malloc(sizeof(ir_block_t*) * n);
+    dom->order = dom_malloc(sizeof(int) * n);
+    dom->idom = dom_malloc(sizeof(ir_block_t*) * n);
+    dom->enter = dom_malloc(sizeof(int) * n);
+    dom->leave = dom_malloc(sizeof(int) * n);
+    if (n == 0)
+    {
+        dom->child_start = dom_malloc(sizeof(int));
+        dom->front_start = dom_malloc(sizeof(int));
+        return dom;
+    }
+
+    dom_number(dom, fn);
+    dom_idoms(dom);
+    dom_tree(dom);
+    dom_frontiers(dom);
+    return dom;
+}
+
+void dom_destroy(dom_t* dom)
+{
+    if (!dom) return;
+    free(dom->rpo);
+    free(dom->order);
+    free(dom->idom);
+    free(dom->enter);
+    free(dom->leave);
+    free(dom->child_start);
+    free(dom->children);
+    free(dom->front_start);
+    free(dom->front);
+    free(dom);
+}
+
+const dom_t* dom_get(ir_func_t* fn)
+{
+    if (!fn->dom) fn->dom = dom_compute(fn);
+    return fn->dom;
+}
+
+int dom_reachable(const dom_t* dom, const ir_block_t* b)
+{
+    return b->id < dom->block_count && dom->order[b->id] >= 0;
+}
+
+int dom_dominates(const dom_t* dom, const ir_block_t* a, const ir_block_t* b)
+{
+    if (!dom_reachable(dom, a) || !dom_reachable(dom, b)) return 0;
+    return dom->enter[a->id] <= dom->enter[b->id] && dom->leave[b->id] <= dom->leave[a->id];
+}
+
+ir_block_t* dom_idom(const dom_t* dom, const ir_block_t* b)
+{
+    return b->id < dom->block_count ? dom->idom[b->id] : NULL;
+}
+
+ir_block_t** dom_children(const dom_t* dom, const ir_block_t* b, int* count)
+{
+    if (!dom_reachable(dom, b))
+    {
+        *count = 0;
+        return NULL;
+    }
+    *count = dom->child_start[b->id + 1] - dom->child_start[b->id];
+    return dom->children + dom->child_start[b->id];
+}
+
+ir_block_t** dom_frontier(const dom_t* dom, const ir_block_t* b, int* count)
+{
+    if (!dom_reachable(dom, b))
+    {
+        *count = 0;
+        return NULL;
+    }
+    *count = dom->front_start[b->id + 1] - dom->front_start[b->id];
+    return dom->front + dom->front_start[b->id];
+}
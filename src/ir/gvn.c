@@ -0,0 +1,336 @@
+#include "gvn.h"
+#include "dom.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+typedef struct
+{
+    ir_op_t op;
+    const type_t* type;
+    ir_value_t* ops[3];
+    int count;
+    const_value_t value;        // IR_CONST
+    int index;                  // IR_RANGE_GET
+    sym_entry_t* sym;           // IR_LOAD, IR_FUNC
+    int memory;                 // IR_LOAD, IR_INDEX: the memory state read
+    const ir_value_t* phi;      // IR_PHI: the operands are the phi's own
+} gvn_key_t;
+
+typedef struct
+{
+    gvn_key_t key;
+    unsigned int hash;
+    ir_value_t* leader;
+    int next;                   // next entry in the bucket, -1 if last
+} gvn_entry_t;
+
+typedef struct
+{
+    int* buckets;               // power of two, -1 if empty
+    int bucket_mask;
+
+    // entries live on a stack, newest at the head of their bucket, so
+    // leaving a scope pops them off in order
+    gvn_entry_t* entries;
+    int entry_count;
+    int entry_capacity;
+
+    int memory;                 // the last memory state handed out
+    int* memory_out;            // by block id, the memory state at the end
+
+    int removed;
+} gvn_t;
+
+static void* gvn_malloc(size_t size)
+{
+    void* m = calloc(1, size ? size : 1);
+    if (!m) { fprintf(stderr, "Out of memory\n"); exit(1); }
+    return m;
+}
+
+static int gvn_commutes(ir_op_t op)
+{
+    switch (op)
+    {
+        case IR_ADD:
+        case IR_MUL:
+        case IR_BAND:
+        case IR_BOR:
+        case IR_BXOR:
+        case IR_EQ:
+        case IR_NE:
+            return 1;
+        default:
+            return 0;
+    }
+}
+
+// the key of v in the given memory state, 0 when v is not a pure
+// function of its key
+static int gvn_key(ir_value_t* v, int memory, gvn_key_t* key)
+{
+    memset(key, 0, sizeof(gvn_key_t));
+    key->op = v->op;
+    key->type = v->type;
+    if (v->id < 0) return 0;
+
+    switch (v->op)
+    {
+        case IR_CONST:
+            key->value = v->value;
+            return 1;
+        case IR_FUNC:
+            key->sym = v->sym;
+            return 1;
+        case IR_PHI:
+            key->phi = v;
+            return 1;
+        case IR_LOAD:
+            key->sym = v->sym;
+            key->memory = memory;
+            return 1;
+        case IR_INDEX:
+            key->memory = memory;
+            break;
+        case IR_RANGE_GET:
+            key->index = v->index;
+            break;
+        case IR_NEG:
+        case IR_NOT:
+        case IR_BNOT:
+        case IR_ADD:
+        case IR_SUB:
+        case IR_MUL:
+        case IR_DIV:
+        case IR_MOD:
+        case IR_BAND:
+        case IR_BOR:
+        case IR_BXOR:
+        case IR_SHL:
+        case IR_SHR:
+        case IR_EQ:
+        case IR_NE:
+        case IR_LT:
+        case IR_LE:
+        case IR_GT:
+        case IR_GE:
+        case IR_CONVERT:
+        case IR_RANGE:
+            break;
+        default:
+            // undef, params, allocations and calls are each their own value
+            return 0;
+    }
+
+    if (v->operand_count > 3) return 0;
+    key->count = v->operand_count;
+    for (int i = 0; i < v->operand_count; i++)
+        key->ops[i] = v->operands[i];
+
+    // a > b is b < a
+    if (v->op == IR_GT || v->op == IR_GE)
+    {
+        key->op = v->op == IR_GT ? IR_LT : IR_LE;
+        key->ops[0] = v->operands[1];
+        key->ops[1] = v->operands[0];
+    }
+    if (gvn_commutes(key->op) && key->ops[0]->id > key->ops[1]->id)
+    {
+        ir_value_t* t = key->ops[0];
+        key->ops[0] = key->ops[1];
+        key->ops[1] = t;
+    }
+    return 1;
+}
+
+static unsigned int gvn_mix(unsigned int h, unsigned long long x)
+{
+    h ^= (unsigned int)(x ^ (x >> 32));
+    return h * 16777619u;
+}
+
+static unsigned int gvn_hash(const gvn_key_t* key)
+{
+    unsigned int h = 2166136261u;
+    h = gvn_mix(h, (unsigned long long)key->op);
+    h = gvn_mix(h, (unsigned long long)(size_t)key->type);
+    for (int i = 0; i < key->count; i++)
+        h = gvn_mix(h, (unsigned long long)key->ops[i]->id);
+    h = gvn_mix(h, (unsigned long long)key->index);
+    h = gvn_mix(h, (unsigned long long)(size_t)key->sym);
+    h = gvn_mix(h, (unsigned long long)key->memory);
+
+    if (key->op == IR_CONST)
+    {
+        h = gvn_mix(h, (unsigned long long)key->value.kind);
+        if (key->value.kind == CONST_FLOAT)
+        {
+            unsigned long long bits;
+            memcpy(&bits, &key->value.f, sizeof(bits));
+            h = gvn_mix(h, bits);
+        }
+        else if (key->value.kind == CONST_STR)
+        {
+            for (const char* s = key->value.s; s && *s; s++) h = gvn_mix(h, (unsigned char)*s);
+        }
+        else
+        {
+            h = gvn_mix(h, (unsigned long long)key->value.i);
+        }
+    }
+    if (key->phi)
+    {
+        h = gvn_mix(h, (unsigned long long)key->phi->block->id);
+        for (int i = 0; i < key->phi->operand_count; i++)
+            h = gvn_mix(h, (unsigned long long)key->phi->operands[i]->id);
+    }
+    return h;
+}
+
+static int gvn_same_const(const_value_t a, const_value_t b)
+{
+    if (a.kind != b.kind) return 0;
+    switch (a.kind)
+    {
+        case CONST_FLOAT: return memcmp(&a.f, &b.f, sizeof(double)) == 0;
+        case CONST_STR:   return a.s == b.s || (a.s && b.s && strcmp(a.s, b.s) == 0);
+        default:          return a.i == b.i;
+    }
+}
+
+static int gvn_equal(const gvn_key_t* a, const gvn_key_t* b)
+{
+    if (a->op != b->op || a->type != b->type || a->count != b->count) return 0;
+    if (a->index != b->index || a->sym != b->sym || a->memory != b->memory) return 0;
+    for (int i = 0; i < a->count; i++)
+        if (a->ops[i] != b->ops[i]) return 0;
+
+    if (a->op == IR_CONST && !gvn_same_const(a->value, b->value)) return 0;
+    if (a->phi)
+    {
+        if (a->phi->block != b->phi->block || a->phi->operand_count != b->phi->operand_count) return 0;
+        for (int i = 0; i < a->phi->operand_count; i++)
+            if (a->phi->operands[i] != b->phi->operands[i]) return 0;
+    }
+    return 1;
+}
+
+static ir_value_t* gvn_find(const gvn_t* g, const gvn_key_t* key, unsigned int hash)
+{
+    for (int e = g->buckets[hash & g->bucket_mask]; e >= 0; e = g->entries[e].next)
+        if (g->entries[e].hash == hash && gvn_equal(&g->entries[e].key, key)) return g->entries[e].leader;
+    return NULL;
+}
+
+static void gvn_insert(gvn_t* g, const gvn_key_t* key, unsigned int hash, ir_value_t* leader)
+{
+    if (g->entry_count == g->entry_capacity)
+    {
+        g->entry_capacity = g->entry_capacity ? g->entry_capacity * 2 : 64;
+        g->entries = realloc(g->entries, sizeof(gvn_entry_t) * g->entry_capacity);
+        if (!g->entries) { fprintf(stderr, "Out of memory\n"); exit(1); }
+    }
+    int bucket = (int)(hash & g->bucket_mask);
+    gvn_entry_t* e = &g->entries[g->entry_count];
+    e->key = *key;
+    e->hash = hash;
+    e->leader = leader;
+    e->next = g->buckets[bucket];
+    g->buckets[bucket] = g->entry_count++;
+}
+
+static void gvn_leave(gvn_t* g, int mark)
+{
+    while (g->entry_count > mark)
+    {
+        gvn_entry_t* e = &g->entries[--g->entry_count];
+        g->buckets[e->hash & g->bucket_mask] = e->next;
+    }
+}
+
+static void gvn_block(gvn_t* g, ir_block_t* b)
+{
+    // a single predecessor is the idom, walked already, and its memory
+    // state carries on; at a join another path may have written
+    int memory = b->pred_count == 1 ? g->memory_out[b->preds[0]->id] : ++g->memory;
+
+    ir_value_t* v = b->first;
+    while (v)
+    {
+        ir_value_t* next = v->next;
+        if (v->op == IR_STORE || v->op == IR_SET_ELEM || v->op == IR_CALL) memory = ++g->memory;
+
+        gvn_key_t key;
+        if (gvn_key(v, memory, &key))
+        {
+            unsigned int hash = gvn_hash(&key);
+            ir_value_t* leader = gvn_find(g, &key, hash);
+            if (leader)
+            {
+                ir_replace_uses(v, leader);
+                ir_remove(v);
+                g->removed++;
+            }
+            else
+            {
+                gvn_insert(g, &key, hash, v);
+            }
+        }
+        v = next;
+    }
+    g->memory_out[b->id] = memory;
+}
+
+int gvn_run(ir_func_t* fn)
+{
+    if (fn->block_count == 0) return 0;
+
+    const dom_t* dom = dom_get(fn);
+    gvn_t g = { 0 };
+
+    int buckets = 64;
+    while (buckets < 2 * fn->value_count) buckets *= 2;
+    g.buckets = gvn_malloc(sizeof(int) * buckets);
+    g.bucket_mask = buckets - 1;
+    for (int i = 0; i < buckets; i++) g.buckets[i] = -1;
+    g.memory_out = gvn_malloc(sizeof(int) * fn->block_count);
+
+    // preorder over the dominator tree with an explicit stack; each frame
+    // remembers where its block's entries start
+    int n = dom->rpo_count;
+    ir_block_t** stack = gvn_malloc(sizeof(ir_block_t*) * (n + 1));
+    int* marks = gvn_malloc(sizeof(int) * (n + 1));
+    int* next = gvn_malloc(sizeof(int) * (n + 1));
+    int top = 0;
+
+    stack[top] = fn->blocks[0];
+    marks[top] = g.entry_count;
+    next[top++] = 0;
+    gvn_block(&g, fn->blocks[0]);
+
+    while (top > 0)
+    {
+        ir_block_t* b = stack[top - 1];
+        int count;
+        ir_block_t** children = dom_children(dom, b, &count);
+        if (next[top - 1] < count)
+        {
+            ir_block_t* c = children[next[top - 1]++];
+            stack[top] = c;
+            marks[top] = g.entry_count;
+            next[top++] = 0;
+            gvn_block(&g, c);
+            continue;
+        }
+        gvn_leave(&g, marks[--top]);
+    }
+
+    free(stack);
+    free(marks);
+    free(next);
+    free(g.buckets);
+    free(g.entries);
+    free(g.memory_out);
+    return g.removed;
+}
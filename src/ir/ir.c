@@ -0,0 +1,940 @@
+#include "ir.h"
+#include "dom.h"
+#include "loops.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+#define IR_CHUNK_SIZE (64 * 1024)
+#define IR_TYPE_MAX   128     // longest type name printed
+
+typedef struct ir_chunk_t
+{
+    struct ir_chunk_t* next;
+    size_t used;
+    size_t size;
+} ir_chunk_t;
+
+#define IR_CHUNK_HEADER ((sizeof(ir_chunk_t) + 15) & ~(size_t)15)
+
+typedef struct ir_arena_t
+{
+    ir_chunk_t* chunks;
+} ir_arena_t;
+
+static void* ir_malloc(size_t size)
+{
+    void* m = calloc(1, size ? size : 1);
+    if (!m) { fprintf(stderr, "Out of memory\n"); exit(1); }
+    return m;
+}
+
+/* ---------- arena ---------- */
+
+void* ir_alloc(ir_module_t* module, size_t size)
+{
+    ir_arena_t* arena = module->arena;
+    size = (size + 15) & ~(size_t)15;
+
+    ir_chunk_t* chunk = arena->chunks;
+    if (!chunk || chunk->used + size > chunk->size)
+    {
+        // the chunk header comes first, padded to keep the payload aligned
+        size_t payload = size > IR_CHUNK_SIZE ? size : IR_CHUNK_SIZE;
+        chunk = ir_malloc(IR_CHUNK_HEADER + payload);
+        chunk->size = payload;
+        chunk->next = arena->chunks;
+        arena->chunks = chunk;
+    }
+
+    void* m = (char*)chunk + IR_CHUNK_HEADER + chunk->used;
+    chunk->used += size;
+    memset(m, 0, size);
+    return m;
+}
+
+// double an arena array, the old space stays with the arena
+static void* ir_grow(ir_module_t* module, void* items, int* capacity, size_t elem)
+{
+    int grown = *capacity ? *capacity * 2 : 4;
+    void* m = ir_alloc(module, elem * grown);
+    if (items) memcpy(m, items, elem * *capacity);
+    *capacity = grown;
+    return m;
+}
+
+ir_module_t* ir_module_create(void)
+{
+    ir_module_t* module = ir_malloc(sizeof(ir_module_t));
+    module->arena = ir_malloc(sizeof(ir_arena_t));
+    return module;
+}
+
+void ir_module_destroy(ir_module_t* module)
+{
+    if (!module) return;
+
+    for (int i = 0; i < module->func_count; i++)
+        ir_invalidate(module->funcs[i]);
+
+    ir_chunk_t* chunk = module->arena->chunks;
+    while (chunk)
+    {
+        ir_chunk_t* next = chunk->next;
+        free(chunk);
+        chunk = next;
+    }
+    free(module->arena);
+    free(module);
+}
+
+/* ---------- building ---------- */
+
+ir_func_t* ir_func_create(ir_module_t* module, const char* name, sym_entry_t* sym, const type_t* result)
+{
+    ir_func_t* fn = ir_alloc(module, sizeof(ir_func_t));
+    fn->name = name;
+    fn->sym = sym;
+    fn->result = result;
+    fn->module = module;
+
+    if (module->func_count == module->func_capacity)
+        module->funcs = ir_grow(module, module->funcs, &module->func_capacity, sizeof(ir_func_t*));
+    module->funcs[module->func_count++] = fn;
+    return fn;
+}
+
+ir_block_t* ir_block_create(ir_func_t* fn)
+{
+    ir_block_t* b = ir_alloc(fn->module, sizeof(ir_block_t));
+    b->id = fn->block_count;
+    b->func = fn;
+    ir_invalidate(fn);
+
+    if (fn->block_count == fn->block_capacity)
+        fn->blocks = ir_grow(fn->module, fn->blocks, &fn->block_capacity, sizeof(ir_block_t*));
+    fn->blocks[fn->block_count++] = b;
+    return b;
+}
+
+static void ir_add_user(ir_value_t* value, ir_value_t* user)
+{
+    ir_module_t* module = user->block->func->module;
+    if (value->user_count == value->user_capacity)
+        value->users = ir_grow(module, value->users, &value->user_capacity, sizeof(ir_value_t*));
+    value->users[value->user_count++] = user;
+}
+
+static void ir_drop_user(ir_value_t* value, ir_value_t* user)
+{
+    for (int i = 0; i < value->user_count; i++)
+    {
+        if (value->users[i] == user)
+        {
+            value->users[i] = value->users[--value->user_count];
+            return;
+        }
+    }
+}
+
+static void ir_add_operand(ir_value_t* v, ir_value_t* operand)
+{
+    ir_module_t* module = v->block->func->module;
+    if (v->operand_count == v->operand_capacity)
+        v->operands = ir_grow(module, v->operands, &v->operand_capacity, sizeof(ir_value_t*));
+    v->operands[v->operand_count++] = operand;
+    if (operand) ir_add_user(operand, v);
+}
+
+static ir_value_t* ir_new_value(ir_block_t* b, ir_op_t op, const type_t* type)
+{
+    ir_func_t* fn = b->func;
+    ir_value_t* v = ir_alloc(fn->module, sizeof(ir_value_t));
+    v->op = op;
+    v->type = type;
+    v->block = b;
+
+    // void results and stores define nothing
+    int has_result = type && type->kind != TY_VOID && op != IR_STORE && op != IR_SET_ELEM && !ir_is_terminator(op);
+    v->id = has_result ? fn->value_count++ : -1;
+    if (!has_result) v->type = NULL;
+    return v;
+}
+
+static void ir_link_after(ir_block_t* b, ir_value_t* after, ir_value_t* v)
+{
+    v->prev = after;
+    v->next = after ? after->next : b->first;
+    if (v->next) v->next->prev = v;
+    else b->last = v;
+    if (after) after->next = v;
+    else b->first = v;
+}
+
+ir_value_t* ir_emit(ir_block_t* b, ir_op_t op, const type_t* type, ir_value_t** operands, int count)
+{
+    ir_value_t* v = ir_new_value(b, op, type);
+    for (int i = 0; i < count; i++)
+        ir_add_operand(v, operands[i]);
+    ir_link_after(b, b->last, v);
+    return v;
+}
+
+ir_value_t* ir_insert_before(ir_value_t* before, ir_op_t op, const type_t* type, ir_value_t** operands, int count)
+{
+    ir_block_t* b = before->block;
+    ir_value_t* v = ir_new_value(b, op, type);
+    for (int i = 0; i < count; i++)
+        ir_add_operand(v, operands[i]);
+    ir_link_after(b, before->prev, v);
+    return v;
+}
+
+ir_value_t* ir_const(ir_block_t* b, const type_t* type, const_value_t value)
+{
+    ir_value_t* v = ir_emit(b, IR_CONST, type, NULL, 0);
+    v->value = value;
+    return v;
+}
+
+ir_value_t* ir_param(ir_func_t* fn, int index, const type_t* type)
+{
+    ir_value_t* v = ir_emit(fn->blocks[0], IR_PARAM, type, NULL, 0);
+    v->index = index;
+    return v;
+}
+
+ir_value_t* ir_phi(ir_block_t* b, const type_t* type)
+{
+    ir_value_t* after = NULL;
+    for (ir_value_t* i = b->first; i && i->op == IR_PHI; i = i->next)
+        after = i;
+
+    ir_value_t* v = ir_new_value(b, IR_PHI, type);
+    ir_link_after(b, after, v);
+    return v;
+}
+
+void ir_phi_add(ir_value_t* phi, ir_value_t* value)
+{
+    ir_add_operand(phi, value);
+}
+
+static void ir_add_pred(ir_block_t* b, ir_block_t* pred)
+{
+    if (b->pred_count == b->pred_capacity)
+        b->preds = ir_grow(b->func->module, b->preds, &b->pred_capacity, sizeof(ir_block_t*));
+    b->preds[b->pred_count++] = pred;
+}
+
+static void ir_add_edge(ir_block_t* from, ir_block_t* to)
+{
+    ir_invalidate(from->func);
+    from->succs[from->succ_count++] = to;
+    ir_add_pred(to, from);
+}
+
+static ir_value_t* ir_terminate(ir_block_t* b, ir_op_t op, ir_value_t** operands, int count, int succs)
+{
+    ir_value_t* v = ir_emit(b, op, NULL, operands, count);
+    b->succs = ir_alloc(b->func->module, sizeof(ir_block_t*) * (succs ? succs : 1));
+    b->succ_count = 0;
+    return v;
+}
+
+void ir_jump(ir_block_t* b, ir_block_t* target)
+{
+    ir_terminate(b, IR_JUMP, NULL, 0, 1);
+    ir_add_edge(b, target);
+}
+
+void ir_branch(ir_block_t* b, ir_value_t* cond, ir_block_t* then_block, ir_block_t* else_block)
+{
+    ir_terminate(b, IR_BRANCH, &cond, 1, 2);
+    ir_add_edge(b, then_block);
+    ir_add_edge(b, else_block);
+}
+
+void ir_switch(ir_block_t* b, ir_value_t* value, long long low, ir_block_t** targets, int count,
+               ir_block_t* otherwise)
+{
+    ir_value_t* v = ir_terminate(b, IR_SWITCH, &value, 1, count + 1);
+    v->low = low;
+    ir_add_edge(b, otherwise);
+    for (int i = 0; i < count; i++)
+        ir_add_edge(b, targets[i]);
+}
+
+void ir_return(ir_block_t* b, ir_value_t* value)
+{
+    ir_terminate(b, IR_RETURN, &value, value ? 1 : 0, 0);
+}
+
+void ir_unreachable(ir_block_t* b)
+{
+    ir_terminate(b, IR_UNREACHABLE, NULL, 0, 0);
+}
+
+int ir_is_terminator(ir_op_t op)
+{
+    return op >= IR_JUMP;
+}
+
+ir_value_t* ir_terminator(const ir_block_t* b)
+{
+    return b->last && ir_is_terminator(b->last->op) ? b->last : NULL;
+}
+
+void ir_set_operand(ir_value_t* v, int i, ir_value_t* operand)
+{
+    if (v->operands[i] == operand) return;
+    if (v->operands[i]) ir_drop_user(v->operands[i], v);
+    v->operands[i] = operand;
+    if (operand) ir_add_user(operand, v);
+}
+
+void ir_replace_uses(ir_value_t* old, ir_value_t* value)
+{
+    if (old == value) return;
+
+    // each pass takes one user off old's list
+    while (old->user_count > 0)
+    {
+        ir_value_t* user = old->users[old->user_count - 1];
+        for (int i = 0; i < user->operand_count; i++)
+        {
+            if (user->operands[i] == old)
+            {
+                ir_set_operand(user, i, value);
+                break;
+            }
+        }
+    }
+}
+
+void ir_remove(ir_value_t* v)
+{
+    for (int i = 0; i < v->operand_count; i++)
+        ir_set_operand(v, i, NULL);
+    v->operand_count = 0;
+
+    ir_block_t* b = v->block;
+    if (v->prev) v->prev->next = v->next;
+    else b->first = v->next;
+    if (v->next) v->next->prev = v->prev;
+    else b->last = v->prev;
+    v->prev = v->next = NULL;
+}
+
+// forget the index'th predecessor of b, and the matching phi operands
+static void ir_remove_pred(ir_block_t* b, int index)
+{
+    for (ir_value_t* phi = b->first; phi && phi->op == IR_PHI; phi = phi->next)
+    {
+        if (index >= phi->operand_count) continue;
+        ir_set_operand(phi, index, NULL);
+        memmove(&phi->operands[index], &phi->operands[index + 1],
+                sizeof(ir_value_t*) * (phi->operand_count - index - 1));
+        phi->operand_count--;
+    }
+    memmove(&b->preds[index], &b->preds[index + 1], sizeof(ir_block_t*) * (b->pred_count - index - 1));
+    b->pred_count--;
+    ir_invalidate(b->func);
+}
+
+int ir_remove_unreachable(ir_func_t* fn)
+{
+    int n = fn->block_count;
+    if (n == 0) return 0;
+
+    char* seen = ir_malloc(n);
+    ir_block_t** stack = ir_malloc(sizeof(ir_block_t*) * n);
+    int top = 0;
+    stack[top++] = fn->blocks[0];
+    seen[0] = 1;
+    while (top > 0)
+    {
+        ir_block_t* b = stack[--top];
+        for (int i = 0; i < b->succ_count; i++)
+        {
+            ir_block_t* s = b->succs[i];
+            if (!seen[s->id])
+            {
+                seen[s->id] = 1;
+                stack[top++] = s;
+            }
+        }
+    }
+
+    // unhook the dead blocks first, then drop what they use
+    for (int i = 0; i < n; i++)
+    {
+        if (seen[i]) continue;
+        ir_block_t* b = fn->blocks[i];
+        for (int s = 0; s < b->succ_count; s++)
+            for (int p = b->succs[s]->pred_count - 1; p >= 0; p--)
+                if (b->succs[s]->preds[p] == b) ir_remove_pred(b->succs[s], p);
+    }
+    for (int i = 0; i < n; i++)
+    {
+        if (seen[i]) continue;
+        for (ir_value_t* v = fn->blocks[i]->first; v; v = v->next)
+            for (int o = 0; o < v->operand_count; o++)
+                ir_set_operand(v, o, NULL);
+    }
+
+    // the ids change
+    ir_invalidate(fn);
+    int kept = 0;
+    for (int i = 0; i < n; i++)
+    {
+        if (!seen[i]) continue;
+        fn->blocks[kept] = fn->blocks[i];
+        fn->blocks[kept]->id = kept;
+        kept++;
+    }
+    fn->block_count = kept;
+
+    free(seen);
+    free(stack);
+    return n - kept;
+}
+
+void ir_set_jump(ir_block_t* b, ir_block_t* target)
+{
+    int kept = 0;
+    for (int s = 0; s < b->succ_count; s++)
+    {
+        ir_block_t* succ = b->succs[s];
+        if (succ == target && !kept)
+        {
+            kept = 1;
+            continue;
+        }
+        for (int p = succ->pred_count - 1; p >= 0; p--)
+        {
+            if (succ->preds[p] != b) continue;
+            ir_remove_pred(succ, p);
+            break;
+        }
+    }
+
+    ir_value_t* term = ir_terminator(b);
+    if (term) ir_remove(term);
+    ir_emit(b, IR_JUMP, NULL, NULL, 0);
+    b->succs[0] = target;
+    b->succ_count = 1;
+    ir_invalidate(b->func);
+}
+
+ir_block_t* ir_split_preds(ir_block_t* b, ir_block_t* const* moved, int count)
+{
+    ir_block_t* split = ir_block_create(b->func);
+
+    // the edges that move, in b's pred order; a block branching to b twice
+    // moves both edges
+    char* moves = ir_malloc(b->pred_count);
+    for (int p = 0; p < b->pred_count; p++)
+        for (int m = 0; m < count; m++)
+            if (b->preds[p] == moved[m]) moves[p] = 1;
+
+    for (int p = 0; p < b->pred_count; p++)
+    {
+        if (!moves[p]) continue;
+        ir_block_t* pred = b->preds[p];
+
+        // retarget one of pred's edges still going to b for each of b's
+        // entries, so repeated edges stay paired up
+        for (int s = 0; s < pred->succ_count; s++)
+        {
+            if (pred->succs[s] != b) continue;
+            pred->succs[s] = split;
+            break;
+        }
+        ir_add_pred(split, pred);
+    }
+
+    // each phi keeps one operand for split, merged there when they differ
+    for (ir_value_t* phi = b->first; phi && phi->op == IR_PHI; phi = phi->next)
+    {
+        ir_value_t* same = NULL;
+        int differ = 0;
+        for (int p = 0; p < b->pred_count && p < phi->operand_count; p++)
+        {
+            if (!moves[p]) continue;
+            if (same && phi->operands[p] != same) differ = 1;
+            same = phi->operands[p];
+        }
+
+        ir_value_t* merged = same;
+        if (differ)
+        {
+            merged = ir_phi(split, phi->type);
+            for (int p = 0; p < b->pred_count && p < phi->operand_count; p++)
+                if (moves[p]) ir_phi_add(merged, phi->operands[p]);
+        }
+
+        int kept = 0;
+        for (int p = 0; p < phi->operand_count; p++)
+        {
+            ir_value_t* op = phi->operands[p];
+            if (p < b->pred_count && moves[p]) ir_set_operand(phi, p, NULL);
+            else phi->operands[kept++] = op;
+        }
+        phi->operand_count = kept;
+        ir_phi_add(phi, merged);
+    }
+
+    int kept = 0;
+    for (int p = 0; p < b->pred_count; p++)
+        if (!moves[p]) b->preds[kept++] = b->preds[p];
+    b->pred_count = kept;
+    free(moves);
+
+    ir_jump(split, b);
+    return split;
+}
+
+void ir_invalidate(ir_func_t* fn)
+{
+    dom_destroy(fn->dom);
+    loops_destroy(fn->loops);
+    fn->dom = NULL;
+    fn->loops = NULL;
+}
+
+int ir_remove_trivial_phis(ir_func_t* fn)
+{
+    int removed = 0;
+    int changed = 1;
+    while (changed)
+    {
+        changed = 0;
+        for (int i = 0; i < fn->block_count; i++)
+        {
+            ir_value_t* phi = fn->blocks[i]->first;
+            while (phi && phi->op == IR_PHI)
+            {
+                ir_value_t* next = phi->next;
+                ir_value_t* same = NULL;
+                int trivial = 1;
+                for (int o = 0; o < phi->operand_count && trivial; o++)
+                {
+                    ir_value_t* op = phi->operands[o];
+                    if (op == same || op == phi) continue;
+                    if (same) trivial = 0;
+                    same = op;
+                }
+
+                // a phi of nothing but itself is left for whoever made it
+                if (trivial && same)
+                {
+                    ir_replace_uses(phi, same);
+                    ir_remove(phi);
+                    removed++;
+                    changed = 1;
+                }
+                phi = next;
+            }
+        }
+    }
+    return removed;
+}
+
+/* ---------- printing ---------- */
+
+const char* ir_op_name(ir_op_t op)
+{
+    switch (op)
+    {
+        case IR_CONST:       return "const";
+        case IR_PARAM:       return "param";
+        case IR_UNDEF:       return "undef";
+        case IR_PHI:         return "phi";
+        case IR_FUNC:        return "func";
+        case IR_NEG:         return "neg";
+        case IR_NOT:         return "not";
+        case IR_BNOT:        return "bnot";
+        case IR_ADD:         return "add";
+        case IR_SUB:         return "sub";
+        case IR_MUL:         return "mul";
+        case IR_DIV:         return "div";
+        case IR_MOD:         return "mod";
+        case IR_BAND:        return "band";
+        case IR_BOR:         return "bor";
+        case IR_BXOR:        return "bxor";
+        case IR_SHL:         return "shl";
+        case IR_SHR:         return "shr";
+        case IR_EQ:          return "eq";
+        case IR_NE:          return "ne";
+        case IR_LT:          return "lt";
+        case IR_LE:          return "le";
+        case IR_GT:          return "gt";
+        case IR_GE:          return "ge";
+        case IR_CONVERT:     return "convert";
+        case IR_CONCAT:      return "concat";
+        case IR_RANGE:       return "range";
+        case IR_RANGE_GET:   return "range.get";
+        case IR_LOAD:        return "load";
+        case IR_STORE:       return "store";
+        case IR_ARRAY:       return "array";
+        case IR_INDEX:       return "index";
+        case IR_SET_ELEM:    return "setelem";
+        case IR_CALL:        return "call";
+        case IR_JUMP:        return "jmp";
+        case IR_BRANCH:      return "br";
+        case IR_SWITCH:      return "switch";
+        case IR_RETURN:      return "ret";
+        case IR_UNREACHABLE: return "unreachable";
+        default:             return "?";
+    }
+}
+
+// same order as storage_t
+static const char* ir_storage_name(int storage)
+{
+    static const char* names[] = { "", " stack", " caller", " heap" };
+    return storage >= 0 && storage < 4 ? names[storage] : "";
+}
+
+static void ir_print_const(const_value_t value, FILE* out)
+{
+    switch (value.kind)
+    {
+        case CONST_INT:   fprintf(out, "%lld", value.i); break;
+        case CONST_FLOAT: fprintf(out, "%g", value.f); break;
+        case CONST_BOOL:  fprintf(out, "%s", value.i ? "true" : "false"); break;
+        case CONST_STR:   fprintf(out, "\"%s\"", value.s); break;
+        default:          fprintf(out, "none"); break;
+    }
+}
+
+static void ir_print_operand(const ir_value_t* v, FILE* out)
+{
+    if (v) fprintf(out, "%%%d", v->id);
+    else fprintf(out, "<null>");
+}
+
+static void ir_print_value(const ir_value_t* v, FILE* out)
+{
+    char buf[IR_TYPE_MAX];
+
+    fprintf(out, "    ");
+    if (v->id >= 0) fprintf(out, "%%%d = ", v->id);
+    fprintf(out, "%s", ir_op_name(v->op));
+    if (v->type) fprintf(out, " %s", type_to_string(v->type, buf, sizeof(buf)));
+
+    switch (v->op)
+    {
+        case IR_CONST:
+            fprintf(out, " ");
+            ir_print_const(v->value, out);
+            break;
+        case IR_PARAM:
+        case IR_RANGE_GET:
+            fprintf(out, " %d", v->index);
+            break;
+        case IR_FUNC:
+            fprintf(out, " @%s", sym_name(v->sym));
+            break;
+        case IR_LOAD:
+        case IR_STORE:
+            // globals are @name, locals $name
+            fprintf(out, " %c%s", v->sym->level == 0 ? '@' : '$', sym_name(v->sym));
+            break;
+        case IR_PHI:
+            for (int i = 0; i < v->operand_count; i++)
+            {
+                fprintf(out, "%s[", i ? ", " : " ");
+                ir_print_operand(v->operands[i], out);
+                fprintf(out, ", b%d]", i < v->block->pred_count ? v->block->preds[i]->id : -1);
+            }
+            fprintf(out, "\n");
+            return;
+        case IR_CALL:
+            if (v->sym) fprintf(out, " @%s", sym_name(v->sym));
+            break;
+        default:
+            break;
+    }
+
+    for (int i = 0; i < v->operand_count; i++)
+    {
+        fprintf(out, "%s", i ? ", " : " ");
+        ir_print_operand(v->operands[i], out);
+    }
+
+    const ir_block_t* b = v->block;
+    switch (v->op)
+    {
+        case IR_JUMP:
+            fprintf(out, " b%d", b->succs[0]->id);
+            break;
+        case IR_BRANCH:
+            fprintf(out, ", b%d, b%d", b->succs[0]->id, b->succs[1]->id);
+            break;
+        case IR_SWITCH:
+            fprintf(out, ", %lld [", v->low);
+            for (int i = 1; i < b->succ_count; i++)
+                fprintf(out, "%sb%d", i > 1 ? " " : "", b->succs[i]->id);
+            fprintf(out, "], b%d", b->succs[0]->id);
+            break;
+        case IR_ARRAY:
+        case IR_CONCAT:
+        case IR_CALL:
+            fprintf(out, "%s", ir_storage_name(v->storage));
+            break;
+        case IR_INDEX:
+            if (v->in_bounds) fprintf(out, " inbounds");
+            break;
+        default:
+            break;
+    }
+    fprintf(out, "\n");
+}
+
+void ir_print_func(const ir_func_t* fn, FILE* out)
+{
+    char buf[IR_TYPE_MAX];
+
+    fprintf(out, "fn @%s(", fn->name);
+    for (int i = 0; i < fn->param_count; i++)
+        fprintf(out, "%s%%%d: %s", i ? ", " : "", fn->params[i]->id,
+                type_to_string(fn->params[i]->type, buf, sizeof(buf)));
+    fprintf(out, ") -> %s {\n", fn->result ? type_to_string(fn->result, buf, sizeof(buf)) : "void");
+
+    for (int i = 0; i < fn->block_count; i++)
+    {
+        const ir_block_t* b = fn->blocks[i];
+        fprintf(out, "b%d:", b->id);
+        if (b->pred_count > 0)
+        {
+            fprintf(out, "    ; preds");
+            for (int p = 0; p < b->pred_count; p++) fprintf(out, " b%d", b->preds[p]->id);
+        }
+        fprintf(out, "\n");
+
+        for (const ir_value_t* v = b->first; v; v = v->next)
+            ir_print_value(v, out);
+    }
+    fprintf(out, "}\n");
+}
+
+void ir_print(const ir_module_t* module, FILE* out)
+{
+    for (int i = 0; i < module->func_count; i++)
+    {
+        if (i) fprintf(out, "\n");
+        ir_print_func(module->funcs[i], out);
+    }
+}
+
+/* ---------- verifier ---------- */
+
+typedef struct
+{
+    const ir_func_t* fn;
+    dom_t* dom;
+    int errors;
+
+    // the functions of the module, by symbol index
+    const unsigned char* lowered;
+    unsigned int lowered_count;
+} ir_verifier_t;
+
+static void ir_fail(ir_verifier_t* vr, const ir_block_t* b, const ir_value_t* v, const char* what)
+{
+    if (v && v->id >= 0)
+        printf("IR error in @%s, b%d, %%%d: %s\n", vr->fn->name, b->id, v->id, what);
+    else if (v)
+        printf("IR error in @%s, b%d, %s: %s\n", vr->fn->name, b->id, ir_op_name(v->op), what);
+    else
+        printf("IR error in @%s, b%d: %s\n", vr->fn->name, b->id, what);
+    vr->errors++;
+}
+
+// str and array lengths may differ where the checker allowed it
+static int ir_same_type(const type_t* a, const type_t* b)
+{
+    if (a == b) return 1;
+    if (!a || !b) return 0;
+    if (a->kind == TY_STR && b->kind == TY_STR) return 1;
+    if (a->kind == TY_ARRAY && b->kind == TY_ARRAY) return a->elem == b->elem;
+    return 0;
+}
+
+// the checker's error type never reaches lowered code; a value without a
+// type is one that has no result
+static int ir_error_type(const type_t* type)
+{
+    return type && type->kind == TY_ERROR;
+}
+
+static int ir_count(ir_block_t* const* blocks, int count, const ir_block_t* b)
+{
+    int n = 0;
+    for (int i = 0; i < count; i++) n += blocks[i] == b;
+    return n;
+}
+
+static int ir_uses(const ir_value_t* user, const ir_value_t* value)
+{
+    int n = 0;
+    for (int i = 0; i < user->operand_count; i++) n += user->operands[i] == value;
+    return n;
+}
+
+// is def before use in their shared block
+static int ir_comes_before(const ir_value_t* def, const ir_value_t* use)
+{
+    for (const ir_value_t* v = use->prev; v; v = v->prev)
+        if (v == def) return 1;
+    return 0;
+}
+
+static void ir_verify_types(ir_verifier_t* vr, const ir_block_t* b, const ir_value_t* v)
+{
+    if (ir_error_type(v->type)) ir_fail(vr, b, v, "result has the error type");
+    for (int i = 0; i < v->operand_count; i++)
+        if (v->operands[i] && ir_error_type(v->operands[i]->type))
+            ir_fail(vr, b, v, "operand has the error type");
+
+    switch (v->op)
+    {
+        case IR_ADD: case IR_SUB: case IR_MUL: case IR_DIV: case IR_MOD:
+        case IR_BAND: case IR_BOR: case IR_BXOR: case IR_SHL: case IR_SHR:
+            if (v->operand_count != 2) ir_fail(vr, b, v, "binary operation without two operands");
+            else if (!ir_same_type(v->operands[0]->type, v->type) || !ir_same_type(v->operands[1]->type, v->type))
+                ir_fail(vr, b, v, "operand types differ from the result");
+            break;
+        case IR_EQ: case IR_NE: case IR_LT: case IR_LE: case IR_GT: case IR_GE:
+            if (v->operand_count != 2) ir_fail(vr, b, v, "comparison without two operands");
+            else if (!ir_same_type(v->operands[0]->type, v->operands[1]->type))
+                ir_fail(vr, b, v, "comparison of different types");
+            if (!v->type || v->type->kind != TY_BOOL) ir_fail(vr, b, v, "comparison is not bool");
+            break;
+        case IR_BRANCH:
+            if (v->operand_count != 1 || !v->operands[0]->type || v->operands[0]->type->kind != TY_BOOL)
+                ir_fail(vr, b, v, "branch condition is not bool");
+            break;
+        case IR_PHI:
+            for (int i = 0; i < v->operand_count; i++)
+                if (v->operands[i] && !ir_same_type(v->operands[i]->type, v->type))
+                    ir_fail(vr, b, v, "phi operand of another type");
+            break;
+        case IR_RETURN:
+        {
+            const type_t* result = vr->fn->result;
+            int is_void = !result || result->kind == TY_VOID;
+            if (is_void && v->operand_count) ir_fail(vr, b, v, "value returned from a void function");
+            else if (!is_void && (!v->operand_count || !ir_same_type(v->operands[0]->type, result)))
+                ir_fail(vr, b, v, "return value does not match the result type");
+            break;
+        }
+        default:
+            break;
+    }
+}
+
+// a function named by IR_FUNC or IR_CALL is in the module, unless it
+// lives elsewhere: imported, or a prototype without a body
+static void ir_verify_callee(ir_verifier_t* vr, const ir_block_t* b, const ir_value_t* v)
+{
+    const sym_entry_t* sym = v->sym;
+    if (!sym || sym->symbol_type != SYM_FUNCTION || sym->imported || !sym->info.func.is_defined) return;
+    if (sym->index < vr->lowered_count && vr->lowered[sym->index]) return;
+    ir_fail(vr, b, v, "function is not in the module");
+}
+
+static void ir_verify_block(ir_verifier_t* vr, const ir_block_t* b)
+{
+    if (b->func != vr->fn) ir_fail(vr, b, NULL, "block of another function");
+    if (!ir_terminator(b)) ir_fail(vr, b, NULL, "block is not terminated");
+    if (b->id == 0 && b->pred_count > 0) ir_fail(vr, b, NULL, "entry block has predecessors");
+
+    for (int i = 0; i < b->succ_count; i++)
+    {
+        const ir_block_t* s = b->succs[i];
+        if (ir_count(s->preds, s->pred_count, b) != ir_count(b->succs, b->succ_count, s))
+            ir_fail(vr, b, NULL, "successor does not list this block as a predecessor");
+    }
+    for (int i = 0; i < b->pred_count; i++)
+    {
+        const ir_block_t* p = b->preds[i];
+        if (ir_count(p->succs, p->succ_count, b) == 0)
+            ir_fail(vr, b, NULL, "predecessor does not branch here");
+    }
+
+    int past_phis = 0;
+    for (const ir_value_t* v = b->first; v; v = v->next)
+    {
+        if (v->block != b) ir_fail(vr, b, v, "instruction lists another block");
+        if (ir_is_terminator(v->op) && v != b->last) ir_fail(vr, b, v, "terminator before the end of the block");
+
+        if (v->op == IR_PHI)
+        {
+            if (past_phis) ir_fail(vr, b, v, "phi after other instructions");
+            if (v->operand_count != b->pred_count) ir_fail(vr, b, v, "phi operands do not match the predecessors");
+        }
+        else
+        {
+            past_phis = 1;
+        }
+
+        for (int i = 0; i < v->operand_count; i++)
+        {
+            const ir_value_t* op = v->operands[i];
+            if (!op)
+            {
+                ir_fail(vr, b, v, "missing operand");
+                continue;
+            }
+            if (op->id < 0) ir_fail(vr, b, v, "operand has no result");
+            if (!op->block || op->block->func != vr->fn) ir_fail(vr, b, v, "operand from another function");
+            if (v->op != IR_PHI && op->block == b && !ir_comes_before(op, v))
+                ir_fail(vr, b, v, "operand used before it is defined");
+
+            // a phi operand is used at the end of its predecessor
+            const ir_block_t* at = v->op == IR_PHI ? (i < b->pred_count ? b->preds[i] : NULL) : b;
+            if (at && op->block && op->block != at && dom_reachable(vr->dom, at)
+                && !dom_dominates(vr->dom, op->block, at))
+                ir_fail(vr, b, v, "operand does not dominate its use");
+
+            int listed = 0;
+            for (int u = 0; u < op->user_count; u++) listed += op->users[u] == v;
+            if (listed != ir_uses(v, op)) ir_fail(vr, b, v, "operand does not list this user");
+        }
+
+        if (v->op == IR_FUNC || v->op == IR_CALL) ir_verify_callee(vr, b, v);
+        ir_verify_types(vr, b, v);
+    }
+}
+
+int ir_verify(const ir_module_t* module)
+{
+    unsigned int lowered_count = 0;
+    for (int f = 0; f < module->func_count; f++)
+        if (module->funcs[f]->sym && module->funcs[f]->sym->index >= lowered_count)
+            lowered_count = module->funcs[f]->sym->index + 1;
+
+    unsigned char* lowered = calloc(lowered_count + 1, 1);
+    if (!lowered) { fprintf(stderr, "Out of memory\n"); exit(1); }
+    for (int f = 0; f < module->func_count; f++)
+        if (module->funcs[f]->sym) lowered[module->funcs[f]->sym->index] = 1;
+
+    int errors = 0;
+    for (int f = 0; f < module->func_count; f++)
+    {
+        ir_verifier_t vr = { module->funcs[f], NULL, 0, lowered, lowered_count };
+        if (vr.fn->block_count == 0) continue;
+
+        // computed afresh, the cached one may be what is wrong
+        vr.dom = dom_compute(vr.fn);
+        for (int i = 0; i < vr.fn->block_count; i++)
+            ir_verify_block(&vr, vr.fn->blocks[i]);
+        dom_destroy(vr.dom);
+        errors += vr.errors;
+    }
+    free(lowered);
+    return errors;
+}
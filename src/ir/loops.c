@@ -0,0 +1,207 @@
+#include "loops.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+static void* loops_malloc(size_t size)
+{
+    void* m = calloc(1, size ? size : 1);
+    if (!m) { fprintf(stderr, "Out of memory\n"); exit(1); }
+    return m;
+}
+
+static loop_t* loops_outermost(loop_t* loop)
+{
+    while (loop->parent) loop = loop->parent;
+    return loop;
+}
+
+// walk back from the latches to the header; a block already in an inner
+// loop stands for that whole loop, which now hangs under this one
+static void loops_body(loops_t* loops, loop_t* loop, const dom_t* dom, ir_block_t** stack)
+{
+    int top = 0;
+    for (int i = 0; i < loop->latch_count; i++)
+        stack[top++] = loop->latches[i];
+
+    while (top > 0)
+    {
+        ir_block_t* b = stack[--top];
+        if (b == loop->header) continue;
+
+        loop_t* inner = loops->innermost[b->id];
+        if (!inner)
+        {
+            loops->innermost[b->id] = loop;
+            for (int p = 0; p < b->pred_count; p++)
+                if (dom_reachable(dom, b->preds[p])) stack[top++] = b->preds[p];
+            continue;
+        }
+
+        inner = loops_outermost(inner);
+        if (inner == loop) continue;
+        inner->parent = loop;
+        for (int p = 0; p < inner->header->pred_count; p++)
+            if (dom_reachable(dom, inner->header->preds[p])) stack[top++] = inner->header->preds[p];
+    }
+}
+
+loops_t* loops_compute(const ir_func_t* fn, const dom_t* dom)
+{
+    int n = fn->block_count;
+    loops_t* loops = loops_malloc(sizeof(loops_t));
+    loops->block_count = n;
+    loops->innermost = loops_malloc(sizeof(loop_t*) * (n + 1));
+    loops->loops = loops_malloc(sizeof(loop_t*) * (n + 1));
+
+    // per loop, each edge is pushed once at most, besides the latches
+    int edges = 0;
+    for (int i = 0; i < n; i++) edges += fn->blocks[i]->pred_count;
+    ir_block_t** stack = loops_malloc(sizeof(ir_block_t*) * (2 * edges + 1));
+
+    // postorder visits an inner header before the header dominating it
+    for (int i = dom->rpo_count - 1; i >= 0; i--)
+    {
+        ir_block_t* h = dom->rpo[i];
+        int latches = 0;
+        for (int p = 0; p < h->pred_count; p++)
+            latches += dom_dominates(dom, h, h->preds[p]);
+        if (!latches) continue;
+
+        loop_t* loop = loops_malloc(sizeof(loop_t));
+        loop->header = h;
+        loop->latches = loops_malloc(sizeof(ir_block_t*) * latches);
+        for (int p = 0; p < h->pred_count; p++)
+            if (dom_dominates(dom, h, h->preds[p])) loop->latches[loop->latch_count++] = h->preds[p];
+
+        loops->innermost[h->id] = loop;
+        loops_body(loops, loop, dom, stack);
+        loops->loops[loops->loop_count++] = loop;
+    }
+    free(stack);
+
+    // parents come later in the list, so this goes outside in
+    for (int i = loops->loop_count - 1; i >= 0; i--)
+    {
+        loop_t* loop = loops->loops[i];
+        loop->depth = loop->parent ? loop->parent->depth + 1 : 1;
+    }
+
+    // blocks in reverse postorder, which puts each header first
+    for (int i = 0; i < dom->rpo_count; i++)
+        for (loop_t* l = loops->innermost[dom->rpo[i]->id]; l; l = l->parent)
+            l->block_count++;
+    for (int i = 0; i < loops->loop_count; i++)
+    {
+        loops->loops[i]->blocks = loops_malloc(sizeof(ir_block_t*) * loops->loops[i]->block_count);
+        loops->loops[i]->block_count = 0;
+    }
+    for (int i = 0; i < dom->rpo_count; i++)
+        for (loop_t* l = loops->innermost[dom->rpo[i]->id]; l; l = l->parent)
+            l->blocks[l->block_count++] = dom->rpo[i];
+
+    for (int i = 0; i < loops->loop_count; i++)
+    {
+        loop_t* loop = loops->loops[i];
+        ir_block_t* outside = NULL;
+        int entries = 0;
+        for (int p = 0; p < loop->header->pred_count; p++)
+        {
+            ir_block_t* pred = loop->header->preds[p];
+            if (loops_contains(loops, loop, pred)) continue;
+            outside = pred;
+            entries++;
+        }
+        if (entries == 1 && outside->succ_count == 1) loop->preheader = outside;
+    }
+    return loops;
+}
+
+void loops_destroy(loops_t* loops)
+{
+    if (!loops) return;
+    for (int i = 0; i < loops->loop_count; i++)
+    {
+        free(loops->loops[i]->blocks);
+        free(loops->loops[i]->latches);
+        free(loops->loops[i]);
+    }
+    free(loops->loops);
+    free(loops->innermost);
+    free(loops);
+}
+
+const loops_t* loops_get(ir_func_t* fn)
+{
+    if (!fn->loops) fn->loops = loops_compute(fn, dom_get(fn));
+    return fn->loops;
+}
+
+loop_t* loops_innermost(const loops_t* loops, const ir_block_t* b)
+{
+    return b->id < loops->block_count ? loops->innermost[b->id] : NULL;
+}
+
+int loops_depth(const loops_t* loops, const ir_block_t* b)
+{
+    loop_t* loop = loops_innermost(loops, b);
+    return loop ? loop->depth : 0;
+}
+
+int loops_contains(const loops_t* loops, const loop_t* loop, const ir_block_t* b)
+{
+    for (loop_t* l = loops_innermost(loops, b); l && l->depth >= loop->depth; l = l->parent)
+        if (l == loop) return 1;
+    return 0;
+}
+
+int loops_insert_preheaders(ir_func_t* fn)
+{
+    const loops_t* loops = loops_get(fn);
+
+    // gather first: the first split drops the forest
+    int count = 0;
+    ir_block_t** headers = loops_malloc(sizeof(ir_block_t*) * (loops->loop_count + 1));
+    ir_block_t*** entries = loops_malloc(sizeof(ir_block_t**) * (loops->loop_count + 1));
+    int* entry_counts = loops_malloc(sizeof(int) * (loops->loop_count + 1));
+
+    for (int i = 0; i < loops->loop_count; i++)
+    {
+        loop_t* loop = loops->loops[i];
+        if (loop->preheader) continue;
+
+        ir_block_t* h = loop->header;
+        ir_block_t** outside = loops_malloc(sizeof(ir_block_t*) * h->pred_count);
+        int outside_count = 0;
+        for (int p = 0; p < h->pred_count; p++)
+        {
+            ir_block_t* pred = h->preds[p];
+            if (loops_contains(loops, loop, pred)) continue;
+
+            int seen = 0;
+            for (int o = 0; o < outside_count; o++) seen |= outside[o] == pred;
+            if (!seen) outside[outside_count++] = pred;
+        }
+
+        // a header only its latches reach, such as the entry, has no way in
+        if (outside_count == 0)
+        {
+            free(outside);
+            continue;
+        }
+        headers[count] = h;
+        entries[count] = outside;
+        entry_counts[count++] = outside_count;
+    }
+
+    for (int i = 0; i < count; i++)
+    {
+        ir_split_preds(headers[i], entries[i], entry_counts[i]);
+        free(entries[i]);
+    }
+
+    free(headers);
+    free(entries);
+    free(entry_counts);
+    return count;
+}
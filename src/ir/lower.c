@@ -0,0 +1,945 @@
+#include "lower.h"
+#include "match.h"
+#include "ssa.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+typedef struct
+{
+    ir_module_t* module;
+    ir_func_t* fn;
+    ir_block_t* cur;        // NULL after a return: what follows is dead
+    ASTNode* decl;          // the function being lowered, NULL in .init
+    ssa_t* ssa;
+    symtab_t* table;
+
+    // by sym index: the function declaring a local, and whether a nested
+    // function names it, which keeps it in memory
+    ASTNode** owner;
+    unsigned char* captured;
+    int hidden;             // SSA variables lowering makes up, numbered past the symbols
+
+    // functions declared in the body being lowered
+    ASTNode** nested;
+    int nested_count;
+    int nested_capacity;
+} lower_t;
+
+static ir_value_t* lower_expr(lower_t* l, ASTNode* node);
+static void lower_stmt(lower_t* l, ASTNode* node);
+static void lower_function(lower_t* l, ASTNode* decl, const char* outer);
+
+static void* lower_realloc(void* m, size_t size)
+{
+    m = realloc(m, size ? size : 1);
+    if (!m) { fprintf(stderr, "Out of memory\n"); exit(1); }
+    return m;
+}
+
+/* ---------- values ---------- */
+
+static ir_value_t* lower_int(lower_t* l, const type_t* type, long long i)
+{
+    const_value_t v = { type->kind == TY_BOOL ? CONST_BOOL : CONST_INT, i, 0.0, NULL };
+    return ir_const(l->cur, type, v);
+}
+
+static ir_value_t* lower_convert(lower_t* l, ir_value_t* v, const type_t* type)
+{
+    if (!type || !v->type || v->type == type) return v;
+    if (!type_is_numeric(type) || !type_is_numeric(v->type)) return v;
+    return ir_emit(l->cur, IR_CONVERT, type, &v, 1);
+}
+
+// the type both sides of a numeric operator are brought to, as the checker
+// does: the wider of the two, at least int
+static const type_t* lower_common(const type_t* a, const type_t* b)
+{
+    if (!a || !b || !type_is_numeric(a) || !type_is_numeric(b)) return a;
+    type_kind_t kind = a->kind > b->kind ? a->kind : b->kind;
+    return type_prim(kind < TY_INT ? TY_INT : kind);
+}
+
+static ir_value_t* lower_arith(lower_t* l, ir_op_t op, const type_t* type, ir_value_t* a, ir_value_t* b)
+{
+    ir_value_t* operands[2] = { lower_convert(l, a, type), lower_convert(l, b, type) };
+    return ir_emit(l->cur, op, type, operands, 2);
+}
+
+static ir_value_t* lower_compare(lower_t* l, ir_op_t op, ir_value_t* a, ir_value_t* b)
+{
+    const type_t* common = lower_common(a->type, b->type);
+    ir_value_t* operands[2] = { lower_convert(l, a, common), lower_convert(l, b, common) };
+    return ir_emit(l->cur, op, type_prim(TY_BOOL), operands, 2);
+}
+
+// the IR operator of a binary or compound assignment token, IR_CONST if none
+static ir_op_t lower_binary_op(TokenType op)
+{
+    switch (op)
+    {
+        case PLUS:
+        case PLUS_ASSIGN:    return IR_ADD;
+        case MINUS:
+        case MINUS_ASSIGN:   return IR_SUB;
+        case STAR:
+        case STAR_ASSIGN:    return IR_MUL;
+        case SLASH:
+        case SLASH_ASSIGN:   return IR_DIV;
+        case PERCENT:
+        case PERCENT_ASSIGN: return IR_MOD;
+        case BITWISE_AND:
+        case AND_ASSIGN:     return IR_BAND;
+        case BITWISE_OR:     return IR_BOR;
+        case BITWISE_XOR:    return IR_BXOR;
+        case LSHIFT:         return IR_SHL;
+        case RSHIFT:         return IR_SHR;
+        case EQUAL:          return IR_EQ;
+        case NOT_EQUAL:      return IR_NE;
+        case LESS:           return IR_LT;
+        case LESS_EQUAL:     return IR_LE;
+        case GREATER:        return IR_GT;
+        case GREATER_EQUAL:  return IR_GE;
+        default:             return IR_CONST;
+    }
+}
+
+static int lower_is_compare(ir_op_t op)
+{
+    return op >= IR_EQ && op <= IR_GE;
+}
+
+/* ---------- variables ---------- */
+
+// the SSA variable of a local the current function owns and no nested
+// function names, -1 for what stays in memory
+static int lower_var(lower_t* l, sym_entry_t* sym)
+{
+    if (!sym || sym->level == 0 || sym->index >= l->table->sym_count) return -1;
+    if (l->owner[sym->index] != l->decl || l->captured[sym->index]) return -1;
+    return (int)sym->index;
+}
+
+static int lower_hidden(lower_t* l)
+{
+    return l->table->sym_count + l->hidden++;
+}
+
+static ir_value_t* lower_read(lower_t* l, sym_entry_t* sym, const type_t* type)
+{
+    int var = lower_var(l, sym);
+    if (var >= 0) return ssa_read(l->ssa, var, l->cur, type);
+
+    ir_value_t* v = ir_emit(l->cur, IR_LOAD, type, NULL, 0);
+    v->sym = sym;
+    return v;
+}
+
+// store value, converted to the variable's type, and return what was stored
+static ir_value_t* lower_write(lower_t* l, sym_entry_t* sym, ir_value_t* value, const type_t* type)
+{
+    value = lower_convert(l, value, type);
+    int var = lower_var(l, sym);
+    if (var >= 0)
+    {
+        ssa_write(l->ssa, var, l->cur, value);
+        return value;
+    }
+
+    ir_value_t* store = ir_emit(l->cur, IR_STORE, NULL, &value, 1);
+    store->sym = sym;
+    return value;
+}
+
+// continue in b, all of whose predecessors are in place
+static void lower_begin(lower_t* l, ir_block_t* b)
+{
+    l->cur = b;
+    ssa_seal(l->ssa, b);
+}
+
+/* ---------- expressions ---------- */
+
+static ir_value_t* lower_identifier(lower_t* l, ASTNode* node)
+{
+    sym_entry_t* sym = node->as.ident.sym;
+    if (!sym) return ir_emit(l->cur, IR_UNDEF, node->ty, NULL, 0);
+
+    if (sym->symbol_type == SYM_FUNCTION)
+    {
+        ir_value_t* v = ir_emit(l->cur, IR_FUNC, node->ty, NULL, 0);
+        v->sym = sym;
+        return v;
+    }
+    return lower_read(l, sym, node->ty);
+}
+
+static ir_value_t* lower_unary(lower_t* l, ASTNode* node)
+{
+    ir_value_t* operand = lower_expr(l, node->as.unary.operand);
+    switch (node->as.unary.op->type)
+    {
+        case NOT:
+            return ir_emit(l->cur, IR_NOT, node->ty, &operand, 1);
+        case BITWISE_NOT:
+            operand = lower_convert(l, operand, node->ty);
+            return ir_emit(l->cur, IR_BNOT, node->ty, &operand, 1);
+        default:
+            operand = lower_convert(l, operand, node->ty);
+            return ir_emit(l->cur, IR_NEG, node->ty, &operand, 1);
+    }
+}
+
+// a && b and a || b as values: b is only evaluated when it decides
+static ir_value_t* lower_logical(lower_t* l, ASTNode* node)
+{
+    int is_and = node->as.binary.op->type == AND;
+    const type_t* type = type_prim(TY_BOOL);
+
+    ir_value_t* left = lower_expr(l, node->as.binary.left);
+    ir_value_t* decided = lower_int(l, type, is_and ? 0 : 1);
+
+    ir_block_t* rhs = ir_block_create(l->fn);
+    ir_block_t* join = ir_block_create(l->fn);
+    if (is_and) ir_branch(l->cur, left, rhs, join);
+    else ir_branch(l->cur, left, join, rhs);
+
+    lower_begin(l, rhs);
+    ir_value_t* right = lower_expr(l, node->as.binary.right);
+    ir_jump(l->cur, join);
+
+    lower_begin(l, join);
+    ir_value_t* phi = ir_phi(join, type);
+    ir_phi_add(phi, decided);
+    ir_phi_add(phi, right);
+    return phi;
+}
+
+static ir_value_t* lower_binary(lower_t* l, ASTNode* node)
+{
+    TokenType op = node->as.binary.op->type;
+    if (op == AND || op == OR) return lower_logical(l, node);
+
+    ir_value_t* left = lower_expr(l, node->as.binary.left);
+    ir_value_t* right = lower_expr(l, node->as.binary.right);
+
+    if (op == PLUS && node->ty && node->ty->kind == TY_STR)
+    {
+        ir_value_t* operands[2] = { left, right };
+        ir_value_t* v = ir_emit(l->cur, IR_CONCAT, node->ty, operands, 2);
+        v->storage = node->as.binary.storage;
+        return v;
+    }
+
+    ir_op_t ir_op = lower_binary_op(op);
+    if (lower_is_compare(ir_op)) return lower_compare(l, ir_op, left, right);
+    return lower_arith(l, ir_op, node->ty, left, right);
+}
+
+static ir_value_t* lower_assign(lower_t* l, ASTNode* node)
+{
+    AssignExpr* assign = &node->as.assign;
+    const type_t* target = node->ty;
+    ir_value_t* value = lower_expr(l, assign->value);
+
+    if (assign->op->type != ASSIGN)
+    {
+        ir_value_t* old = lower_read(l, assign->sym, target);
+        if (target && target->kind == TY_STR)
+        {
+            ir_value_t* operands[2] = { old, value };
+            value = ir_emit(l->cur, IR_CONCAT, target, operands, 2);
+            value->storage = assign->sym->storage;
+        }
+        else
+        {
+            value = lower_arith(l, lower_binary_op(assign->op->type), lower_common(target, value->type), old, value);
+        }
+    }
+    return lower_write(l, assign->sym, value, target);
+}
+
+static ir_value_t* lower_call(lower_t* l, ASTNode* node)
+{
+    FnCall* call = &node->as.call;
+    ASTNode* callee = call->callee;
+    sym_entry_t* sym = callee && callee->type == AST_IDENTIFIER ? callee->as.ident.sym : NULL;
+    int direct = sym && sym->symbol_type == SYM_FUNCTION;
+
+    const type_t* fn = callee ? callee->ty : NULL;
+    int first = direct ? 0 : 1;
+    ir_value_t** operands = lower_realloc(NULL, sizeof(ir_value_t*) * (call->arg_count + 1));
+    if (!direct) operands[0] = lower_expr(l, callee);
+
+    for (int i = 0; i < call->arg_count; i++)
+    {
+        ir_value_t* arg = lower_expr(l, call->args[i]);
+        if (fn && fn->kind == TY_FN && i < fn->param_count) arg = lower_convert(l, arg, fn->params[i]);
+        operands[first + i] = arg;
+    }
+
+    ir_value_t* v = ir_emit(l->cur, IR_CALL, node->ty, operands, first + call->arg_count);
+    v->sym = direct ? sym : NULL;
+    v->storage = call->storage;
+    free(operands);
+    return v;
+}
+
+static ir_value_t* lower_range(lower_t* l, ASTNode* node)
+{
+    const type_t* elem = node->ty && node->ty->kind == TY_RANGE ? node->ty->elem : type_prim(TY_INT);
+    ir_value_t* operands[3];
+    operands[0] = lower_convert(l, lower_expr(l, node->as.rng.start), elem);
+    operands[1] = lower_convert(l, lower_expr(l, node->as.rng.end), elem);
+    operands[2] = node->as.rng.step ? lower_convert(l, lower_expr(l, node->as.rng.step), elem)
+                                    : lower_int(l, elem, 1);
+    return ir_emit(l->cur, IR_RANGE, node->ty, operands, 3);
+}
+
+static ir_value_t* lower_expr(lower_t* l, ASTNode* node)
+{
+    switch (node->type)
+    {
+        case AST_LITERAL:
+            return ir_const(l->cur, node->ty, const_of(node));
+        case AST_IDENTIFIER:
+            return lower_identifier(l, node);
+        case AST_UNARY:
+            return lower_unary(l, node);
+        case AST_BINARY:
+            return lower_binary(l, node);
+        case AST_ASSIGN:
+            return lower_assign(l, node);
+        case AST_INDEX:
+        {
+            ir_value_t* operands[2] = { lower_expr(l, node->as.idx.base), lower_expr(l, node->as.idx.index) };
+            ir_value_t* v = ir_emit(l->cur, IR_INDEX, node->ty, operands, 2);
+            v->in_bounds = node->as.idx.in_bounds;
+            return v;
+        }
+        case AST_FN_CALL:
+            return lower_call(l, node);
+        case AST_RANGE:
+            return lower_range(l, node);
+        default:
+            return ir_emit(l->cur, IR_UNDEF, node->ty, NULL, 0);
+    }
+}
+
+/* ---------- control flow ---------- */
+
+// branch to t when cond holds and to f otherwise, && || and ! by jumping
+static void lower_cond(lower_t* l, ASTNode* cond, ir_block_t* t, ir_block_t* f)
+{
+    if (cond->type == AST_BINARY && (cond->as.binary.op->type == AND || cond->as.binary.op->type == OR))
+    {
+        ir_block_t* rhs = ir_block_create(l->fn);
+        if (cond->as.binary.op->type == AND) lower_cond(l, cond->as.binary.left, rhs, f);
+        else lower_cond(l, cond->as.binary.left, t, rhs);
+        lower_begin(l, rhs);
+        lower_cond(l, cond->as.binary.right, t, f);
+        return;
+    }
+    if (cond->type == AST_UNARY && cond->as.unary.op->type == NOT)
+    {
+        lower_cond(l, cond->as.unary.operand, f, t);
+        return;
+    }
+    ir_branch(l->cur, lower_expr(l, cond), t, f);
+}
+
+// continue in join if anything reaches it
+static void lower_continue_at(lower_t* l, ir_block_t* join)
+{
+    lower_begin(l, join);
+    if (join->pred_count == 0) l->cur = NULL;
+}
+
+static void lower_if(lower_t* l, ASTNode* node)
+{
+    IfStmt* stmt = &node->as.ifstmt;
+
+    // a plain else has no condition
+    if (!stmt->condition)
+    {
+        lower_stmt(l, stmt->then_branch);
+        return;
+    }
+
+    ir_block_t* then_block = ir_block_create(l->fn);
+    ir_block_t* else_block = stmt->else_branch ? ir_block_create(l->fn) : NULL;
+    ir_block_t* join = ir_block_create(l->fn);
+    lower_cond(l, stmt->condition, then_block, else_block ? else_block : join);
+
+    lower_begin(l, then_block);
+    lower_stmt(l, stmt->then_branch);
+    if (l->cur) ir_jump(l->cur, join);
+
+    if (else_block)
+    {
+        lower_begin(l, else_block);
+        lower_stmt(l, stmt->else_branch);
+        if (l->cur) ir_jump(l->cur, join);
+    }
+    lower_continue_at(l, join);
+}
+
+static ir_block_t* lower_target(ir_block_t** bodies, ir_block_t* otherwise, int target)
+{
+    return target == MATCH_DEFAULT ? otherwise : bodies[target];
+}
+
+// compare the scrutinee with each case in order
+static void lower_case_chain(lower_t* l, MatchStmt* match, ir_value_t* value, ir_block_t** bodies,
+                             ir_block_t* otherwise)
+{
+    for (size_t i = 0; i < match->case_count; i++)
+    {
+        ir_value_t* expected = lower_expr(l, match->match_cases[i]->as.matchcase.expr);
+        ir_block_t* next = ir_block_create(l->fn);
+        ir_branch(l->cur, lower_compare(l, IR_EQ, value, expected), bodies[i], next);
+        lower_begin(l, next);
+    }
+    ir_jump(l->cur, otherwise);
+}
+
+static void lower_decision(lower_t* l, MatchStmt* match, const match_node_t* node, ir_value_t* value,
+                           ir_block_t** bodies, ir_block_t* otherwise)
+{
+    switch (node->kind)
+    {
+        case MATCH_LEAF:
+            ir_jump(l->cur, lower_target(bodies, otherwise, node->target));
+            break;
+
+        case MATCH_TABLE:
+        {
+            int count = (int)(node->high - node->low + 1);
+            ir_block_t** targets = lower_realloc(NULL, sizeof(ir_block_t*) * count);
+            for (int i = 0; i < count; i++)
+                targets[i] = lower_target(bodies, otherwise, node->targets[i]);
+            ir_switch(l->cur, value, node->low, targets, count, otherwise);
+            free(targets);
+            break;
+        }
+
+        case MATCH_SPLIT:
+        {
+            ir_block_t* left = ir_block_create(l->fn);
+            ir_block_t* right = ir_block_create(l->fn);
+            ir_value_t* pivot = lower_int(l, value->type, node->pivot);
+            ir_branch(l->cur, lower_compare(l, IR_LT, value, pivot), left, right);
+
+            lower_begin(l, left);
+            lower_decision(l, match, node->left, value, bodies, otherwise);
+            lower_begin(l, right);
+            lower_decision(l, match, node->right, value, bodies, otherwise);
+            break;
+        }
+
+        case MATCH_CHAIN:
+            if (!node->ranges)
+            {
+                lower_case_chain(l, match, value, bodies, otherwise);
+                break;
+            }
+            for (int i = 0; i < node->range_count; i++)
+            {
+                const match_range_t* r = &node->ranges[i];
+                ir_block_t* target = lower_target(bodies, otherwise, r->target);
+                ir_block_t* next = ir_block_create(l->fn);
+
+                if (r->low == r->high)
+                {
+                    ir_value_t* c = lower_compare(l, IR_EQ, value, lower_int(l, value->type, r->low));
+                    ir_branch(l->cur, c, target, next);
+                }
+                else
+                {
+                    ir_block_t* upper = ir_block_create(l->fn);
+                    ir_value_t* c = lower_compare(l, IR_GE, value, lower_int(l, value->type, r->low));
+                    ir_branch(l->cur, c, upper, next);
+                    lower_begin(l, upper);
+                    c = lower_compare(l, IR_LE, value, lower_int(l, value->type, r->high));
+                    ir_branch(l->cur, c, target, next);
+                }
+                lower_begin(l, next);
+            }
+            ir_jump(l->cur, otherwise);
+            break;
+    }
+}
+
+static void lower_match(lower_t* l, ASTNode* node)
+{
+    MatchStmt* match = &node->as.matchstmt;
+    ir_value_t* value = lower_expr(l, match->pattern);
+
+    ir_block_t** bodies = lower_realloc(NULL, sizeof(ir_block_t*) * (match->case_count + 1));
+    for (size_t i = 0; i < match->case_count; i++)
+        bodies[i] = ir_block_create(l->fn);
+    ir_block_t* def = match->def_case ? ir_block_create(l->fn) : NULL;
+    ir_block_t* join = ir_block_create(l->fn);
+    ir_block_t* otherwise = def ? def : join;
+
+    if (match->plan && match->plan->root) lower_decision(l, match, match->plan->root, value, bodies, otherwise);
+    else lower_case_chain(l, match, value, bodies, otherwise);
+
+    // every arm is reached from the dispatch alone
+    for (size_t i = 0; i < match->case_count; i++)
+    {
+        lower_begin(l, bodies[i]);
+        lower_stmt(l, match->match_cases[i]->as.matchcase.stmt);
+        if (l->cur) ir_jump(l->cur, join);
+    }
+    if (def)
+    {
+        lower_begin(l, def);
+        lower_stmt(l, match->def_case->as.matchcase.stmt);
+        if (l->cur) ir_jump(l->cur, join);
+    }
+
+    free(bodies);
+    lower_continue_at(l, join);
+}
+
+// loop cond { } and loop { }
+static void lower_while(lower_t* l, ASTNode* node, ASTNode* cond)
+{
+    ir_block_t* header = ir_block_create(l->fn);
+    ir_block_t* body = ir_block_create(l->fn);
+    ir_block_t* exit = ir_block_create(l->fn);
+
+    // the header is sealed once the back edge is in
+    ir_jump(l->cur, header);
+    l->cur = header;
+    if (cond) lower_cond(l, cond, body, exit);
+    else ir_jump(header, body);
+
+    lower_begin(l, body);
+    lower_stmt(l, node->as.loop.block);
+    if (l->cur) ir_jump(l->cur, header);
+    ssa_seal(l->ssa, header);
+    lower_continue_at(l, exit);
+}
+
+// loop i: a...b...s { }. The range is evaluated once and the counter is a
+// variable of its own, so it lives in a phi of the header; the loop
+// variable is set from it on each pass and is left one step past the last
+// one, like the interpreter in ctfe.c. The end is included, see
+// const_range_in in fold.h
+static void lower_counted(lower_t* l, ASTNode* node, ASTNode* var, ASTNode* range)
+{
+    const type_t* elem = range->ty && range->ty->kind == TY_RANGE ? range->ty->elem : type_prim(TY_INT);
+    ir_value_t *start, *end, *step;
+
+    if (range->type == AST_RANGE)
+    {
+        start = lower_convert(l, lower_expr(l, range->as.rng.start), elem);
+        end = lower_convert(l, lower_expr(l, range->as.rng.end), elem);
+        step = range->as.rng.step ? lower_convert(l, lower_expr(l, range->as.rng.step), elem)
+                                  : lower_int(l, elem, 1);
+    }
+    else
+    {
+        ir_value_t* r = lower_expr(l, range);
+        ir_value_t* parts[3];
+        for (int i = 0; i < 3; i++)
+        {
+            parts[i] = ir_emit(l->cur, IR_RANGE_GET, elem, &r, 1);
+            parts[i]->index = i;
+        }
+        start = parts[0];
+        end = parts[1];
+        step = parts[2];
+    }
+
+    ir_block_t* header = ir_block_create(l->fn);
+    ir_block_t* body = ir_block_create(l->fn);
+    ir_block_t* exit = ir_block_create(l->fn);
+
+    int count = lower_hidden(l);
+    ssa_write(l->ssa, count, l->cur, start);
+    ir_jump(l->cur, header);
+    l->cur = header;
+    ir_value_t* counter = ssa_read(l->ssa, count, header, elem);
+
+    if (step->op == IR_CONST)
+    {
+        ir_op_t op = step->value.i > 0 ? IR_LE : IR_GE;
+        ir_branch(l->cur, lower_compare(l, op, counter, end), body, exit);
+    }
+    else
+    {
+        // the direction is only known at run time
+        ir_block_t* up = ir_block_create(l->fn);
+        ir_block_t* down = ir_block_create(l->fn);
+        ir_branch(l->cur, lower_compare(l, IR_GT, step, lower_int(l, elem, 0)), up, down);
+        lower_begin(l, up);
+        ir_branch(l->cur, lower_compare(l, IR_LE, counter, end), body, exit);
+        lower_begin(l, down);
+        ir_branch(l->cur, lower_compare(l, IR_GE, counter, end), body, exit);
+    }
+
+    lower_begin(l, body);
+    if (var) lower_write(l, var->as.ident.sym, counter, var->ty);
+    lower_stmt(l, node->as.loop.block);
+    if (l->cur)
+    {
+        ir_value_t* next = lower_arith(l, IR_ADD, elem, ssa_read(l->ssa, count, l->cur, elem), step);
+        ssa_write(l->ssa, count, l->cur, next);
+        ir_jump(l->cur, header);
+    }
+    ssa_seal(l->ssa, header);
+
+    lower_begin(l, exit);
+    if (var) lower_write(l, var->as.ident.sym, ssa_read(l->ssa, count, exit, elem), var->ty);
+}
+
+static void lower_loop(lower_t* l, ASTNode* node)
+{
+    ASTNode* cond = node->as.loop.condition;
+    ASTNode* var = cond && cond->type == AST_LOOP_EXPR ? cond->as.loopexpr.variable : NULL;
+    ASTNode* expr = cond && cond->type == AST_LOOP_EXPR ? cond->as.loopexpr.expr : cond;
+
+    if (expr && (expr->type == AST_RANGE || (expr->ty && expr->ty->kind == TY_RANGE)))
+        lower_counted(l, node, var, expr);
+    else
+        lower_while(l, node, expr);
+}
+
+/* ---------- statements ---------- */
+
+static void lower_return(lower_t* l, ASTNode* node)
+{
+    ASTNode* expr = node->as.return_stmt.expr;
+    ir_value_t* value = expr ? lower_expr(l, expr) : NULL;
+    if (value && value->id < 0) value = NULL;   // return of a void call
+    if (value) value = lower_convert(l, value, l->fn->result);
+
+    ir_return(l->cur, value);
+    l->cur = NULL;
+}
+
+static void lower_array_decl(lower_t* l, ASTNode* node)
+{
+    Array* arr = &node->as.arr;
+    sym_entry_t* sym = arr->ident->as.ident.sym;
+    const type_t* type = arr->ident->ty;
+    const type_t* elem = type && type->kind == TY_ARRAY ? type->elem : NULL;
+
+    ir_value_t* array = ir_emit(l->cur, IR_ARRAY, type, NULL, 0);
+    array->storage = sym ? sym->storage : 0;
+
+    for (size_t i = 0; i < arr->literal_count; i++)
+    {
+        ir_value_t* operands[3];
+        operands[2] = lower_convert(l, lower_expr(l, arr->literals[i]), elem);
+        operands[0] = array;
+        operands[1] = lower_int(l, type_prim(TY_INT), (long long)i);
+        ir_emit(l->cur, IR_SET_ELEM, NULL, operands, 3);
+    }
+    if (sym) lower_write(l, sym, array, type);
+}
+
+static void lower_add_nested(lower_t* l, ASTNode* fn)
+{
+    if (l->nested_count == l->nested_capacity)
+    {
+        l->nested_capacity = l->nested_capacity ? l->nested_capacity * 2 : 4;
+        l->nested = lower_realloc(l->nested, sizeof(ASTNode*) * l->nested_capacity);
+    }
+    l->nested[l->nested_count++] = fn;
+}
+
+static void lower_stmt(lower_t* l, ASTNode* node)
+{
+    if (!node) return;
+
+    // nothing after a return runs, but nested functions still exist
+    if (!l->cur && node->type != AST_BLOCK && node->type != AST_FN_DECL) return;
+
+    switch (node->type)
+    {
+        case AST_BLOCK:
+            for (size_t i = 0; i < node->as.block.count; i++)
+                lower_stmt(l, node->as.block.statements[i]);
+            break;
+        case AST_VAR_DECL:
+        case AST_CONST_DECL:
+        {
+            ASTNode* ident = node->as.declaration.ident;
+            if (node->as.declaration.value && ident->as.ident.sym)
+                lower_write(l, ident->as.ident.sym, lower_expr(l, node->as.declaration.value), ident->ty);
+            break;
+        }
+        case AST_ARRAY_DECL:
+            lower_array_decl(l, node);
+            break;
+        case AST_FN_DECL:
+            lower_add_nested(l, node);
+            break;
+        case AST_IF:
+            lower_if(l, node);
+            break;
+        case AST_MATCH:
+            lower_match(l, node);
+            break;
+        case AST_LOOP:
+            lower_loop(l, node);
+            break;
+        case AST_RETURN:
+            lower_return(l, node);
+            break;
+        case AST_STRUCT:
+        case AST_UNION:
+        case AST_ENUM:
+        case AST_IMPORT:
+        case AST_STMT:
+        case AST_PROGRAM:
+            break;
+        default:
+            lower_expr(l, node);
+            break;
+    }
+}
+
+/* ---------- variables in memory ---------- */
+
+static void lower_declare(lower_t* l, ASTNode* ident, ASTNode* fn)
+{
+    sym_entry_t* sym = ident ? ident->as.ident.sym : NULL;
+    if (sym && sym->level > 0 && sym->index < l->table->sym_count && !l->owner[sym->index])
+        l->owner[sym->index] = fn;
+}
+
+static void lower_use(lower_t* l, sym_entry_t* sym, ASTNode* fn)
+{
+    if (!sym || sym->level == 0 || sym->index >= l->table->sym_count) return;
+    if (l->owner[sym->index] && l->owner[sym->index] != fn) l->captured[sym->index] = 1;
+}
+
+// find the owner of each local and the locals a nested function names;
+// those stay in memory so both functions see the same variable
+static void lower_scan(lower_t* l, ASTNode* node, ASTNode* fn)
+{
+    if (!node) return;
+
+    switch (node->type)
+    {
+        case AST_IDENTIFIER:
+            lower_use(l, node->as.ident.sym, fn);
+            break;
+        case AST_ASSIGN:
+            lower_use(l, node->as.assign.sym, fn);
+            lower_scan(l, node->as.assign.value, fn);
+            break;
+        case AST_UNARY:
+            lower_scan(l, node->as.unary.operand, fn);
+            break;
+        case AST_BINARY:
+            lower_scan(l, node->as.binary.left, fn);
+            lower_scan(l, node->as.binary.right, fn);
+            break;
+        case AST_INDEX:
+            lower_scan(l, node->as.idx.base, fn);
+            lower_scan(l, node->as.idx.index, fn);
+            break;
+        case AST_FN_CALL:
+            lower_scan(l, node->as.call.callee, fn);
+            for (int i = 0; i < node->as.call.arg_count; i++)
+                lower_scan(l, node->as.call.args[i], fn);
+            break;
+        case AST_RANGE:
+            lower_scan(l, node->as.rng.start, fn);
+            lower_scan(l, node->as.rng.end, fn);
+            lower_scan(l, node->as.rng.step, fn);
+            break;
+        case AST_BLOCK:
+            for (size_t i = 0; i < node->as.block.count; i++)
+                lower_scan(l, node->as.block.statements[i], fn);
+            break;
+        case AST_VAR_DECL:
+        case AST_CONST_DECL:
+            lower_declare(l, node->as.declaration.ident, fn);
+            lower_scan(l, node->as.declaration.value, fn);
+            break;
+        case AST_ARRAY_DECL:
+            lower_declare(l, node->as.arr.ident, fn);
+            for (size_t i = 0; i < node->as.arr.literal_count; i++)
+                lower_scan(l, node->as.arr.literals[i], fn);
+            break;
+        case AST_IF:
+            lower_scan(l, node->as.ifstmt.condition, fn);
+            lower_scan(l, node->as.ifstmt.then_branch, fn);
+            lower_scan(l, node->as.ifstmt.else_branch, fn);
+            break;
+        case AST_MATCH:
+            lower_scan(l, node->as.matchstmt.pattern, fn);
+            for (size_t i = 0; i < node->as.matchstmt.case_count; i++)
+            {
+                lower_scan(l, node->as.matchstmt.match_cases[i]->as.matchcase.expr, fn);
+                lower_scan(l, node->as.matchstmt.match_cases[i]->as.matchcase.stmt, fn);
+            }
+            if (node->as.matchstmt.def_case)
+                lower_scan(l, node->as.matchstmt.def_case->as.matchcase.stmt, fn);
+            break;
+        case AST_LOOP:
+            lower_scan(l, node->as.loop.condition, fn);
+            lower_scan(l, node->as.loop.block, fn);
+            break;
+        case AST_LOOP_EXPR:
+            // the header declares its variable unless one is in scope
+            lower_declare(l, node->as.loopexpr.variable, fn);
+            lower_scan(l, node->as.loopexpr.variable, fn);
+            lower_scan(l, node->as.loopexpr.expr, fn);
+            break;
+        case AST_RETURN:
+            lower_scan(l, node->as.return_stmt.expr, fn);
+            break;
+        case AST_FN_DECL:
+            for (size_t i = 0; i < node->as.func.params_count; i++)
+                lower_declare(l, node->as.func.params[i]->as.param.ident, node);
+            lower_scan(l, node->as.func.block, node);
+            break;
+        default:
+            break;
+    }
+}
+
+/* ---------- functions ---------- */
+
+static const char* lower_name(lower_t* l, const char* outer, const char* name)
+{
+    size_t size = (outer ? strlen(outer) + 1 : 0) + strlen(name) + 1;
+    char* full = ir_alloc(l->module, size);
+    if (outer) sprintf(full, "%s.%s", outer, name);
+    else strcpy(full, name);
+    return full;
+}
+
+// start a function in its entry block
+static void lower_start(lower_t* l, ASTNode* decl, const char* name, sym_entry_t* sym, const type_t* result)
+{
+    l->decl = decl;
+    l->hidden = 0;
+    l->fn = ir_func_create(l->module, name, sym, result);
+    l->ssa = ssa_create(l->fn);
+    lower_begin(l, ir_block_create(l->fn));
+}
+
+// close the last block and drop the ones nothing reaches; a join that lost
+// a dead predecessor may be left with a trivial phi
+static void lower_finish(lower_t* l)
+{
+    if (l->cur)
+    {
+        if (!l->fn->result || l->fn->result->kind == TY_VOID) ir_return(l->cur, NULL);
+        else ir_unreachable(l->cur);
+    }
+    l->cur = NULL;
+
+    for (int i = 0; i < l->fn->block_count; i++)
+        ssa_seal(l->ssa, l->fn->blocks[i]);
+    int phis = ssa_phi_count(l->ssa);
+    int removed = ssa_removed_count(l->ssa);
+    ssa_destroy(l->ssa);
+    l->ssa = NULL;
+
+    ir_remove_unreachable(l->fn);
+    removed += ir_remove_trivial_phis(l->fn);
+    printf("DEBUG: ssa '%s': %d phi(s) placed, %d trivial removed\n", l->fn->name, phis, removed);
+}
+
+static void lower_function(lower_t* l, ASTNode* decl, const char* outer)
+{
+    FuncDecl* func = &decl->as.func;
+    if (!func->block) return;   // a prototype
+
+    const char* name = lower_name(l, outer, func->ident->as.ident.name);
+
+    const type_t* type = func->ident->ty;
+    const type_t* result = type && type->kind == TY_FN ? type->elem : type_prim(TY_VOID);
+
+    ASTNode** saved_nested = l->nested;
+    int saved_count = l->nested_count, saved_capacity = l->nested_capacity;
+    l->nested = NULL;
+    l->nested_count = l->nested_capacity = 0;
+
+    lower_start(l, decl, name, func->ident->as.ident.sym, result);
+
+    l->fn->param_count = (int)func->params_count;
+    l->fn->params = ir_alloc(l->module, sizeof(ir_value_t*) * (func->params_count + 1));
+    for (size_t i = 0; i < func->params_count; i++)
+    {
+        ASTNode* ident = func->params[i]->as.param.ident;
+        l->fn->params[i] = ir_param(l->fn, (int)i, func->params[i]->ty);
+        lower_write(l, ident->as.ident.sym, l->fn->params[i], ident->ty);
+    }
+
+    lower_stmt(l, func->block);
+    lower_finish(l);
+
+    // functions declared inside come after their parent
+    ASTNode** nested = l->nested;
+    int nested_count = l->nested_count;
+    for (int i = 0; i < nested_count; i++)
+        lower_function(l, nested[i], name);
+    free(nested);
+
+    l->nested = saved_nested;
+    l->nested_count = saved_count;
+    l->nested_capacity = saved_capacity;
+}
+
+ir_module_t* ir_lower_program(ASTNode* prog, symtab_t* table)
+{
+    if (!prog || prog->type != AST_PROGRAM || !table) return NULL;
+
+    lower_t l = { .module = ir_module_create(), .table = table };
+    ASTNode** stmts = prog->as.program.statements;
+    int count = prog->as.program.stmt_count;
+
+    l.owner = lower_realloc(NULL, sizeof(ASTNode*) * (table->sym_count + 1));
+    l.captured = lower_realloc(NULL, table->sym_count + 1);
+    memset(l.owner, 0, sizeof(ASTNode*) * (table->sym_count + 1));
+    memset(l.captured, 0, table->sym_count + 1);
+    for (int i = 0; i < count; i++)
+        lower_scan(&l, stmts[i], NULL);
+
+    // global initializers run first, in program order
+    int globals = 0;
+    for (int i = 0; i < count; i++)
+    {
+        ASTNode* stmt = stmts[i];
+        if (!stmt) continue;
+        switch (stmt->type)
+        {
+            case AST_FN_DECL:
+            case AST_STRUCT:
+            case AST_UNION:
+            case AST_ENUM:
+            case AST_IMPORT:
+            case AST_STMT:
+                break;
+            default:
+                globals++;
+                break;
+        }
+    }
+    if (globals)
+    {
+        lower_start(&l, NULL, ".init", NULL, type_prim(TY_VOID));
+        for (int i = 0; i < count; i++)
+            if (stmts[i] && stmts[i]->type != AST_FN_DECL) lower_stmt(&l, stmts[i]);
+        lower_finish(&l);
+    }
+
+    for (int i = 0; i < count; i++)
+        if (stmts[i] && stmts[i]->type == AST_FN_DECL) lower_function(&l, stmts[i], NULL);
+
+    free(l.owner);
+    free(l.captured);
+    return l.module;
+}
@@ -0,0 +1,31 @@
+#include "opt.h"
+#include "gvn.h"
+#include "loops.h"
+#include "sccp.h"
+
+static void opt_function(ir_func_t* fn)
+{
+    sccp_stats_t sccp = sccp_run(fn);
+    printf("DEBUG: sccp '%s': %d value(s) folded, %d branch(es) resolved, %d block(s) removed\n",
+           fn->name, sccp.folded, sccp.branches, sccp.blocks);
+
+    // on what is left once the constants are known
+    int removed = gvn_run(fn);
+    printf("DEBUG: gvn '%s': %d redundant instruction(s) removed\n", fn->name, removed);
+
+    // later passes hoist into the preheaders
+    int preheaders = loops_insert_preheaders(fn);
+
+    const loops_t* loops = loops_get(fn);
+    int depth = 0;
+    for (int i = 0; i < loops->loop_count; i++)
+        if (loops->loops[i]->depth > depth) depth = loops->loops[i]->depth;
+    printf("DEBUG: loops '%s': %d loop(s), nested %d deep, %d preheader(s) added\n",
+           fn->name, loops->loop_count, depth, preheaders);
+}
+
+void ir_optimize(ir_module_t* module)
+{
+    for (int i = 0; i < module->func_count; i++)
+        opt_function(module->funcs[i]);
+}
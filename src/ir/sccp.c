@@ -0,0 +1,410 @@
+#include "sccp.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+typedef enum
+{
+    SCCP_TOP,           // no evidence yet
+    SCCP_CONST,
+    SCCP_BOTTOM         // not a constant
+} sccp_state_t;
+
+typedef struct
+{
+    sccp_state_t state;
+    const_value_t value;
+} sccp_cell_t;
+
+typedef struct
+{
+    ir_func_t* fn;
+    sccp_cell_t* cells;         // by value id
+
+    unsigned char* reached;     // by block id
+    int* edge_start;            // edge flags of block i start at edge_start[i]
+    unsigned char* edges;
+
+    ir_block_t** blocks;        // reached, instructions not visited yet
+    int block_count;
+    ir_value_t** values;        // changed, users not visited yet
+    int value_count;
+    int value_capacity;
+} sccp_t;
+
+static void* sccp_malloc(size_t size)
+{
+    void* m = calloc(1, size ? size : 1);
+    if (!m) { fprintf(stderr, "Out of memory\n"); exit(1); }
+    return m;
+}
+
+static TokenType sccp_token(ir_op_t op)
+{
+    switch (op)
+    {
+        case IR_ADD:  return PLUS;
+        case IR_SUB:  return MINUS;
+        case IR_MUL:  return STAR;
+        case IR_DIV:  return SLASH;
+        case IR_MOD:  return PERCENT;
+        case IR_BAND: return BITWISE_AND;
+        case IR_BOR:  return BITWISE_OR;
+        case IR_BXOR: return BITWISE_XOR;
+        case IR_SHL:  return LSHIFT;
+        case IR_SHR:  return RSHIFT;
+        case IR_EQ:   return EQUAL;
+        case IR_NE:   return NOT_EQUAL;
+        case IR_LT:   return LESS;
+        case IR_LE:   return LESS_EQUAL;
+        case IR_GT:   return GREATER;
+        case IR_GE:   return GREATER_EQUAL;
+        case IR_NEG:  return MINUS;
+        case IR_NOT:  return NOT;
+        case IR_BNOT: return BITWISE_NOT;
+        default:      return TOKEN_EOF;
+    }
+}
+
+static int sccp_same(const_value_t a, const_value_t b)
+{
+    if (a.kind != b.kind) return 0;
+    switch (a.kind)
+    {
+        case CONST_FLOAT: return a.f == b.f;
+        case CONST_STR:   return a.s == b.s || (a.s && b.s && strcmp(a.s, b.s) == 0);
+        default:          return a.i == b.i;
+    }
+}
+
+static sccp_cell_t sccp_cell(const sccp_t* sc, const ir_value_t* v)
+{
+    return sc->cells[v->id];
+}
+
+static const sccp_cell_t SCCP_OVERDEFINED = { SCCP_BOTTOM, { CONST_NONE, 0, 0.0, NULL } };
+
+static sccp_cell_t sccp_const(const_value_t value)
+{
+    sccp_cell_t cell = { SCCP_CONST, value };
+    return cell;
+}
+
+// the lower of two cells
+static sccp_cell_t sccp_meet(sccp_cell_t a, sccp_cell_t b)
+{
+    if (a.state == SCCP_TOP) return b;
+    if (b.state == SCCP_TOP) return a;
+    if (a.state == SCCP_BOTTOM || b.state == SCCP_BOTTOM) return SCCP_OVERDEFINED;
+    return sccp_same(a.value, b.value) ? a : SCCP_OVERDEFINED;
+}
+
+static int sccp_edge_live(const sccp_t* sc, const ir_block_t* from, const ir_block_t* to)
+{
+    for (int s = 0; s < from->succ_count; s++)
+        if (from->succs[s] == to && sc->edges[sc->edge_start[from->id] + s]) return 1;
+    return 0;
+}
+
+/* ---------- evaluation ---------- */
+
+static sccp_cell_t sccp_eval(const sccp_t* sc, const ir_value_t* v)
+{
+    const_value_t out;
+    switch (v->op)
+    {
+        case IR_CONST:
+            return sccp_const(v->value);
+
+        case IR_PHI:
+        {
+            sccp_cell_t cell = { SCCP_TOP, { CONST_NONE, 0, 0.0, NULL } };
+            for (int i = 0; i < v->operand_count && i < v->block->pred_count; i++)
+                if (sccp_edge_live(sc, v->block->preds[i], v->block))
+                    cell = sccp_meet(cell, sccp_cell(sc, v->operands[i]));
+            return cell;
+        }
+
+        case IR_NEG:
+        case IR_NOT:
+        case IR_BNOT:
+        case IR_CONVERT:
+        {
+            sccp_cell_t a = sccp_cell(sc, v->operands[0]);
+            if (a.state != SCCP_CONST) return a;
+            if (v->op == IR_CONVERT)
+            {
+                if (!type_is_numeric(v->type) || a.value.kind == CONST_STR) return SCCP_OVERDEFINED;
+                return sccp_const(const_convert(a.value, v->type));
+            }
+            if (const_unary(sccp_token(v->op), v->type, a.value, &out) != FOLD_OK) return SCCP_OVERDEFINED;
+            return sccp_const(out);
+        }
+
+        case IR_ADD:
+        case IR_SUB:
+        case IR_MUL:
+        case IR_DIV:
+        case IR_MOD:
+        case IR_BAND:
+        case IR_BOR:
+        case IR_BXOR:
+        case IR_SHL:
+        case IR_SHR:
+        case IR_EQ:
+        case IR_NE:
+        case IR_LT:
+        case IR_LE:
+        case IR_GT:
+        case IR_GE:
+        {
+            sccp_cell_t a = sccp_cell(sc, v->operands[0]);
+            sccp_cell_t b = sccp_cell(sc, v->operands[1]);
+            if (a.state == SCCP_BOTTOM || b.state == SCCP_BOTTOM) return SCCP_OVERDEFINED;
+            if (a.state == SCCP_TOP || b.state == SCCP_TOP) return a.state == SCCP_TOP ? a : b;
+
+            // division by zero is left to run time
+            if (const_binary(sccp_token(v->op), v->type, a.value, b.value, &out) != FOLD_OK)
+                return SCCP_OVERDEFINED;
+            return sccp_const(out);
+        }
+
+        case IR_RANGE_GET:
+        {
+            // a part of a range built here
+            const ir_value_t* range = v->operands[0];
+            if (range->op != IR_RANGE || v->index < 0 || v->index >= range->operand_count) return SCCP_OVERDEFINED;
+            return sccp_cell(sc, range->operands[v->index]);
+        }
+
+        default:
+            // parameters, memory, calls; an undef could be anything, but a
+            // branch on one must still go somewhere
+            return SCCP_OVERDEFINED;
+    }
+}
+
+static void sccp_changed(sccp_t* sc, ir_value_t* v)
+{
+    if (sc->value_count == sc->value_capacity)
+    {
+        sc->value_capacity = sc->value_capacity ? sc->value_capacity * 2 : 64;
+        sc->values = realloc(sc->values, sizeof(ir_value_t*) * sc->value_capacity);
+        if (!sc->values) { fprintf(stderr, "Out of memory\n"); exit(1); }
+    }
+    sc->values[sc->value_count++] = v;
+}
+
+static void sccp_visit_phis(sccp_t* sc, ir_block_t* b);
+
+static void sccp_mark_edge(sccp_t* sc, ir_block_t* from, int index)
+{
+    unsigned char* edge = &sc->edges[sc->edge_start[from->id] + index];
+    if (*edge) return;
+    *edge = 1;
+
+    ir_block_t* to = from->succs[index];
+    if (!sc->reached[to->id])
+    {
+        sc->reached[to->id] = 1;
+        sc->blocks[sc->block_count++] = to;
+    }
+    else
+    {
+        // one more operand counts now
+        sccp_visit_phis(sc, to);
+    }
+}
+
+static void sccp_visit(sccp_t* sc, ir_value_t* v)
+{
+    if (!sc->reached[v->block->id]) return;
+
+    ir_block_t* b = v->block;
+    switch (v->op)
+    {
+        case IR_JUMP:
+            sccp_mark_edge(sc, b, 0);
+            return;
+
+        case IR_BRANCH:
+        {
+            sccp_cell_t c = sccp_cell(sc, v->operands[0]);
+            if (c.state == SCCP_TOP) return;
+            if (c.state == SCCP_CONST && c.value.kind == CONST_BOOL)
+            {
+                sccp_mark_edge(sc, b, c.value.i ? 0 : 1);
+                return;
+            }
+            sccp_mark_edge(sc, b, 0);
+            sccp_mark_edge(sc, b, 1);
+            return;
+        }
+
+        case IR_SWITCH:
+        {
+            sccp_cell_t c = sccp_cell(sc, v->operands[0]);
+            if (c.state == SCCP_TOP) return;
+            if (c.state == SCCP_CONST && c.value.kind == CONST_INT)
+            {
+                long long slot = c.value.i - v->low;
+                sccp_mark_edge(sc, b, slot >= 0 && slot < b->succ_count - 1 ? (int)slot + 1 : 0);
+                return;
+            }
+            for (int s = 0; s < b->succ_count; s++)
+                sccp_mark_edge(sc, b, s);
+            return;
+        }
+
+        default:
+            break;
+    }
+    if (v->id < 0) return;
+
+    sccp_cell_t old = sc->cells[v->id];
+    sccp_cell_t cell = sccp_eval(sc, v);
+
+    // only ever down, whatever the order things were seen in
+    cell = sccp_meet(old, cell);
+    if (cell.state == old.state && (cell.state != SCCP_CONST || sccp_same(cell.value, old.value))) return;
+    sc->cells[v->id] = cell;
+    sccp_changed(sc, v);
+}
+
+static void sccp_visit_phis(sccp_t* sc, ir_block_t* b)
+{
+    for (ir_value_t* v = b->first; v && v->op == IR_PHI; v = v->next)
+        sccp_visit(sc, v);
+}
+
+static void sccp_solve(sccp_t* sc)
+{
+    sc->reached[0] = 1;
+    sc->blocks[sc->block_count++] = sc->fn->blocks[0];
+
+    while (sc->block_count > 0 || sc->value_count > 0)
+    {
+        if (sc->block_count > 0)
+        {
+            ir_block_t* b = sc->blocks[--sc->block_count];
+            for (ir_value_t* v = b->first; v; v = v->next)
+                sccp_visit(sc, v);
+            continue;
+        }
+
+        ir_value_t* v = sc->values[--sc->value_count];
+        for (int u = 0; u < v->user_count; u++)
+            sccp_visit(sc, v->users[u]);
+    }
+}
+
+/* ---------- rewriting ---------- */
+
+static int sccp_fold_values(sccp_t* sc)
+{
+    // the constants made here have ids past the cells
+    int values = sc->fn->value_count;
+    int folded = 0;
+    for (int i = 0; i < sc->fn->block_count; i++)
+    {
+        ir_block_t* b = sc->fn->blocks[i];
+        if (!sc->reached[b->id]) continue;
+
+        ir_value_t* v = b->first;
+        while (v)
+        {
+            ir_value_t* next = v->next;
+            if (v->id >= 0 && v->id < values && v->op != IR_CONST
+                && sc->cells[v->id].state == SCCP_CONST)
+            {
+                // constants go after the phis
+                ir_value_t* at = v;
+                while (at->op == IR_PHI) at = at->next;
+                ir_value_t* c = ir_insert_before(at, IR_CONST, v->type, NULL, 0);
+                c->value = sc->cells[v->id].value;
+
+                // everything found constant is free of side effects
+                ir_replace_uses(v, c);
+                ir_remove(v);
+                folded++;
+            }
+            v = next;
+        }
+    }
+    return folded;
+}
+
+// a branch or switch with one successor reached becomes a jump there
+static int sccp_fold_branches(sccp_t* sc)
+{
+    int branches = 0;
+    for (int i = 0; i < sc->fn->block_count; i++)
+    {
+        ir_block_t* b = sc->fn->blocks[i];
+        ir_value_t* term = ir_terminator(b);
+        if (!sc->reached[b->id] || !term || (term->op != IR_BRANCH && term->op != IR_SWITCH)) continue;
+
+        ir_block_t* target = NULL;
+        int targets = 0;
+        for (int s = 0; s < b->succ_count; s++)
+        {
+            if (!sc->edges[sc->edge_start[b->id] + s] || b->succs[s] == target) continue;
+            target = b->succs[s];
+            targets++;
+        }
+        if (targets != 1) continue;
+
+        ir_set_jump(b, target);
+        branches++;
+    }
+    return branches;
+}
+
+// constants nothing uses any more, from folding or from the dead blocks
+static void sccp_drop_constants(ir_func_t* fn)
+{
+    for (int i = 0; i < fn->block_count; i++)
+    {
+        ir_value_t* v = fn->blocks[i]->first;
+        while (v)
+        {
+            ir_value_t* next = v->next;
+            if (v->op == IR_CONST && v->user_count == 0) ir_remove(v);
+            v = next;
+        }
+    }
+}
+
+sccp_stats_t sccp_run(ir_func_t* fn)
+{
+    sccp_stats_t stats = { 0, 0, 0 };
+    if (fn->block_count == 0) return stats;
+
+    int n = fn->block_count;
+    sccp_t sc = { .fn = fn };
+    sc.cells = sccp_malloc(sizeof(sccp_cell_t) * (fn->value_count + 1));
+    sc.reached = sccp_malloc(n);
+    sc.edge_start = sccp_malloc(sizeof(int) * (n + 1));
+    for (int i = 0; i < n; i++)
+        sc.edge_start[i + 1] = sc.edge_start[i] + fn->blocks[i]->succ_count;
+    sc.edges = sccp_malloc(sc.edge_start[n] + 1);
+
+    // a block is pushed once, when it is first reached
+    sc.blocks = sccp_malloc(sizeof(ir_block_t*) * n);
+
+    sccp_solve(&sc);
+
+    stats.folded = sccp_fold_values(&sc);
+    stats.branches = sccp_fold_branches(&sc);
+    stats.blocks = ir_remove_unreachable(fn);
+    ir_remove_trivial_phis(fn);
+    sccp_drop_constants(fn);
+
+    free(sc.cells);
+    free(sc.reached);
+    free(sc.edge_start);
+    free(sc.edges);
+    free(sc.blocks);
+    free(sc.values);
+    return stats;
+}
@@ -0,0 +1,303 @@
+#include "ssa.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+// the definition of var at the end of a block
+typedef struct
+{
+    int var;
+    int block;          // -1 when the slot is empty
+    ir_value_t* value;
+} ssa_def_t;
+
+// a phi placed in a block that was not sealed yet
+typedef struct
+{
+    int var;
+    ir_value_t* phi;
+    const type_t* type;
+    int next;           // next pending phi of the same block, -1 if last
+} ssa_pending_t;
+
+struct ssa_t
+{
+    ir_func_t* fn;
+
+    ssa_def_t* defs;            // open addressing, power of two
+    int def_count;
+    int def_capacity;
+
+    // by block id
+    unsigned char* sealed;
+    int* pending_head;
+    int block_capacity;
+
+    ssa_pending_t* pending;
+    int pending_count;
+    int pending_capacity;
+
+    // what a removed phi was replaced by, by value id
+    ir_value_t** forward;
+    int forward_capacity;
+
+    int phis;
+    int removed;
+};
+
+static void* ssa_realloc(void* m, size_t size)
+{
+    m = realloc(m, size ? size : 1);
+    if (!m) { fprintf(stderr, "Out of memory\n"); exit(1); }
+    return m;
+}
+
+ssa_t* ssa_create(ir_func_t* fn)
+{
+    ssa_t* ssa = ssa_realloc(NULL, sizeof(ssa_t));
+    memset(ssa, 0, sizeof(ssa_t));
+    ssa->fn = fn;
+
+    ssa->def_capacity = 256;
+    ssa->defs = ssa_realloc(NULL, sizeof(ssa_def_t) * ssa->def_capacity);
+    for (int i = 0; i < ssa->def_capacity; i++) ssa->defs[i].block = -1;
+    return ssa;
+}
+
+void ssa_destroy(ssa_t* ssa)
+{
+    if (!ssa) return;
+    free(ssa->defs);
+    free(ssa->sealed);
+    free(ssa->pending_head);
+    free(ssa->pending);
+    free(ssa->forward);
+    free(ssa);
+}
+
+// blocks are created while lowering, grow the per-block arrays to match
+static void ssa_reserve_blocks(ssa_t* ssa, int id)
+{
+    if (id < ssa->block_capacity) return;
+
+    int grown = ssa->block_capacity ? ssa->block_capacity : 64;
+    while (grown <= id) grown *= 2;
+    ssa->sealed = ssa_realloc(ssa->sealed, grown);
+    ssa->pending_head = ssa_realloc(ssa->pending_head, sizeof(int) * grown);
+    memset(ssa->sealed + ssa->block_capacity, 0, grown - ssa->block_capacity);
+    for (int i = ssa->block_capacity; i < grown; i++) ssa->pending_head[i] = -1;
+    ssa->block_capacity = grown;
+}
+
+int ssa_is_sealed(const ssa_t* ssa, const ir_block_t* b)
+{
+    return b->id < ssa->block_capacity && ssa->sealed[b->id];
+}
+
+/* ---------- current definitions ---------- */
+
+static unsigned int ssa_hash(int var, int block)
+{
+    unsigned int h = (unsigned int)var * 2654435761u;
+    return h ^ ((unsigned int)block * 40503u);
+}
+
+static ssa_def_t* ssa_slot(ssa_def_t* defs, int capacity, int var, int block)
+{
+    unsigned int mask = (unsigned int)capacity - 1;
+    unsigned int i = ssa_hash(var, block) & mask;
+    while (defs[i].block >= 0 && (defs[i].var != var || defs[i].block != block))
+        i = (i + 1) & mask;
+    return &defs[i];
+}
+
+// follow the phis removed since the value was recorded
+static ir_value_t* ssa_resolve(const ssa_t* ssa, ir_value_t* v)
+{
+    while (v && v->id >= 0 && v->id < ssa->forward_capacity && ssa->forward[v->id])
+        v = ssa->forward[v->id];
+    return v;
+}
+
+void ssa_write(ssa_t* ssa, int var, ir_block_t* b, ir_value_t* value)
+{
+    // keep the table at most half full
+    if ((ssa->def_count + 1) * 2 > ssa->def_capacity)
+    {
+        int capacity = ssa->def_capacity * 2;
+        ssa_def_t* defs = ssa_realloc(NULL, sizeof(ssa_def_t) * capacity);
+        for (int i = 0; i < capacity; i++) defs[i].block = -1;
+        for (int i = 0; i < ssa->def_capacity; i++)
+            if (ssa->defs[i].block >= 0)
+                *ssa_slot(defs, capacity, ssa->defs[i].var, ssa->defs[i].block) = ssa->defs[i];
+        free(ssa->defs);
+        ssa->defs = defs;
+        ssa->def_capacity = capacity;
+    }
+
+    ssa_def_t* slot = ssa_slot(ssa->defs, ssa->def_capacity, var, b->id);
+    if (slot->block < 0) ssa->def_count++;
+    slot->var = var;
+    slot->block = b->id;
+    slot->value = value;
+}
+
+static ir_value_t* ssa_lookup(const ssa_t* ssa, int var, const ir_block_t* b)
+{
+    ssa_def_t* slot = ssa_slot(ssa->defs, ssa->def_capacity, var, b->id);
+    return slot->block >= 0 ? ssa_resolve(ssa, slot->value) : NULL;
+}
+
+/* ---------- phis ---------- */
+
+// a read with no write on some path
+static ir_value_t* ssa_undef(ssa_t* ssa, const type_t* type)
+{
+    ir_block_t* entry = ssa->fn->blocks[0];
+    if (entry->first) return ir_insert_before(entry->first, IR_UNDEF, type, NULL, 0);
+    return ir_emit(entry, IR_UNDEF, type, NULL, 0);
+}
+
+static void ssa_forward(ssa_t* ssa, ir_value_t* phi, ir_value_t* value)
+{
+    if (phi->id >= ssa->forward_capacity)
+    {
+        int grown = ssa->forward_capacity ? ssa->forward_capacity : 64;
+        while (grown <= phi->id) grown *= 2;
+        ssa->forward = ssa_realloc(ssa->forward, sizeof(ir_value_t*) * grown);
+        memset(ssa->forward + ssa->forward_capacity, 0, sizeof(ir_value_t*) * (grown - ssa->forward_capacity));
+        ssa->forward_capacity = grown;
+    }
+    ssa->forward[phi->id] = value;
+}
+
+static int ssa_is_removed(const ssa_t* ssa, const ir_value_t* v)
+{
+    return v->id >= 0 && v->id < ssa->forward_capacity && ssa->forward[v->id];
+}
+
+// replace phi by its only operand other than itself, if it has one
+static ir_value_t* ssa_try_remove(ssa_t* ssa, ir_value_t* phi)
+{
+    // an incomplete phi has not seen all its operands
+    if (!ssa_is_sealed(ssa, phi->block)) return phi;
+
+    ir_value_t* same = NULL;
+    for (int i = 0; i < phi->operand_count; i++)
+    {
+        ir_value_t* op = phi->operands[i];
+        if (op == same || op == phi) continue;
+        if (same) return phi;   // merges two values
+        same = op;
+    }
+    if (!same) same = ssa_undef(ssa, phi->type);
+
+    // the phis using this one may become trivial in turn
+    int count = 0;
+    ir_value_t** users = ssa_realloc(NULL, sizeof(ir_value_t*) * (phi->user_count + 1));
+    for (int i = 0; i < phi->user_count; i++)
+        if (phi->users[i] != phi && phi->users[i]->op == IR_PHI) users[count++] = phi->users[i];
+
+    ir_replace_uses(phi, same);
+    ir_remove(phi);
+    ssa_forward(ssa, phi, same);
+    ssa->removed++;
+
+    for (int i = 0; i < count; i++)
+        if (!ssa_is_removed(ssa, users[i])) ssa_try_remove(ssa, users[i]);
+    free(users);
+
+    return ssa_resolve(ssa, same);
+}
+
+static ir_value_t* ssa_add_operands(ssa_t* ssa, int var, ir_value_t* phi, const type_t* type)
+{
+    ir_block_t* b = phi->block;
+    for (int i = 0; i < b->pred_count; i++)
+        ir_phi_add(phi, ssa_read(ssa, var, b->preds[i], type));
+    return ssa_try_remove(ssa, phi);
+}
+
+static ir_value_t* ssa_new_phi(ssa_t* ssa, ir_block_t* b, const type_t* type)
+{
+    ssa->phis++;
+    return ir_phi(b, type);
+}
+
+ir_value_t* ssa_read(ssa_t* ssa, int var, ir_block_t* b, const type_t* type)
+{
+    ssa_reserve_blocks(ssa, b->id);
+
+    // single predecessors are walked, not recursed into, so long chains of
+    // blocks cost no stack
+    ir_block_t* start = b;
+    ir_value_t* v;
+    for (;;)
+    {
+        v = ssa_lookup(ssa, var, b);
+        if (v) break;
+
+        if (!ssa_is_sealed(ssa, b))
+        {
+            v = ssa_new_phi(ssa, b, type);
+            if (ssa->pending_count == ssa->pending_capacity)
+            {
+                ssa->pending_capacity = ssa->pending_capacity ? ssa->pending_capacity * 2 : 16;
+                ssa->pending = ssa_realloc(ssa->pending, sizeof(ssa_pending_t) * ssa->pending_capacity);
+            }
+            ssa->pending[ssa->pending_count] = (ssa_pending_t){ var, v, type, ssa->pending_head[b->id] };
+            ssa->pending_head[b->id] = ssa->pending_count++;
+            break;
+        }
+        if (b->pred_count == 1)
+        {
+            b = b->preds[0];
+            ssa_reserve_blocks(ssa, b->id);
+            continue;
+        }
+        if (b->pred_count == 0)
+        {
+            v = ssa_undef(ssa, type);
+            break;
+        }
+
+        // the phi is recorded first so a loop back to b finds it
+        ir_value_t* phi = ssa_new_phi(ssa, b, type);
+        ssa_write(ssa, var, b, phi);
+        v = ssa_add_operands(ssa, var, phi, type);
+        break;
+    }
+
+    v = ssa_resolve(ssa, v);
+    for (ir_block_t* c = start; c != b; c = c->preds[0])
+        ssa_write(ssa, var, c, v);
+    ssa_write(ssa, var, b, v);
+    return v;
+}
+
+void ssa_seal(ssa_t* ssa, ir_block_t* b)
+{
+    ssa_reserve_blocks(ssa, b->id);
+    if (ssa->sealed[b->id]) return;
+    ssa->sealed[b->id] = 1;
+
+    for (int i = ssa->pending_head[b->id]; i >= 0; i = ssa->pending[i].next)
+    {
+        ssa_pending_t p = ssa->pending[i];
+        ir_value_t* value = ssa_add_operands(ssa, p.var, p.phi, p.type);
+
+        // a read may have recorded the phi further down already
+        if (value != p.phi) ssa_write(ssa, p.var, b, value);
+    }
+    ssa->pending_head[b->id] = -1;
+}
+
+int ssa_phi_count(const ssa_t* ssa)
+{
+    return ssa ? ssa->phis : 0;
+}
+
+int ssa_removed_count(const ssa_t* ssa)
+{
+    return ssa ? ssa->removed : 0;
+}
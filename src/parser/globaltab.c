@@ -0,0 +1,140 @@
+#include "globaltab.h"
+#include "symtab.h"
+
+#include <stdlib.h>
+#include <stdio.h>
+
+static unsigned int globaltab_hash(name_id_t name)
+{
+    return name * 2654435761u;
+}
+
+static globaltab_t* globaltab_build(scope_t* scope)
+{
+    globaltab_t* globals = calloc(1, sizeof(globaltab_t));
+    if (!globals)
+    {
+        fprintf(stderr, "Error: Failed to allocate global table\n");
+        exit(1);
+    }
+
+    // load factor at most 1/2
+    unsigned int capacity = 16;
+    while (capacity < (unsigned int)scope->symbol_count * 2) capacity *= 2;
+
+    globals->slots = calloc(capacity, sizeof(globaltab_slot_t));
+    if (!globals->slots)
+    {
+        fprintf(stderr, "Error: Failed to allocate global table\n");
+        exit(1);
+    }
+    globals->mask = capacity - 1;
+
+    for (int i = 0; i < scope->symbol_count; i++)
+    {
+        sym_entry_t* sym = scope->symbols[i];
+        if (!sym || sym->name == NAME_NONE) continue;
+
+        unsigned int j = globaltab_hash(sym->name) & globals->mask;
+        while (globals->slots[j].name != NAME_NONE && globals->slots[j].name != sym->name)
+            j = (j + 1) & globals->mask;
+
+        // first declaration wins, like the live table
+        if (globals->slots[j].name == NAME_NONE)
+        {
+            globals->slots[j].name = sym->name;
+            globals->slots[j].symbol = sym;
+            globals->count++;
+        }
+    }
+    return globals;
+}
+
+const globaltab_t* symtab_freeze_globals(symtab_t* table)
+{
+    if (!table || !table->global_scope) return NULL;
+
+    const globaltab_t* published = symtab_globals(table);
+    if (published) return published;
+
+    globaltab_t* globals = globaltab_build(table->global_scope);
+    __atomic_store_n(&table->globals, globals, __ATOMIC_RELEASE);
+    return globals;
+}
+
+const globaltab_t* symtab_globals(symtab_t* table)
+{
+    return table ? __atomic_load_n(&table->globals, __ATOMIC_ACQUIRE) : NULL;
+}
+
+const sym_entry_t* globaltab_lookup(const globaltab_t* globals, name_id_t name)
+{
+    if (!globals || name == NAME_NONE) return NULL;
+
+    unsigned int j = globaltab_hash(name) & globals->mask;
+    while (globals->slots[j].name != NAME_NONE)
+    {
+        if (globals->slots[j].name == name) return globals->slots[j].symbol;
+        j = (j + 1) & globals->mask;
+    }
+    return NULL;
+}
+
+void globaltab_destroy(globaltab_t* globals)
+{
+    if (!globals) return;
+    free(globals->slots);
+    free(globals);
+}
+
+void local_scopes_init(local_scopes_t* scopes, const globaltab_t* globals)
+{
+    scopes->globals = globals;
+    symmap_init(&scopes->locals);
+    scopes->marks = NULL;
+    scopes->depth = 0;
+    scopes->capacity = 0;
+}
+
+void local_scopes_free(local_scopes_t* scopes)
+{
+    symmap_free(&scopes->locals);
+    free(scopes->marks);
+    scopes->marks = NULL;
+    scopes->depth = 0;
+    scopes->capacity = 0;
+}
+
+// no depth limit, so every exit has the mark of its own entry
+void local_scopes_enter(local_scopes_t* scopes)
+{
+    if (scopes->depth == scopes->capacity)
+    {
+        scopes->capacity = scopes->capacity ? scopes->capacity * 2 : MAX_DEPTH;
+        scopes->marks = realloc(scopes->marks, sizeof(int) * scopes->capacity);
+        if (!scopes->marks)
+        {
+            fprintf(stderr, "Error: Failed to grow scope stack\n");
+            exit(1);
+        }
+    }
+    scopes->marks[scopes->depth++] = symmap_mark(&scopes->locals);
+}
+
+void local_scopes_exit(local_scopes_t* scopes)
+{
+    if (scopes->depth == 0) return;
+    symmap_unwind(&scopes->locals, scopes->marks[--scopes->depth]);
+}
+
+void local_scopes_bind(local_scopes_t* scopes, sym_entry_t* symbol)
+{
+    symmap_push(&scopes->locals, symbol);
+}
+
+const sym_entry_t* local_scopes_lookup(local_scopes_t* scopes, name_id_t name)
+{
+    sym_entry_t* sym = symmap_lookup(&scopes->locals, name);
+    if (sym) return sym;
+    return globaltab_lookup(scopes->globals, name);
+}
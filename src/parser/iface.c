@@ -0,0 +1,656 @@
+#define _POSIX_C_SOURCE 200809L     // mmap under -std=c99
+
+#include "iface.h"
+#include "symtab.h"
+#include "intern.h"
+#include "types.h"
+
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#define IFACE_MAGIC   0x46494e50u   // "PNIF"
+#define IFACE_VERSION 2
+
+typedef struct
+{
+    unsigned int magic;
+    unsigned int version;
+    unsigned int symbol_count;
+    unsigned int bucket_count;      // power of two
+    unsigned int type_count;
+    unsigned int member_count;
+    unsigned int records_offset;
+    unsigned int buckets_offset;
+    unsigned int types_offset;
+    unsigned int members_offset;
+    unsigned int strings_offset;
+    unsigned int strings_size;
+} iface_header_t;
+
+typedef struct
+{
+    unsigned int name;              // offset into the string table
+    unsigned int hash;
+    unsigned char symbol_type;      // symbol_t
+    unsigned char type;             // datatype_t
+    unsigned short name_length;
+    int line;
+    int param_count;                // functions
+    int extra;                      // is_constant for variables, size for arrays
+    unsigned int full_type;         // index + 1 into the type table, 0 if unknown
+} iface_record_t;
+
+// One entry of the type table, see types.h. The parts of a structural
+// type come before it, so the table is rebuilt in one pass; a struct or
+// union is entered before its fields, which may name it again.
+typedef struct
+{
+    unsigned int kind;              // type_kind_t
+    int length;                     // array and str length, -1 if unsized
+    unsigned int elem;              // index + 1: element, or a function's result
+    unsigned int name;              // string offset of a struct, enum or union name
+    unsigned int first;             // parameters or fields, in the member table
+    unsigned int count;
+} iface_type_t;
+
+typedef struct
+{
+    unsigned int name;              // string offset of a field name, 0 for a parameter
+    unsigned int type;              // index + 1
+} iface_member_t;
+
+struct iface_module_t
+{
+    void* map;
+    size_t size;
+    const iface_header_t* header;
+    const iface_record_t* records;
+    const unsigned int* buckets;
+    const iface_type_t* type_entries;
+    const iface_member_t* members;
+    const char* strings;
+    const type_t** types;           // the type table, rebuilt when opened
+};
+
+static unsigned int iface_hash(const char* name, size_t len)
+{
+    unsigned int h = 2166136261u;
+    for (size_t i = 0; i < len; i++)
+    {
+        h ^= (unsigned char)name[i];
+        h *= 16777619u;
+    }
+    return h;
+}
+
+// the symbols an interface holds
+static int iface_exported_kind(unsigned int symbol_type)
+{
+    switch (symbol_type)
+    {
+        case SYM_FUNCTION:
+        case SYM_CONSTANT:
+        case SYM_VARIABLE:
+        case SYM_ARRAY:
+        case SYM_STRUCT:
+        case SYM_ENUM:
+        case SYM_UNION:
+            return 1;
+        default:
+            return 0;
+    }
+}
+
+static int iface_exports(sym_entry_t* sym)
+{
+    return !sym->imported && iface_exported_kind(sym->symbol_type);
+}
+
+/* ---------- writing ---------- */
+
+typedef struct
+{
+    char* strings;
+    size_t strings_used;
+    size_t strings_capacity;
+
+    iface_type_t* types;
+    unsigned int type_count;
+    unsigned int type_capacity;
+
+    iface_member_t* members;
+    unsigned int member_count;
+    unsigned int member_capacity;
+
+    unsigned int* index;            // by type_t.id, table index + 1
+    unsigned int index_size;
+} iface_builder_t;
+
+// grown to at least needed items, the new ones zeroed
+static void* iface_grow(void* items, unsigned int* capacity, unsigned int needed, size_t size)
+{
+    if (needed <= *capacity) return items;
+
+    unsigned int grown = *capacity ? *capacity : 16;
+    while (grown < needed) grown *= 2;
+    items = realloc(items, size * grown);
+    if (!items)
+    {
+        fprintf(stderr, "Error: Out of memory writing interface\n");
+        exit(1);
+    }
+    memset((char*)items + size * *capacity, 0, size * (grown - *capacity));
+    *capacity = grown;
+    return items;
+}
+
+static unsigned int iface_add_string(iface_builder_t* b, const char* str)
+{
+    size_t len = strlen(str) + 1;
+    if (b->strings_used + len > b->strings_capacity)
+    {
+        size_t grown = b->strings_capacity ? b->strings_capacity : 256;
+        while (grown < b->strings_used + len) grown *= 2;
+        b->strings = realloc(b->strings, grown);
+        if (!b->strings)
+        {
+            fprintf(stderr, "Error: Out of memory writing interface\n");
+            exit(1);
+        }
+        b->strings_capacity = grown;
+    }
+
+    unsigned int offset = (unsigned int)b->strings_used;
+    memcpy(b->strings + offset, str, len);
+    b->strings_used += len;
+    return offset;
+}
+
+static unsigned int iface_new_type(iface_builder_t* b, const type_t* type)
+{
+    b->types = iface_grow(b->types, &b->type_capacity, b->type_count + 1, sizeof(iface_type_t));
+    iface_type_t* entry = &b->types[b->type_count++];
+    memset(entry, 0, sizeof(iface_type_t));
+    entry->kind = type->kind;
+    entry->length = type->length;
+
+    if (type->id >= b->index_size)
+    {
+        b->index = iface_grow(b->index, &b->index_size, type->id + 1, sizeof(unsigned int));
+    }
+    b->index[type->id] = b->type_count;
+    return b->type_count;
+}
+
+static void iface_add_members(iface_builder_t* b, unsigned int entry, const unsigned int* names,
+                              const unsigned int* types, int count)
+{
+    b->members = iface_grow(b->members, &b->member_capacity, b->member_count + count, sizeof(iface_member_t));
+    b->types[entry - 1].first = b->member_count;
+    b->types[entry - 1].count = (unsigned int)count;
+    for (int i = 0; i < count; i++)
+    {
+        b->members[b->member_count].name = names ? names[i] : 0;
+        b->members[b->member_count++].type = types[i];
+    }
+}
+
+// the table index + 1 of type, entering it and its parts as needed
+static unsigned int iface_add_type(iface_builder_t* b, const type_t* type)
+{
+    if (!type) return 0;
+    if (type->id < b->index_size && b->index[type->id]) return b->index[type->id];
+
+    // a struct or union first, so a field can refer back to it
+    if (type->kind == TY_STRUCT || type->kind == TY_ENUM || type->kind == TY_UNION)
+    {
+        unsigned int entry = iface_new_type(b, type);
+        b->types[entry - 1].name = iface_add_string(b, intern_str(type->name));
+        if (type->field_count == 0) return entry;
+
+        unsigned int* names = malloc(sizeof(unsigned int) * type->field_count);
+        unsigned int* types = malloc(sizeof(unsigned int) * type->field_count);
+        if (!names || !types)
+        {
+            fprintf(stderr, "Error: Out of memory writing interface\n");
+            exit(1);
+        }
+        for (int i = 0; i < type->field_count; i++)
+        {
+            names[i] = iface_add_string(b, intern_str(type->fields[i].name));
+            types[i] = iface_add_type(b, type->fields[i].type);
+        }
+        iface_add_members(b, entry, names, types, type->field_count);
+        free(names);
+        free(types);
+        return entry;
+    }
+
+    unsigned int elem = iface_add_type(b, type->elem);
+    unsigned int* params = malloc(sizeof(unsigned int) * (type->param_count + 1));
+    if (!params)
+    {
+        fprintf(stderr, "Error: Out of memory writing interface\n");
+        exit(1);
+    }
+    for (int i = 0; i < type->param_count; i++)
+        params[i] = iface_add_type(b, type->params[i]);
+
+    unsigned int entry = iface_new_type(b, type);
+    b->types[entry - 1].elem = elem;
+    if (type->kind == TY_FN) iface_add_members(b, entry, NULL, params, type->param_count);
+    free(params);
+    return entry;
+}
+
+// the checked type of an exported symbol, NULL if analysis left none
+static const type_t* iface_symbol_full_type(symtab_t* table, sym_entry_t* sym)
+{
+    switch (sym->symbol_type)
+    {
+        case SYM_STRUCT: return type_named(TY_STRUCT, sym->name);
+        case SYM_ENUM:   return type_named(TY_ENUM, sym->name);
+        case SYM_UNION:  return type_named(TY_UNION, sym->name);
+        default:
+            if (!table->types || sym->index >= table->type_count) return NULL;
+            return table->types[sym->index];
+    }
+}
+
+int iface_write(symtab_t* table, const char* path)
+{
+    if (!table || !table->global_scope || !path) return -1;
+
+    scope_t* global = table->global_scope;
+    int capacity = global->symbol_count ? global->symbol_count : 1;
+
+    iface_record_t* records = calloc(capacity, sizeof(iface_record_t));
+    unsigned int bucket_count = 16;
+    while (bucket_count < (unsigned int)capacity * 2) bucket_count *= 2;
+    unsigned int* buckets = calloc(bucket_count, sizeof(unsigned int));
+
+    if (!records || !buckets)
+    {
+        fprintf(stderr, "Error: Out of memory writing interface '%s'\n", path);
+        free(records); free(buckets);
+        return -1;
+    }
+
+    iface_builder_t builder;
+    memset(&builder, 0, sizeof(builder));
+
+    unsigned int count = 0;
+    for (int i = 0; i < global->symbol_count; i++)
+    {
+        sym_entry_t* sym = global->symbols[i];
+        if (!iface_exports(sym)) continue;
+
+        const char* name = sym_name(sym);
+        size_t len = strlen(name);
+        unsigned int hash = iface_hash(name, len);
+
+        // first declaration of a name wins
+        unsigned int b = hash & (bucket_count - 1);
+        int duplicate = 0;
+        while (buckets[b] != 0)
+        {
+            const iface_record_t* other = &records[buckets[b] - 1];
+            if (other->hash == hash && other->name_length == len
+                && memcmp(builder.strings + other->name, name, len) == 0)
+            {
+                duplicate = 1;
+                break;
+            }
+            b = (b + 1) & (bucket_count - 1);
+        }
+        if (duplicate) continue;
+
+        iface_record_t* rec = &records[count];
+        rec->name = iface_add_string(&builder, name);
+        rec->hash = hash;
+        rec->symbol_type = (unsigned char)sym->symbol_type;
+        rec->type = (unsigned char)sym->type;
+        rec->name_length = (unsigned short)len;
+        rec->line = sym->line;
+        if (sym->symbol_type == SYM_FUNCTION)
+            rec->param_count = sym->info.func.param_count;
+        else if (sym->symbol_type == SYM_ARRAY)
+            rec->extra = sym->info.array.size;
+        else if (sym->symbol_type == SYM_VARIABLE || sym->symbol_type == SYM_CONSTANT)
+            rec->extra = sym->info.var.is_constant;
+        rec->full_type = iface_add_type(&builder, iface_symbol_full_type(table, sym));
+
+        buckets[b] = ++count;
+    }
+
+    iface_header_t header;
+    header.magic = IFACE_MAGIC;
+    header.version = IFACE_VERSION;
+    header.symbol_count = count;
+    header.bucket_count = bucket_count;
+    header.type_count = builder.type_count;
+    header.member_count = builder.member_count;
+    header.records_offset = sizeof(iface_header_t);
+    header.buckets_offset = header.records_offset + count * sizeof(iface_record_t);
+    header.types_offset = header.buckets_offset + bucket_count * sizeof(unsigned int);
+    header.members_offset = header.types_offset + builder.type_count * sizeof(iface_type_t);
+    header.strings_offset = header.members_offset + builder.member_count * sizeof(iface_member_t);
+    header.strings_size = (unsigned int)builder.strings_used;
+
+    int ok = 0;
+    FILE* file = fopen(path, "wb");
+    if (file)
+    {
+        ok = fwrite(&header, sizeof(header), 1, file) == 1
+          && fwrite(records, sizeof(iface_record_t), count, file) == count
+          && fwrite(buckets, sizeof(unsigned int), bucket_count, file) == bucket_count
+          && fwrite(builder.types, sizeof(iface_type_t), builder.type_count, file) == builder.type_count
+          && fwrite(builder.members, sizeof(iface_member_t), builder.member_count, file) == builder.member_count
+          && fwrite(builder.strings, 1, builder.strings_used, file) == builder.strings_used;
+        ok = fclose(file) == 0 && ok;
+    }
+    if (!ok)
+        fprintf(stderr, "Error: Could not write interface '%s'\n", path);
+
+    free(records);
+    free(buckets);
+    free(builder.strings);
+    free(builder.types);
+    free(builder.members);
+    free(builder.index);
+    return ok ? 0 : -1;
+}
+
+/* ---------- reading ---------- */
+
+// a NUL-terminated string inside the table, NULL if offset is out of it
+static const char* iface_string(const iface_module_t* module, unsigned int offset)
+{
+    size_t size = module->header->strings_size;
+    if (offset >= size) return NULL;
+    if (!memchr(module->strings + offset, '\0', size - offset)) return NULL;
+    return module->strings + offset;
+}
+
+// Rebuild the type table through the constructors, so imported types are
+// the very objects the importer builds for the same types. Returns 0 if
+// an entry is malformed.
+static int iface_read_types(iface_module_t* module)
+{
+    const iface_header_t* h = module->header;
+    module->types = calloc(h->type_count + 1, sizeof(const type_t*));
+    if (!module->types) return 0;
+
+    for (unsigned int i = 0; i < h->type_count; i++)
+    {
+        const iface_type_t* t = &module->type_entries[i];
+        if (t->kind > TY_UNION) return 0;
+        if (t->count > h->member_count || t->first > h->member_count - t->count) return 0;
+
+        // the parts of a structural type are entered before it
+        const type_t* elem = NULL;
+        if (t->kind == TY_ARRAY || t->kind == TY_VEC || t->kind == TY_RANGE || t->kind == TY_FN)
+        {
+            if (t->elem > i || (t->elem == 0 && t->kind != TY_FN)) return 0;
+            if (t->elem) elem = module->types[t->elem - 1];
+        }
+
+        switch (t->kind)
+        {
+            case TY_STR:    module->types[i] = type_str(t->length); break;
+            case TY_ARRAY:  module->types[i] = type_array(elem, t->length); break;
+            case TY_VEC:    module->types[i] = type_vec(elem); break;
+            case TY_RANGE:  module->types[i] = type_range(elem); break;
+            case TY_FN:
+            {
+                const type_t** params = calloc(t->count + 1, sizeof(const type_t*));
+                if (!params) return 0;
+                for (unsigned int p = 0; p < t->count; p++)
+                {
+                    unsigned int type = module->members[t->first + p].type;
+                    if (type == 0 || type > i)
+                    {
+                        free(params);
+                        return 0;
+                    }
+                    params[p] = module->types[type - 1];
+                }
+                module->types[i] = type_fn(elem, params, (int)t->count);
+                free(params);
+                break;
+            }
+            case TY_STRUCT:
+            case TY_ENUM:
+            case TY_UNION:
+            {
+                const char* name = iface_string(module, t->name);
+                if (!name) return 0;
+                module->types[i] = type_named((type_kind_t)t->kind, intern(name));
+                break;
+            }
+            default:
+                module->types[i] = type_prim((type_kind_t)t->kind);
+                break;
+        }
+    }
+
+    // fields may name any type, so they are checked once all exist
+    for (unsigned int i = 0; i < h->type_count; i++)
+    {
+        const iface_type_t* t = &module->type_entries[i];
+        if (t->kind != TY_STRUCT && t->kind != TY_UNION) continue;
+        for (unsigned int f = 0; f < t->count; f++)
+        {
+            const iface_member_t* m = &module->members[t->first + f];
+            if (m->type == 0 || m->type > h->type_count || !iface_string(module, m->name)) return 0;
+        }
+    }
+    return 1;
+}
+
+// every record and bucket points inside the file and holds a symbol this
+// compiler exports, so lookups can trust them. Returns 0 if one does not.
+static int iface_check_records(const iface_module_t* module)
+{
+    const iface_header_t* h = module->header;
+
+    for (unsigned int i = 0; i < h->symbol_count; i++)
+    {
+        const iface_record_t* rec = &module->records[i];
+        if (!iface_exported_kind(rec->symbol_type) || rec->type > TYPE_UNKNOWN) return 0;
+        if ((size_t)rec->name + rec->name_length >= h->strings_size) return 0;
+        if (module->strings[rec->name + rec->name_length] != '\0') return 0;
+        if (rec->full_type > h->type_count) return 0;
+        if (rec->symbol_type == SYM_FUNCTION && rec->param_count < 0) return 0;
+    }
+
+    for (unsigned int b = 0; b < h->bucket_count; b++)
+        if (module->buckets[b] > h->symbol_count) return 0;
+    return 1;
+}
+
+// give an imported struct or union its fields, unless it has them already
+static void iface_set_fields(const iface_module_t* module, unsigned int full_type)
+{
+    const iface_type_t* t = &module->type_entries[full_type - 1];
+    if (t->count == 0 || (t->kind != TY_STRUCT && t->kind != TY_UNION)) return;
+
+    type_field_t* fields = malloc(sizeof(type_field_t) * t->count);
+    if (!fields) return;
+    for (unsigned int f = 0; f < t->count; f++)
+    {
+        const iface_member_t* m = &module->members[t->first + f];
+        fields[f].name = intern(iface_string(module, m->name));
+        fields[f].type = module->types[m->type - 1];
+    }
+    type_set_fields(module->types[full_type - 1], fields, (int)t->count);
+    free(fields);
+}
+
+iface_module_t* iface_open(const char* path)
+{
+    int fd = open(path, O_RDONLY);
+    if (fd < 0) return NULL;
+
+    struct stat st;
+    if (fstat(fd, &st) != 0 || (size_t)st.st_size < sizeof(iface_header_t))
+    {
+        close(fd);
+        return NULL;
+    }
+
+    size_t size = (size_t)st.st_size;
+    void* map = mmap(NULL, size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (map == MAP_FAILED) return NULL;
+
+    // check every section lies inside the file before trusting offsets
+    const iface_header_t* h = map;
+    int valid = h->magic == IFACE_MAGIC
+        && h->version == IFACE_VERSION
+        && h->bucket_count != 0
+        && (h->bucket_count & (h->bucket_count - 1)) == 0
+        && h->symbol_count < h->bucket_count
+        && h->records_offset == sizeof(iface_header_t)
+        && h->buckets_offset == h->records_offset + (size_t)h->symbol_count * sizeof(iface_record_t)
+        && h->types_offset == h->buckets_offset + (size_t)h->bucket_count * sizeof(unsigned int)
+        && h->members_offset == h->types_offset + (size_t)h->type_count * sizeof(iface_type_t)
+        && h->strings_offset == h->members_offset + (size_t)h->member_count * sizeof(iface_member_t)
+        && (size_t)h->strings_offset + h->strings_size <= size;
+    if (!valid)
+    {
+        munmap(map, size);
+        return NULL;
+    }
+
+    iface_module_t* module = malloc(sizeof(iface_module_t));
+    if (!module)
+    {
+        munmap(map, size);
+        return NULL;
+    }
+
+    module->map = map;
+    module->size = size;
+    module->header = h;
+    module->records = (const iface_record_t*)((const char*)map + h->records_offset);
+    module->buckets = (const unsigned int*)((const char*)map + h->buckets_offset);
+    module->type_entries = (const iface_type_t*)((const char*)map + h->types_offset);
+    module->members = (const iface_member_t*)((const char*)map + h->members_offset);
+    module->strings = (const char*)map + h->strings_offset;
+    module->types = NULL;
+
+    if (!iface_check_records(module) || !iface_read_types(module))
+    {
+        iface_close(module);
+        return NULL;
+    }
+    return module;
+}
+
+void iface_close(iface_module_t* module)
+{
+    if (!module) return;
+    munmap(module->map, module->size);
+    free(module->types);
+    free(module);
+}
+
+int iface_symbol_count(const iface_module_t* module)
+{
+    return module ? (int)module->header->symbol_count : 0;
+}
+
+static const iface_record_t* iface_lookup(const iface_module_t* module, const char* name, size_t len)
+{
+    const iface_header_t* h = module->header;
+    unsigned int hash = iface_hash(name, len);
+    unsigned int mask = h->bucket_count - 1;
+
+    // records and buckets were checked by iface_open; a damaged file may
+    // have no empty bucket, so the probe stops after visiting them all
+    unsigned int b = hash & mask;
+    for (unsigned int probe = 0; probe < h->bucket_count && module->buckets[b] != 0; probe++)
+    {
+        const iface_record_t* rec = &module->records[module->buckets[b] - 1];
+        if (rec->hash == hash && rec->name_length == len
+            && memcmp(module->strings + rec->name, name, len) == 0) return rec;
+        b = (b + 1) & mask;
+    }
+    return NULL;
+}
+
+int symtab_import(symtab_t* table, const char* path)
+{
+    if (!table || !path) return -1;
+
+    iface_module_t* module = iface_open(path);
+    if (!module) return -1;
+
+    iface_module_t** imports = realloc(table->imports, sizeof(iface_module_t*) * (table->import_count + 1));
+    if (!imports)
+    {
+        iface_close(module);
+        return -1;
+    }
+    table->imports = imports;
+    table->imports[table->import_count++] = module;
+    return 0;
+}
+
+sym_entry_t* iface_resolve(symtab_t* table, name_id_t name)
+{
+    if (!table || name == NAME_NONE) return NULL;
+
+    const char* str = intern_str(name);
+    size_t len = strlen(str);
+
+    for (int i = 0; i < table->import_count; i++)
+    {
+        const iface_record_t* rec = iface_lookup(table->imports[i], str, len);
+        if (!rec) continue;
+
+        sym_entry_t* sym = sym_create(table, str, rec->symbol_type, rec->type, rec->line);
+        if (!sym) return NULL;
+
+        sym->imported = 1;
+        if (rec->full_type) iface_set_fields(table->imports[i], rec->full_type);
+        if (rec->symbol_type == SYM_FUNCTION)
+        {
+            sym->info.func.param_count = rec->param_count;
+            sym->info.func.is_defined = 1;
+        }
+        else if (rec->symbol_type == SYM_ARRAY)
+        {
+            sym->info.array.size = rec->extra;
+        }
+        else if (rec->symbol_type == SYM_VARIABLE || rec->symbol_type == SYM_CONSTANT)
+        {
+            sym->info.var.is_constant = rec->extra;
+        }
+        return symtab_insert_global(table, sym);
+    }
+    return NULL;
+}
+
+const type_t* iface_symbol_type(symtab_t* table, const sym_entry_t* sym)
+{
+    if (!table || !sym || !sym->imported) return NULL;
+
+    const char* str = intern_str(sym->name);
+    size_t len = strlen(str);
+
+    // the module iface_resolve took it from, the first that exports it
+    for (int i = 0; i < table->import_count; i++)
+    {
+        const iface_record_t* rec = iface_lookup(table->imports[i], str, len);
+        if (!rec) continue;
+        return rec->full_type ? table->imports[i]->types[rec->full_type - 1] : NULL;
+    }
+    return NULL;
+}
@@ -0,0 +1,215 @@
+#define _POSIX_C_SOURCE 200809L     // pthread_rwlock_t under -std=c99
+
+#include "intern.h"
+
+#include <pthread.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+
+#define INTERN_BLOCK_SIZE   (64 * 1024)
+#define INTERN_INITIAL_SLOTS 256
+#define INTERN_PAGE_SHIFT   10
+#define INTERN_PAGE_SIZE    (1 << INTERN_PAGE_SHIFT)
+#define INTERN_MAX_PAGES    4096    // 4M names
+
+typedef struct intern_block_t intern_block_t;
+
+// strings are packed into big blocks so they never move
+struct intern_block_t
+{
+    intern_block_t* next;
+    size_t used;
+    size_t size;
+    char data[];
+};
+
+typedef struct
+{
+    const char* string;
+    unsigned int hash;
+} intern_name_t;
+
+// Thread safety: ids map to fixed-size pages that never move, and count
+// is published with release ordering after the entry is written, so
+// intern_str needs no lock. The probe table is guarded by a rwlock:
+// lookups share it, inserting a new name takes it exclusively.
+typedef struct
+{
+    intern_name_t* pages[INTERN_MAX_PAGES];  // id -> name
+    name_id_t count;
+
+    name_id_t* slots;       // open addressing, NAME_NONE marks empty
+    size_t slot_capacity;
+
+    intern_block_t* blocks;
+    pthread_rwlock_t lock;
+} intern_table_t;
+
+static intern_table_t table = { .lock = PTHREAD_RWLOCK_INITIALIZER };
+static pthread_once_t table_once = PTHREAD_ONCE_INIT;
+
+static unsigned int intern_hash(const char* name, size_t len)
+{
+    unsigned int h = 2166136261u;
+    for (size_t i = 0; i < len; i++)
+    {
+        h ^= (unsigned char)name[i];
+        h *= 16777619u;
+    }
+    return h;
+}
+
+static void* intern_alloc(size_t size)
+{
+    void* m = calloc(1, size);
+    if (!m) { fprintf(stderr, "Out of memory\n"); exit(1); }
+    return m;
+}
+
+static intern_name_t* intern_entry(name_id_t id)
+{
+    return &table.pages[id >> INTERN_PAGE_SHIFT][id & (INTERN_PAGE_SIZE - 1)];
+}
+
+static void intern_init(void)
+{
+    table.pages[0] = intern_alloc(sizeof(intern_name_t) * INTERN_PAGE_SIZE);
+    table.pages[0][0].string = "";
+    table.slot_capacity = INTERN_INITIAL_SLOTS;
+    table.slots = intern_alloc(sizeof(name_id_t) * table.slot_capacity);
+
+    __atomic_store_n(&table.count, 1, __ATOMIC_RELEASE);    // id 0 is NAME_NONE
+}
+
+static const char* intern_copy(const char* name, size_t len)
+{
+    intern_block_t* b = table.blocks;
+    if (!b || b->used + len + 1 > b->size)
+    {
+        size_t size = len + 1 > INTERN_BLOCK_SIZE ? len + 1 : INTERN_BLOCK_SIZE;
+        b = intern_alloc(sizeof(intern_block_t) + size);
+        b->size = size;
+        b->next = table.blocks;
+        table.blocks = b;
+    }
+
+    char* s = b->data + b->used;
+    memcpy(s, name, len);
+    s[len] = '\0';
+    b->used += len + 1;
+    return s;
+}
+
+static size_t intern_probe(const char* name, size_t len, unsigned int hash)
+{
+    size_t mask = table.slot_capacity - 1;
+    size_t i = hash & mask;
+
+    while (table.slots[i] != NAME_NONE)
+    {
+        intern_name_t* e = intern_entry(table.slots[i]);
+        if (e->hash == hash
+            && strncmp(e->string, name, len) == 0
+            && e->string[len] == '\0')
+            return i;
+        i = (i + 1) & mask;
+    }
+    return i;
+}
+
+static void intern_grow_slots(void)
+{
+    name_id_t* old = table.slots;
+    size_t old_capacity = table.slot_capacity;
+
+    table.slot_capacity *= 2;
+    table.slots = intern_alloc(sizeof(name_id_t) * table.slot_capacity);
+
+    size_t mask = table.slot_capacity - 1;
+    for (size_t i = 0; i < old_capacity; i++)
+    {
+        name_id_t id = old[i];
+        if (id == NAME_NONE) continue;
+
+        size_t j = intern_entry(id)->hash & mask;
+        while (table.slots[j] != NAME_NONE)
+            j = (j + 1) & mask;
+        table.slots[j] = id;
+    }
+    free(old);
+}
+
+name_id_t intern_n(const char* name, size_t len)
+{
+    pthread_once(&table_once, intern_init);
+    unsigned int hash = intern_hash(name, len);
+
+    // most names are already there, check under the shared lock first
+    pthread_rwlock_rdlock(&table.lock);
+    name_id_t id = table.slots[intern_probe(name, len, hash)];
+    pthread_rwlock_unlock(&table.lock);
+    if (id != NAME_NONE) return id;
+
+    pthread_rwlock_wrlock(&table.lock);
+    size_t i = intern_probe(name, len, hash);
+    if (table.slots[i] != NAME_NONE)
+    {
+        // another thread got here first
+        id = table.slots[i];
+        pthread_rwlock_unlock(&table.lock);
+        return id;
+    }
+
+    id = table.count;
+    if ((id >> INTERN_PAGE_SHIFT) >= INTERN_MAX_PAGES)
+    {
+        fprintf(stderr, "Error: Too many distinct names\n");
+        exit(1);
+    }
+    if (!table.pages[id >> INTERN_PAGE_SHIFT])
+        table.pages[id >> INTERN_PAGE_SHIFT] = intern_alloc(sizeof(intern_name_t) * INTERN_PAGE_SIZE);
+
+    intern_name_t* e = intern_entry(id);
+    e->string = intern_copy(name, len);
+    e->hash = hash;
+    table.slots[i] = id;
+    __atomic_store_n(&table.count, id + 1, __ATOMIC_RELEASE);
+
+    // keep the load factor under 1/2
+    if ((size_t)table.count * 2 > table.slot_capacity)
+        intern_grow_slots();
+
+    pthread_rwlock_unlock(&table.lock);
+    return id;
+}
+
+name_id_t intern(const char* name)
+{
+    if (!name) return NAME_NONE;
+    return intern_n(name, strlen(name));
+}
+
+name_id_t intern_find(const char* name)
+{
+    if (!name) return NAME_NONE;
+    pthread_once(&table_once, intern_init);
+
+    size_t len = strlen(name);
+    pthread_rwlock_rdlock(&table.lock);
+    name_id_t id = table.slots[intern_probe(name, len, intern_hash(name, len))];
+    pthread_rwlock_unlock(&table.lock);
+    return id;
+}
+
+const char* intern_str(name_id_t id)
+{
+    if (id == NAME_NONE || id >= __atomic_load_n(&table.count, __ATOMIC_ACQUIRE)) return "";
+    return intern_entry(id)->string;
+}
+
+name_id_t intern_count(void)
+{
+    name_id_t count = __atomic_load_n(&table.count, __ATOMIC_ACQUIRE);
+    return count ? count : 1;
+}
@@ -8,7 +8,9 @@
 
 ASTNode* parse_field(Parser* parser)
 {
-    ASTNode* ident = parse_primary_expr(parser);
+    Token* name = parser_consume(parser, IDENTIFIER, "Expected field name\n");
+    if (!name) return NULL;
+    ASTNode* ident = ast_new_identifier(name);
 
     parser_consume(parser, COLON, "Expected ':' after parameter name.\n");
 
@@ -17,6 +19,22 @@ ASTNode* parse_field(Parser* parser)
     return ast_field(ident, type);
 }
 
+// fields are separated by commas or newlines
+static ASTNode** parse_fields(Parser* parser, size_t* count)
+{
+    ASTNode** fields = NULL;
+
+    while (!parser_check(parser, CLOSE_CURLY) && !parser_is_at_end(parser))
+    {
+        if (parser_match(parser, NEWLINE) || parser_match(parser, COMMA)) continue;
+
+        ASTNode* field = parse_field(parser);
+        if (!field) break;
+        fields = parser_grow_array(fields, count, field);
+    }
+    return fields;
+}
+
 ASTNode* parse_struct(Parser* parser) 
 {
     parser_advance(parser); // consume struct keyword
@@ -24,19 +42,15 @@ ASTNode* parse_struct(Parser* parser)
     ASTNode** fields = NULL;
     size_t fields_count = 0;
 
-    name = parse_primary_expr(parser);
+    // the name is a declaration, not a use
+    Token* name_token = parser_consume(parser, IDENTIFIER, "Expected struct name after 'struct'\n");
+    if (!name_token) return NULL;
+    name = ast_new_identifier(name_token);
 
     if (!parser_check(parser, OPEN_CURLY)) return NULL;
     parser_consume(parser, OPEN_CURLY, "Expected '{' after struct name\n");
 
-    if (!parser_check(parser, CLOSE_CURLY)) 
-    {
-        do {
-            ASTNode* field = parse_field(parser);
-            printf("filed333\n");
-            fields = parser_grow_array(fields, &fields_count, field);
-        } while (parser_match(parser, COMMA));
-    }
+    fields = parse_fields(parser, &fields_count);
     parser_consume(parser, CLOSE_CURLY, "Expected '}' after fields\n");
 
     return ast_struct(name, fields, fields_count);
@@ -56,18 +70,22 @@ ASTNode* parse_enum(Parser* parser)
     ASTNode** enum_values = NULL;
     size_t enum_count = 0;
     
-    // Parse enum variants
+    // Parse enum variants, one per line or comma separated
     while (!parser_check(parser, CLOSE_CURLY) && !parser_is_at_end(parser))
     {
-        // Token* variant_token = parser_advance(parser);
+        if (parser_match(parser, NEWLINE)) continue;
 
-        // if (!variant_token)
-            // break;
-    
-        parser_advance(parser);
-        ASTNode* variant = parse_primary_expr(parser);
+        // variants are declarations, not uses
+        Token* variant_token = parser_consume(parser, IDENTIFIER, "Expected enum variant\n");
+        if (!variant_token)
+            break;
+
+        ASTNode* variant = ast_new_identifier(variant_token);
         enum_values = parser_grow_array(enum_values, &enum_count, variant);
         
+        int newline = 0;
+        while (parser_match(parser, NEWLINE)) newline = 1;
+
         // Optional comma
         if (parser_check(parser, COMMA))
         {
@@ -76,7 +94,7 @@ ASTNode* parse_enum(Parser* parser)
             if (parser_check(parser, CLOSE_CURLY))
                 break;
         }
-        else if (!parser_check(parser, CLOSE_CURLY))
+        else if (!parser_check(parser, CLOSE_CURLY) && !newline)
         {
             parser_error(parser, "Expected ',' or '}' after enum variant\n");
             break;
@@ -98,13 +116,7 @@ ASTNode* parse_union(Parser* parser)
     if (!parser_check(parser, OPEN_CURLY)) return NULL;
     parser_consume(parser, OPEN_CURLY, "Expected '{' after struct name\n");
 
-    if (!parser_check(parser, CLOSE_CURLY)) 
-    {
-        do {
-            ASTNode* field = parse_field(parser);
-            fields = parser_grow_array(fields, &fields_count, field);
-        } while (parser_match(parser, COMMA));
-    }
+    fields = parse_fields(parser, &fields_count);
     parser_consume(parser, CLOSE_CURLY, "Expected '}' after fields\n");
 
     Token* struct_name = parser_advance(parser);
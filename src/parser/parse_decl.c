@@ -3,6 +3,7 @@
 #include "token.h"
 #include "scope.h"
 #include "symtab.h"
+#include "prepass.h"
 #include <stdio.h>
 #include <stdlib.h>
 #include <stdbool.h>
@@ -28,7 +29,7 @@ ASTNode* parse_var_decl(Parser* parser)
 
     // Check for array declaration -> var ident[...]
     if (parser_match(parser, OPEN_BRACKET)) 
-        return parse_array_decl(parser, ident);
+        return parse_array_decl(parser, ident_tk, ident);
 
     // Handle typed declaration -> var ident: Type
     if (parser_match(parser, COLON))
@@ -51,16 +52,22 @@ ASTNode* parse_var_decl(Parser* parser)
     
     printf("DEBUG: Checking for redeclaration of '%s'\n", ident_tk->lexeme);
     
-    // Check for redeclaration in current scope
-    if (symtab_lookup_current_scope(parser->symtab, ident_tk->lexeme)) {
+    // Check for redeclaration in current scope, top-level names were
+    // declared by the pre-pass
+    if (prepass_symbol(parser->toplevel, ident_tk)) {
+        printf("DEBUG: Variable '%s' was predeclared\n", ident_tk->lexeme);
+        ident->as.ident.sym = prepass_symbol(parser->toplevel, ident_tk);
+    } else if (symtab_lookup_current_scope(parser->symtab, ident_tk->lexeme)) {
         fprintf(stderr, "Error at line %d: Variable '%s' already declared in this scope\n",
                 ident_tk->location.line, ident_tk->lexeme);
+        parser->error_count++;
         // Don't return NULL, just warn and continue
     } else {
         printf("DEBUG: Creating symbol for '%s'\n", ident_tk->lexeme);
         
         // Create and insert symbol
         sym_entry_t* sym = sym_create(
+            parser->symtab,
             ident_tk->lexeme,
             SYM_VARIABLE,
             TYPE_UNKNOWN,  // We'll improve type inference later
@@ -71,13 +78,13 @@ ASTNode* parse_var_decl(Parser* parser)
             printf("DEBUG: ERROR - sym_create returned NULL!\n");
         } else {
             printf("DEBUG: Symbol created, inserting into table\n");
-            sym->level = parser->symtab->current_depth;
-            sym->scope = parser->symtab->current_scope;
+            sym->column = ident_tk->location.column;
             
             if (symtab_insert(parser->symtab, sym) == NULL) {
                 printf("DEBUG: ERROR - symtab_insert failed!\n");
             } else {
                 printf("DEBUG: Symbol inserted successfully\n");
+                ident->as.ident.sym = sym;
             }
         }
     }
@@ -86,7 +93,7 @@ ASTNode* parse_var_decl(Parser* parser)
     return ast_var_decl(ident, data_type, value);
 }
 
-ASTNode* parse_array_decl(Parser* parser, ASTNode* ident)
+ASTNode* parse_array_decl(Parser* parser, Token* ident_tk, ASTNode* ident)
 {
     Token* data_type = NULL;
     ASTNode* range = NULL;
@@ -98,23 +105,46 @@ ASTNode* parse_array_decl(Parser* parser, ASTNode* ident)
             range = ast_new_literal(parser_advance(parser));
     }
 
-    parser_consume(parser, CLOSE_BRACKET, "Expected a ']' after array size\n");
+    // top-level arrays were declared by the pre-pass
+    sym_entry_t* sym = prepass_symbol(parser->toplevel, ident_tk);
+    if (!sym && symtab_lookup_current_scope(parser->symtab, ident_tk->lexeme))
+    {
+        fprintf(stderr, "Error at line %d: Array '%s' already declared in this scope\n",
+                ident_tk->location.line, ident_tk->lexeme);
+        parser->error_count++;
+    }
+    else if (!sym)
+    {
+        sym = sym_create(parser->symtab, ident_tk->lexeme, SYM_ARRAY, TYPE_ARRAY,
+                         ident_tk->location.line);
+        sym->column = ident_tk->location.column;
+        sym = symtab_insert(parser->symtab, sym);
+    }
+    if (sym)
+    {
+        sym->info.array.dimensions = 1;
+        sym->info.array.size = range ? atoi(range->as.literal.value) : 0;
+        ident->as.ident.sym = sym;
+    }
 
-    parser_consume(parser, ASSIGN, "Expected '=' after array declaration\n");
-    parser_consume(parser, OPEN_BRACKET, "Expected '[' to begin array initializer\n");
+    parser_consume(parser, CLOSE_BRACKET, "Expected a ']' after array size\n");
 
+    // without an initializer every element starts at zero
     ASTNode** elements = NULL;
     size_t count = 0;
-    if (!parser_check(parser, CLOSE_BRACKET))
+    if (parser_match(parser, ASSIGN))
     {
-        do 
+        parser_consume(parser, OPEN_BRACKET, "Expected '[' to begin array initializer\n");
+        if (!parser_check(parser, CLOSE_BRACKET))
         {
-            ASTNode* literal = parse_expr(parser);
-            elements = parser_grow_array(elements, &count, literal);
-        } while (parser_match(parser, COMMA));
+            do 
+            {
+                ASTNode* literal = parse_expr(parser);
+                if (literal) elements = parser_grow_array(elements, &count, literal);
+            } while (parser_match(parser, COMMA));
+        }
+        parser_consume(parser, CLOSE_BRACKET, "Expected a ']' after array initialization\n");
     }
-
-    parser_consume(parser, CLOSE_BRACKET, "Expected a ']' after array initialization\n");
     parser_consume(parser, NEWLINE, "Expected newline\n");
 
     return ast_new_array(ident, data_type, range, elements, count);
@@ -133,7 +163,7 @@ ASTNode* parse_const_decl(Parser* parser)
 
     // Check for array declaration -> let ident[...]
     if (parser_match(parser, OPEN_BRACKET)) 
-        return parse_array_decl(parser, ident);
+        return parse_array_decl(parser, ident_tk, ident);
 
     // Handle typed declaration -> let ident: Type
     if (parser_match(parser, COLON))
@@ -148,18 +178,23 @@ ASTNode* parse_const_decl(Parser* parser)
 
     parser_match(parser, NEWLINE);
 
+    // top-level constants were declared by the pre-pass
+    ident->as.ident.sym = prepass_symbol(parser->toplevel, ident_tk);
+    if (ident->as.ident.sym)
+        return ast_const_decl(ident, data_type, value);
+
     // create and insert symbol
     sym_entry_t* sym = sym_create(
+        parser->symtab,
         ident_tk->lexeme,
         SYM_VARIABLE,
         TYPE_UNKNOWN,
         ident_tk->location.line
     );
-    // set level and scope
-    sym->level = parser->symtab->current_depth;
-    sym->scope = parser->symtab->current_scope;
-
-    symtab_insert(parser->symtab, sym);
+    // level and scope are set on insertion
+    sym->column = ident_tk->location.column;
+    sym->info.var.is_constant = 1;
+    ident->as.ident.sym = symtab_insert(parser->symtab, sym);
     
     return ast_const_decl(ident, data_type, value);
 }
@@ -182,12 +217,14 @@ ASTNode* parse_param(Parser* parser)
     // Check for redeclaration
     if (symtab_lookup_current_scope(parser->symtab, ident_tk->lexeme)) {
         fprintf(stderr, "Error: Function '%s' already declared\n", ident_tk->lexeme);
+        parser->error_count++;
         // Continue parsing anyway
     } else {
         printf("DEBUG: Creating function symbol for '%s'\n", ident_tk->lexeme);
         
         // Create function symbol
         sym_entry_t* param_sym = sym_create(
+            parser->symtab,
             ident_tk->lexeme,
             SYM_PARAM,
             TYPE_VOID,
@@ -199,11 +236,13 @@ ASTNode* parse_param(Parser* parser)
         } else {
             param_sym->info.param.position = 0;
             param_sym->info.param.offset = 0;
+            param_sym->column = ident_tk->location.column;
             
             if (symtab_insert(parser->symtab, param_sym) == NULL) {
                 printf("DEBUG: ERROR - Failed to insert function symbol\n");
             } else {
                 printf("DEBUG: Function symbol inserted successfully\n");
+                ident->as.ident.sym = param_sym;
             }
         }
     }
@@ -219,6 +258,7 @@ ASTNode* parse_func_decl(Parser* parser)
     size_t params_count = 0;
     ASTNode* block = NULL;
     Token* return_type = NULL;
+    sym_entry_t* func_sym = NULL;
 
     if (!parser_match(parser, FN))
         return NULL;
@@ -238,15 +278,20 @@ ASTNode* parse_func_decl(Parser* parser)
         goto skip_symtab;
     }
 
-    // Check for redeclaration
-    if (symtab_lookup_current_scope(parser->symtab, ident->lexeme)) {
+    // top-level functions were declared by the pre-pass
+    func_sym = prepass_symbol(parser->toplevel, ident);
+    if (func_sym) {
+        printf("DEBUG: Function '%s' was predeclared\n", ident->lexeme);
+    } else if (symtab_lookup_current_scope(parser->symtab, ident->lexeme)) {
         fprintf(stderr, "Error: Function '%s' already declared\n", ident->lexeme);
+        parser->error_count++;
         // Continue parsing anyway
     } else {
         printf("DEBUG: Creating function symbol for '%s'\n", ident->lexeme);
         
         // Create function symbol
-        sym_entry_t* func_sym = sym_create(
+        func_sym = sym_create(
+            parser->symtab,
             ident->lexeme,
             SYM_FUNCTION,
             TYPE_VOID,
@@ -259,6 +304,8 @@ ASTNode* parse_func_decl(Parser* parser)
             func_sym->info.func.param_count = 0;
             func_sym->info.func.params = NULL;
             func_sym->info.func.is_defined = 0;
+            func_sym->info.func.body_scope = -1;
+            func_sym->column = ident->location.column;
             
             if (symtab_insert(parser->symtab, func_sym) == NULL) {
                 printf("DEBUG: ERROR - Failed to insert function symbol\n");
@@ -276,7 +323,9 @@ skip_symtab:
         printf("DEBUG: Entering function scope\n");
         symtab_enter_scope(parser->symtab);
         if (parser->symtab->current_scope) {
-            parser->symtab->current_scope->flags |= FUNCTION;
+            parser->symtab->current_scope->flags |= SCOPE_FUNCTION;
+            if (func_sym)
+                func_sym->info.func.body_scope = parser->symtab->current_scope->index;
         }
     }
     
@@ -286,10 +335,16 @@ skip_symtab:
             ASTNode* param = parse_param(parser);
             if (param) {
                 params = parser_grow_array(params, &params_count, param);
+                sym_entry_t* param_sym = param->as.param.ident->as.ident.sym;
+                if (param_sym)
+                    param_sym->info.param.position = (int)params_count - 1;
             }
         } while (parser_match(parser, COMMA));
     }
     parser_consume(parser, CLOSE_PAREN, "Expected ')' after parameters\n");
+    if (func_sym)
+        func_sym->info.func.param_count = (int)params_count;
+    identifier->as.ident.sym = func_sym;
 
     // return type
     if (parser_match(parser, ARROW))
@@ -302,6 +357,8 @@ skip_symtab:
     {
         block = parse_block(parser);
     }
+    if (func_sym)
+        func_sym->info.func.is_defined = block != NULL;
     
     // Exit function scope
     if (parser->symtab != NULL) {
@@ -35,8 +35,29 @@ ASTNode* parse_assign_expr(Parser* parser)
                 // This IS an assignment
                 Token* name = parser_advance(parser);  // consume identifier
                 Token* op = parser_advance(parser);     // consume operator
+
+                // record the target before the value so references stay in source order
+                sym_entry_t* sym = symtab_lookup(parser->symtab, name->lexeme);
+                if (!sym)
+                {
+                    fprintf(stderr, "Error at line %d: Undefined identifier '%s'\n",
+                            name->location.line, name->lexeme);
+                    parser->error_count++;
+                }
+                else
+                {
+                    // compound assignments read the old value first
+                    if (op->type != ASSIGN)
+                        symtab_add_reference(parser->symtab, sym, name->location.line,
+                                             name->location.column, 0);
+                    symtab_add_reference(parser->symtab, sym, name->location.line,
+                                         name->location.column, 1);  // 1 = write
+                }
+
                 ASTNode* value = parse_assign_expr(parser); // right-associative
-                return ast_new_assign(name, op, value);
+                ASTNode* assign = ast_new_assign(name, op, value);
+                assign->as.assign.sym = sym;
+                return assign;
             }
         }
     }
@@ -237,13 +258,18 @@ ASTNode* parse_primary_expr(Parser* parser)
             // Look up the symbol
             sym_entry_t* sym = symtab_lookup(parser->symtab, tk->lexeme);
             if (!sym)
+            {
                 fprintf(stderr, "Error at line %d: Undefined identifier '%s'\n",
                         tk->location.line, tk->lexeme);
+                parser->error_count++;
+            }
             else
                 // Add reference
-                symtab_add_reference(sym, tk->location.line, 0);  // 0 = read
+                symtab_add_reference(parser->symtab, sym, tk->location.line, tk->location.column, 0);  // 0 = read
 
-            return ast_new_identifier(tk);
+            ASTNode* ident = ast_new_identifier(tk);
+            ident->as.ident.sym = sym;
+            return ident;
         case OPEN_PAREN: 
         {
             parser_advance(parser);
@@ -270,6 +296,22 @@ ASTNode* parse_loop_expr(Parser* parser)
         Token* identifier = parser_previous(parser);
         variable = ast_new_identifier(identifier);
 
+        // loop i: a...b assigns i, declaring it in the loop scope if needed
+        sym_entry_t* sym = symtab_lookup(parser->symtab, identifier->lexeme);
+        if (!sym)
+        {
+            sym = sym_create(parser->symtab, identifier->lexeme, SYM_VARIABLE, TYPE_UNKNOWN,
+                             identifier->location.line);
+            sym->column = identifier->location.column;
+            sym = symtab_insert(parser->symtab, sym);
+        }
+        else
+        {
+            symtab_add_reference(parser->symtab, sym, identifier->location.line,
+                                 identifier->location.column, 1);
+        }
+        variable->as.ident.sym = sym;
+
         parser_match(parser, COLON);
 
         expr = parse_range(parser);
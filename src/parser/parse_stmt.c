@@ -3,6 +3,7 @@
 #include "token.h"
 #include "scope.h"
 #include "symtab.h"
+#include "iface.h"
 #include <stdio.h>
 #include <stdlib.h>
 #include <stdbool.h>
@@ -69,6 +70,27 @@ ASTNode* parse_return_stmt(Parser* parser)
     return ast_return_stmt(expr);
 }
 
+// import name -> map <import_dir>name.pni, see iface.h
+ASTNode* parse_import_stmt(Parser* parser)
+{
+    parser_advance(parser); // consume import keyword
+    Token* module = parser_consume(parser, IDENTIFIER, "Expected module name after 'import'\n");
+    if (!module) return NULL;
+    parser_match(parser, NEWLINE);
+
+    char path[512];
+    snprintf(path, sizeof(path), "%s%s.pni", parser->import_dir, module->lexeme);
+
+    if (symtab_import(parser->symtab, path) != 0)
+    {
+        fprintf(stderr, "Error at line %d: Cannot load interface '%s' for module '%s'\n",
+                module->location.line, path, module->lexeme);
+        parser->error_count++;
+    }
+
+    return ast_import(module);
+}
+
 ASTNode* parse_if_stmt(Parser* parser)
 {
     if (!parser_consume(parser, IF, "Expected 'if' keyword"))
@@ -108,6 +130,9 @@ ASTNode* parse_match_stmt(Parser* parser)
 
     while (!parser_check(parser, CLOSE_CURLY) && !parser_is_at_end(parser))
     {
+        // cases are separated by newlines
+        if (parser_match(parser, NEWLINE)) continue;
+
         if (parser_match(parser, UNDERSCORE)) 
         {            
             // Default case "_ => <expr>;"
@@ -143,6 +168,12 @@ ASTNode* parse_loop_stmt(Parser* parser)
 {
     parser_match(parser, LOOP);
     ASTNode* condition = NULL;
+
+    // the loop variable lives in a scope around the header and body
+    symtab_enter_scope(parser->symtab);
+    if (parser->symtab->current_scope)
+        parser->symtab->current_scope->flags |= SCOPE_LOOP | SCOPE_LOOP_HEADER;
+
     if (parser_check(parser, OPEN_CURLY))
     {
         goto block;
@@ -157,6 +188,7 @@ ASTNode* parse_loop_stmt(Parser* parser)
     if (parser_check(parser, OPEN_CURLY))
         block = parse_block(parser);
 
+    symtab_exit_scope(parser->symtab);
     return ast_loop(condition, block);
 }
 
@@ -197,6 +229,12 @@ ASTNode* parse_stmt(Parser* parser)
         if (fun_decl != NULL) return fun_decl;
     }
 
+    if (parser_check(parser, IMPORT))
+    {
+        ASTNode* import_stmt = parse_import_stmt(parser);
+        if (import_stmt != NULL) return import_stmt;
+    }
+
     if (parser_check(parser, RETURN))
     {
         ASTNode* return_stmt = parse_return_stmt(parser);
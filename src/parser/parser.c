@@ -3,6 +3,7 @@
 #include "scope.h"
 #include "symtab.h"
 #include "token.h"
+#include "prepass.h"
 #include <stdio.h>
 #include <stdlib.h>
 #include <stdbool.h>
@@ -26,6 +27,9 @@ Parser* init_parser(Token** tokens, int count)
     p->current = 0;
     p->count = count;
     p->error_msg = NULL;
+    p->error_count = 0;
+    p->toplevel = NULL;
+    p->import_dir = "";
     
     printf("DEBUG: Creating symbol table\n");
     p->symtab = symtab_create();
@@ -116,7 +120,10 @@ void report_error(SourceLocation loc, const char* msg)
 ASTNode* parse_program(Parser* parser)
 {
     ASTNode* root = ast_program();
-    scope_t* global_scope = create_global_scope();
+
+    // declare every top-level name first so declaration order doesn't matter
+    parser->toplevel = prepass_collect(parser->tokens, parser->count);
+    prepass_declare(parser->toplevel, parser->symtab);
     
     while (!parser_is_at_end(parser))
     {
@@ -0,0 +1,247 @@
+#include "prepass.h"
+#include "symtab.h"
+#include "token.h"
+
+#include <stdlib.h>
+#include <stdio.h>
+
+static int prepass_is_open(TokenType type)
+{
+    return type == OPEN_CURLY || type == OPEN_PAREN || type == OPEN_BRACKET;
+}
+
+static int prepass_is_close(TokenType type)
+{
+    return type == CLOSE_CURLY || type == CLOSE_PAREN || type == CLOSE_BRACKET;
+}
+
+static int prepass_at_end(Token** tokens, int count, int i)
+{
+    return i >= count || tokens[i]->type == TOKEN_EOF;
+}
+
+// i is on an opening bracket, returns one past its matching close
+static int prepass_skip_group(Token** tokens, int count, int i)
+{
+    int depth = 0;
+    for (; !prepass_at_end(tokens, count, i); i++)
+    {
+        if (prepass_is_open(tokens[i]->type)) depth++;
+        else if (prepass_is_close(tokens[i]->type) && --depth == 0) return i + 1;
+    }
+    return i;
+}
+
+// next stop token or newline outside any brackets, starting at i
+static int prepass_scan_to(Token** tokens, int count, int i, TokenType stop)
+{
+    while (!prepass_at_end(tokens, count, i)
+           && tokens[i]->type != stop
+           && tokens[i]->type != NEWLINE)
+    {
+        if (prepass_is_open(tokens[i]->type)) i = prepass_skip_group(tokens, count, i);
+        else i++;
+    }
+    return i;
+}
+
+static int prepass_is_name(Token** tokens, int count, int i)
+{
+    return !prepass_at_end(tokens, count, i)
+        && (tokens[i]->type == IDENTIFIER || tokens[i]->type == MAIN);
+}
+
+static void prepass_add(toplevel_index_t* index, toplevel_kind_t kind, Token* name,
+                        int start, int end, int is_array)
+{
+    if (index->count == index->capacity)
+    {
+        index->capacity = index->capacity ? index->capacity * 2 : 32;
+        index->decls = realloc(index->decls, sizeof(toplevel_decl_t) * index->capacity);
+        if (!index->decls)
+        {
+            fprintf(stderr, "Out of memory\n");
+            exit(1);
+        }
+    }
+
+    toplevel_decl_t* decl = &index->decls[index->count++];
+    decl->kind = kind;
+    decl->name = intern(name->lexeme);
+    decl->name_token = name;
+    decl->start = start;
+    decl->end = end;
+    decl->is_array = is_array;
+    decl->symbol = NULL;
+}
+
+static int prepass_compare_name(const void* a, const void* b)
+{
+    const toplevel_decl_t* x = *(toplevel_decl_t* const*)a;
+    const toplevel_decl_t* y = *(toplevel_decl_t* const*)b;
+
+    if (x->name != y->name) return x->name < y->name ? -1 : 1;
+    return x->start < y->start ? -1 : x->start > y->start;
+}
+
+toplevel_index_t* prepass_collect(Token** tokens, int count)
+{
+    toplevel_index_t* index = calloc(1, sizeof(toplevel_index_t));
+    if (!index)
+    {
+        fprintf(stderr, "Out of memory\n");
+        exit(1);
+    }
+
+    int i = 0;
+    while (!prepass_at_end(tokens, count, i))
+    {
+        int start = i;
+        int name = i + 1;
+        int end;
+
+        switch (tokens[i]->type)
+        {
+            case FN:
+            case STRUCT:
+            case ENUM:
+            {
+                // fn name(...) -> type { ... }, struct name { ... }
+                end = prepass_scan_to(tokens, count, name, OPEN_CURLY);
+                if (!prepass_at_end(tokens, count, end) && tokens[end]->type == OPEN_CURLY)
+                    end = prepass_skip_group(tokens, count, end);
+
+                if (prepass_is_name(tokens, count, name))
+                {
+                    toplevel_kind_t kind = tokens[i]->type == FN ? TOP_FN
+                                         : tokens[i]->type == STRUCT ? TOP_STRUCT : TOP_ENUM;
+                    prepass_add(index, kind, tokens[name], start, end, 0);
+                }
+                break;
+            }
+            case UNION:
+            {
+                // union { ... } name
+                end = name;
+                if (!prepass_at_end(tokens, count, end) && tokens[end]->type == OPEN_CURLY)
+                    end = prepass_skip_group(tokens, count, end);
+
+                if (prepass_is_name(tokens, count, end))
+                {
+                    prepass_add(index, TOP_UNION, tokens[end], start, end + 1, 0);
+                    end++;
+                }
+                break;
+            }
+            case LET:
+            case VAR:
+            {
+                // up to the end of the line, initializers may span lines inside brackets
+                end = prepass_scan_to(tokens, count, name, NEWLINE);
+
+                if (prepass_is_name(tokens, count, name))
+                {
+                    int is_array = !prepass_at_end(tokens, count, name + 1)
+                                && tokens[name + 1]->type == OPEN_BRACKET;
+                    prepass_add(index, tokens[i]->type == LET ? TOP_LET : TOP_VAR,
+                                tokens[name], start, end, is_array);
+                }
+                break;
+            }
+            default:
+                // any other top-level statement, skip whole groups so their
+                // contents are never mistaken for top-level declarations
+                end = prepass_is_open(tokens[i]->type)
+                    ? prepass_skip_group(tokens, count, i)
+                    : i + 1;
+                break;
+        }
+
+        i = end > start ? end : start + 1;
+    }
+
+    index->by_name = malloc(sizeof(toplevel_decl_t*) * (index->count ? index->count : 1));
+    if (!index->by_name)
+    {
+        fprintf(stderr, "Out of memory\n");
+        exit(1);
+    }
+    for (int j = 0; j < index->count; j++)
+        index->by_name[j] = &index->decls[j];
+    qsort(index->by_name, index->count, sizeof(toplevel_decl_t*), prepass_compare_name);
+
+    return index;
+}
+
+void toplevel_index_destroy(toplevel_index_t* index)
+{
+    if (!index) return;
+    free(index->by_name);
+    free(index->decls);
+    free(index);
+}
+
+void prepass_declare(toplevel_index_t* index, symtab_t* table)
+{
+    if (!index || !table) return;
+
+    for (int i = 0; i < index->count; i++)
+    {
+        toplevel_decl_t* decl = &index->decls[i];
+        const char* name = intern_str(decl->name);
+
+        // a duplicate is reported when its declaration is parsed
+        if (symtab_lookup_current_scope(table, name)) continue;
+
+        symbol_t kind;
+        datatype_t type;
+        switch (decl->kind)
+        {
+            case TOP_FN:     kind = SYM_FUNCTION; type = TYPE_VOID;    break;
+            case TOP_STRUCT: kind = SYM_STRUCT;   type = TYPE_STRUCT;  break;
+            case TOP_ENUM:   kind = SYM_ENUM;     type = TYPE_ENUM;    break;
+            case TOP_UNION:  kind = SYM_UNION;    type = TYPE_UNKNOWN; break;
+            default:
+                kind = decl->is_array ? SYM_ARRAY : SYM_VARIABLE;
+                type = TYPE_UNKNOWN;
+                break;
+        }
+
+        sym_entry_t* sym = sym_create(table, name, kind, type, decl->name_token->location.line);
+        if (!sym) continue;
+
+        sym->column = decl->name_token->location.column;
+        if (kind == SYM_VARIABLE)
+            sym->info.var.is_constant = decl->kind == TOP_LET;
+
+        decl->symbol = symtab_insert(table, sym);
+    }
+}
+
+const toplevel_decl_t* toplevel_find(toplevel_index_t* index, name_id_t name)
+{
+    if (!index || name == NAME_NONE) return NULL;
+
+    // first entry with this name
+    int lo = 0, hi = index->count;
+    while (lo < hi)
+    {
+        int mid = lo + (hi - lo) / 2;
+        if (index->by_name[mid]->name < name) lo = mid + 1;
+        else hi = mid;
+    }
+
+    for (; lo < index->count && index->by_name[lo]->name == name; lo++)
+    {
+        if (index->by_name[lo]->symbol) return index->by_name[lo];
+    }
+    return NULL;
+}
+
+sym_entry_t* prepass_symbol(toplevel_index_t* index, Token* name_token)
+{
+    if (!index || !name_token) return NULL;
+
+    const toplevel_decl_t* decl = toplevel_find(index, intern_find(name_token->lexeme));
+    return decl && decl->name_token == name_token ? decl->symbol : NULL;
+}
@@ -0,0 +1,592 @@
+#include "psymtab.h"
+#include "symtab.h"
+#include "intern.h"
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+
+#define PHAMT_BITS 5
+#define PHAMT_MASK 31
+
+// Everything stored in a trie leaf starts with this header
+typedef struct pobj_t pobj_t;
+struct pobj_t
+{
+    int refcount;
+    void (*destroy)(pobj_t* obj);
+};
+
+typedef struct
+{
+    pobj_t base;
+    sym_entry_t sym;
+} psym_t;
+
+// one frozen scope of a function, symbols sorted by name id
+typedef struct
+{
+    int parent;         // local scope index, -1 for the parameter scope
+    int count;
+    psym_t** symbols;
+} pscope_t;
+
+struct pfunc_t
+{
+    pobj_t base;
+    name_id_t name;
+    int scope_count;
+    pscope_t* scopes;
+};
+
+// A slot is either a leaf (child == NULL) or a subtrie
+typedef struct
+{
+    unsigned int key;
+    pobj_t* value;
+    phamt_node_t* child;
+} phamt_slot_t;
+
+struct phamt_node_t
+{
+    int refcount;
+    unsigned int bitmap;    // which of the 32 slots are present
+    int count;
+    phamt_slot_t slots[];   // present slots, in bit order
+};
+
+struct psymtab_t
+{
+    int refcount;
+    phamt_node_t* globals;      // name -> psym_t
+    phamt_node_t* functions;    // name -> pfunc_t
+    int global_count;
+    int function_count;
+};
+
+static long live_objects;
+
+static void* psymtab_alloc(size_t size)
+{
+    void* m = calloc(1, size);
+    if (!m) { fprintf(stderr, "Out of memory\n"); exit(1); }
+    return m;
+}
+
+static void pobj_release(pobj_t* obj)
+{
+    if (!obj || --obj->refcount > 0) return;
+    obj->destroy(obj);
+    live_objects--;
+}
+
+// ---------------------------------------------------------------------------
+// HAMT
+
+// odd multiplier, so this is a bijection on 32 bits and distinct keys
+// always split by the last level: no collision buckets needed
+static unsigned int phamt_hash(unsigned int key)
+{
+    return key * 2654435761u;
+}
+
+static int phamt_popcount(unsigned int x)
+{
+    x = x - ((x >> 1) & 0x55555555u);
+    x = (x & 0x33333333u) + ((x >> 2) & 0x33333333u);
+    return (int)((((x + (x >> 4)) & 0x0F0F0F0Fu) * 0x01010101u) >> 24);
+}
+
+static phamt_node_t* phamt_node_alloc(int count)
+{
+    phamt_node_t* node = psymtab_alloc(sizeof(phamt_node_t) + sizeof(phamt_slot_t) * count);
+    node->refcount = 1;
+    node->count = count;
+    live_objects++;
+    return node;
+}
+
+static void phamt_slot_retain(phamt_slot_t* slot)
+{
+    if (slot->child) slot->child->refcount++;
+    else slot->value->refcount++;
+}
+
+static void phamt_release(phamt_node_t* node)
+{
+    if (!node || --node->refcount > 0) return;
+
+    for (int i = 0; i < node->count; i++)
+    {
+        if (node->slots[i].child) phamt_release(node->slots[i].child);
+        else pobj_release(node->slots[i].value);
+    }
+    free(node);
+    live_objects--;
+}
+
+// shallow copy, every slot gains a reference
+static phamt_node_t* phamt_clone(const phamt_node_t* node)
+{
+    phamt_node_t* copy = phamt_node_alloc(node->count);
+    copy->bitmap = node->bitmap;
+    memcpy(copy->slots, node->slots, sizeof(phamt_slot_t) * node->count);
+    for (int i = 0; i < copy->count; i++)
+        phamt_slot_retain(&copy->slots[i]);
+    return copy;
+}
+
+// Returns a new trie with key bound to value; node is not modified.
+// The trie takes its own reference to value.
+static phamt_node_t* phamt_insert(const phamt_node_t* node, int shift, unsigned int hash,
+                                  unsigned int key, pobj_t* value, int* added)
+{
+    unsigned int bit = 1u << ((hash >> shift) & PHAMT_MASK);
+    int pos = node ? phamt_popcount(node->bitmap & (bit - 1)) : 0;
+
+    if (!node || !(node->bitmap & bit))
+    {
+        int count = node ? node->count : 0;
+        phamt_node_t* copy = phamt_node_alloc(count + 1);
+        copy->bitmap = (node ? node->bitmap : 0) | bit;
+
+        for (int i = 0; i < pos; i++)
+        {
+            copy->slots[i] = node->slots[i];
+            phamt_slot_retain(&copy->slots[i]);
+        }
+        copy->slots[pos].key = key;
+        copy->slots[pos].value = value;
+        value->refcount++;
+        for (int i = pos; i < count; i++)
+        {
+            copy->slots[i + 1] = node->slots[i];
+            phamt_slot_retain(&copy->slots[i + 1]);
+        }
+
+        *added = 1;
+        return copy;
+    }
+
+    phamt_node_t* copy = phamt_clone(node);
+    phamt_slot_t* slot = &copy->slots[pos];
+
+    if (slot->child)
+    {
+        phamt_node_t* child = phamt_insert(slot->child, shift + PHAMT_BITS, hash, key, value, added);
+        phamt_release(slot->child);
+        slot->child = child;
+    }
+    else if (slot->key == key)
+    {
+        pobj_release(slot->value);
+        slot->value = value;
+        value->refcount++;
+    }
+    else
+    {
+        // two keys share this prefix, push both one level down
+        int ignored = 0;
+        phamt_node_t* one = phamt_insert(NULL, shift + PHAMT_BITS, phamt_hash(slot->key),
+                                         slot->key, slot->value, &ignored);
+        phamt_node_t* both = phamt_insert(one, shift + PHAMT_BITS, hash, key, value, added);
+        phamt_release(one);
+        pobj_release(slot->value);
+
+        slot->key = 0;
+        slot->value = NULL;
+        slot->child = both;
+    }
+    return copy;
+}
+
+// Returns a new trie without key, NULL if it would be empty.
+// When key is absent, node itself comes back with an extra reference.
+static phamt_node_t* phamt_remove(phamt_node_t* node, int shift, unsigned int hash,
+                                  unsigned int key, int* removed)
+{
+    if (!node) return NULL;
+
+    unsigned int bit = 1u << ((hash >> shift) & PHAMT_MASK);
+    if (!(node->bitmap & bit))
+    {
+        node->refcount++;
+        return node;
+    }
+
+    int pos = phamt_popcount(node->bitmap & (bit - 1));
+    phamt_slot_t* slot = &node->slots[pos];
+
+    if (slot->child)
+    {
+        phamt_node_t* child = phamt_remove(slot->child, shift + PHAMT_BITS, hash, key, removed);
+        if (child == slot->child)
+        {
+            phamt_release(child);
+            node->refcount++;
+            return node;
+        }
+        if (child)
+        {
+            phamt_node_t* copy = phamt_clone(node);
+            phamt_release(copy->slots[pos].child);
+            copy->slots[pos].child = child;
+            return copy;
+        }
+        // subtrie emptied, drop the slot below
+    }
+    else if (slot->key != key)
+    {
+        node->refcount++;
+        return node;
+    }
+    else
+    {
+        *removed = 1;
+    }
+
+    if (node->count == 1) return NULL;
+
+    phamt_node_t* copy = phamt_node_alloc(node->count - 1);
+    copy->bitmap = node->bitmap & ~bit;
+    for (int i = 0, j = 0; i < node->count; i++)
+    {
+        if (i == pos) continue;
+        copy->slots[j] = node->slots[i];
+        phamt_slot_retain(&copy->slots[j++]);
+    }
+    return copy;
+}
+
+static pobj_t* phamt_find(const phamt_node_t* node, unsigned int key)
+{
+    unsigned int hash = phamt_hash(key);
+
+    for (int shift = 0; node; shift += PHAMT_BITS)
+    {
+        unsigned int bit = 1u << ((hash >> shift) & PHAMT_MASK);
+        if (!(node->bitmap & bit)) return NULL;
+
+        const phamt_slot_t* slot = &node->slots[phamt_popcount(node->bitmap & (bit - 1))];
+        if (!slot->child)
+            return slot->key == key ? slot->value : NULL;
+        node = slot->child;
+    }
+    return NULL;
+}
+
+static void phamt_each(const phamt_node_t* node, void (*fn)(pobj_t* value, void* ctx), void* ctx)
+{
+    if (!node) return;
+    for (int i = 0; i < node->count; i++)
+    {
+        if (node->slots[i].child) phamt_each(node->slots[i].child, fn, ctx);
+        else fn(node->slots[i].value, ctx);
+    }
+}
+
+// ---------------------------------------------------------------------------
+// Shared records
+
+static void psym_destroy(pobj_t* obj)
+{
+    free(obj);
+}
+
+static psym_t* psym_create(const sym_entry_t* symbol)
+{
+    psym_t* p = psymtab_alloc(sizeof(psym_t));
+    p->base.refcount = 1;
+    p->base.destroy = psym_destroy;
+    live_objects++;
+
+    // drop everything that points back into the live table
+    p->sym = *symbol;
+    p->sym.first_ref = 0;
+    p->sym.last_ref = 0;
+    p->sym.shadowed = NULL;
+    if (symbol->symbol_type == SYM_FUNCTION)
+        p->sym.info.func.params = NULL;
+    else if (symbol->symbol_type == SYM_VARIABLE || symbol->symbol_type == SYM_CONSTANT)
+        p->sym.info.var.initial_value = NULL;
+    return p;
+}
+
+static void pfunc_destroy(pobj_t* obj)
+{
+    pfunc_t* f = (pfunc_t*)obj;
+
+    for (int i = 0; i < f->scope_count; i++)
+    {
+        for (int j = 0; j < f->scopes[i].count; j++)
+            pobj_release(&f->scopes[i].symbols[j]->base);
+        free(f->scopes[i].symbols);
+    }
+    free(f->scopes);
+    free(f);
+}
+
+static int pfunc_subtree_size(scope_t* scope)
+{
+    int n = 1;
+    for (int i = 0; i < scope->children_cnt; i++)
+        n += pfunc_subtree_size(scope->children[i]);
+    return n;
+}
+
+static int psym_compare_name(const void* a, const void* b)
+{
+    name_id_t x = (*(psym_t* const*)a)->sym.name;
+    name_id_t y = (*(psym_t* const*)b)->sym.name;
+    return x < y ? -1 : x > y;
+}
+
+static void pfunc_collect(pfunc_t* f, scope_t* scope, int parent)
+{
+    int at = f->scope_count++;
+    pscope_t* ps = &f->scopes[at];
+
+    ps->parent = parent;
+    ps->symbols = psymtab_alloc(sizeof(psym_t*) * (scope->symbol_count ? scope->symbol_count : 1));
+    for (int i = 0; i < scope->symbol_count; i++)
+    {
+        if (scope->symbols[i])
+            ps->symbols[ps->count++] = psym_create(scope->symbols[i]);
+    }
+    qsort(ps->symbols, ps->count, sizeof(psym_t*), psym_compare_name);
+
+    for (int i = 0; i < scope->children_cnt; i++)
+        pfunc_collect(f, scope->children[i], at);
+}
+
+static pfunc_t* pfunc_create(symtab_t* table, const sym_entry_t* function)
+{
+    pfunc_t* f = psymtab_alloc(sizeof(pfunc_t));
+    f->base.refcount = 1;
+    f->base.destroy = pfunc_destroy;
+    f->name = function->name;
+    live_objects++;
+
+    scope_t* body = function->info.func.body_scope >= 0
+        ? symtab_scope(table, function->info.func.body_scope)
+        : NULL;
+    if (body)
+    {
+        f->scopes = psymtab_alloc(sizeof(pscope_t) * pfunc_subtree_size(body));
+        pfunc_collect(f, body, -1);
+    }
+    return f;
+}
+
+// ---------------------------------------------------------------------------
+// Versions
+
+// takes over the caller's references to both tries
+static psymtab_t* psymtab_version(phamt_node_t* globals, phamt_node_t* functions,
+                                  int global_count, int function_count)
+{
+    psymtab_t* v = psymtab_alloc(sizeof(psymtab_t));
+    v->refcount = 1;
+    live_objects++;
+    v->globals = globals;
+    v->functions = functions;
+    v->global_count = global_count;
+    v->function_count = function_count;
+    return v;
+}
+
+psymtab_t* psymtab_empty(void)
+{
+    return psymtab_version(NULL, NULL, 0, 0);
+}
+
+void psymtab_retain(psymtab_t* version)
+{
+    if (version) version->refcount++;
+}
+
+void psymtab_release(psymtab_t* version)
+{
+    if (!version || --version->refcount > 0) return;
+
+    phamt_release(version->globals);
+    phamt_release(version->functions);
+    free(version);
+    live_objects--;
+}
+
+psymtab_t* psymtab_set_global(psymtab_t* prev, const sym_entry_t* symbol)
+{
+    int added = 0;
+    psym_t* p = psym_create(symbol);
+    phamt_node_t* globals = phamt_insert(prev->globals, 0, phamt_hash(symbol->name),
+                                         symbol->name, &p->base, &added);
+    pobj_release(&p->base);
+
+    if (prev->functions) prev->functions->refcount++;
+    return psymtab_version(globals, prev->functions,
+                           prev->global_count + added, prev->function_count);
+}
+
+psymtab_t* psymtab_remove_global(psymtab_t* prev, name_id_t name)
+{
+    int removed = 0;
+    phamt_node_t* globals = phamt_remove(prev->globals, 0, phamt_hash(name), name, &removed);
+
+    if (prev->functions) prev->functions->refcount++;
+    return psymtab_version(globals, prev->functions,
+                           prev->global_count - removed, prev->function_count);
+}
+
+psymtab_t* psymtab_set_function(psymtab_t* prev, symtab_t* table, const sym_entry_t* function)
+{
+    psymtab_t* with_global = psymtab_set_global(prev, function);
+
+    int added = 0;
+    pfunc_t* f = pfunc_create(table, function);
+    phamt_node_t* functions = phamt_insert(prev->functions, 0, phamt_hash(function->name),
+                                           function->name, &f->base, &added);
+    pobj_release(&f->base);
+
+    with_global->globals->refcount++;
+    psymtab_t* v = psymtab_version(with_global->globals, functions,
+                                   with_global->global_count, prev->function_count + added);
+    psymtab_release(with_global);
+    return v;
+}
+
+psymtab_t* psymtab_remove_function(psymtab_t* prev, name_id_t name)
+{
+    psymtab_t* without_global = psymtab_remove_global(prev, name);
+
+    int removed = 0;
+    phamt_node_t* functions = phamt_remove(prev->functions, 0, phamt_hash(name), name, &removed);
+
+    if (without_global->globals) without_global->globals->refcount++;
+    psymtab_t* v = psymtab_version(without_global->globals, functions,
+                                   without_global->global_count, prev->function_count - removed);
+    psymtab_release(without_global);
+    return v;
+}
+
+psymtab_t* psymtab_from_symtab(symtab_t* table)
+{
+    psymtab_t* v = psymtab_empty();
+    if (!table || !table->global_scope) return v;
+
+    scope_t* global = table->global_scope;
+    for (int i = 0; i < global->symbol_count; i++)
+    {
+        sym_entry_t* sym = global->symbols[i];
+        if (!sym) continue;
+
+        psymtab_t* next = sym->symbol_type == SYM_FUNCTION
+            ? psymtab_set_function(v, table, sym)
+            : psymtab_set_global(v, sym);
+        psymtab_release(v);
+        v = next;
+    }
+    return v;
+}
+
+// ---------------------------------------------------------------------------
+// Queries
+
+const sym_entry_t* psymtab_lookup_global(const psymtab_t* version, name_id_t name)
+{
+    if (!version || name == NAME_NONE) return NULL;
+    psym_t* p = (psym_t*)phamt_find(version->globals, name);
+    return p ? &p->sym : NULL;
+}
+
+const pfunc_t* psymtab_function(const psymtab_t* version, name_id_t name)
+{
+    if (!version || name == NAME_NONE) return NULL;
+    return (const pfunc_t*)phamt_find(version->functions, name);
+}
+
+int psymtab_function_count(const psymtab_t* version)
+{
+    return version ? version->function_count : 0;
+}
+
+static const sym_entry_t* pscope_find(const pscope_t* scope, name_id_t name)
+{
+    int lo = 0, hi = scope->count - 1;
+    while (lo <= hi)
+    {
+        int mid = lo + (hi - lo) / 2;
+        name_id_t at = scope->symbols[mid]->sym.name;
+        if (at == name) return &scope->symbols[mid]->sym;
+        if (at < name) lo = mid + 1;
+        else hi = mid - 1;
+    }
+    return NULL;
+}
+
+const sym_entry_t* psymtab_lookup(const psymtab_t* version, const pfunc_t* function,
+                                  int scope, name_id_t name)
+{
+    if (name == NAME_NONE) return NULL;
+
+    while (function && scope >= 0 && scope < function->scope_count)
+    {
+        const sym_entry_t* sym = pscope_find(&function->scopes[scope], name);
+        if (sym) return sym;
+        scope = function->scopes[scope].parent;
+    }
+    return psymtab_lookup_global(version, name);
+}
+
+int pfunc_scope_count(const pfunc_t* function)
+{
+    return function ? function->scope_count : 0;
+}
+
+int pfunc_scope_parent(const pfunc_t* function, int scope)
+{
+    if (!function || scope < 0 || scope >= function->scope_count) return -1;
+    return function->scopes[scope].parent;
+}
+
+long psymtab_live_objects(void)
+{
+    return live_objects;
+}
+
+static void psymtab_print_global(pobj_t* value, void* ctx)
+{
+    (void)ctx;
+    const sym_entry_t* sym = &((psym_t*)value)->sym;
+    printf("  %-20s | %-12s | %-10s | Line: %d\n",
+           intern_str(sym->name),
+           symbol_type_to_string(sym->symbol_type),
+           datatype_to_string(sym->type),
+           sym->line);
+}
+
+static void psymtab_print_function(pobj_t* value, void* ctx)
+{
+    (void)ctx;
+    const pfunc_t* f = (const pfunc_t*)value;
+
+    printf("  fn %s:", intern_str(f->name));
+    for (int i = 0; i < f->scope_count; i++)
+    {
+        printf(" [");
+        for (int j = 0; j < f->scopes[i].count; j++)
+            printf("%s%s", j ? " " : "", intern_str(f->scopes[i].symbols[j]->sym.name));
+        printf("]");
+    }
+    printf("\n");
+}
+
+void psymtab_print(const psymtab_t* version)
+{
+    if (!version) return;
+
+    printf("\n-------- Symbol Table Snapshot ----------\n");
+    printf("Globals: %d | Functions: %d\n", version->global_count, version->function_count);
+    phamt_each(version->globals, psymtab_print_global, NULL);
+    phamt_each(version->functions, psymtab_print_function, NULL);
+}
@@ -3,6 +3,7 @@
 
 #include <stdlib.h>
 #include <stdio.h>
+#include <string.h>
 
 scope_t* scope_create(int level, scope_t* parent)
 {
@@ -17,18 +18,22 @@ scope_t* scope_create(int level, scope_t* parent)
     scope->level = level;
     scope->symbols = NULL;  // Start with NULL, will allocate on first insert
     scope->symbol_count = 0;
+    scope->symbol_capacity = 0;
+    scope->index = 0;
     scope->parent = parent;
     scope->flags = 0;
     scope->children = NULL;
     scope->children_cnt = 0;
+    scope->undo_mark = 0;
+    memset(&scope->names, 0, sizeof(scope_bloom_t));
 
     // Inherit certain flags from parent
     if (parent) {
-        if (parent->flags & FUNCTION) {
-            scope->flags |= FUNCTION;
+        if (parent->flags & SCOPE_FUNCTION) {
+            scope->flags |= SCOPE_FUNCTION;
         }
-        if (parent->flags & LOOP) {
-            scope->flags |= LOOP;
+        if (parent->flags & SCOPE_LOOP) {
+            scope->flags |= SCOPE_LOOP;
         }
     }
     
@@ -48,6 +53,8 @@ void symtab_enter_scope(symtab_t* table)
 {
     int new_depth = table->current_depth + 1;
     scope_t* new_scope = scope_create(new_depth, table->current_scope);
+    new_scope->undo_mark = symmap_mark(&table->map);
+    symtab_register_scope(table, new_scope);
 
     if (table->current_scope != NULL)
     {
@@ -58,19 +65,61 @@ void symtab_enter_scope(symtab_t* table)
         parent->children_cnt++;
     }
 
-    table->scopes[new_depth] = new_scope;
+    // the stack is only kept for the debug dump; the chain is scope->parent
+    if (new_depth < MAX_DEPTH) table->scopes[new_depth] = new_scope;
     table->current_scope = new_scope;
     table->current_depth = new_depth;
 }
 
+static const char* scope_usage_kind(sym_entry_t* sym)
+{
+    switch (sym->symbol_type)
+    {
+        case SYM_PARAM:    return "parameter";
+        case SYM_CONSTANT: return "constant";
+        case SYM_ARRAY:    return "array";
+        default:           return sym->info.var.is_constant ? "constant" : "variable";
+    }
+}
+
+// Every reference to a local is made inside its scope, so once the scope
+// closes the read and write sets say all there is to know: one bit test
+// per symbol, no walk over the body or the reference chains.
+static void scope_check_usage(symtab_t* table, scope_t* scope)
+{
+    for (int i = 0; i < scope->symbol_count; i++)
+    {
+        sym_entry_t* sym = scope->symbols[i];
+        if (sym->symbol_type != SYM_VARIABLE && sym->symbol_type != SYM_CONSTANT
+            && sym->symbol_type != SYM_PARAM && sym->symbol_type != SYM_ARRAY) continue;
+
+        unsigned int word = sym->index >> 6;
+        unsigned long long bit = 1ULL << (sym->index & 63);
+        if (table->read_set[word] & bit) continue;
+
+        sym->usage = (table->write_set[word] & bit) ? SYM_WRITE_ONLY : SYM_UNUSED;
+
+        // loop counters are often there just to count
+        if (!table->warn_unused || (scope->flags & SCOPE_LOOP_HEADER)) continue;
+
+        SourceLocation loc = { .line = sym->line, .column = sym->column };
+        if (sym->usage == SYM_UNUSED)
+            diag_warning(&table->diags, loc, "unused %s '%s'", scope_usage_kind(sym), sym_name(sym));
+        else
+            diag_warning(&table->diags, loc, "%s '%s' is assigned but never read",
+                         scope_usage_kind(sym), sym_name(sym));
+    }
+}
+
 void symtab_exit_scope(symtab_t* table)
 {
     if (table->current_depth == 0) return;
 
     scope_t* prev = table->current_scope;
+    scope_check_usage(table, prev);
 
-    // could scope check for unused variables
-    // before exit
+    // restore the bindings this scope shadowed
+    symmap_unwind(&table->map, prev->undo_mark);
 
     table->current_scope = prev->parent;
     table->current_depth--;
@@ -80,20 +129,79 @@ void scope_destroy(scope_t* scope)
 {
     if(scope == NULL) return;
 
-    for (int i = 0; i < scope->symbol_count; i++)
-    {
-        sym_entry_t* sym = scope->symbols[i];
-        sym_destroy(sym);
-    }
-
+    // symbols belong to the table's pool, only the index array is ours
     if (scope->children) 
     {
         free(scope->children);
     }
 
     free(scope->symbols);
+    free(scope->names.bits);
     free(scope);
 }
 
 
 
+
+
+// two bit positions from one multiplicative hash of the id
+static void scope_bloom_bits(const scope_bloom_t* bloom, unsigned int name, unsigned int* a, unsigned int* b)
+{
+    unsigned long long h = name * 0x9E3779B97F4A7C15ULL;
+    *a = (unsigned int)(h >> 40) & bloom->mask;
+    *b = (unsigned int)(h >> 16) & bloom->mask;
+}
+
+static void scope_bloom_set(scope_bloom_t* bloom, unsigned int name)
+{
+    unsigned int a, b;
+    scope_bloom_bits(bloom, name, &a, &b);
+    bloom->bits[a >> 6] |= 1ULL << (a & 63);
+    bloom->bits[b >> 6] |= 1ULL << (b & 63);
+    bloom->count++;
+}
+
+int scope_bloom_may_contain(const scope_bloom_t* bloom, unsigned int name)
+{
+    if (bloom->bits == NULL) return 0;
+
+    unsigned int a, b;
+    scope_bloom_bits(bloom, name, &a, &b);
+    return ((bloom->bits[a >> 6] >> (a & 63)) & 1)
+        && ((bloom->bits[b >> 6] >> (b & 63)) & 1);
+}
+
+// rehash the scope's names into a filter sized for them
+static void scope_bloom_rebuild(scope_bloom_t* bloom, scope_t* scope)
+{
+    unsigned int bits = SCOPE_BLOOM_MIN_BITS;
+    while (bits < (unsigned int)(scope->symbol_count * SCOPE_BLOOM_BITS_PER_NAME)) bits *= 2;
+
+    free(bloom->bits);
+    bloom->bits = calloc(bits / 64, sizeof(unsigned long long));
+    if (!bloom->bits)
+    {
+        fprintf(stderr, "Error: Failed to allocate scope filter\n");
+        exit(1);
+    }
+    bloom->mask = bits - 1;
+    bloom->count = 0;
+
+    for (int i = 0; i < scope->symbol_count; i++)
+        scope_bloom_set(bloom, scope->symbols[i]->name);
+}
+
+void scope_bloom_add(scope_t* scope, unsigned int name)
+{
+    if (scope == NULL) return;
+
+    // the rebuild picks up the new name from the symbol list
+    scope_bloom_t* bloom = &scope->names;
+    if (bloom->bits == NULL
+        || (unsigned int)(bloom->count + 1) * SCOPE_BLOOM_BITS_PER_NAME > bloom->mask + 1)
+    {
+        scope_bloom_rebuild(bloom, scope);
+        return;
+    }
+    scope_bloom_set(bloom, name);
+}
@@ -0,0 +1,133 @@
+#include "symmap.h"
+#include "symtab.h"
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+
+#define SYMMAP_INITIAL_CAPACITY 256
+
+void symmap_init(symmap_t* map)
+{
+    map->capacity = SYMMAP_INITIAL_CAPACITY;
+    map->tops = calloc(map->capacity, sizeof(sym_entry_t*));
+    if (!map->tops)
+    {
+        fprintf(stderr, "Error: Failed to allocate symbol map\n");
+        exit(1);
+    }
+
+    map->undo_log = NULL;
+    map->undo_count = 0;
+    map->undo_capacity = 0;
+}
+
+void symmap_free(symmap_t* map)
+{
+    free(map->tops);
+    free(map->undo_log);
+
+    map->tops = NULL;
+    map->capacity = 0;
+    map->undo_log = NULL;
+    map->undo_count = 0;
+    map->undo_capacity = 0;
+}
+
+// make room for every id the interner has handed out
+static void symmap_reserve(symmap_t* map, name_id_t id)
+{
+    if (id < map->capacity) return;
+
+    size_t capacity = map->capacity;
+    while (capacity <= id) capacity *= 2;
+
+    map->tops = realloc(map->tops, sizeof(sym_entry_t*) * capacity);
+    if (!map->tops)
+    {
+        fprintf(stderr, "Error: Failed to grow symbol map\n");
+        exit(1);
+    }
+    memset(map->tops + map->capacity, 0, sizeof(sym_entry_t*) * (capacity - map->capacity));
+    map->capacity = capacity;
+}
+
+void symmap_push(symmap_t* map, sym_entry_t* symbol)
+{
+    symmap_reserve(map, symbol->name);
+
+    symbol->shadowed = map->tops[symbol->name];
+    map->tops[symbol->name] = symbol;
+
+    if (map->undo_count == map->undo_capacity)
+    {
+        map->undo_capacity = map->undo_capacity ? map->undo_capacity * 2 : 64;
+        map->undo_log = realloc(map->undo_log, sizeof(sym_entry_t*) * map->undo_capacity);
+        if (!map->undo_log)
+        {
+            printf("Out of memory\n");
+            exit(1);
+        }
+    }
+    map->undo_log[map->undo_count++] = symbol;
+}
+
+void symmap_bind_outermost(symmap_t* map, sym_entry_t* symbol)
+{
+    symmap_reserve(map, symbol->name);
+
+    sym_entry_t** link = &map->tops[symbol->name];
+    while (*link != NULL)
+        link = &(*link)->shadowed;
+
+    *link = symbol;
+    symbol->shadowed = NULL;
+}
+
+sym_entry_t* symmap_lookup(symmap_t* map, name_id_t name)
+{
+    if (name == NAME_NONE || name >= map->capacity) return NULL;
+    return map->tops[name];
+}
+
+int symmap_mark(symmap_t* map)
+{
+    return map->undo_count;
+}
+
+// unlink symbol from its binding stack
+static void symmap_unlink(symmap_t* map, sym_entry_t* symbol)
+{
+    sym_entry_t** link = &map->tops[symbol->name];
+
+    while (*link != NULL && *link != symbol)
+        link = &(*link)->shadowed;
+
+    if (*link == symbol)
+        *link = symbol->shadowed;
+    symbol->shadowed = NULL;
+}
+
+void symmap_unwind(symmap_t* map, int mark)
+{
+    while (map->undo_count > mark)
+    {
+        sym_entry_t* symbol = map->undo_log[--map->undo_count];
+        // entries are NULL when the symbol was removed earlier
+        if (symbol != NULL)
+            symmap_unlink(map, symbol);
+    }
+}
+
+void symmap_forget(symmap_t* map, sym_entry_t* symbol, int mark)
+{
+    for (int i = map->undo_count - 1; i >= mark; i--)
+    {
+        if (map->undo_log[i] == symbol)
+        {
+            map->undo_log[i] = NULL;
+            symmap_unlink(map, symbol);
+            return;
+        }
+    }
+}
@@ -1,5 +1,7 @@
 #include "symtab.h"
 #include "scope.h"
+#include "globaltab.h"
+#include "iface.h"
 #include <stdlib.h>
 #include <stdio.h>
 #include <string.h>
@@ -41,6 +43,32 @@ symtab_t* symtab_create(void)
     table->scopes[0] = table->global_scope;
     table->current_scope = table->global_scope;
     table->current_depth = 0;
+    symmap_init(&table->map);
+
+    table->scope_list = NULL;
+    table->scope_count = 0;
+    table->scope_capacity = 0;
+    symtab_register_scope(table, table->global_scope);
+
+    table->sym_chunks = NULL;
+    table->sym_count = 0;
+    table->sym_chunk_count = 0;
+
+    table->ref_chunks = NULL;
+    table->ref_chunk_count = 0;
+    table->ref_used = REF_CHUNK_SIZE;   // the first segment opens a chunk
+    table->ref_count = 0;
+
+    memset(&table->stats, 0, sizeof(symtab_stats_t));
+    table->read_set = NULL;
+    table->write_set = NULL;
+    table->warn_unused = 1;
+    diag_init(&table->diags);
+    table->globals = NULL;
+    table->imports = NULL;
+    table->import_count = 0;
+    table->types = NULL;
+    table->type_count = 0;
     
     printf("DEBUG: symtab_create - COMPLETE\n");
     printf("       table=%p\n", (void*)table);
@@ -55,19 +83,71 @@ symtab_t* symtab_create(void)
 
 void symtab_destroy(symtab_t* table)
 {
-    for (int i = 0; i < table->current_depth; i++)
+    // every scope is in the list, including ones already exited
+    for (int i = 0; i < table->scope_count; i++)
     {
-        scope_destroy(table->scopes[i]);
+        scope_destroy(table->scope_list[i]);
     }
+    free(table->scope_list);
+
+    for (int i = 0; i < table->sym_chunk_count; i++)
+    {
+        free(table->sym_chunks[i]);
+    }
+    free(table->sym_chunks);
+
+    for (int i = 0; i < table->ref_chunk_count; i++)
+    {
+        free(table->ref_chunks[i]);
+    }
+    free(table->ref_chunks);
+    free(table->read_set);
+    free(table->write_set);
+    diag_free(&table->diags);
+
+    symmap_free(&table->map);
+    globaltab_destroy(table->globals);
+    for (int i = 0; i < table->import_count; i++)
+    {
+        iface_close(table->imports[i]);
+    }
+    free(table->imports);
+    free(table->types);
     free(table);
 }
 
+void symtab_register_scope(symtab_t* table, scope_t* scope)
+{
+    if (table->scope_count == table->scope_capacity)
+    {
+        table->scope_capacity = table->scope_capacity ? table->scope_capacity * 2 : 16;
+        table->scope_list = realloc(table->scope_list, sizeof(scope_t*) * table->scope_capacity);
+        if (!table->scope_list)
+        {
+            printf("Out of memory\n");
+            exit(1);
+        }
+    }
+    scope->index = table->scope_count;
+    table->scope_list[table->scope_count++] = scope;
+}
+
+scope_t* symtab_scope(symtab_t* table, unsigned int index)
+{
+    if (index >= (unsigned int)table->scope_count) return NULL;
+    return table->scope_list[index];
+}
+
+sym_entry_t* symtab_symbol(symtab_t* table, unsigned int index)
+{
+    if (index >= table->sym_count) return NULL;
+    return &table->sym_chunks[index >> SYM_CHUNK_SHIFT][index & (SYM_CHUNK_SIZE - 1)];
+}
+
 // symbol operations
-sym_entry_t** grow_array_sym(sym_entry_t** refs, int* count, sym_entry_t* ref)
+sym_entry_t** grow_array_sym(sym_entry_t** refs, int* count, int* capacity, sym_entry_t* ref)
 {
-    printf("DEBUG: Growing symbol array from %d to %d\n", *count, *count + 1);
-    
-    if (!count) {
+    if (!count || !capacity) {
         fprintf(stderr, "ERROR: grow_array_sym - count is NULL\n");
         return refs;
     }
@@ -77,27 +157,23 @@ sym_entry_t** grow_array_sym(sym_entry_t** refs, int* count, sym_entry_t* ref)
         return refs;
     }
     
-    int new_count = *count + 1;
-    
-    // Handle NULL (first allocation)
-    sym_entry_t** new_refs;
-    if (refs == NULL) {
-        new_refs = malloc(sizeof(sym_entry_t*) * new_count);
-    } else {
-        new_refs = realloc(refs, sizeof(sym_entry_t*) * new_count);
-    }
-    
-    if (!new_refs) {
-        fprintf(stderr, "Error: Failed to grow symbol array\n");
-        return refs;
+    // double the capacity so insertion is amortized O(1)
+    if (*count == *capacity)
+    {
+        int new_capacity = *capacity ? *capacity * 2 : 4;
+        sym_entry_t** new_refs = realloc(refs, sizeof(sym_entry_t*) * new_capacity);
+        if (!new_refs) {
+            fprintf(stderr, "Error: Failed to grow symbol array\n");
+            return refs;
+        }
+        printf("DEBUG: Symbol array grown from %d to %d slots\n", *capacity, new_capacity);
+        refs = new_refs;
+        *capacity = new_capacity;
     }
     
-    new_refs[*count] = ref;
-    *count = new_count;
+    refs[(*count)++] = ref;
     
-    printf("DEBUG: Symbol array grown successfully to %d elements\n", new_count);
-    
-    return new_refs;
+    return refs;
 }
 
 sym_entry_t* symtab_insert(symtab_t* table, sym_entry_t* symbol)
@@ -107,36 +183,168 @@ sym_entry_t* symtab_insert(symtab_t* table, sym_entry_t* symbol)
         printf("Symbol table doesn't exist!!!\n");
         return NULL;
     }
+
+    // other threads may be reading the frozen copy
+    if (table->current_depth == 0 && table->globals != NULL)
+    {
+        fprintf(stderr, "Error: Global scope is frozen, cannot declare '%s'\n", sym_name(symbol));
+        return NULL;
+    }
     
+    symbol->level = table->current_depth;
+    symbol->scope = table->current_scope->index;
+
     table->current_scope->symbols = grow_array_sym(
         table->current_scope->symbols, 
         &(table->current_scope->symbol_count), 
+        &(table->current_scope->symbol_capacity), 
         symbol
     );
+
+    symmap_push(&table->map, symbol);
+    scope_bloom_add(table->current_scope, symbol->name);
     
     return symbol;
 }
 
+// Enter symbol into the global scope while any scope is current. The
+// binding goes under the live ones and is never unwound.
+sym_entry_t* symtab_insert_global(symtab_t* table, sym_entry_t* symbol)
+{
+    if (table == NULL || table->global_scope == NULL) return NULL;
+
+    if (table->globals != NULL)
+    {
+        fprintf(stderr, "Error: Global scope is frozen, cannot declare '%s'\n", sym_name(symbol));
+        return NULL;
+    }
+
+    scope_t* global = table->global_scope;
+    symbol->level = 0;
+    symbol->scope = global->index;
+
+    global->symbols = grow_array_sym(
+        global->symbols,
+        &global->symbol_count,
+        &global->symbol_capacity,
+        symbol
+    );
+
+    symmap_bind_outermost(&table->map, symbol);
+    scope_bloom_add(global, symbol->name);
+
+    return symbol;
+}
+
+// one probe into the live map, whatever the nesting depth
 sym_entry_t* symtab_lookup(symtab_t* table, const char* name)
 {
     if (table == NULL || table->current_scope == NULL) return NULL;
 
-    scope_t* scope = table->current_scope;
+    // a name that was never interned can't be bound, unless an imported
+    // module declares it
+    name_id_t id = intern_find(name);
+    if (id == NAME_NONE && table->import_count > 0) id = intern(name);
+
+    return symtab_lookup_id(table, id);
+}
+
+// the parallel checker looks names up too, so the counters are atomic
+static void symtab_count(unsigned long* counter)
+{
+    __atomic_fetch_add(counter, 1, __ATOMIC_RELAXED);
+}
+
+static sym_entry_t* symtab_count_result(symtab_t* table, sym_entry_t* sym)
+{
+    symtab_count(&table->stats.lookups);
+    if (sym) symtab_count(&table->stats.hits);
+    return sym;
+}
 
-    while (scope != NULL)
+// a name bound nowhere may still be exported by an imported module
+static sym_entry_t* symtab_resolve_import(symtab_t* table, name_id_t name)
+{
+    if (table->import_count == 0 || name == NAME_NONE) return NULL;
+    return iface_resolve(table, name);
+}
+
+sym_entry_t* symtab_lookup_id(symtab_t* table, name_id_t name)
+{
+    if (table == NULL || table->current_scope == NULL) return NULL;
+    if (name == NAME_NONE) return symtab_count_result(table, NULL);
+
+    // the map holds every live binding, the filters cannot add anything.
+    // NULL means symbol doesn't exist yet
+    sym_entry_t* sym = symtab_count_result(table, symmap_lookup(&table->map, name));
+    return sym ? sym : symtab_resolve_import(table, name);
+}
+
+static sym_entry_t* scope_lookup_local_id(scope_t* scope, name_id_t id)
+{
+    for (int i = 0; i < scope->symbol_count; i++)
     {
-        for (int i = 0; i < scope->symbol_count; i++)
+        if (scope->symbols[i]->name == id)
         {
-            if (strcmp(scope->symbols[i]->name, name) == 0)
-            {
-                return scope->symbols[i];
-            }
+            return scope->symbols[i];
         }
+    }
+    return NULL;
+}
+
+sym_entry_t* scope_lookup_local(scope_t* scope, const char* name)
+{
+    if (scope == NULL || name == NULL) return NULL;
 
-        scope = scope->parent;
+    name_id_t id = intern_find(name);
+    if (id == NAME_NONE) return NULL;
+
+    return scope_lookup_local_id(scope, id);
+}
+
+// only scopes whose filter says maybe are searched; with stats, count
+// the scopes the filters skipped and those searched in vain
+static sym_entry_t* scope_lookup_id(scope_t* scope, name_id_t id, symtab_stats_t* stats)
+{
+    for (; scope != NULL; scope = scope->parent)
+    {
+        if (!scope_bloom_may_contain(&scope->names, id))
+        {
+            if (stats) symtab_count(&stats->bloom_rejects);
+            continue;
+        }
+
+        sym_entry_t* sym = scope_lookup_local_id(scope, id);
+        if (sym) return sym;
+        if (stats) symtab_count(&stats->bloom_false_positives);
     }
 
-    return NULL;  // meaning symbol doesn't exist yet
+    return NULL;
+}
+
+sym_entry_t* scope_lookup(scope_t* scope, const char* name)
+{
+    name_id_t id = intern_find(name);
+    if (id == NAME_NONE) return NULL;
+
+    return scope_lookup_id(scope, id, NULL);
+}
+
+sym_entry_t* symtab_lookup_from(symtab_t* table, scope_t* scope, const char* name)
+{
+    if (table == NULL || scope == NULL) return NULL;
+
+    name_id_t id = intern_find(name);
+    if (id == NAME_NONE) return symtab_count_result(table, NULL);
+
+    return symtab_count_result(table, scope_lookup_id(scope, id, &table->stats));
+}
+
+int sym_is_type(sym_entry_t* symbol)
+{
+    return symbol->symbol_type == SYM_STRUCT
+        || symbol->symbol_type == SYM_ENUM
+        || symbol->symbol_type == SYM_UNION;
 }
 
 sym_entry_t* symtab_lookup_current_scope(symtab_t* table, const char* name)
@@ -171,32 +379,11 @@ sym_entry_t* symtab_lookup_current_scope(symtab_t* table, const char* name)
         return NULL;
     }
     
-    scope_t* scope = table->current_scope;
-    printf("DEBUG: scope->symbol_count=%d\n", scope->symbol_count);
-    printf("DEBUG: scope->symbols=%p\n", (void*)scope->symbols);
-    
-    if (scope->symbols == NULL && scope->symbol_count == 0) {
-        printf("DEBUG: Scope is empty (no symbols yet)\n");
-        return NULL;
-    }
-    
-    if (scope->symbols == NULL) {
-        fprintf(stderr, "ERROR: symbols array is NULL but count=%d\n", scope->symbol_count);
-        fflush(stderr);
-        return NULL;
-    }
-    
-    for (int i = 0; i < scope->symbol_count; i++) {
-        printf("DEBUG: Checking symbol %d/%d\n", i, scope->symbol_count);
-        if (scope->symbols[i]) {
-            printf("DEBUG: Symbol %d name='%s'\n", i, scope->symbols[i]->name);
-            if (strcmp(scope->symbols[i]->name, name) == 0) {
-                printf("DEBUG: Found '%s' in current scope\n", name);
-                return scope->symbols[i];
-            }
-        } else {
-            printf("DEBUG: Symbol %d is NULL\n", i);
-        }
+    // the innermost binding is in this scope only if it was declared here
+    sym_entry_t* sym = symtab_lookup(table, name);
+    if (sym != NULL && sym->scope == (unsigned int)table->current_scope->index) {
+        printf("DEBUG: Found '%s' in current scope\n", name);
+        return sym;
     }
     
     printf("DEBUG: '%s' not found in current scope\n", name);
@@ -208,12 +395,14 @@ int symtab_remove(symtab_t* table, const char* name)
     if (table == NULL || table->current_scope == NULL) return 0;
     
     scope_t* scope = table->current_scope;
+    name_id_t id = intern_find(name);
 
     for (int i = 0; i < scope->symbol_count; i++) 
     {
-        if (strcmp(scope->symbols[i]->name, name) == 0)
+        if (scope->symbols[i]->name == id)
         {
-            sym_destroy(scope->symbols[i]);
+            // the record stays in the pool, it is only unlinked
+            symmap_forget(&table->map, scope->symbols[i], scope->undo_mark);
 
             for (int j = i; j < scope->symbol_count - 1; j++)
             {
@@ -228,69 +417,200 @@ int symtab_remove(symtab_t* table, const char* name)
 }
 
 // Reference tracking
-void symtab_add_reference(sym_entry_t* symbol, int line, int is_write)
+// a segment is named by its chunk and offset; the first chunk starts
+// past offset 0, so 0 ends a chain
+static unsigned char* ref_segment(symtab_t* table, unsigned int position)
 {
-    reference_t* ref = (reference_t*)malloc(sizeof(reference_t));
+    return table->ref_chunks[position >> REF_CHUNK_SHIFT] + (position & (REF_CHUNK_SIZE - 1));
+}
 
-    ref->line = line;
-    ref->is_write = is_write;
+static unsigned int ref_segment_next(const unsigned char* segment)
+{
+    unsigned int next;
+    memcpy(&next, segment, sizeof(next));
+    return next;
+}
 
-    reference_t** refs = symbol->references;
-    symbol->references = grow_array(refs, &(symbol->ref_count), ref);
+static unsigned int ref_segment_create(symtab_t* table, int size)
+{
+    if (table->ref_used + size > REF_CHUNK_SIZE)
+    {
+        int chunk = table->ref_chunk_count;
+        table->ref_chunks = realloc(table->ref_chunks, sizeof(unsigned char*) * (chunk + 1));
+        if (!table->ref_chunks)
+        {
+            printf("Out of memory\n");
+            exit(1);
+        }
+        table->ref_chunks[chunk] = malloc(REF_CHUNK_SIZE);
+        if (!table->ref_chunks[chunk])
+        {
+            printf("Out of memory\n");
+            exit(1);
+        }
+        table->ref_chunk_count++;
+        table->ref_used = chunk == 0 ? REF_SEGMENT_MIN : 0;
+    }
+
+    unsigned int position = ((unsigned int)(table->ref_chunk_count - 1) << REF_CHUNK_SHIFT) | table->ref_used;
+    table->ref_used += size;
+
+    unsigned char* segment = ref_segment(table, position);
+    memset(segment, 0, sizeof(unsigned int));
+    segment[4] = REF_SEGMENT_HEADER;
+    segment[5] = (unsigned char)size;
+    return position;
 }
 
-void reference_destroy(reference_t* ref)
+static int ref_put_varint(unsigned char* out, unsigned int v)
 {
-    // ensure to reduce ref_count after using this function
-    free(ref);
+    int n = 0;
+    while (v >= 0x80)
+    {
+        out[n++] = (unsigned char)(v | 0x80);
+        v >>= 7;
+    }
+    out[n++] = (unsigned char)v;
+    return n;
 }
 
-// symbol entry operations
-sym_entry_t* sym_entry_create(const char* name, symbol_t type, 
-                              datatype_t data_type, int line)
+static unsigned int ref_get_varint(const unsigned char* in, unsigned int* offset)
 {
-    sym_entry_t* sym = (sym_entry_t*)malloc(sizeof(sym_entry_t));
+    unsigned int v = 0;
+    for (int shift = 0; ; shift += 7)
+    {
+        unsigned char byte = in[(*offset)++];
+        v |= (unsigned int)(byte & 0x7f) << shift;
+        if (!(byte & 0x80)) return v;
+    }
+}
 
-    if (sym == NULL) return NULL;
+// A reference is two varints: the line's difference from the symbol's
+// previous reference, zigzagged so a step back stays short, then the
+// column with is_write in its low bit. References come in source order,
+// so most are two bytes.
+void symtab_add_reference(symtab_t* table, sym_entry_t* symbol, int line, int column, int is_write)
+{
+    int delta = line - symbol->ref_line;
+    unsigned int zigzag = ((unsigned int)delta << 1) ^ (unsigned int)-(delta < 0);
 
-    strncpy(sym->name, name, MAX_NAME_LEN - 1);
-    sym->name[MAX_NAME_LEN - 1] = '\0';
-    sym->symbol_type = type;
-    sym->type = data_type;
-    sym->address = 0;
-    sym->line = line;
-    sym->level = 0;
-    sym->scope = NULL;
+    unsigned char record[16];
+    int length = ref_put_varint(record, zigzag);
+    length += ref_put_varint(record + length, ((unsigned int)(unsigned short)column << 1) | (is_write ? 1 : 0));
 
-    sym->references = NULL;
-    sym->ref_count = 0;
+    // a record never straddles two segments
+    unsigned char* segment = symbol->last_ref ? ref_segment(table, symbol->last_ref) : NULL;
+    if (!segment || segment[4] + length > segment[5])
+    {
+        int size = segment ? segment[5] * 2 : REF_SEGMENT_MIN;
+        if (size > REF_SEGMENT_MAX) size = REF_SEGMENT_MAX;
+
+        unsigned int position = ref_segment_create(table, size);
+        if (segment)
+            memcpy(segment, &position, sizeof(position));
+        else
+            symbol->first_ref = position;
+        symbol->last_ref = position;
+        segment = ref_segment(table, position);
+    }
+    memcpy(segment + segment[4], record, length);
+    segment[4] += length;
 
-    return sym;
+    symbol->ref_line = line;
+    symbol->ref_count++;
+    table->ref_count++;
+
+    unsigned long long* set = is_write ? table->write_set : table->read_set;
+    set[symbol->index >> 6] |= 1ULL << (symbol->index & 63);
 }
 
-sym_entry_t* sym_create(const char* name, symbol_t type, datatype_t data_type, int line)
+int symtab_first_reference(symtab_t* table, sym_entry_t* symbol, reference_t* ref)
 {
-    if (!name) return NULL;
-    
-    sym_entry_t* entry = malloc(sizeof(sym_entry_t));
-    if (!entry) 
+    ref->line = 0;
+    ref->segment = symbol->first_ref;
+    ref->offset = REF_SEGMENT_HEADER;
+    return symtab_next_reference(table, ref);
+}
+
+int symtab_next_reference(symtab_t* table, reference_t* ref)
+{
+    if (ref->segment == 0) return 0;
+
+    const unsigned char* segment = ref_segment(table, ref->segment);
+    if (ref->offset >= segment[4])
     {
-        fprintf(stderr, "Error: Failed to allocate symbol entry\n");
-        return NULL;
+        ref->segment = ref_segment_next(segment);
+        ref->offset = REF_SEGMENT_HEADER;
+        if (ref->segment == 0) return 0;
+        segment = ref_segment(table, ref->segment);
     }
+
+    unsigned int zigzag = ref_get_varint(segment, &ref->offset);
+    ref->line += (int)(zigzag >> 1) ^ -(int)(zigzag & 1);
+    unsigned int column = ref_get_varint(segment, &ref->offset);
+    ref->column = (unsigned short)(column >> 1);
+    ref->is_write = column & 1;
+    return 1;
+}
+
+// symbol entry operations
+sym_entry_t* sym_create(symtab_t* table, const char* name, symbol_t type, datatype_t data_type, int line)
+{
+    if (!table || !name) return NULL;
     
-    // Copy name safely
-    strncpy(entry->name, name, MAX_NAME_LEN - 1);
-    entry->name[MAX_NAME_LEN - 1] = '\0';
+    unsigned int index = table->sym_count;
+    int chunk = index >> SYM_CHUNK_SHIFT;
+
+    if (chunk == table->sym_chunk_count)
+    {
+        sym_entry_t** chunks = realloc(table->sym_chunks, sizeof(sym_entry_t*) * (chunk + 1));
+        if (!chunks)
+        {
+            fprintf(stderr, "Error: Failed to allocate symbol entry\n");
+            return NULL;
+        }
+        table->sym_chunks = chunks;
+        table->sym_chunks[chunk] = malloc(sizeof(sym_entry_t) * SYM_CHUNK_SIZE);
+        if (!table->sym_chunks[chunk]) 
+        {
+            fprintf(stderr, "Error: Failed to allocate symbol entry\n");
+            return NULL;
+        }
+
+        // the usage bit sets grow a chunk at a time with the pool
+        size_t words = SYM_CHUNK_SIZE / 64;
+        size_t total = (chunk + 1) * words;
+        table->read_set = realloc(table->read_set, sizeof(unsigned long long) * total);
+        table->write_set = realloc(table->write_set, sizeof(unsigned long long) * total);
+        if (!table->read_set || !table->write_set)
+        {
+            fprintf(stderr, "Error: Failed to allocate symbol entry\n");
+            return NULL;
+        }
+        memset(table->read_set + chunk * words, 0, sizeof(unsigned long long) * words);
+        memset(table->write_set + chunk * words, 0, sizeof(unsigned long long) * words);
+        table->sym_chunk_count++;
+    }
+
+    sym_entry_t* entry = &table->sym_chunks[chunk][index & (SYM_CHUNK_SIZE - 1)];
+    table->sym_count++;
     
+    entry->name = intern(name);
     entry->symbol_type = type;
     entry->type = data_type;
-    entry->address = 0;
-    entry->line = line;
     entry->level = 0;
-    entry->scope = NULL;
-    entry->references = NULL;
+    entry->imported = 0;
+    entry->usage = SYM_USED;
+    entry->storage = 0;             // STORAGE_NONE until escape analysis
+    entry->scope = 0;
+    entry->index = index;
+    entry->line = line;
+    entry->column = 0;
+    entry->first_ref = 0;
+    entry->last_ref = 0;
     entry->ref_count = 0;
+    entry->ref_line = 0;
+    entry->shadowed = NULL;
     
     // Initialize union based on symbol type
     switch (type) 
@@ -306,6 +626,7 @@ sym_entry_t* sym_create(const char* name, symbol_t type, datatype_t data_type, i
             entry->info.func.params = NULL;
             entry->info.func.param_count = 0;
             entry->info.func.is_defined = 0;
+            entry->info.func.body_scope = -1;
             break;
             
         case SYM_PARAM:
@@ -330,29 +651,6 @@ sym_entry_t* sym_create(const char* name, symbol_t type, datatype_t data_type, i
     return entry;
 }
 
-void sym_destroy(sym_entry_t* entry)
-{
-    for (int i = 0; i < entry->ref_count; i++)
-    {
-        free(entry->references[i]);
-    }
-    free(entry);
-}
-
-reference_t** grow_array(reference_t** refs, int* count, reference_t* ref)
-{
-    refs = realloc(refs, sizeof(reference_t*) * (*count + 1));
-    if (!refs)
-    {
-        printf("Out of memory\n");
-        exit(1);
-    }
-    refs[*count] = ref;
-    (*count)++;
-    return refs;
-}
-
-
 
 const char* symbol_type_to_string(symbol_t type)
 {
@@ -365,6 +663,7 @@ const char* symbol_type_to_string(symbol_t type)
         case SYM_ARRAY:     return "ARRAY";
         case SYM_STRUCT:    return "STRUCT";
         case SYM_ENUM:      return "ENUM";
+        case SYM_UNION:     return "UNION";
         case SYM_LABEL:     return "LABEL";
         default:            return "UNKNOWN";
     }
@@ -389,21 +688,21 @@ const char* datatype_to_string(datatype_t type)
     }
 }
 
-void symtab_print_scope(scope_t* scope)
+void symtab_print_scope(symtab_t* table, scope_t* scope)
 {
     if (!scope) return;
     
     printf("\n  --- Scope Level %d (Symbols: %d) ---\n", scope->level, scope->symbol_count);
     
-    if (scope->flags & FUNCTION) printf("  [FUNCTION SCOPE]\n");
-    if (scope->flags & LOOP) printf("  [LOOP SCOPE]\n");
+    if (scope->flags & SCOPE_FUNCTION) printf("  [FUNCTION SCOPE]\n");
+    if (scope->flags & SCOPE_LOOP) printf("  [LOOP SCOPE]\n");
     
     for (int i = 0; i < scope->symbol_count; i++) {
         sym_entry_t* sym = scope->symbols[i];
         if (!sym) continue;
         
         printf("  %-20s | %-12s | %-10s | Line: %-4d | Refs: %d",
-               sym->name,
+               sym_name(sym),
                symbol_type_to_string(sym->symbol_type),
                datatype_to_string(sym->type),
                sym->line,
@@ -444,28 +743,32 @@ void symtab_print_scope(scope_t* scope)
         // Print references
         if (sym->ref_count > 0) {
             printf("    References: ");
-            for (int j = 0; j < sym->ref_count; j++) {
-                printf("L%d%s", 
-                       sym->references[j]->line,
-                       sym->references[j]->is_write ? "(W)" : "(R)");
-                if (j < sym->ref_count - 1) printf(", ");
+            reference_t ref;
+            int first = 1;
+            for (int more = symtab_first_reference(table, sym, &ref); more; 
+                 more = symtab_next_reference(table, &ref)) {
+                printf("%sL%d%s", 
+                       first ? "" : ", ",
+                       ref.line,
+                       ref.is_write ? "(W)" : "(R)");
+                first = 0;
             }
             printf("\n");
         }
     }
 }
 
-void symtab_print_scope_r(scope_t* scope)
+void symtab_print_scope_r(symtab_t* table, scope_t* scope)
 {
     if (!scope) return;
 
-    symtab_print_scope(scope);
+    symtab_print_scope(table, scope);
 
     for(int i = 0; i < scope->children_cnt; i++)
     {
         if (scope->children[i])
         {
-            symtab_print_scope_r(scope->children[i]);
+            symtab_print_scope_r(table, scope->children[i]);
         }
     }
 }
@@ -485,10 +788,19 @@ void symtab_print(symtab_t* table)
     printf("Current Depth: %d\n", table->current_depth);
     
     // Print all scopes from global to current
-    symtab_print_scope_r(table->global_scope);
+    symtab_print_scope_r(table, table->global_scope);
     
+    symtab_print_stats(table);
     printf("\n");
     printf("================================================================================\n");
     printf("\n");
 }
 
+void symtab_print_stats(symtab_t* table)
+{
+    if (!table) return;
+
+    symtab_stats_t* st = &table->stats;
+    printf("\n  Lookups: %lu | Hits: %lu | Misses: %lu | Scopes skipped by filter: %lu, searched in vain: %lu\n",
+           st->lookups, st->hits, st->lookups - st->hits, st->bloom_rejects, st->bloom_false_positives);
+}
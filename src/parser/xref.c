@@ -0,0 +1,261 @@
+#include "xref.h"
+#include "symtab.h"
+#include "intern.h"
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+
+static void* xref_alloc(size_t size)
+{
+    void* m = calloc(1, size ? size : 1);
+    if (!m) { fprintf(stderr, "Out of memory\n"); exit(1); }
+    return m;
+}
+
+static int xref_compare_position(const void* a, const void* b)
+{
+    const xref_entry_t* x = a;
+    const xref_entry_t* y = b;
+
+    if (x->line != y->line) return x->line < y->line ? -1 : 1;
+    if (x->column != y->column) return x->column < y->column ? -1 : 1;
+    if (x->kind != y->kind) return x->kind < y->kind ? -1 : 1;
+    return 0;
+}
+
+static int xref_counts_as_unused(sym_entry_t* sym, name_id_t main_name)
+{
+    switch (sym->symbol_type)
+    {
+        case SYM_VARIABLE:
+        case SYM_CONSTANT:
+        case SYM_PARAM:
+        case SYM_ARRAY:
+            return 1;
+        case SYM_FUNCTION:
+            return sym->name != main_name;  // main is called by the runtime
+        default:
+            return 0;
+    }
+}
+
+xref_index_t* xref_build(symtab_t* table)
+{
+    if (!table) return NULL;
+
+    xref_index_t* index = xref_alloc(sizeof(xref_index_t));
+    index->table = table;
+    index->symbol_count = table->sym_count;
+
+    // one definition per symbol plus every reference
+    int capacity = (int)table->sym_count + (int)table->ref_count;
+    index->by_position = xref_alloc(sizeof(xref_entry_t) * capacity);
+    index->by_symbol = xref_alloc(sizeof(xref_entry_t) * capacity);
+    index->group_start = xref_alloc(sizeof(unsigned int) * (index->symbol_count + 1));
+
+    int n = 0;
+    for (unsigned int i = 0; i < table->sym_count; i++)
+    {
+        sym_entry_t* sym = symtab_symbol(table, i);
+        int length = (int)strlen(sym_name(sym));
+
+        // imported symbols are defined in another file
+        if (!sym->imported)
+        {
+            xref_entry_t* def = &index->by_position[n++];
+            def->line = sym->line;
+            def->column = sym->column;
+            def->length = length;
+            def->symbol = i;
+            def->kind = XREF_DEF;
+        }
+
+        reference_t ref;
+        for (int more = symtab_first_reference(table, sym, &ref); more;
+             more = symtab_next_reference(table, &ref))
+        {
+            xref_entry_t* use = &index->by_position[n++];
+            use->line = ref.line;
+            use->column = ref.column;
+            use->length = length;
+            use->symbol = i;
+            use->kind = ref.is_write ? XREF_WRITE : XREF_READ;
+        }
+    }
+    index->count = n;
+
+    qsort(index->by_position, n, sizeof(xref_entry_t), xref_compare_position);
+
+    // counting sort by symbol, stable so groups keep source order
+    unsigned int* reads = xref_alloc(sizeof(unsigned int) * (index->symbol_count + 1));
+    for (int i = 0; i < n; i++)
+    {
+        index->group_start[index->by_position[i].symbol + 1]++;
+        if (index->by_position[i].kind == XREF_READ)
+            reads[index->by_position[i].symbol]++;
+    }
+    for (unsigned int i = 0; i < index->symbol_count; i++)
+        index->group_start[i + 1] += index->group_start[i];
+
+    unsigned int* fill = xref_alloc(sizeof(unsigned int) * (index->symbol_count + 1));
+    memcpy(fill, index->group_start, sizeof(unsigned int) * (index->symbol_count + 1));
+    for (int i = 0; i < n; i++)
+        index->by_symbol[fill[index->by_position[i].symbol]++] = index->by_position[i];
+    free(fill);
+
+    // definitions sort first within a group, since they come first in the
+    // source. Forward references (see parse order) can precede them, so
+    // move the definition to the front explicitly.
+    for (unsigned int i = 0; i < index->symbol_count; i++)
+    {
+        for (unsigned int j = index->group_start[i]; j < index->group_start[i + 1]; j++)
+        {
+            if (index->by_symbol[j].kind != XREF_DEF) continue;
+
+            xref_entry_t def = index->by_symbol[j];
+            memmove(&index->by_symbol[index->group_start[i] + 1],
+                    &index->by_symbol[index->group_start[i]],
+                    sizeof(xref_entry_t) * (j - index->group_start[i]));
+            index->by_symbol[index->group_start[i]] = def;
+            break;
+        }
+    }
+
+    index->unused = xref_alloc(sizeof(unsigned int) * (index->symbol_count + 1));
+    name_id_t main_name = intern_find("main");
+    for (unsigned int i = 0; i < index->symbol_count; i++)
+    {
+        sym_entry_t* sym = symtab_symbol(table, i);
+        if (reads[i] == 0 && !sym->imported && xref_counts_as_unused(sym, main_name))
+            index->unused[index->unused_count++] = i;
+    }
+    free(reads);
+
+    return index;
+}
+
+void xref_destroy(xref_index_t* index)
+{
+    if (!index) return;
+
+    free(index->by_position);
+    free(index->by_symbol);
+    free(index->group_start);
+    free(index->unused);
+    free(index);
+}
+
+const xref_entry_t* xref_at(xref_index_t* index, int line, int column)
+{
+    if (!index || index->count == 0) return NULL;
+
+    // last span starting at or before line:column
+    int lo = 0, hi = index->count - 1, found = -1;
+    while (lo <= hi)
+    {
+        int mid = lo + (hi - lo) / 2;
+        const xref_entry_t* e = &index->by_position[mid];
+
+        if (e->line < line || (e->line == line && e->column <= column))
+        {
+            found = mid;
+            lo = mid + 1;
+        }
+        else
+        {
+            hi = mid - 1;
+        }
+    }
+
+    if (found < 0) return NULL;
+
+    const xref_entry_t* e = &index->by_position[found];
+    if (e->line != line || column >= e->column + e->length) return NULL;
+    return e;
+}
+
+sym_entry_t* xref_symbol_at(xref_index_t* index, int line, int column)
+{
+    const xref_entry_t* e = xref_at(index, line, column);
+    return e ? symtab_symbol(index->table, e->symbol) : NULL;
+}
+
+const xref_entry_t* xref_references(xref_index_t* index, sym_entry_t* symbol, int* count)
+{
+    if (!index || !symbol || symbol->index >= index->symbol_count)
+    {
+        if (count) *count = 0;
+        return NULL;
+    }
+
+    unsigned int start = index->group_start[symbol->index];
+    if (count) *count = (int)(index->group_start[symbol->index + 1] - start);
+    return &index->by_symbol[start];
+}
+
+const xref_entry_t* xref_definition(xref_index_t* index, sym_entry_t* symbol)
+{
+    int count = 0;
+    const xref_entry_t* refs = xref_references(index, symbol, &count);
+    if (count == 0 || refs[0].kind != XREF_DEF) return NULL;
+    return refs;
+}
+
+const unsigned int* xref_unused(xref_index_t* index, int* count)
+{
+    if (count) *count = index ? index->unused_count : 0;
+    return index ? index->unused : NULL;
+}
+
+int xref_is_unused(xref_index_t* index, sym_entry_t* symbol)
+{
+    if (!index || !symbol) return 0;
+
+    int lo = 0, hi = index->unused_count - 1;
+    while (lo <= hi)
+    {
+        int mid = lo + (hi - lo) / 2;
+        if (index->unused[mid] == symbol->index) return 1;
+        if (index->unused[mid] < symbol->index) lo = mid + 1;
+        else hi = mid - 1;
+    }
+    return 0;
+}
+
+static const char* xref_kind_to_string(xref_kind_t kind)
+{
+    switch (kind) {
+        case XREF_DEF:   return "def";
+        case XREF_READ:  return "read";
+        case XREF_WRITE: return "write";
+        default:         return "???";
+    }
+}
+
+void xref_print(xref_index_t* index)
+{
+    if (!index) return;
+
+    printf("\n-------- Cross References ----------\n");
+    for (unsigned int i = 0; i < index->symbol_count; i++)
+    {
+        sym_entry_t* sym = symtab_symbol(index->table, i);
+        int count = 0;
+        const xref_entry_t* refs = xref_references(index, sym, &count);
+
+        printf("  %-20s", sym_name(sym));
+        for (int j = 0; j < count; j++)
+        {
+            printf(" %d:%d(%s)", refs[j].line, refs[j].column, xref_kind_to_string(refs[j].kind));
+        }
+        printf("\n");
+    }
+
+    printf("  Unused:");
+    for (int i = 0; i < index->unused_count; i++)
+    {
+        printf(" %s", sym_name(symtab_symbol(index->table, index->unused[i])));
+    }
+    printf("\n");
+}
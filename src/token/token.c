@@ -14,6 +14,7 @@ const char *keywords[] =
     "match", 
     "import", 
     "struct", 
+    "union", 
     "variant", 
     "enum",  
     "vec",  
@@ -31,7 +32,8 @@ const char *keywords[] =
     "main",
     "let",
     "return",
-    "void"
+    "void",
+    NULL
 };
 
 int is_keyword(const char *str) 
@@ -63,6 +65,9 @@ TokenType keyword_to_token(const char *keyword)
     else if (strcmp(keyword, "int") == 0) return TYPE;
     else if (strcmp(keyword, "long") == 0) return TYPE;
     else if (strcmp(keyword, "float") == 0) return TYPE;
+    else if (strcmp(keyword, "double") == 0) return TYPE;
+    else if (strcmp(keyword, "byte") == 0) return TYPE;
+    else if (strcmp(keyword, "short") == 0) return TYPE;
     else if (strcmp(keyword, "let") == 0) return LET;
     else if (strcmp(keyword, "var") == 0) return VAR;
     else if (strcmp(keyword, "match") == 0) return MATCH;
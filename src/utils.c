@@ -357,6 +357,12 @@ void print_ast(ASTNode* node, int indent)
             }
             break;
 
+        case AST_IMPORT:
+            printf("Import: %s", node->as.import.module->lexeme);
+            print_location(node->location);
+            printf("\n");
+            break;
+
         // =================== STRUCTURAL ===================
         case AST_BLOCK:
             printf("Block (%zu statements)", node->as.block.count);
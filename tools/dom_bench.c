@@ -0,0 +1,160 @@
+// Benchmark of the CFG analyses on one large function, see dom.h and
+// loops.h. The generator walks forward from the entry and at each step
+// opens a loop, closes the innermost open one with a back edge, or adds
+// an if/else diamond, until the function has BENCH_BLOCKS blocks; the
+// same seed gives the same CFG on every run. Half the loops are entered
+// from both arms of a diamond, so their headers have two predecessors
+// outside the loop and need a preheader. Dominators with their frontiers
+// and then the loop forest are computed BENCH_RUNS times and the fastest
+// run is reported. Then preheaders are inserted, one per such loop, and
+// every loop must have one and the IR must verify. Build and run it with
+// `make bench`.
+
+#define _POSIX_C_SOURCE 199309L     // clock_gettime under -std=c99
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+#include "ir.h"
+#include "dom.h"
+#include "loops.h"
+#include "types.h"
+
+#define BENCH_BLOCKS    100000
+#define BENCH_RUNS      5
+#define BENCH_MAX_OPEN  4096        // loops open at once
+#define BENCH_SEED      12345u
+
+char* filename = "dom_bench";       // token.c reports through it
+
+static unsigned int bench_state = BENCH_SEED;
+
+// a small LCG, so the CFG does not depend on the C library
+static unsigned int bench_rand(void)
+{
+    bench_state = bench_state * 1103515245u + 12345u;
+    return (bench_state >> 16) & 0x7fff;
+}
+
+static double bench_now(void)
+{
+    struct timespec t;
+    clock_gettime(CLOCK_MONOTONIC, &t);
+    return t.tv_sec + t.tv_nsec * 1e-9;
+}
+
+// the function, and in *joined the loops entered from two blocks
+static ir_func_t* bench_function(ir_module_t* module, int blocks, int* joined)
+{
+    ir_func_t* fn = ir_func_create(module, "bench", NULL, NULL);
+    ir_block_t* cur = ir_block_create(fn);
+    ir_value_t* cond = ir_param(fn, 0, type_prim(TY_BOOL));
+
+    ir_block_t** open = malloc(sizeof(ir_block_t*) * BENCH_MAX_OPEN);
+    if (!open) { fprintf(stderr, "Out of memory\n"); exit(1); }
+    int top = 0;
+    *joined = 0;
+
+    // room for the exits of the loops still open at the end
+    while (fn->block_count + top < blocks - 3)
+    {
+        unsigned int step = bench_rand() % 3;
+        if (step == 0 && top < BENCH_MAX_OPEN)
+        {
+            ir_block_t* header = ir_block_create(fn);
+            if (bench_rand() % 2)
+            {
+                ir_block_t* left = ir_block_create(fn);
+                ir_block_t* right = ir_block_create(fn);
+                ir_branch(cur, cond, left, right);
+                ir_jump(left, header);
+                ir_jump(right, header);
+                (*joined)++;
+            }
+            else
+            {
+                ir_jump(cur, header);
+            }
+            open[top++] = header;
+            cur = header;
+        }
+        else if (step == 1 && top > 0)
+        {
+            ir_block_t* exit = ir_block_create(fn);
+            ir_branch(cur, cond, open[--top], exit);
+            cur = exit;
+        }
+        else
+        {
+            ir_block_t* left = ir_block_create(fn);
+            ir_block_t* right = ir_block_create(fn);
+            ir_block_t* join = ir_block_create(fn);
+            ir_branch(cur, cond, left, right);
+            ir_jump(left, join);
+            ir_jump(right, join);
+            cur = join;
+        }
+    }
+    while (top > 0)
+    {
+        ir_block_t* exit = ir_block_create(fn);
+        ir_branch(cur, cond, open[--top], exit);
+        cur = exit;
+    }
+    ir_return(cur, NULL);
+
+    free(open);
+    return fn;
+}
+
+int main(void)
+{
+    ir_module_t* module = ir_module_create();
+    int joined;
+    ir_func_t* fn = bench_function(module, BENCH_BLOCKS, &joined);
+
+    double best_dom = 0, best_loops = 0;
+    long front = 0;
+    int loop_count = 0, depth = 0;
+    for (int run = 0; run < BENCH_RUNS; run++)
+    {
+        double t0 = bench_now();
+        dom_t* dom = dom_compute(fn);
+        double t1 = bench_now();
+        loops_t* loops = loops_compute(fn, dom);
+        double t2 = bench_now();
+
+        if (run == 0 || t1 - t0 < best_dom) best_dom = t1 - t0;
+        if (run == 0 || t2 - t1 < best_loops) best_loops = t2 - t1;
+
+        front = dom->front_start[dom->block_count];
+        loop_count = loops->loop_count;
+        for (int i = 0; i < loops->loop_count; i++)
+            if (loops->loops[i]->depth > depth) depth = loops->loops[i]->depth;
+
+        loops_destroy(loops);
+        dom_destroy(dom);
+    }
+
+    printf("dom_bench: %d blocks, %ld frontier entries, %d loops, depth %d\n",
+           fn->block_count, front, loop_count, depth);
+    printf("dom_bench: dominators and frontiers %.3f ms, loops %.3f ms (best of %d)\n",
+           best_dom * 1e3, best_loops * 1e3, BENCH_RUNS);
+
+    double t0 = bench_now();
+    int inserted = loops_insert_preheaders(fn);
+    double t1 = bench_now();
+
+    const loops_t* after = loops_get(fn);
+    int missing = 0;
+    for (int i = 0; i < after->loop_count; i++)
+        if (!after->loops[i]->preheader) missing++;
+    int broken = ir_verify(module);
+
+    printf("dom_bench: %d preheader(s) in %.3f ms, %d expected, %d loop(s) without one, %d IR problem(s)\n",
+           inserted, (t1 - t0) * 1e3, joined, missing, broken);
+
+    ir_module_destroy(module);
+    return inserted != joined || missing != 0 || broken != 0;
+}
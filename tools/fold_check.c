@@ -0,0 +1,85 @@
+// Checks the constants folded in test/test8.pn, see fold.h and ctfe.h.
+// The sample's main binds the results of loops over ranges to lets, and
+// after the analysis each must be the literal below: ranges include their
+// end, so factorial(5) is 120 and fibonacci(10) is 55. Build and run it
+// with `make check`.
+
+#include <stdio.h>
+#include <string.h>
+
+#include "lexer.h"
+#include "token.h"
+#include "parser.h"
+#include "ast.h"
+#include "analysis.h"
+
+#define CHECK_FILE  "test/test8.pn"
+
+char* filename = "test8.pn";        // token.c reports through it
+
+typedef struct
+{
+    const char* name;
+    const char* value;
+} check_t;
+
+static const check_t checks[] = {
+    { "fact", "120" },      // factorial(5), 2...5
+    { "fib",  "55" },       // fibonacci(10), 2...10
+    { "down", "22" },       // 10...0...-3 is 10, 7, 4, 1
+};
+
+static ASTNode* check_find(ASTNode* block, const char* name)
+{
+    for (size_t i = 0; block && i < block->as.block.count; i++)
+    {
+        ASTNode* s = block->as.block.statements[i];
+        if (s->type == AST_CONST_DECL && strcmp(s->as.declaration.ident->as.ident.name, name) == 0)
+            return s->as.declaration.value;
+    }
+    return NULL;
+}
+
+int main(void)
+{
+    Lexer* lex = lexer_init(CHECK_FILE);
+    if (!lex)
+    {
+        fprintf(stderr, "fold_check: cannot read %s\n", CHECK_FILE);
+        return 1;
+    }
+    init_global_array();
+    lexer(lex);
+
+    Parser* parser = init_parser(global_array->tokens, global_array->token_count);
+    ASTNode* root = parse_program(parser);
+    if (!root || start_analysis(root, parser->symtab, 0, NULL, NULL) != 0)
+    {
+        fprintf(stderr, "fold_check: %s does not compile\n", CHECK_FILE);
+        return 1;
+    }
+
+    ASTNode* body = NULL;
+    for (int i = 0; i < root->as.program.stmt_count; i++)
+    {
+        ASTNode* s = root->as.program.statements[i];
+        if (s->type == AST_FN_DECL && strcmp(s->as.func.ident->as.ident.name, "main") == 0)
+            body = s->as.func.block;
+    }
+
+    int wrong = 0;
+    int count = sizeof(checks) / sizeof(checks[0]);
+    for (int i = 0; i < count; i++)
+    {
+        ASTNode* v = check_find(body, checks[i].name);
+        const char* got = v && v->type == AST_LITERAL ? v->as.literal.value : "not folded";
+        if (strcmp(got, checks[i].value) != 0)
+        {
+            fprintf(stderr, "fold_check: %s is %s, expected %s\n", checks[i].name, got, checks[i].value);
+            wrong++;
+        }
+    }
+
+    printf("fold_check: %d constant(s), %d wrong\n", count, wrong);
+    return wrong != 0;
+}
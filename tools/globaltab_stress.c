@@ -0,0 +1,160 @@
+// Concurrent stress test of the frozen global table, see globaltab.h.
+// Readers start before the global scope is frozen and wait for the table
+// to be published, then each drives its own local_scopes_t: scopes nested
+// past MAX_DEPTH, locals that shadow globals, names interned while the
+// other threads intern and look up theirs. Every lookup is checked against
+// the symbol it must find. Build and run it with `make tsan`, which puts
+// ThreadSanitizer over the same code.
+
+#define _POSIX_C_SOURCE 200809L     // sched_yield under -std=c99
+
+#include <pthread.h>
+#include <sched.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "globaltab.h"
+#include "symtab.h"
+#include "intern.h"
+
+#define STRESS_THREADS  8
+#define STRESS_GLOBALS  2000
+#define STRESS_ROUNDS   200
+#define STRESS_DEPTH    (MAX_DEPTH + 36)    // past the parser's stack
+
+char* filename = "globaltab_stress";     // token.c reports through it
+
+typedef struct
+{
+    symtab_t* table;
+    int id;
+    long lookups;
+    long mismatches;
+} stress_thread_t;
+
+static sym_entry_t* stress_global(symtab_t* table, int i)
+{
+    return table->global_scope->symbols[i];
+}
+
+static void stress_expect(stress_thread_t* t, local_scopes_t* scopes, name_id_t name, const sym_entry_t* expected)
+{
+    t->lookups++;
+    if (local_scopes_lookup(scopes, name) != expected) t->mismatches++;
+}
+
+static void* stress_worker(void* arg)
+{
+    stress_thread_t* t = arg;
+
+    // spin until the freeze publishes the table
+    const globaltab_t* globals;
+    while ((globals = symtab_globals(t->table)) == NULL) sched_yield();
+
+    // this thread's locals: one of its own at each level, and at every
+    // third level one that shadows a global
+    sym_entry_t* own = calloc(STRESS_DEPTH, sizeof(sym_entry_t));
+    sym_entry_t* shadows = calloc(STRESS_DEPTH, sizeof(sym_entry_t));
+    if (!own || !shadows) { fprintf(stderr, "Out of memory\n"); exit(1); }
+
+    char name[64];
+    for (int round = 0; round < STRESS_ROUNDS; round++)
+    {
+        local_scopes_t scopes;
+        local_scopes_init(&scopes, globals);
+
+        for (int d = 0; d < STRESS_DEPTH; d++)
+        {
+            local_scopes_enter(&scopes);
+
+            // interned again every round, racing the other threads
+            snprintf(name, sizeof(name), "t%d_d%d", t->id, d);
+            own[d].name = intern(name);
+            local_scopes_bind(&scopes, &own[d]);
+
+            if (d % 3 == 0)
+            {
+                shadows[d].name = stress_global(t->table, (d * 7 + t->id) % STRESS_GLOBALS)->name;
+                local_scopes_bind(&scopes, &shadows[d]);
+            }
+
+            stress_expect(t, &scopes, own[d].name, &own[d]);
+            if (d > 0) stress_expect(t, &scopes, own[d - 1].name, &own[d - 1]);
+
+            int g = (round * 31 + d * 17 + t->id) % STRESS_GLOBALS;
+            const sym_entry_t* expected = stress_global(t->table, g);
+            for (int s = 0; s <= d; s += 3)
+                if (shadows[s].name == expected->name) expected = &shadows[s];
+            stress_expect(t, &scopes, stress_global(t->table, g)->name, expected);
+
+            // another thread's local is never visible here
+            snprintf(name, sizeof(name), "t%d_d%d", (t->id + 1) % STRESS_THREADS, d);
+            name_id_t other = intern_find(name);
+            if (other != NAME_NONE) stress_expect(t, &scopes, other, NULL);
+        }
+
+        // on the way out each level's bindings go, and what they shadowed is back
+        for (int d = STRESS_DEPTH - 1; d >= 0; d--)
+        {
+            local_scopes_exit(&scopes);
+            stress_expect(t, &scopes, own[d].name, NULL);
+            if (d > 0) stress_expect(t, &scopes, own[d - 1].name, &own[d - 1]);
+            if (d % 3 == 0)
+            {
+                const sym_entry_t* expected = stress_global(t->table, (d * 7 + t->id) % STRESS_GLOBALS);
+                for (int s = 0; s < d; s += 3)
+                    if (shadows[s].name == expected->name) expected = &shadows[s];
+                stress_expect(t, &scopes, shadows[d].name, expected);
+            }
+        }
+        local_scopes_free(&scopes);
+    }
+
+    free(own);
+    free(shadows);
+    return NULL;
+}
+
+int main(void)
+{
+    symtab_t* table = symtab_create();
+    char name[64];
+    for (int i = 0; i < STRESS_GLOBALS; i++)
+    {
+        snprintf(name, sizeof(name), "g%d", i);
+        symtab_insert(table, sym_create(table, name, SYM_VARIABLE, TYPE_INT, i + 1));
+    }
+
+    pthread_t ids[STRESS_THREADS];
+    stress_thread_t threads[STRESS_THREADS];
+    for (int i = 0; i < STRESS_THREADS; i++)
+    {
+        threads[i] = (stress_thread_t){ .table = table, .id = i };
+        if (pthread_create(&ids[i], NULL, stress_worker, &threads[i]) != 0)
+        {
+            fprintf(stderr, "Error: could not start thread %d\n", i);
+            return 1;
+        }
+    }
+
+    // published while the readers are already polling for it
+    symtab_freeze_globals(table);
+
+    long lookups = 0, mismatches = 0;
+    for (int i = 0; i < STRESS_THREADS; i++)
+    {
+        pthread_join(ids[i], NULL);
+        lookups += threads[i].lookups;
+        mismatches += threads[i].mismatches;
+    }
+
+    // the frozen global scope turns new globals away
+    int refused = symtab_insert(table, sym_create(table, "late", SYM_VARIABLE, TYPE_INT, 0)) == NULL;
+
+    printf("globaltab_stress: %d threads, %ld lookups, %ld mismatch(es), late global %s\n",
+           STRESS_THREADS, lookups, mismatches, refused ? "refused" : "accepted");
+
+    symtab_destroy(table);
+    return mismatches != 0 || !refused;
+}
@@ -0,0 +1,179 @@
+// Checks the persistent symbol table, see psymtab.h. test/test8.pn is
+// parsed once and snapshotted, then CHECK_EDITS edits follow, each one a
+// new version: a function is replaced with its line moved, as if it were
+// edited and re-analysed, and a global is rebound. Only the last
+// CHECK_WINDOW versions and the first one are kept.
+//  - a version about to be released must still show its own edit
+//  - the edited function gets a new record, every other is shared with
+//    the previous version
+//  - the first version still matches the live table after all the edits
+//  - live objects never pass the first version plus the largest edit
+//    times CHECK_WINDOW and the function count, as the oldest version kept
+//    may share a record made up to one round of edits before it; and they
+//    drop to 0 once every version is released
+// Build and run it with `make check`.
+
+#include <stdio.h>
+#include <string.h>
+
+#include "lexer.h"
+#include "token.h"
+#include "parser.h"
+#include "symtab.h"
+#include "psymtab.h"
+#include "intern.h"
+
+#define CHECK_FILE      "test/test8.pn"
+#define CHECK_EDITS     2000
+#define CHECK_WINDOW    8
+#define CHECK_FUNCS     64
+
+char* filename = "test8.pn";        // token.c reports through it
+
+static int wrong;
+
+static void check(int ok, const char* what, int edit)
+{
+    if (ok) return;
+    fprintf(stderr, "psymtab_check: %s (edit %d)\n", what, edit);
+    wrong++;
+}
+
+// every scope of function against the frozen record, in creation order
+static int check_scopes(symtab_t* table, const psymtab_t* version, const pfunc_t* f,
+                        scope_t* scope, int* at)
+{
+    int ok = 1;
+    int index = (*at)++;
+
+    for (int i = 0; i < scope->symbol_count; i++)
+    {
+        sym_entry_t* sym = scope->symbols[i];
+        if (!sym) continue;
+
+        const sym_entry_t* got = psymtab_lookup(version, f, index, sym->name);
+        ok &= got && got->symbol_type == sym->symbol_type && got->line == sym->line;
+    }
+    for (int i = 0; i < scope->children_cnt; i++)
+        ok &= check_scopes(table, version, f, scope->children[i], at);
+    return ok;
+}
+
+// version holds what the live table held when it was parsed
+static int check_matches_table(symtab_t* table, const psymtab_t* version)
+{
+    int ok = 1;
+    scope_t* global = table->global_scope;
+
+    for (int i = 0; i < global->symbol_count; i++)
+    {
+        sym_entry_t* sym = global->symbols[i];
+        if (!sym) continue;
+
+        const sym_entry_t* got = psymtab_lookup_global(version, sym->name);
+        ok &= got && got->line == sym->line;
+        if (sym->symbol_type != SYM_FUNCTION) continue;
+
+        const pfunc_t* f = psymtab_function(version, sym->name);
+        int at = 0;
+        ok &= f && check_scopes(table, version, f, symtab_scope(table, sym->info.func.body_scope), &at);
+        ok &= at == pfunc_scope_count(f);
+    }
+    return ok;
+}
+
+int main(void)
+{
+    Lexer* lex = lexer_init(CHECK_FILE);
+    if (!lex)
+    {
+        fprintf(stderr, "psymtab_check: cannot read %s\n", CHECK_FILE);
+        return 1;
+    }
+    init_global_array();
+    lexer(lex);
+
+    Parser* parser = init_parser(global_array->tokens, global_array->token_count);
+    if (!parse_program(parser) || parser->error_count != 0)
+    {
+        fprintf(stderr, "psymtab_check: %s does not parse\n", CHECK_FILE);
+        return 1;
+    }
+    symtab_t* table = parser->symtab;
+
+    sym_entry_t* funcs[CHECK_FUNCS];
+    int func_count = 0;
+    scope_t* global = table->global_scope;
+    for (int i = 0; i < global->symbol_count && func_count < CHECK_FUNCS; i++)
+        if (global->symbols[i] && global->symbols[i]->symbol_type == SYM_FUNCTION)
+            funcs[func_count++] = global->symbols[i];
+
+    if (func_count == 0)
+    {
+        fprintf(stderr, "psymtab_check: no functions in %s\n", CHECK_FILE);
+        return 1;
+    }
+
+    psymtab_t* first = psymtab_from_symtab(table);
+    check(psymtab_function_count(first) == func_count, "functions missing", 0);
+    check(check_matches_table(table, first), "first version differs from the table", 0);
+    long base = psymtab_live_objects();
+
+    sym_entry_t edited_global;
+    memset(&edited_global, 0, sizeof(edited_global));
+    edited_global.name = intern("edited_global");
+    edited_global.symbol_type = SYM_VARIABLE;
+    edited_global.type = TYPE_INT;
+
+    psymtab_t* window[CHECK_WINDOW] = {0};
+    psymtab_t* prev = first;
+    long peak = base, max_edit = 0;
+
+    for (int edit = 1; edit <= CHECK_EDITS; edit++)
+    {
+        psymtab_t** slot = &window[edit % CHECK_WINDOW];
+        if (*slot)
+        {
+            // the version of edit - CHECK_WINDOW, untouched by every edit since
+            int old = edit - CHECK_WINDOW;
+            sym_entry_t* f = funcs[old % func_count];
+            const sym_entry_t* got = psymtab_lookup_global(*slot, f->name);
+            check(got && got->line == old, "old version lost its function edit", old);
+            got = psymtab_lookup_global(*slot, edited_global.name);
+            check(got && got->line == old, "old version lost its global edit", old);
+            psymtab_release(*slot);
+            *slot = NULL;
+        }
+
+        long before = psymtab_live_objects();
+
+        sym_entry_t moved = *funcs[edit % func_count];
+        moved.line = edit;
+        psymtab_t* with_func = psymtab_set_function(prev, table, &moved);
+        edited_global.line = edit;
+        psymtab_t* next = psymtab_set_global(with_func, &edited_global);
+        psymtab_release(with_func);
+
+        if (psymtab_live_objects() - before > max_edit) max_edit = psymtab_live_objects() - before;
+        if (psymtab_live_objects() > peak) peak = psymtab_live_objects();
+
+        for (int i = 0; i < func_count; i++)
+        {
+            int same = psymtab_function(prev, funcs[i]->name) == psymtab_function(next, funcs[i]->name);
+            check(same == (i != edit % func_count), "function records not shared", edit);
+        }
+        *slot = prev = next;
+    }
+
+    check(check_matches_table(table, first), "first version changed by later edits", CHECK_EDITS);
+    check(peak <= base + (CHECK_WINDOW + func_count) * max_edit, "live objects grow with the edits", CHECK_EDITS);
+
+    for (int i = 0; i < CHECK_WINDOW; i++)
+        psymtab_release(window[i]);
+    psymtab_release(first);
+    check(psymtab_live_objects() == 0, "objects left after the last release", CHECK_EDITS);
+
+    printf("psymtab_check: %d edits over %d functions, %ld objects at most (%ld in the first version, %ld per edit), %d wrong\n",
+           CHECK_EDITS, func_count, peak, base, max_edit, wrong);
+    return wrong != 0;
+}